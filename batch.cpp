@@ -0,0 +1,686 @@
+/*
+ * @author Jakub Šuráň (xsuran07)
+ * @file batch.cpp
+ * @brief Implementation of class representing non-interactive batch mode.
+ */
+
+#include <iostream>
+#include <fstream>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/stat.h>
+
+#include "batch.h"
+#include "tftp_client.h"
+#include "tftp_daemon.h"
+#include "tftp_cache.h"
+#include "tftp_sync.h"
+#include "tftp_flight.h"
+#include "tftp_rate.h"
+#include "tftp_watch.h"
+#include "tftp_prefetch.h"
+#include "tftp_unpack.h"
+#include "tftp_server.h"
+
+// PUBLIC INSTANCE METHODS
+
+// constructor
+Batch::Batch()
+{
+    this->concurrency = 0;
+    this->verbose = false;
+    this->cache_size = CACHE_BUDGET;
+    this->data_stdout = false;
+    this->data_stdin = false;
+    this->dedup = true;
+    this->dedup_window = FLIGHT_SPOOL_LIMIT;
+    this->rate = 0;
+    this->debounce = WATCH_DEBOUNCE;
+    this->bytes = 0;
+    this->listen = "0.0.0.0";
+    this->memory = SERVER_CACHE_BUDGET;
+    this->relay = false;
+    this->writable = false;
+}
+
+int Batch::run(int argc, char **argv)
+{
+    if(!parse_args(argc, argv)) {
+        print_usage();
+        return EXIT_USAGE;
+    }
+
+    // standard output is reserved for results
+    Tftp_client::set_log_stream((this->verbose)? &std::cerr : nullptr);
+
+    if(!this->cache.empty() && !Tftp_cache::instance().configure(this->cache, this->cache_size)) {
+        return EXIT_USAGE;
+    }
+
+    if(!this->sync.empty() && !Tftp_sync::instance().configure(this->sync)) {
+        return EXIT_USAGE;
+    }
+
+    // concurrent downloads of the same file share one transfer
+    Tftp_flight::set_enabled(this->dedup);
+    Tftp_flight::set_spool_limit(this->dedup_window);
+    Tftp_rate::global().set_rate(this->rate);
+
+    // jobs parsed from now on use default interface and local address
+    if(!Tftp_parameters::set_default_binding(this->device, this->source)) {
+        return EXIT_USAGE;
+    }
+
+    // relay downloads missing files by template request
+    if(!this->root.empty()) {
+        return (!this->relay || collect_jobs())? run_server() : EXIT_USAGE;
+    }
+
+    if(!this->serve.empty()) {
+        Tftp_daemon daemon(this->serve);
+
+        return (daemon.run())? EXIT_OK : EXIT_USAGE;
+    }
+
+    if(!collect_jobs()) {
+        return EXIT_USAGE;
+    }
+
+    if(!this->watch.empty()) {
+        return run_watch();
+    }
+
+    if(!this->manifests.empty() || !this->configs.empty()) {
+        return run_prefetch();
+    }
+
+    return (this->remote.empty())? run_local() : run_remote();
+}
+
+// PRIVATE INSTANCE METHODS
+
+bool Batch::parse_args(int argc, char **argv)
+{
+    for(int i = 1; i < argc; i++) {
+        std::string_view arg(argv[i]);
+
+        if(arg == "--jobs" || arg == "--concurrency" || arg == "--daemon" || arg == "--submit" ||
+            arg == "--cache" || arg == "--cache-size" || arg == "--sync-manifest" || arg == "--rate-limit" ||
+            arg == "--interface" || arg == "--source" || arg == "--watch" || arg == "--debounce" ||
+            arg == "--prefetch" || arg == "--boot-config" || arg == "--server" || arg == "--listen" ||
+            arg == "--server-cache" || arg == "--relay" || arg == "--dedup-window") {
+            if(i + 1 == argc) {
+                std::cerr << "Option " << arg << " requires argument!" << std::endl;
+                return false;
+            }
+
+            i++;
+            if(arg == "--jobs") {
+                this->jobs = argv[i];
+            } else if(arg == "--daemon") {
+                this->serve = argv[i];
+            } else if(arg == "--submit") {
+                this->remote = argv[i];
+            } else if(arg == "--cache") {
+                this->cache = argv[i];
+            } else if(arg == "--sync-manifest") {
+                this->sync = argv[i];
+            } else if(arg == "--interface") {
+                this->device = argv[i];
+            } else if(arg == "--source") {
+                this->source = argv[i];
+            } else if(arg == "--watch") {
+                std::string dir(argv[i]);
+
+                // relative paths of files are derived from directory
+                while(dir.size() > 1 && dir.back() == '/') {
+                    dir.pop_back();
+                }
+
+                this->watch.push_back(dir);
+            } else if(arg == "--server" || arg == "--relay") {
+                this->root = argv[i];
+                this->relay = (arg == "--relay");
+            } else if(arg == "--listen") {
+                this->listen = argv[i];
+            } else if(arg == "--server-cache") {
+                if(!Tftp_parameters::parse_size(argv[i], this->memory)) {
+                    std::cerr << "Invalid size of memory cache of server!" << std::endl;
+                    return false;
+                }
+            } else if(arg == "--prefetch") {
+                this->manifests.push_back(argv[i]);
+            } else if(arg == "--boot-config") {
+                this->configs.push_back(argv[i]);
+            } else if(arg == "--debounce") {
+                uint64_t n;
+
+                // 0 uploads changed file without waiting
+                if(!Tftp_parameters::parse_number(argv[i], n) || n > INT32_MAX) {
+                    std::cerr << "Debounce has to be number of milliseconds!" << std::endl;
+                    return false;
+                }
+
+                this->debounce = n;
+            } else if(arg == "--dedup-window") {
+                if(!Tftp_parameters::parse_size(argv[i], this->dedup_window)) {
+                    std::cerr << "Invalid size of deduplication window!" << std::endl;
+                    return false;
+                }
+            } else if(arg == "--cache-size") {
+                if(!Tftp_parameters::parse_size(argv[i], this->cache_size)) {
+                    std::cerr << "Invalid size of cache!" << std::endl;
+                    return false;
+                }
+            } else if(arg == "--rate-limit") {
+                if(!Tftp_parameters::parse_size(argv[i], this->rate) || this->rate == 0) {
+                    std::cerr << "Invalid rate limit!" << std::endl;
+                    return false;
+                }
+            } else {
+                int n = Tftp_parameters::convert_to_number(argv[i], "--concurrency");
+
+                if(n <= 0) {
+                    std::cerr << "Concurrency has to be positive number!" << std::endl;
+                    return false;
+                }
+
+                this->concurrency = n;
+            }
+        } else if(arg == "--verbose") {
+            this->verbose = true;
+        } else if(arg == "--no-dedup") {
+            this->dedup = false;
+        } else if(arg == "--allow-write") {
+            this->writable = true;
+        } else if(arg == "--help") {
+            return false;
+        } else {
+            this->transfer.push_back(arg);
+        }
+    }
+
+    // jobs run by daemon use its cache and manifest
+    if((!this->cache.empty() || !this->sync.empty()) && !this->remote.empty()) {
+        std::cerr << "Cache and sync manifest cannot be combined with submitting to daemon!" << std::endl;
+        return false;
+    }
+
+    // server is driven by requests of its clients
+    if(!this->root.empty()) {
+        if(!this->jobs.empty() || this->transfer.empty() == this->relay || !this->remote.empty() || !this->serve.empty() ||
+            !this->watch.empty() || !this->manifests.empty() || !this->configs.empty()) {
+            std::cerr << "Server cannot be combined with transfers (relay needs template download), daemon or other modes!"
+                << std::endl;
+            return false;
+        }
+
+        return true;
+    }
+
+    // daemon gets jobs from its clients
+    if(!this->serve.empty()) {
+        if(!this->jobs.empty() || !this->transfer.empty() || !this->remote.empty()) {
+            std::cerr << "Daemon cannot be combined with transfers!" << std::endl;
+            return false;
+        }
+
+        return true;
+    }
+
+    // uploads are started by changes of files
+    if(!this->watch.empty() && (!this->jobs.empty() || !this->remote.empty() || this->transfer.empty())) {
+        std::cerr << "Watch mode needs template upload given by arguments (without job file and daemon)!" << std::endl;
+        return false;
+    }
+
+    // downloads are given by manifests and boot configurations
+    if((!this->manifests.empty() || !this->configs.empty()) &&
+        (!this->jobs.empty() || !this->remote.empty() || !this->watch.empty() || this->transfer.empty())) {
+        std::cerr << "Prefetch needs template download given by arguments (without job file, daemon and watch mode)!" << std::endl;
+        return false;
+    }
+
+    // transfer is specified either by arguments or by job file
+    if(this->jobs.empty() == this->transfer.empty()) {
+        std::cerr << "Transfer has to be specified either by arguments or by job file!" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+bool Batch::collect_jobs()
+{
+    if(this->jobs.empty()) {
+        std::string line;
+
+        for(auto arg : this->transfer) {
+            line += (line.empty())? "" : " ";
+            line += arg;
+        }
+
+        return add_job(line);
+    }
+
+    if(this->jobs == "-") {
+        if(!load_jobs(std::cin)) {
+            return false;
+        }
+
+        // standard input has already been consumed by job file
+        if(this->data_stdin) {
+            std::cerr << "Standard input cannot be used both for jobs and data!" << std::endl;
+            return false;
+        }
+
+        return true;
+    }
+
+    std::ifstream in(this->jobs);
+
+    if(!in.is_open()) {
+        std::cerr << "Cannot open job file " << this->jobs << "!" << std::endl;
+        return false;
+    }
+
+    return load_jobs(in);
+}
+
+bool Batch::add_job(const std::string &line)
+{
+    this->p.set_options(line);
+    if(this->p.parse_command() != Parser::TFTP) {
+        return false;
+    }
+
+    // data of more jobs would be mixed together
+    if(this->p.get_params()->is_stdio()) {
+        bool &used = (this->p.get_params()->get_req_type() == Tftp_parameters::READ)?
+            this->data_stdout : this->data_stdin;
+
+        if(used) {
+            std::cerr << "Standard output/input can be used only by one job!" << std::endl;
+            return false;
+        }
+
+        used = true;
+    }
+
+    this->lines.push_back(line);
+    this->params.push_back(*this->p.get_params());
+    return true;
+}
+
+bool Batch::load_jobs(std::istream &in)
+{
+    std::string line;
+    size_t line_num = 0;
+
+    while(std::getline(in, line)) {
+        size_t start = line.find_first_not_of(" \t\r");
+
+        line_num++;
+
+        // skip empty lines and comments
+        if(start == std::string::npos || line[start] == '#') {
+            continue;
+        }
+
+        if(!add_job(line)) {
+            std::cerr << "Invalid job on line " << line_num << "!" << std::endl;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+int Batch::run_local()
+{
+    Tftp_executor executor;
+
+    // limit is spread among workers, there is no reason to use more threads than allowed transfers
+    if(this->concurrency > 0) {
+        executor.set_concurrency(this->concurrency);
+    }
+
+    for(auto &params : this->params) {
+        executor.submit(params);
+    }
+
+    // standard output may be occupied by downloaded data
+    std::ostream &out = (this->data_stdout)? std::cerr : std::cout;
+
+    // results are reported one by one in order of submission
+    executor.set_report([this, &out](const Tftp_executor::result_t &result) {
+        this->bytes += result.bytes;
+        print_result(result, out);
+    });
+
+    int ret = (executor.run() == 0)? EXIT_OK : EXIT_TRANSFER;
+
+    // summary goes with log, results stay machine-readable
+    if(Tftp_cache::instance().is_enabled()) {
+        std::lock_guard<std::mutex> guard(Tftp_client::get_output_lock());
+
+        Tftp_cache::instance().print_stats(std::cerr);
+    }
+
+    return ret;
+}
+
+int Batch::run_watch()
+{
+    const Tftp_parameters &tmpl = this->params.front();
+
+    // local path of every upload is given by changed file
+    if(tmpl.get_req_type() != Tftp_parameters::WRITE || this->data_stdin) {
+        std::cerr << "Template of watch mode has to be upload (-W) of local files!" << std::endl;
+        return EXIT_USAGE;
+    }
+
+    Tftp_watch watch(this->watch, tmpl, this->concurrency, this->debounce);
+
+    watch.set_report([](const Tftp_executor::result_t &result) {
+        print_result(result, std::cout);
+    });
+
+    if(!watch.run()) {
+        return EXIT_USAGE;
+    }
+
+    return (watch.get_failed() == 0)? EXIT_OK : EXIT_TRANSFER;
+}
+
+int Batch::run_prefetch()
+{
+    const Tftp_parameters tmpl = this->params.front();
+    Tftp_prefetch prefetch;
+
+    // remote and local path of every download is given by listed file
+    if(tmpl.get_req_type() != Tftp_parameters::READ || tmpl.is_stdio()) {
+        std::cerr << "Template of prefetch has to be download (-R) into local files!" << std::endl;
+        return EXIT_USAGE;
+    }
+
+    for(auto &manifest : this->manifests) {
+        if(!prefetch.load_manifest(manifest)) {
+            return EXIT_USAGE;
+        }
+    }
+
+    for(auto &config : this->configs) {
+        if(!prefetch.load_config(config)) {
+            return EXIT_USAGE;
+        }
+    }
+
+    this->params.clear();
+    if(prefetch.size() == 0 || !prefetch.make_jobs(tmpl, this->params)) {
+        std::cerr << "There are no files to prefetch!" << std::endl;
+        return EXIT_USAGE;
+    }
+
+    int64_t started = Tftp_client::now_ms();
+    int ret = run_local();
+
+    // boot set is staged once the last file is complete
+    std::lock_guard<std::mutex> guard(Tftp_client::get_output_lock());
+
+    std::cerr << "prefetch files=" << this->params.size() << " bytes=" << this->bytes << " time_ms="
+        << Tftp_client::now_ms() - started << " status=" << ((ret == EXIT_OK)? "ok" : "failed") << std::endl;
+    return ret;
+}
+
+int Batch::run_server()
+{
+    struct sockaddr_storage addr;
+    socklen_t addr_len;
+    struct stat st;
+
+    if(!Tftp_server::parse_listen(this->listen, addr, addr_len)) {
+        std::cerr << "Invalid address to listen on (HINT address[,port])!" << std::endl;
+        return EXIT_USAGE;
+    }
+
+    if(stat(this->root.c_str(), &st) == -1 || !S_ISDIR(st.st_mode)) {
+        std::cerr << "Served directory " << this->root << " doesn't exist!" << std::endl;
+        return EXIT_USAGE;
+    }
+
+    Tftp_server server(this->root, addr, addr_len, this->memory);
+
+    if(this->relay) {
+        const Tftp_parameters &tmpl = this->params.front();
+
+        // missing files are downloaded into served directory
+        if(tmpl.get_req_type() != Tftp_parameters::READ || tmpl.is_stdio()) {
+            std::cerr << "Template of relay has to be download (-R) from upstream server!" << std::endl;
+            return EXIT_USAGE;
+        }
+
+        server.set_upstream(tmpl);
+    }
+
+    server.set_log((this->verbose)? &std::cerr : nullptr);
+    server.set_writable(this->writable);
+
+    if(!server.run()) {
+        return EXIT_USAGE;
+    }
+
+    server.print_stats(std::cerr);
+    return EXIT_OK;
+}
+
+int Batch::run_remote()
+{
+    struct sockaddr_un addr;
+    std::string request;
+    std::string buf;
+    size_t results = 0;
+    size_t failed = 0;
+    char chunk[4096];
+    ssize_t n;
+    int fd;
+
+    // daemon has its own standard input/output
+    if(this->data_stdout || this->data_stdin) {
+        std::cerr << "Standard output/input cannot be used by jobs run by daemon!" << std::endl;
+        return EXIT_USAGE;
+    }
+
+    if(this->remote.size() >= sizeof(addr.sun_path)) {
+        std::cerr << "Path of socket is too long!" << std::endl;
+        return EXIT_USAGE;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    memcpy(addr.sun_path, this->remote.c_str(), this->remote.size());
+
+    if((fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)) == -1) {
+        std::cerr << "socket() failed!" << std::endl;
+        return EXIT_USAGE;
+    }
+
+    if(connect(fd, (struct sockaddr *) &addr, sizeof(addr)) == -1) {
+        std::cerr << "Cannot connect to daemon - " << strerror(errno) << "!" << std::endl;
+        close(fd);
+        return EXIT_USAGE;
+    }
+
+    // daemon resolves relative paths against its own directory
+    if(getcwd(chunk, sizeof(chunk)) == nullptr) {
+        std::cerr << "getcwd() failed!" << std::endl;
+        close(fd);
+        return EXIT_USAGE;
+    }
+
+    std::string cwd(chunk);
+
+    // request lines are split by whitespace
+    if(cwd.find_first_of(" \t\r\n\v\f") != std::string::npos) {
+        std::cerr << "Jobs cannot be submitted from directory whose path contains whitespace!" << std::endl;
+        close(fd);
+        return EXIT_USAGE;
+    }
+
+    // all jobs at once, daemon closes connection after the last result
+    for(size_t i = 0; i < this->lines.size(); i++) {
+        request += absolute_job(this->lines[i], this->params[i], cwd) + "\n";
+    }
+    request += "quit\n";
+
+    for(size_t sent = 0; sent < request.size(); sent += n) {
+        if((n = send(fd, request.data() + sent, request.size() - sent, MSG_NOSIGNAL)) == -1) {
+            std::cerr << "send() failed!" << std::endl;
+            close(fd);
+            return EXIT_USAGE;
+        }
+    }
+
+    while((n = recv(fd, chunk, sizeof(chunk), 0)) > 0) {
+        size_t pos;
+
+        buf.append(chunk, n);
+
+        while((pos = buf.find('\n')) != std::string::npos) {
+            std::string_view line(buf.data(), pos);
+
+            // results are printed in the same format as in local run
+            if(line.substr(0, 7) == "result ") {
+                std::lock_guard<std::mutex> guard(Tftp_client::get_output_lock());
+
+                std::cout << line.substr(7) << std::endl;
+                failed += line.find(" status=ok ") == std::string_view::npos;
+                results++;
+            } else if(this->verbose || line.substr(0, 8) == "invalid ") {
+                std::cerr << line << std::endl;
+            }
+
+            buf.erase(0, pos + 1);
+        }
+    }
+
+    close(fd);
+
+    // daemon has ended before all results have been sent
+    if(results < this->lines.size()) {
+        std::cerr << "Daemon didn't report results of all jobs!" << std::endl;
+        return EXIT_TRANSFER;
+    }
+
+    return (failed == 0)? EXIT_OK : EXIT_TRANSFER;
+}
+
+// STATIC METHODS
+
+void Batch::print_result(const Tftp_executor::result_t &result, std::ostream &out)
+{
+    std::lock_guard<std::mutex> guard(Tftp_client::get_output_lock());
+
+    out << Tftp_executor::format_result(result) << std::endl;
+}
+
+std::string Batch::absolute_job(const std::string &line, const Tftp_parameters &params, const std::string &cwd)
+{
+    std::string res;
+    std::string_view prev;
+    size_t i = 0;
+    bool local = false;
+
+    // tokens are separated the same way as by parser
+    while(true) {
+        while(i < line.size() && std::isspace(static_cast<unsigned char> (line[i]))) {
+            i++;
+        }
+
+        if(i == line.size()) {
+            break;
+        }
+
+        size_t start = i;
+
+        while(i < line.size() && !std::isspace(static_cast<unsigned char> (line[i]))) {
+            i++;
+        }
+
+        std::string_view token(line.data() + start, i - start);
+
+        if(!res.empty()) {
+            res.push_back(' ');
+        }
+
+        // "-" is standard input/output
+        if((prev == "-l" || prev == "-M") && token != "-" && token.front() != '/') {
+            res += Tftp_parameters::join_path(cwd, token);
+        } else {
+            res += token;
+        }
+
+        local = local || prev == "-l";
+        prev = token;
+    }
+
+    // local file named after remote one (or current directory for extracted archive)
+    if(!local) {
+        std::vector<std::string_view> parts;
+
+        Tftp_parameters::split_string(params.get_filename(), '/', parts);
+        res += " -l " + Tftp_parameters::join_path(cwd, (params.get_req_type() == Tftp_parameters::READ &&
+            params.get_unpack() != Tftp_parameters::UNPACK_NONE)? Tftp_unpack::local_name(params) :
+            std::string(parts.back()));
+    }
+
+    return res;
+}
+
+void Batch::print_usage()
+{
+    std::cerr << "Usage: mytftpclient                          - interactive terminal" << std::endl;
+    std::cerr << "       mytftpclient [options] [TFTP request parameters] - one transfer" << std::endl;
+    std::cerr << "       mytftpclient [options] --jobs file    - transfers from file, one per line ('-' means stdin)" << std::endl;
+    std::cerr << "       mytftpclient [--verbose] --daemon socket - daemon accepting jobs on Unix domain socket" << std::endl;
+    std::cerr << "       mytftpclient [--verbose] --server dir [--listen address[,port]] [--server-cache N[K|M|G]]" << std::endl;
+    std::cerr << "                    [--allow-write]          - TFTP server serving directory (default 0.0.0.0,69," << std::endl;
+    std::cerr << "                                               hot files up to 256M kept in memory, uploads only" << std::endl;
+    std::cerr << "                                               with --allow-write), SIGINT ends it" << std::endl;
+    std::cerr << "       mytftpclient [--verbose] --relay dir [--listen address[,port]] [--server-cache N[K|M|G]] -R -d path" << std::endl;
+    std::cerr << "                    [-a address,port] [...] - server caching files of upstream server in directory;" << std::endl;
+    std::cerr << "                                               missing file is downloaded by template download (its" << std::endl;
+    std::cerr << "                                               path -d is prefix) and streamed to clients meanwhile" << std::endl;
+    std::cerr << "Options:" << std::endl;
+    std::cerr << "\t--concurrency N - at most N transfers run at the same time" << std::endl;
+    std::cerr << "\t--submit socket - jobs are run by daemon listening on given socket" << std::endl;
+    std::cerr << "\t--cache dir - downloaded files are kept in local cache and served from it when server" << std::endl;
+    std::cerr << "\t              announces the same size (tsize) again; summary of hits is printed at the end" << std::endl;
+    std::cerr << "\t--cache-size N[K|M|G] - maximal size of cache, the least recently used files are evicted (default 1G)" << std::endl;
+    std::cerr << "\t--sync-manifest file - uploads with option -S are recorded into file and skipped next time" << std::endl;
+    std::cerr << "\t                       if size and digest of local file haven't changed" << std::endl;
+    std::cerr << "\t--rate-limit N[K|M|G] - all transfers together send at most N bytes per second" << std::endl;
+    std::cerr << "\t--interface name - transfers without option -i are bound to interface (SO_BINDTODEVICE)" << std::endl;
+    std::cerr << "\t--source address - transfers without option -B are sent from local address" << std::endl;
+    std::cerr << "\t--watch dir - watch directory (may be repeated) and upload every written or moved-in file;" << std::endl;
+    std::cerr << "\t              transfer arguments are template of uploads, its remote path (-d) is prefix of"  << std::endl;
+    std::cerr << "\t              remote paths; --concurrency limits concurrent uploads (default 4), SIGINT ends" << std::endl;
+    std::cerr << "\t--debounce ms - watched file is uploaded once it hasn't changed for ms (default 500, 0 at once)" << std::endl;
+    std::cerr << "\t--prefetch manifest - download every file listed by manifest (lines \"path [size]\", '-' means stdin)" << std::endl;
+    std::cerr << "\t                      into local tree; transfer arguments are template of downloads, its remote" << std::endl;
+    std::cerr << "\t                      path (-d) is prefix of listed paths and its local path (-l) is root of tree;" << std::endl;
+    std::cerr << "\t                      size of file is checked if it is listed; total time is printed at the end" << std::endl;
+    std::cerr << "\t--boot-config file - prefetch kernels, initrds and device trees referred to by pxelinux or grub" << std::endl;
+    std::cerr << "\t                     configuration (may be combined with --prefetch, both may be repeated)" << std::endl;
+    std::cerr << "\t--no-dedup - concurrent downloads of the same file don't share one transfer" << std::endl;
+    std::cerr << "\t--dedup-window N[K|M|G] - download can be joined until it receives N bytes which are kept in memory" << std::endl;
+    std::cerr << "\t                          for joining transfers (default 8M, 0 only before its first data)" << std::endl;
+    std::cerr << "\t--verbose - print log of transfers (or progress reported by daemon) to standard error output" << std::endl;
+    std::cerr << "\t--help - print this help" << std::endl;
+    std::cerr << "Result of every job is printed as line: job=N status=ok|failed bytes=B time_ms=T"
+        << " [sync=skipped] [cache=hit|miss] [flight=joined] [mirror=address,port] [algorithm=digest] file=F" << std::endl;
+    std::cerr << "(to standard error output if downloaded data are streamed to standard output by option -l -)." << std::endl;
+    std::cerr << "Exit code is 0 if all transfers succeed, 1 if some of them fail and 2 on invalid usage." << std::endl;
+}
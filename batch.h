@@ -0,0 +1,165 @@
+/*
+ * @author Jakub Šuráň (xsuran07)
+ * @file batch.h
+ * @brief Interface of class representing non-interactive batch mode.
+ */
+
+#ifndef __BATCH_H_
+#define __BATCH_H_
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <istream>
+
+#include "parser.h"
+#include "tftp_executor.h"
+
+/**
+ * @brief Exit codes of batch mode.
+ */
+typedef enum {
+    EXIT_OK = 0, // all transfers completed without errors
+    EXIT_TRANSFER = 1, // at least one transfer failed
+    EXIT_USAGE = 2, // invalid arguments or job, nothing has been transferred
+} exit_code_t;
+
+/**
+ * @brief Class representing non-interactive mode - transfer is specified
+ * directly by command line arguments or transfers are read from job file
+ * (one per line). Result of every job is printed to standard output as one
+ * machine-readable line, log of transfers goes to standard error output
+ * (only if requested). Jobs are run either locally or by daemon (see Tftp_daemon),
+ * this class also starts daemon itself.
+ */
+class Batch
+{
+    private:
+        Parser p;
+        std::string jobs; // name of job file, empty if transfer is given by arguments
+        size_t concurrency; // maximum of concurrent transfers, 0 means default
+        bool verbose;
+        std::string serve; // path of socket to run daemon on
+        std::string remote; // path of socket of daemon to submit jobs to
+        std::string cache; // directory of local cache of downloaded files, empty if it isn't used
+        uint64_t cache_size; // budget of local cache in bytes
+        std::string sync; // manifest of uploads done in sync mode, empty if they aren't recorded
+        std::vector<std::string_view> transfer; // arguments specifying transfer
+        std::vector<std::string> lines; // all jobs (as request lines)
+        std::vector<Tftp_parameters> params; // all jobs (parsed)
+        bool data_stdout; // some job streams downloaded data to standard output
+        bool data_stdin; // some job uploads data from standard input
+        bool dedup; // concurrent downloads of the same file share one transfer
+        uint64_t dedup_window; // bytes a download may receive while it still can be shared
+        uint64_t rate; // rate limit of all transfers in bytes per second, 0 means unlimited
+        std::string device; // interface used by transfers without option -i, empty means any
+        std::string source; // local address used by transfers without option -B, empty means any
+        std::vector<std::string> watch; // directories whose changed files are uploaded, empty if watch mode isn't used
+        int64_t debounce; // time in ms without change after which watched file is uploaded
+        std::vector<std::string> manifests; // manifests of files to prefetch
+        std::vector<std::string> configs; // boot configurations whose files are prefetched
+        uint64_t bytes; // bytes transferred by jobs run in this process
+        std::string root; // directory served by TFTP server, empty if server isn't run
+        std::string listen; // address TFTP server listens on
+        uint64_t memory; // budget of files kept in memory by TFTP server
+        bool relay; // server downloads missing files from upstream server given by template
+        bool writable; // server accepts uploads
+
+    public:
+        /**
+         * @brief Constructor.
+         */
+        Batch();
+
+        /**
+         * @brief Performs transfers specified by given command line arguments.
+         * @param argc Number of arguments.
+         * @param argv Arguments (including name of program).
+         * @returns exit code of program (see exit_code_t).
+         */
+        int run(int argc, char **argv);
+
+    private:
+        /**
+         * @brief Separates options of batch mode from arguments specifying transfer.
+         * @returns true in case of success, false otherwise.
+         */
+        bool parse_args(int argc, char **argv);
+
+        /**
+         * @brief Collects all jobs from arguments or from job file.
+         * @returns true if all jobs are valid, false otherwise.
+         */
+        bool collect_jobs();
+
+        /**
+         * @brief Parses one job and stores it. Standard output and input may be
+         * used by one job each.
+         * @param line Request line of job.
+         * @returns true if job is valid TFTP request, false otherwise.
+         */
+        bool add_job(const std::string &line);
+
+        /**
+         * @brief Reads jobs from given stream (one per line, empty lines and lines
+         * starting with '#' are skipped).
+         * @param in Stream to read jobs from.
+         * @returns true if all jobs are valid, false otherwise.
+         */
+        bool load_jobs(std::istream &in);
+
+        /**
+         * @brief Runs collected jobs by executor in this process.
+         * @returns exit code of program (see exit_code_t).
+         */
+        int run_local();
+
+        /**
+         * @brief Watches directories and uploads changed files (job is template of uploads).
+         * @returns exit code of program (see exit_code_t).
+         */
+        int run_watch();
+
+        /**
+         * @brief Downloads all files of manifests and boot configurations (job is
+         * template of downloads) and prints time till the whole set is staged.
+         * @returns exit code of program (see exit_code_t).
+         */
+        int run_prefetch();
+
+        /**
+         * @brief Runs TFTP server serving directory (or relaying upstream server) till SIGINT or SIGTERM.
+         * @returns exit code of program (see exit_code_t).
+         */
+        int run_server();
+
+        /**
+         * @brief Submits collected jobs to daemon and prints results sent back.
+         * @returns exit code of program (see exit_code_t).
+         */
+        int run_remote();
+
+        /**
+         * @brief Static method. Prints result of one job as machine-readable line.
+         * @param result Result to print.
+         * @param out Stream to print result into.
+         */
+        static void print_result(const Tftp_executor::result_t &result, std::ostream &out);
+
+        /**
+         * @brief Static method. Rewrites local paths of job (-l, -M and implicit local file)
+         * as absolute ones, so daemon running in another directory uses the same files.
+         * @param line Job as request line.
+         * @param params Parsed job.
+         * @param cwd Current directory of submitter (without whitespace).
+         * @returns rewritten request line.
+         */
+        static std::string absolute_job(const std::string &line, const Tftp_parameters &params, const std::string &cwd);
+
+        /**
+         * @brief Static method. Prints usage of non-interactive mode.
+         */
+        static void print_usage();
+};
+
+#endif
@@ -0,0 +1,254 @@
+/*
+ * @author Jakub Šuráň (xsuran07)
+ * @file bench_codec.cpp
+ * @brief Measures throughput of building and parsing TFTP packets by codec.
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <string.h>
+#include <arpa/inet.h>
+
+#include "tftp_codec.h"
+
+#define BENCH_ITERATIONS 2000000
+#define BENCH_BLKSIZE 512
+
+static uint64_t checksum = 0; // results are used, so compiler cannot drop the work
+
+/**
+ * @brief Baseline - byte by byte helpers client used before codec (binary mode),
+ * every byte is bounds-checked and strings are copied out of packet.
+ */
+class Legacy
+{
+    public:
+        uint8_t *buf;
+        size_t size;
+        size_t pos;
+
+        Legacy(uint8_t *buf, size_t size) { this->buf = buf; this->size = size; this->pos = 0; };
+
+        bool write_byte(uint8_t b)
+        {
+            if(this->pos >= this->size) {
+                return false;
+            }
+
+            this->buf[this->pos++] = b;
+            return true;
+        }
+
+        bool write_word(uint16_t w)
+        {
+            uint16_t converted = htons(w);
+
+            if(this->pos + 1 >= this->size) {
+                return false;
+            }
+
+            memcpy(&this->buf[this->pos], &converted, 2);
+            this->pos += 2;
+            return true;
+        }
+
+        bool write_string(const char *str)
+        {
+            size_t len = strlen(str);
+
+            if(this->pos + len + 1 >= this->size) {
+                return false;
+            }
+
+            for(size_t i = 0; i < len; i++) {
+                if(!write_byte(str[i])) {
+                    return false;
+                }
+            }
+
+            return write_byte('\0');
+        }
+
+        bool read_byte(uint8_t &res)
+        {
+            if(this->pos >= this->size) {
+                return false;
+            }
+
+            res = this->buf[this->pos++];
+            return true;
+        }
+
+        bool read_word(uint16_t &res)
+        {
+            uint16_t tmp;
+
+            if(this->pos + 1 >= this->size) {
+                return false;
+            }
+
+            memcpy(&tmp, &this->buf[this->pos], 2);
+            res = ntohs(tmp);
+            this->pos += 2;
+            return true;
+        }
+
+        bool read_string(std::string &res)
+        {
+            uint8_t c = 1;
+
+            res.clear();
+
+            while(read_byte(c) && c != '\0') {
+                res.push_back(c);
+            }
+
+            return c == '\0';
+        }
+};
+
+// HELPERS
+
+// runs operation and prints millions of packets per second
+static void measure(const char *name, const std::function<uint64_t(uint32_t)> &op)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    for(uint32_t i = 0; i < BENCH_ITERATIONS; i++) {
+        checksum += op(i);
+    }
+
+    double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "codec " << std::left << std::setw(24) << name << std::right << std::fixed << std::setprecision(1)
+        << std::setw(8) << BENCH_ITERATIONS / s / 1e6 << " Mpkt/s" << std::endl;
+}
+
+int main()
+{
+    uint8_t out[BENCH_BLKSIZE + TFTP_HEADER];
+    uint8_t data[BENCH_BLKSIZE + TFTP_HEADER];
+    uint8_t ack[TFTP_HEADER];
+    uint8_t oack[128];
+    uint8_t error[64];
+    size_t oack_len;
+    size_t error_len;
+
+    memset(data, 'x', sizeof(data));
+    Tftp_codec::build_data_header(data, 1);
+    Tftp_codec::build_ack(ack, sizeof(ack), 1);
+    oack_len = Tftp_codec::build_oack(oack, sizeof(oack));
+    oack_len = Tftp_codec::append_option(oack, sizeof(oack), oack_len, "blksize", "1428");
+    oack_len = Tftp_codec::append_option(oack, sizeof(oack), oack_len, "timeout", "3");
+    oack_len = Tftp_codec::append_option(oack, sizeof(oack), oack_len, "tsize", "104857600");
+    error_len = Tftp_codec::build_error(error, sizeof(error), 1, "File not found");
+
+    // building
+    measure("build ACK", [&out](uint32_t i) {
+        return Tftp_codec::build_ack(out, sizeof(out), (uint16_t) i);
+    });
+
+    measure("build DATA header", [&out](uint32_t i) {
+        Tftp_codec::build_data_header(out, (uint16_t) i);
+        return out[3];
+    });
+
+    measure("build RRQ + 3 options", [&out](uint32_t) {
+        size_t len = Tftp_codec::build_rrq(out, sizeof(out), "/tftpboot/pxelinux.0", "octet");
+
+        len = Tftp_codec::append_option(out, sizeof(out), len, "blksize", "1428");
+        len = Tftp_codec::append_option(out, sizeof(out), len, "timeout", "3");
+        return Tftp_codec::append_option(out, sizeof(out), len, "tsize", "0");
+    });
+
+    measure("build ERROR", [&out](uint32_t) {
+        return Tftp_codec::build_error(out, sizeof(out), 1, "File not found");
+    });
+
+    measure("legacy build RRQ + 3 opt", [&out](uint32_t) {
+        Legacy packet(out, sizeof(out));
+
+        packet.write_word(1);
+        packet.write_string("/tftpboot/pxelinux.0");
+        packet.write_string("octet");
+        packet.write_string("blksize");
+        packet.write_string("1428");
+        packet.write_string("timeout");
+        packet.write_string("3");
+        packet.write_string("tsize");
+        packet.write_string("0");
+        return packet.pos;
+    });
+
+    // parsing
+    measure("parse DATA", [&data](uint32_t) {
+        DataView view;
+
+        return (view.parse(data, sizeof(data)))? view.block() + view.payload().size : 0;
+    });
+
+    measure("parse ACK", [&ack](uint32_t) {
+        AckView view;
+
+        return (view.parse(ack, sizeof(ack)))? view.block() : 0;
+    });
+
+    measure("parse OACK + 3 options", [&oack, oack_len](uint32_t) {
+        OackView view;
+        std::string_view name;
+        std::string_view value;
+        uint64_t sum = 0;
+
+        if(view.parse(oack, oack_len)) {
+            while(view.next(name, value)) {
+                sum += name.size() + value.size();
+            }
+        }
+
+        return sum;
+    });
+
+    measure("parse ERROR", [&error, error_len](uint32_t) {
+        ErrorView view;
+
+        return (view.parse(error, error_len))? view.code() + view.message().size() : 0;
+    });
+
+    measure("legacy parse DATA", [&data, &out](uint32_t) {
+        Legacy packet(data, sizeof(data));
+        uint16_t opcode;
+        uint16_t block;
+        uint8_t c;
+        size_t len = 0;
+
+        packet.read_word(opcode);
+        packet.read_word(block);
+
+        while(packet.read_byte(c)) {
+            out[len++] = c;
+        }
+
+        return block + len;
+    });
+
+    measure("legacy parse OACK + 3 opt", [&oack, oack_len](uint32_t) {
+        Legacy packet(oack, oack_len);
+        std::string name;
+        std::string value;
+        uint16_t opcode;
+        uint64_t sum = 0;
+
+        packet.read_word(opcode);
+
+        while(packet.read_string(name) && packet.read_string(value)) {
+            sum += name.size() + value.size();
+        }
+
+        return sum;
+    });
+
+    return (checksum == 0);
+}
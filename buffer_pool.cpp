@@ -0,0 +1,216 @@
+/*
+ * @author Jakub Šuráň (xsuran07)
+ * @file buffer_pool.cpp
+ * @brief Implementation of slab pool for packet buffers.
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <cstring>
+#include <sys/mman.h>
+
+#include "buffer_pool.h"
+
+#define SLAB_SIZE (256 * 1024)
+#define HUGE_SLAB_SIZE (2 * 1024 * 1024)
+
+// HELPERS
+
+static bool huge_pages_requested()
+{
+    const char *env = std::getenv("TFTP_HUGE_PAGES");
+
+    return env != nullptr && strcmp(env, "1") == 0;
+}
+
+// STATIC METHODS
+
+Buffer_pool &Buffer_pool::instance()
+{
+    // initialization of static local variable is thread-safe
+    static Buffer_pool pool(huge_pages_requested());
+
+    return pool;
+}
+
+int Buffer_pool::class_index(uint64_t size)
+{
+    for(int i = 0; i < POOL_CLASSES; i++) {
+        if(size <= (1ULL << (POOL_MIN_SHIFT + i))) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+// PUBLIC INSTANCE METHODS
+
+// constructor
+Buffer_pool::Buffer_pool(bool huge_pages)
+{
+    this->huge_pages = huge_pages;
+    this->huge_slabs = 0;
+
+    for(int i = 0; i < POOL_CLASSES; i++) {
+        this->classes[i].free_list = nullptr;
+        memset(&this->classes[i].stats, 0, sizeof(class_stats_t));
+        this->classes[i].stats.buf_size = 1ULL << (POOL_MIN_SHIFT + i);
+    }
+}
+
+// destructor
+Buffer_pool::~Buffer_pool()
+{
+    for(auto &slab : this->slabs) {
+        munmap(slab.addr, slab.len);
+    }
+}
+
+uint8_t *Buffer_pool::acquire(uint64_t size, uint64_t &capacity)
+{
+    int index = class_index(size);
+    uint8_t *buf;
+
+    if(index < 0) {
+        std::cerr << "Requested buffer is too big (" << size << " bytes)!" << std::endl;
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> guard(this->lock);
+    size_class_t &cls = this->classes[index];
+
+    // no free buffer left => map new slab
+    if(cls.free_list == nullptr && !grow(cls)) {
+        return nullptr;
+    }
+
+    // unlink first free buffer
+    buf = cls.free_list;
+    memcpy(&cls.free_list, buf, sizeof(uint8_t *));
+
+    cls.stats.in_use++;
+    if(cls.stats.in_use > cls.stats.high_water) {
+        cls.stats.high_water = cls.stats.in_use;
+    }
+
+    capacity = cls.stats.buf_size;
+    return buf;
+}
+
+void Buffer_pool::release(uint8_t *buf, uint64_t capacity)
+{
+    int index = class_index(capacity);
+
+    if(buf == nullptr || index < 0) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> guard(this->lock);
+    size_class_t &cls = this->classes[index];
+
+    // link buffer back into free list (content is left as it is)
+    memcpy(buf, &cls.free_list, sizeof(uint8_t *));
+    cls.free_list = buf;
+    cls.stats.in_use--;
+}
+
+uint64_t Buffer_pool::get_reserved()
+{
+    std::lock_guard<std::mutex> guard(this->lock);
+    uint64_t total = 0;
+
+    for(auto &slab : this->slabs) {
+        total += slab.len;
+    }
+
+    return total;
+}
+
+void Buffer_pool::print_stats(std::ostream &out)
+{
+    uint64_t reserved = get_reserved();
+    std::lock_guard<std::mutex> guard(this->lock);
+
+    out << "Buffer pool - " << reserved << " bytes reserved in " << this->slabs.size()
+        << " slabs (" << this->huge_slabs << " backed by huge pages)" << std::endl;
+
+    for(int i = 0; i < POOL_CLASSES; i++) {
+        class_stats_t &s = this->classes[i].stats;
+
+        out << "\t" << std::setfill(' ') << std::setw(5) << s.buf_size << " B: in use " << s.in_use
+            << ", high-water " << s.high_water << ", capacity " << s.capacity << std::endl;
+    }
+}
+
+// PRIVATE INSTANCE METHODS
+
+bool Buffer_pool::grow(size_class_t &cls)
+{
+    size_t len = (this->huge_pages)? HUGE_SLAB_SIZE : SLAB_SIZE;
+    void *addr = MAP_FAILED;
+    bool huge = false;
+
+    if(this->huge_pages) {
+        addr = mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        huge = addr != MAP_FAILED;
+    }
+
+    // no reserved huge pages available => at least ask for transparent ones
+    if(addr == MAP_FAILED) {
+        addr = mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+        if(addr == MAP_FAILED) {
+            std::cerr << "mmap() failed while growing buffer pool!" << std::endl;
+            return false;
+        }
+
+        if(this->huge_pages) {
+            madvise(addr, len, MADV_HUGEPAGE);
+        }
+    }
+
+    this->slabs.push_back({addr, len});
+    this->huge_slabs += huge;
+    cls.stats.slabs++;
+
+    // carve slab into buffers and link them into free list
+    uint8_t *base = static_cast<uint8_t *> (addr);
+    for(size_t off = 0; off + cls.stats.buf_size <= len; off += cls.stats.buf_size) {
+        uint8_t *buf = base + off;
+
+        memcpy(buf, &cls.free_list, sizeof(uint8_t *));
+        cls.free_list = buf;
+        cls.stats.capacity++;
+    }
+
+    return true;
+}
+
+// POOL BUFFER
+
+// destructor
+Pool_buffer::~Pool_buffer()
+{
+    Buffer_pool::instance().release(this->data, this->capacity);
+}
+
+bool Pool_buffer::reserve(uint64_t size)
+{
+    uint64_t capacity;
+    uint8_t *buf;
+
+    if(this->data != nullptr && size <= this->capacity) {
+        return true;
+    }
+
+    if((buf = Buffer_pool::instance().acquire(size, capacity)) == nullptr) {
+        return false;
+    }
+
+    Buffer_pool::instance().release(this->data, this->capacity);
+    this->data = buf;
+    this->capacity = capacity;
+    return true;
+}
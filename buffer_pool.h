@@ -0,0 +1,184 @@
+/*
+ * @author Jakub Šuráň (xsuran07)
+ * @file buffer_pool.h
+ * @brief Interface of slab pool for packet buffers.
+ */
+
+#ifndef __BUFFER_POOL_H_
+#define __BUFFER_POOL_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <ostream>
+#include <vector>
+#include <mutex>
+
+#define POOL_MIN_SHIFT 10 // smallest size class is 1 KiB
+#define POOL_CLASSES 7 // 1 KiB, 2 KiB, ..., 64 KiB (largest TFTP packet is 65468 bytes)
+
+/**
+ * @brief Size-class slab pool from which all packet buffers are taken.
+ * Every size class carves its buffers from big slabs mapped by mmap (optionally
+ * backed by huge pages) and keeps released buffers in free list, so
+ * memory is never returned to the system and buffers are not zeroed on reuse.
+ * Pool may be shared by more threads.
+ */
+class Buffer_pool
+{
+    public:
+        /**
+         * @brief Statistics of one size class.
+         */
+        typedef struct {
+            uint64_t buf_size; // size of buffers in this class
+            uint64_t in_use; // number of currently acquired buffers
+            uint64_t high_water; // maximum of in_use since start
+            uint64_t capacity; // number of buffers carved from slabs
+            uint64_t slabs; // number of mapped slabs
+        } class_stats_t;
+
+    private:
+        /**
+         * @brief Representation of one size class.
+         */
+        typedef struct {
+            uint8_t *free_list; // released buffers linked through their first bytes
+            class_stats_t stats;
+        } size_class_t;
+
+        /**
+         * @brief Representation of one mapped memory region.
+         */
+        typedef struct {
+            void *addr;
+            size_t len;
+        } slab_t;
+
+        size_class_t classes[POOL_CLASSES];
+        std::vector<slab_t> slabs;
+        bool huge_pages;
+        uint64_t huge_slabs;
+        std::mutex lock;
+
+    public:
+        /**
+         * @brief Constructor.
+         * @param huge_pages Determines whether slabs should be backed by huge pages.
+         */
+        Buffer_pool(bool huge_pages = false);
+
+        /**
+         * @brief Destructor. Unmaps all slabs.
+         */
+        ~Buffer_pool();
+
+        Buffer_pool(const Buffer_pool &) = delete;
+        Buffer_pool &operator=(const Buffer_pool &) = delete;
+
+        /**
+         * @brief Static method. Returns pool shared by all transfers. Huge pages
+         * are used if environment variable TFTP_HUGE_PAGES is set to 1.
+         */
+        static Buffer_pool &instance();
+
+        /**
+         * @brief Takes buffer with at least given size from pool. Content of
+         * buffer is undefined.
+         * @param size Minimal size of buffer.
+         * @param capacity Variable to store real size of buffer into.
+         * @returns pointer to buffer or nullptr if size is too big or allocation failed.
+         */
+        uint8_t *acquire(uint64_t size, uint64_t &capacity);
+
+        /**
+         * @brief Returns buffer previously taken by acquire back to pool.
+         * @param buf Buffer to return.
+         * @param capacity Capacity returned by acquire.
+         */
+        void release(uint8_t *buf, uint64_t capacity);
+
+        /**
+         * @brief Enables or disables huge pages for newly mapped slabs.
+         */
+        void set_huge_pages(bool enable) { this->huge_pages = enable; };
+
+        /**
+         * @brief Getter for snapshot of statistics of size class with given index.
+         */
+        class_stats_t get_stats(size_t index)
+        {
+            std::lock_guard<std::mutex> guard(this->lock);
+            return this->classes[index].stats;
+        };
+
+        /**
+         * @brief Counts number of bytes mapped by all slabs.
+         */
+        uint64_t get_reserved();
+
+        /**
+         * @brief Prints occupancy and high-water marks of all size classes.
+         * @param out Stream to print statistics into.
+         */
+        void print_stats(std::ostream &out);
+
+    private:
+        /**
+         * @brief Finds index of the smallest size class able to hold given size.
+         * @returns index of size class or -1 if size is too big.
+         */
+        static int class_index(uint64_t size);
+
+        /**
+         * @brief Maps new slab for given size class and carves it into free buffers.
+         * @returns true in case of success, false otherwise.
+         */
+        bool grow(size_class_t &cls);
+};
+
+/**
+ * @brief Packet buffer taken from Buffer_pool. Buffer is returned to pool
+ * automatically when it is destroyed.
+ */
+class Pool_buffer
+{
+    private:
+        uint8_t *data;
+        uint64_t capacity;
+
+    public:
+        /**
+         * @brief Constructor. No memory is taken from pool until reserve is called.
+         */
+        Pool_buffer() : data(nullptr), capacity(0) {};
+
+        /**
+         * @brief Destructor. Returns buffer back to pool.
+         */
+        ~Pool_buffer();
+
+        Pool_buffer(const Pool_buffer &) = delete;
+        Pool_buffer &operator=(const Pool_buffer &) = delete;
+
+        /**
+         * @brief Makes sure buffer is able to hold at least given number of bytes.
+         * Content of buffer is not preserved when it has to grow.
+         * @param size Required size of buffer.
+         * @returns true in case of success, false otherwise.
+         */
+        bool reserve(uint64_t size);
+
+        /**
+         * @brief Getter for pointer to data.
+         */
+        uint8_t *get() { return this->data; };
+
+        /**
+         * @brief Getter for capacity of buffer.
+         */
+        uint64_t get_capacity() { return this->capacity; };
+
+        uint8_t &operator[](size_t i) { return this->data[i]; };
+};
+
+#endif
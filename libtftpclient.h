@@ -0,0 +1,38 @@
+/*
+ * @author Jakub Šuráň (xsuran07)
+ * @file libtftpclient.h
+ * @brief Public interface of library libtftpclient.a - TFTP transfers embeddable
+ * into other applications.
+ *
+ * Transfer is described by Tftp_parameters (see Tftp_parameters::set_values),
+ * local endpoint is any Tftp_source (WRQ) or Tftp_sink (RRQ) - file descriptor,
+ * memory or callback receiving every DATA payload. Without endpoint, local file
+ * in current directory is used. Example:
+ *
+ *     Tftp_parameters params;
+ *     Tftp_parameters::params_t values = params.get_values();
+ *     values.req_type = Tftp_parameters::READ;
+ *     values.filename = "/tftp/boot.img";
+ *     params.set_values(values);
+ *
+ *     auto sink = std::make_shared<Memory_sink>();
+ *     Tftp_client client;
+ *     client.set_sink(sink);
+ *     client.communicate(&params); // or Tftp_engine::add to run many transfers
+ *
+ * Blocking transfer is run by Tftp_client::communicate, many concurrent ones by
+ * Tftp_engine (one thread, client may be prepared by caller) or Tftp_executor
+ * (thread per core). Tftp_client::get_progress may be polled from any thread,
+ * log goes to stream set by Tftp_client::set_log_stream (nullptr turns it off).
+ */
+
+#ifndef __LIBTFTPCLIENT_H_
+#define __LIBTFTPCLIENT_H_
+
+#include "tftp_parameters.h"
+#include "tftp_stream.h"
+#include "tftp_client.h"
+#include "tftp_engine.h"
+#include "tftp_executor.h"
+
+#endif
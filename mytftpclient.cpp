@@ -5,9 +5,17 @@
  */
 
 #include "terminal.h"
+#include "batch.h"
 
-int main()
+int main(int argc, char **argv)
 {
+	// any argument means non-interactive mode
+	if(argc > 1) {
+		Batch b;
+
+		return b.run(argc, argv);
+	}
+
 	Terminal t;
 
 	t.run();
@@ -5,7 +5,7 @@
  */
 
 #include <iostream>
-#include <regex>
+#include <cctype>
 
 #include "parser.h"
 
@@ -16,14 +16,37 @@ Parser::Parser()
     this->opt_count = 0;
 }
 
-void Parser::set_options(std::string &str)
+void Parser::set_options(std::string_view line)
 {
-    std::regex reg("\\s+"); //match whitespace sequences
-    std::sregex_token_iterator start(str.begin(), str.end(), reg, -1);
-    std::sregex_token_iterator end;
+    size_t i = 0;
+    size_t start;
 
     this->options.clear();
-    this->options.insert(this->options.end(), start, end);
+
+    // single pass over line - every token is a view of nonwhitespace sequence
+    while(true) {
+        while(i < line.size() && std::isspace(static_cast<unsigned char> (line[i]))) {
+            i++;
+        }
+
+        if(i == line.size()) {
+            break;
+        }
+
+        start = i;
+        while(i < line.size() && !std::isspace(static_cast<unsigned char> (line[i]))) {
+            i++;
+        }
+
+        this->options.push_back(line.substr(start, i - start));
+    }
+
+    this->opt_count = this->options.size();
+}
+
+void Parser::set_options(const std::vector<std::string_view> &options)
+{
+    this->options = options;
     this->opt_count = this->options.size();
 }
         
@@ -34,7 +57,7 @@ Parser::command_t Parser::parse_command()
     }
 
     Parser::command_t ret = INVALID;
-    size_t i = (this->options[0].empty())? 1 : 0;
+    size_t i = 0;
     bool no_error = true;
 
     this->params.init_values();
@@ -46,6 +69,9 @@ Parser::command_t Parser::parse_command()
         } else if(this->options[i] == "quit") {
             ret = QUIT;
             no_error = check_combination(ret, this->options[i]);
+        } else if(this->options[i] == "stats") {
+            ret = STATS;
+            no_error = check_combination(ret, this->options[i]);
         } else if(this->params.parse(i, this->options)) {
             ret = TFTP;
         } else {
@@ -68,13 +94,10 @@ Parser::command_t Parser::parse_command()
     return ret;
 }
 
-bool Parser::check_combination(Parser::command_t &opt, std::string option)
+bool Parser::check_combination(Parser::command_t &opt, std::string_view option)
 {
-    //don't take into account first empty option
-    size_t expected = (this->options[0].empty())? 2 : 1;
-
     //option cannot be combined
-    if(this->opt_count != expected) {
+    if(this->opt_count != 1) {
         opt = INVALID;
         std::cerr << "Option " << option << " cannot be combined with other options!" << std::endl;
         return false;
@@ -8,6 +8,7 @@
 #define __PARSER_H_
 
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include "tftp_parameters.h"
@@ -24,13 +25,14 @@ class Parser
         typedef enum {
             HELP,
             QUIT,
+            STATS,
             TFTP,
             INVALID,
         } command_t;
 
     private:
         size_t opt_count;
-        std::vector<std::string> options;
+        std::vector<std::string_view> options;
         Tftp_parameters params;
 
     public:
@@ -41,10 +43,18 @@ class Parser
 
         /**
          * @brief Splits given string by whitespaces into
-         * internal vector of strings.
-         * @param str String with commands.
+         * internal vector of string views. Views refer to given
+         * string, so it has to live till command is parsed.
+         * @param line String with commands.
          */
-        void set_options(std::string &str);
+        void set_options(std::string_view line);
+
+        /**
+         * @brief Takes already split options (e.g. command line arguments).
+         * Views have to live till command is parsed.
+         * @param options Vector with options.
+         */
+        void set_options(const std::vector<std::string_view> &options);
 
         /**
          * @brief Tries to parse commands stored in internal
@@ -64,7 +74,7 @@ class Parser
          * @returns true if internal vector of string includes only one
          * command, false otherwise.
          */
-        bool check_combination(command_t &opt, std::string option);
+        bool check_combination(command_t &opt, std::string_view option);
 };
 
 #endif
\ No newline at end of file
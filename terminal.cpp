@@ -9,10 +9,36 @@
 #include <vector>
 
 #include "terminal.h"
+#include "buffer_pool.h"
+#include "tftp_client.h"
 
 bool Terminal::perform_command()
 {
-    this->p.set_options(this->line);
+    std::string_view commands(this->line);
+    size_t pos;
+    bool run = true;
+
+    // performs all commands separated by ';'
+    do {
+        pos = commands.find(';');
+        run = perform_single(commands.substr(0, pos));
+
+        if(pos != std::string_view::npos) {
+            commands.remove_prefix(pos + 1);
+        }
+    } while(run && pos != std::string_view::npos);
+
+    // requested transfers run concurrently, results of more of them are summarized in order
+    this->executor.set_report((this->executor.get_results().size() > 1)? print_result : nullptr);
+    this->executor.run();
+    this->executor.clear();
+
+    return run;
+}
+
+bool Terminal::perform_single(std::string_view command)
+{
+    this->p.set_options(command);
 
     // performs requested command
     switch(this->p.parse_command()) {
@@ -21,8 +47,17 @@ bool Terminal::perform_command()
         return true;
     case Parser::QUIT:
         return false;
+    case Parser::STATS:
+        Buffer_pool::instance().print_stats(std::cout);
+        return true;
     case Parser::TFTP:
-        this->client.communicate(this->p.get_params());
+        // terminal reads commands from stdin and prints log to stdout
+        if(this->p.get_params()->is_stdio()) {
+            std::cerr << "Local file '-' can be used only in non-interactive mode!" << std::endl;
+            return true;
+        }
+
+        this->executor.submit(*this->p.get_params());
         return true;
     case Parser::INVALID:
         return true;
@@ -31,6 +66,16 @@ bool Terminal::perform_command()
     }
 }
 
+void Terminal::print_result(const Tftp_executor::result_t &result)
+{
+    std::lock_guard<std::mutex> guard(Tftp_client::get_output_lock());
+
+    Tftp_client::print_timestamp();
+    std::cout << "Result #" << result.id + 1 << " (" << result.filename << "): "
+        << ((result.ok)? "OK" : "FAILED") << ", " << result.bytes << " bytes in "
+        << result.duration << " ms" << std::endl;
+}
+
 void Terminal::run()
 {
     bool run = true;
@@ -54,7 +99,9 @@ void Terminal::print_help()
     std::cout << "Supported commands:" << std::endl;
     std::cout << "* help - print this help" << std::endl;
     std::cout << "* quit - ends interactive terminal mode, terminal also ends when EOF is read" << std::endl;
-    std::cout << "* [TFTP request parameters] - specification of parameters for TFTP request:" << std::endl;
+    std::cout << "* stats - print occupancy and high-water marks of packet buffer pool" << std::endl;
+    std::cout << "* [TFTP request parameters] - specification of parameters for TFTP request;"
+        << " more requests separated by ';' are transferred concurrently on all cores:" << std::endl;
     std::cout << "\t -R - request reading from server (required if -W isn't used, usage of both is forbidden)" << std::endl;
     std::cout << "\t -W - request writing to server (required if -R isn't used, usage of both is forbidden)" << std::endl;
     std::cout << "\t -d /absolute_path/filename - filename specifis name of file to transfer,"
@@ -66,6 +113,30 @@ void Terminal::print_help()
     std::cout << "\t -m request multicast transfer - RFC 2090 (optional)" << std::endl;
     std::cout << "\t -c mode - specifies tranfer mode - allowed values for 'mode' are ascii"
         << " (or netascii) and binary (or octet) (optional)" << std::endl;
-    std::cout << "\t -a address, port - address specifies server address (may be both ipv4 or ipv6); default is 127.0.0.1,"
-        << " port specifies port number server listens on; default value is 69 (optional)" << std::endl;
+    std::cout << "\t -a address, port - address specifies server address (may be ipv4, ipv6 or host name - all its addresses"
+        << " are raced like mirrors, families alternate); default is 127.0.0.1,"
+        << " port specifies port number server listens on; default value is 69; option may be repeated to give"
+        << " mirrors of the same files - request is sent to the next mirror after 250 ms"
+        << " without answer and the first answering one serves transfer, stalled binary download continues from"
+        << " another mirror (optional)" << std::endl;
+    std::cout << "\t -l file - local file to store downloaded data into or to take uploaded data from; default is"
+        << " name of transferred file in current directory, '-' means standard output/input (only in"
+        << " non-interactive mode) (optional)" << std::endl;
+    std::cout << "\t -x format - downloaded data are decompressed/unpacked as they arrive; allowed values for 'format'"
+        << " are gzip, zstd, tar, tar.gz and tar.zst; archive is extracted into directory given by -l (optional)" << std::endl;
+    std::cout << "\t -k algorithm[:digest] - checksum of transferred data is computed as blocks are sent/received;"
+        << " allowed values for 'algorithm' are crc32c, xxh3 and sha256; transfer fails if result differs from"
+        << " given digest (optional)" << std::endl;
+    std::cout << "\t -S sync mode - download is aborted right after server announces size of file (tsize)"
+        << " if it matches size of local file, upload is skipped if local file hasn't changed since its last"
+        << " upload recorded in sync manifest (optional)" << std::endl;
+    std::cout << "\t -M manifest - expected digest is taken from manifest with lines 'digest filename' (optional)" << std::endl;
+    std::cout << "\t -r rate - transfer sends/receives at most 'rate' bytes per second (with optional suffix K, M"
+        << " or G); packets are paced evenly (optional)" << std::endl;
+    std::cout << "\t -i interface - socket is bound to interface (SO_BINDTODEVICE), it is also scope of link-local"
+        << " ipv6 addresses without explicit one (address%interface) and only its MTU limits blksize (optional)" << std::endl;
+    std::cout << "\t -B address - socket is bound to local address, only servers of the same family are contacted"
+        << " and MTU of interface owning address limits blksize (optional)" << std::endl;
+    std::cout << "\t -P class - priority of job in batch mode; allowed values are high, normal (default) and low;"
+        << " within class shorter jobs start first, high jobs may take slots of running low ones (optional)" << std::endl;
 }
\ No newline at end of file
@@ -8,13 +8,14 @@
 #define __TERMINAL_H_
 
 #include <string>
+#include <string_view>
 
 #include "parser.h"
-#include "tftp_client.h"
+#include "tftp_executor.h"
 
 /**
  * @brief Class representing terminal which suppport
- * only very limitied set of commands - HELP, QUIT and
+ * only very limitied set of commands - HELP, QUIT, STATS and
  * TFTP client.
  */
 class Terminal
@@ -22,7 +23,7 @@ class Terminal
     private:
         std::string line;
         Parser p;
-        Tftp_client client;
+        Tftp_executor executor;
 
     public:
         /**
@@ -38,17 +39,32 @@ class Terminal
 
     private:
         /**
-         * @brief Tries to parse and perform read command.
-         * @returns true if command has been successfuly parsed
-         * and perform, false otherwise
+         * @brief Tries to parse and perform all commands from read line.
+         * TFTP requests are performed concurrently (on all cores).
+         * @returns false if terminal should end, true otherwise.
          */
         bool perform_command();
 
+        /**
+         * @brief Tries to parse and perform one command. TFTP request
+         * is only queued, it is run by executor.
+         * @param command Command to perform.
+         * @returns false if terminal should end, true otherwise.
+         */
+        bool perform_single(std::string_view command);
+
         /**
          * @brief Prints help for interactive mode.
          */
         void print_help();
 
+        /**
+         * @brief Static method. Prints result of one or more concurrently
+         * performed TFTP requests.
+         * @param result Result to print.
+         */
+        static void print_result(const Tftp_executor::result_t &result);
+
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,172 @@
+/*
+ * @author Jakub Šuráň (xsuran07)
+ * @file test_alloc.cpp
+ * @brief Checks that steady-state DATA/ACK loop of download doesn't allocate memory.
+ */
+
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "tftp_server.h"
+#include "tftp_client.h"
+#include "tftp_parameters.h"
+#include "tftp_stream.h"
+
+#define TEST_LISTEN "127.0.0.1,16969" // loopback server the transfer runs against
+#define TEST_SIZE (8 * 1024 * 1024 + 100) // size of downloaded file (not multiple of block)
+#define TEST_BLKSIZE 1024
+#define TEST_BLKSIZE_STR "1024"
+#define TEST_WARMUP 16 // blocks after which no allocation is allowed
+
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_calloc(size_t n, size_t size);
+extern "C" void *__libc_realloc(void *ptr, size_t size);
+extern "C" void *__libc_memalign(size_t alignment, size_t size);
+
+static thread_local bool counting = false; // only thread of client is checked, server runs beside it
+static size_t allocations = 0;
+
+// HELPERS
+
+// every allocation (operator new included) ends up in one of these
+
+extern "C" void *malloc(size_t size)
+{
+    allocations += counting;
+    return __libc_malloc(size);
+}
+
+extern "C" void *calloc(size_t n, size_t size)
+{
+    allocations += counting;
+    return __libc_calloc(n, size);
+}
+
+extern "C" void *realloc(void *ptr, size_t size)
+{
+    allocations += counting;
+    return __libc_realloc(ptr, size);
+}
+
+extern "C" void *aligned_alloc(size_t alignment, size_t size)
+{
+    allocations += counting;
+    return __libc_memalign(alignment, size);
+}
+
+extern "C" int posix_memalign(void **ptr, size_t alignment, size_t size)
+{
+    allocations += counting;
+    return ((*ptr = __libc_memalign(alignment, size)) != nullptr)? 0 : ENOMEM;
+}
+
+// creates served directory with file to download
+static bool prepare_root(std::string &root)
+{
+    char dir[] = "/tmp/tftp_test.XXXXXX";
+    std::vector<uint8_t> data(TEST_SIZE);
+    int fd;
+
+    if(mkdtemp(dir) == nullptr) {
+        return false;
+    }
+
+    root = dir;
+
+    for(size_t i = 0; i < data.size(); i++) {
+        data[i] = (uint8_t) (i * 7 + i / 4096);
+    }
+
+    if((fd = open((root + "/test.bin").c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644)) == -1) {
+        return false;
+    }
+
+    bool ok = write(fd, data.data(), data.size()) == (ssize_t) data.size();
+
+    close(fd);
+    return ok;
+}
+
+// runs transfer till it ends
+static void drive(Tftp_client &client)
+{
+    while(!client.is_finished()) {
+        struct pollfd pfd = {client.get_socket(), POLLIN, 0};
+        int64_t wait = std::max<int64_t>(client.get_deadline() - Tftp_client::now_ms(), 0);
+
+        if(poll(&pfd, 1, (int) wait) > 0) {
+            client.on_readable();
+        } else {
+            client.handle_timers(Tftp_client::now_ms());
+        }
+    }
+}
+
+int main()
+{
+    std::vector<std::string_view> options = {"-R", "-d", "/test.bin", "-a", TEST_LISTEN, "-s", TEST_BLKSIZE_STR};
+    struct sockaddr_storage addr;
+    socklen_t addr_len;
+    Tftp_parameters params;
+    Tftp_client client;
+    std::string root;
+    uint64_t received = 0;
+    uint64_t blocks = 0;
+
+    if(!prepare_root(root) || !Tftp_server::parse_listen(TEST_LISTEN, addr, addr_len)) {
+        std::cerr << "Cannot prepare served directory!" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    Tftp_server server(root, addr, addr_len);
+    std::thread thread([&server]() { server.run(); });
+
+    params.init_values();
+    for(size_t i = 0; i < options.size(); i++) {
+        if(!params.parse(i, options)) {
+            return EXIT_FAILURE;
+        }
+    }
+
+    // server has to listen before request is sent, otherwise it comes after timeout
+    usleep(100000);
+    Tftp_client::set_log_stream(nullptr);
+
+    // allocations are counted since warmup till the last (short) block
+    client.set_sink(std::make_shared<Callback_sink>([&received, &blocks](byte_span_t data) {
+        received += data.size;
+        counting = ++blocks >= TEST_WARMUP && data.size == TEST_BLKSIZE;
+        return true;
+    }));
+
+    bool ok = params.set_properly() && client.start(params);
+
+    if(ok) {
+        drive(client);
+    }
+
+    counting = false;
+    pthread_kill(thread.native_handle(), SIGTERM);
+    thread.join();
+
+    unlink((root + "/test.bin").c_str());
+    rmdir(root.c_str());
+
+    if(!ok || !client.is_successful() || received != TEST_SIZE) {
+        std::cerr << "test_alloc: transfer failed (" << received << " of " << TEST_SIZE << " bytes)!" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::cout << "test_alloc: " << blocks << " blocks, " << allocations << " allocations after " << TEST_WARMUP
+        << " blocks - " << ((allocations == 0)? "ok" : "FAILED") << std::endl;
+    return (allocations == 0)? EXIT_SUCCESS : EXIT_FAILURE;
+}
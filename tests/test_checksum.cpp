@@ -0,0 +1,113 @@
+/*
+ * @author Jakub Šuráň (xsuran07)
+ * @file test_checksum.cpp
+ * @brief Checks checksums against reference vectors (xxhsum -H3, sha256sum, bitwise CRC32C).
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+#include <stdlib.h>
+
+#include "tftp_checksum.h"
+
+/**
+ * @brief Expected digests of data of given length.
+ */
+typedef struct {
+    size_t length;
+    const char *crc32c;
+    const char *xxh3;
+    const char *sha256;
+} vector_t;
+
+// lengths around XXH3 thresholds (16, 128, 240) and its internal buffer of 4 stripes (256)
+static const vector_t vectors[] = {
+    {0, "00000000", "2d06800538d394c2", "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855"},
+    {3, "c6885c81", "d3bcc83c6f14e70f", "97efedb40915efe5baf532f71b212340ce8b4459cd833ecdbe6d9bd4b779cc29"},
+    {16, "551f3798", "9ec324145cea1dcb", "15c8fa8232afdfa307731c39361827ac8b8a9e05fff98ba3dafcb564ab3bd269"},
+    {128, "d010491a", "5d813d42c0005ea8", "5758fe3e49f86851c51c17d0c3c36e84843222327a720d01722763b8684cc575"},
+    {240, "9b9ece16", "7d85b8d4f8b10c82", "f27b9f87d26bd52a45374e60077badfcdc8412d90135f0a6263a553e4a2f9f19"},
+    {241, "02c6fb3a", "5c56141c894cd97e", "ae156a65c7bf4fc0182d42d9d9c21268fa9455432f3d097d2860f8e9139cf990"},
+    {256, "be9efdee", "cdb34974678d6687", "a4fc8c15a87e3ef5b581667359b74bf1c78b130bbac0e548c3261b6365e95ed4"},
+    {257, "d422470f", "b5c3cd9c180a14b7", "5e1bedfc2a8d12dcd1d7037f589bcca487261efaadbc971c2dc874a6216b5fe0"},
+    {1048576, "3ca8e198", "20da16121ba32047", "3dbac2f942957e365de60b4316ada461206b725f9446456bc85be911fb542ce8"},
+};
+
+// data are fed whole (0) and in chunks not aligned to stripes nor blocks
+static const size_t chunks[] = {0, 1, 7, 63, 65, 1031};
+
+static size_t failures = 0;
+
+// HELPERS
+
+// pseudorandom data (the same generator produced reference digests)
+static std::vector<uint8_t> generate(size_t length)
+{
+    std::vector<uint8_t> data(length);
+    uint32_t x = 1;
+
+    for(size_t i = 0; i < length; i++) {
+        x = x * 1103515245 + 12345;
+        data[i] = (x >> 16) & 0xFF;
+    }
+
+    return data;
+}
+
+static void check(const char *name, size_t length, size_t chunk, const std::string &digest, const char *expected)
+{
+    if(digest != expected) {
+        std::cerr << "test_checksum: " << name << " of " << length << " bytes in chunks of " << chunk << " is "
+            << digest << ", expected " << expected << "!" << std::endl;
+        failures++;
+    }
+}
+
+// CRC of table fallback as printed by digest
+static std::string crc32c_table(const std::vector<uint8_t> &data, size_t chunk)
+{
+    std::ostringstream out;
+    uint32_t crc = 0;
+
+    for(size_t pos = 0; pos < data.size(); pos += chunk) {
+        crc = Tftp_checksum::crc32c_table(crc, {data.data() + pos, std::min(chunk, data.size() - pos)});
+    }
+
+    out << std::hex << std::setw(8) << std::setfill('0') << crc;
+    return out.str();
+}
+
+int main()
+{
+    const Tftp_parameters::checksum_t algorithms[] = {Tftp_parameters::CHECKSUM_CRC32C, Tftp_parameters::CHECKSUM_XXH3,
+        Tftp_parameters::CHECKSUM_SHA256};
+    size_t checks = 0;
+
+    for(auto &vector : vectors) {
+        std::vector<uint8_t> data = generate(vector.length);
+        const char *expected[] = {vector.crc32c, vector.xxh3, vector.sha256};
+
+        for(size_t chunk : chunks) {
+            chunk = (chunk == 0)? std::max<size_t>(data.size(), 1) : chunk;
+
+            for(size_t i = 0; i < 3; i++) {
+                Tftp_checksum checksum(algorithms[i]);
+
+                for(size_t pos = 0; pos < data.size(); pos += chunk) {
+                    checksum.update({data.data() + pos, std::min(chunk, data.size() - pos)});
+                }
+
+                check(Tftp_checksum::get_name(algorithms[i]), vector.length, chunk, checksum.digest(), expected[i]);
+            }
+
+            check("crc32c (table)", vector.length, chunk, crc32c_table(data, chunk), vector.crc32c);
+            checks += 4;
+        }
+    }
+
+    std::cout << "test_checksum: " << checks << " digests, " << failures << " mismatches - "
+        << ((failures == 0)? "ok" : "FAILED") << std::endl;
+    return (failures == 0)? EXIT_SUCCESS : EXIT_FAILURE;
+}
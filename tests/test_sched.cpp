@@ -0,0 +1,84 @@
+/*
+ * @author Jakub Šuráň (xsuran07)
+ * @file test_sched.cpp
+ * @brief Checks choice of priority class by executor - aging of long waiting jobs.
+ */
+
+#include <iostream>
+#include <stdlib.h>
+
+#include "tftp_executor.h"
+
+static const int HIGH = Tftp_parameters::PRIORITY_HIGH;
+static const int NORMAL = Tftp_parameters::PRIORITY_NORMAL;
+static const int LOW = Tftp_parameters::PRIORITY_LOW;
+
+static size_t failures = 0;
+
+// HELPERS
+
+// times of submission of the oldest job of classes high, normal and low (-1 = no job) checked at time now
+static void check(const char *name, int64_t high, int64_t normal, int64_t low, int last, int64_t now, int expected)
+{
+    int64_t oldest[] = {high, normal, low};
+    int chosen = Tftp_executor::choose_class(oldest, last, now);
+
+    if(chosen != expected) {
+        std::cerr << "test_sched: " << name << " chose class " << chosen << ", expected " << expected << "!"
+            << std::endl;
+        failures++;
+    }
+}
+
+int main()
+{
+    size_t checks = 0;
+
+    // jobs waiting equally are taken by priority
+    check("equal waiting", 0, 0, 0, LOW, 1000, HIGH);
+    check("equal long waiting", 0, 0, 0, LOW, 10 * SCHED_AGING, HIGH);
+    check("empty classes", -1, -1, 0, LOW, 0, LOW);
+    check("no jobs", -1, -1, -1, LOW, 0, -1);
+    checks += 4;
+
+    // low job waiting longer by more than two agings overtakes fresh high one
+    check("low promoted over high", 2 * SCHED_AGING + 1, -1, 0, LOW, 2 * SCHED_AGING + 1, LOW);
+    check("low promoted over normal", -1, SCHED_AGING + 1, 0, LOW, SCHED_AGING + 1, LOW);
+    check("low not yet promoted", 2 * SCHED_AGING - 1, -1, 0, LOW, 2 * SCHED_AGING, HIGH);
+    checks += 3;
+
+    // equal aged ranks go to the longer waiting job
+    check("tie low over high", 2 * SCHED_AGING, -1, 0, LOW, 2 * SCHED_AGING, LOW);
+    check("tie normal over high", SCHED_AGING, 0, -1, LOW, 3 * SCHED_AGING, NORMAL);
+    checks += 2;
+
+    // urgent choice takes only high class, however long others wait
+    check("urgent", 5 * SCHED_AGING, 0, 0, HIGH, 5 * SCHED_AGING, HIGH);
+    check("urgent without high", -1, 0, 0, HIGH, 5 * SCHED_AGING, -1);
+    checks += 2;
+
+    // mixed queues - high jobs keep coming every second, low job submitted at 0 waits for them
+    // only until it has waited two agings longer than the oldest high job
+    int64_t started = -1;
+
+    for(int64_t now = 0; now <= 3 * SCHED_AGING; now += 1000) {
+        int64_t oldest[] = {now, now, 0};
+
+        if(Tftp_executor::choose_class(oldest, LOW, now) == LOW) {
+            started = now;
+            break;
+        }
+    }
+
+    if(started != 2 * SCHED_AGING) {
+        std::cerr << "test_sched: low job among stream of high ones started at " << started << " ms, expected "
+            << 2 * SCHED_AGING << " ms!" << std::endl;
+        failures++;
+    }
+
+    checks++;
+
+    std::cout << "test_sched: " << checks << " choices, " << failures << " wrong - "
+        << ((failures == 0)? "ok" : "FAILED") << std::endl;
+    return (failures == 0)? EXIT_SUCCESS : EXIT_FAILURE;
+}
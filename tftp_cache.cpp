@@ -0,0 +1,266 @@
+/*
+ * @author Jakub Šuráň (xsuran07)
+ * @file tftp_cache.cpp
+ * @brief Implementation of local cache of downloaded files.
+ */
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <charconv>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include "tftp_cache.h"
+#include "tftp_checksum.h"
+
+#define TMP_PREFIX ".tmp." // prefix of files being downloaded, followed by pid of owner
+
+// PUBLIC INSTANCE METHODS
+
+// constructor
+Tftp_cache::Tftp_cache()
+{
+    this->budget = CACHE_BUDGET;
+    this->stats = {0, 0, 0, 0, 0, 0};
+    this->next_tmp = 0;
+}
+
+Tftp_cache &Tftp_cache::instance()
+{
+    static Tftp_cache cache;
+
+    return cache;
+}
+
+bool Tftp_cache::configure(const std::string &dir, uint64_t budget)
+{
+    struct stat st;
+    std::lock_guard<std::mutex> guard(this->lock);
+
+    if(mkdir(dir.c_str(), 0755) == -1 && errno != EEXIST) {
+        std::cerr << "Cannot create cache directory " << dir << " - " << strerror(errno) << "!" << std::endl;
+        return false;
+    }
+
+    if(stat(dir.c_str(), &st) == -1 || !S_ISDIR(st.st_mode)) {
+        std::cerr << "Cache directory " << dir << " isn't directory!" << std::endl;
+        return false;
+    }
+
+    this->dir = dir;
+    this->budget = budget;
+    this->stats.budget = budget;
+    load();
+    evict();
+    return true;
+}
+
+bool Tftp_cache::is_enabled()
+{
+    std::lock_guard<std::mutex> guard(this->lock);
+
+    return !this->dir.empty();
+}
+
+int Tftp_cache::lookup(const std::string &key, uint64_t size)
+{
+    std::string name = entry_name(key);
+    std::lock_guard<std::mutex> guard(this->lock);
+    std::string path = this->dir + "/" + name;
+    auto it = this->index.find(name);
+    struct stat st;
+    int fd;
+
+    // entry may have been removed or stored by another process sharing directory
+    if((fd = open(path.c_str(), O_RDONLY | O_CLOEXEC)) != -1 &&
+        (fstat(fd, &st) == -1 || (uint64_t) st.st_size != size)) {
+        close(fd);
+        fd = -1;
+    }
+
+    if(fd == -1) {
+        if(it != this->index.end()) {
+            this->stats.used -= it->second->size;
+            this->stats.entries--;
+            this->lru.erase(it->second);
+            this->index.erase(it);
+        }
+
+        this->stats.misses++;
+        return -1;
+    }
+
+    if(it == this->index.end()) {
+        this->lru.push_front({name, size});
+        this->index[name] = this->lru.begin();
+        this->stats.used += size;
+        this->stats.entries++;
+    } else {
+        this->lru.splice(this->lru.begin(), this->lru, it->second);
+    }
+
+    // time of modification keeps order of use for the next run
+    futimens(fd, nullptr);
+
+    this->stats.hits++;
+    this->stats.saved += size;
+    evict();
+    return fd;
+}
+
+int Tftp_cache::create(std::string &tmp)
+{
+    std::lock_guard<std::mutex> guard(this->lock);
+
+    tmp = this->dir + "/" TMP_PREFIX + std::to_string(getpid()) + "." + std::to_string(this->next_tmp++);
+
+    return open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_EXCL | O_CLOEXEC, 0644);
+}
+
+bool Tftp_cache::store(const std::string &key, const std::string &tmp, uint64_t size)
+{
+    std::string name = entry_name(key);
+    std::lock_guard<std::mutex> guard(this->lock);
+
+    if(size > this->budget || rename(tmp.c_str(), (this->dir + "/" + name).c_str()) == -1) {
+        unlink(tmp.c_str());
+        return false;
+    }
+
+    // the same file has been downloaded by more transfers at once
+    auto it = this->index.find(name);
+    if(it != this->index.end()) {
+        this->stats.used -= it->second->size;
+        this->stats.entries--;
+        this->lru.erase(it->second);
+    }
+
+    this->lru.push_front({name, size});
+    this->index[name] = this->lru.begin();
+    this->stats.used += size;
+    this->stats.entries++;
+    evict();
+    return true;
+}
+
+void Tftp_cache::discard(const std::string &tmp)
+{
+    unlink(tmp.c_str());
+}
+
+bool Tftp_cache::fits(uint64_t size)
+{
+    std::lock_guard<std::mutex> guard(this->lock);
+
+    return size <= this->budget;
+}
+
+Tftp_cache::stats_t Tftp_cache::get_stats()
+{
+    std::lock_guard<std::mutex> guard(this->lock);
+
+    return this->stats;
+}
+
+void Tftp_cache::print_stats(std::ostream &out)
+{
+    stats_t s = get_stats();
+
+    out << "Cache - " << s.hits << " hits, " << s.misses << " misses, " << s.saved << " bytes served from cache, "
+        << s.entries << " entries using " << s.used << " of " << s.budget << " bytes" << std::endl;
+}
+
+// PRIVATE INSTANCE METHODS
+
+void Tftp_cache::load()
+{
+    std::vector<std::pair<int64_t, entry_t>> found;
+    struct dirent *ent;
+    struct stat st;
+    DIR *d;
+
+    this->lru.clear();
+    this->index.clear();
+    this->stats.used = 0;
+    this->stats.entries = 0;
+
+    if((d = opendir(this->dir.c_str())) == nullptr) {
+        return;
+    }
+
+    while((ent = readdir(d)) != nullptr) {
+        std::string_view name(ent->d_name);
+        std::string path = this->dir + "/" + ent->d_name;
+
+        // temporary file of process which has crashed during download
+        if(name.substr(0, strlen(TMP_PREFIX)) == TMP_PREFIX) {
+            int pid = atoi(ent->d_name + strlen(TMP_PREFIX));
+
+            if(pid > 0 && kill(pid, 0) == -1 && errno == ESRCH) {
+                unlink(path.c_str());
+            }
+
+            continue;
+        }
+
+        if(name.size() != Tftp_checksum::get_length(Tftp_parameters::CHECKSUM_XXH3) ||
+            name.find_first_not_of("0123456789abcdef") != std::string_view::npos) {
+            continue;
+        }
+
+        if(stat(path.c_str(), &st) == -1 || !S_ISREG(st.st_mode)) {
+            continue;
+        }
+
+        found.push_back({(int64_t) st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec,
+            {ent->d_name, (uint64_t) st.st_size}});
+    }
+
+    closedir(d);
+
+    // the most recently used entries first
+    std::sort(found.begin(), found.end(), [](const auto &a, const auto &b) {
+        return a.first > b.first;
+    });
+
+    for(auto &item : found) {
+        this->lru.push_back(item.second);
+        this->index[item.second.name] = std::prev(this->lru.end());
+        this->stats.used += item.second.size;
+        this->stats.entries++;
+    }
+}
+
+void Tftp_cache::evict()
+{
+    while(this->stats.used > this->budget && !this->lru.empty()) {
+        entry_t &victim = this->lru.back();
+
+        unlink((this->dir + "/" + victim.name).c_str());
+        this->stats.used -= victim.size;
+        this->stats.entries--;
+        this->index.erase(victim.name);
+        this->lru.pop_back();
+    }
+}
+
+// STATIC METHODS
+
+std::string Tftp_cache::make_key(const std::string &address, int port, const std::string &filename, uint64_t size)
+{
+    return address + "," + std::to_string(port) + ":" + filename + ":" + std::to_string(size);
+}
+
+std::string Tftp_cache::entry_name(const std::string &key)
+{
+    Tftp_checksum hash(Tftp_parameters::CHECKSUM_XXH3);
+
+    hash.update({(const uint8_t *) key.data(), key.size()});
+    return hash.digest();
+}
@@ -0,0 +1,160 @@
+/*
+ * @author Jakub Šuráň (xsuran07)
+ * @file tftp_cache.h
+ * @brief Interface of local cache of downloaded files.
+ */
+
+#ifndef __TFTP_CACHE_H_
+#define __TFTP_CACHE_H_
+
+#include <string>
+#include <string_view>
+#include <list>
+#include <unordered_map>
+#include <mutex>
+#include <ostream>
+#include <stdint.h>
+
+#define CACHE_BUDGET (1024ULL * 1024 * 1024) // default maximal size of all cached files
+
+/**
+ * @brief Local cache of downloaded files shared by all transfers. Entries are
+ * keyed by server, remote path and size of file (tsize) and stored as files in
+ * cache directory, so they survive restart of application. When total size of
+ * entries exceeds budget, the least recently used ones are removed.
+ */
+class Tftp_cache
+{
+    public:
+        /**
+         * @brief Statistics of cache.
+         */
+        typedef struct {
+            uint64_t hits; // downloads served from cache
+            uint64_t misses; // downloads which had to go through network
+            uint64_t saved; // bytes served from cache
+            uint64_t entries; // number of cached files
+            uint64_t used; // total size of cached files
+            uint64_t budget;
+        } stats_t;
+
+    private:
+        /**
+         * @brief Cached file.
+         */
+        typedef struct {
+            std::string name; // name of file in cache directory
+            uint64_t size;
+        } entry_t;
+
+        std::string dir; // empty if cache is disabled
+        uint64_t budget;
+        std::list<entry_t> lru; // the most recently used entry first
+        std::unordered_map<std::string, std::list<entry_t>::iterator> index; // name of file => entry
+        stats_t stats;
+        uint64_t next_tmp; // counter of temporary files
+        std::mutex lock;
+
+    public:
+        /**
+         * @brief Constructor. Cache is disabled until configure is called.
+         */
+        Tftp_cache();
+
+        Tftp_cache(const Tftp_cache &) = delete;
+        Tftp_cache &operator=(const Tftp_cache &) = delete;
+
+        /**
+         * @brief Static method. Returns cache shared by all transfers.
+         */
+        static Tftp_cache &instance();
+
+        /**
+         * @brief Enables cache in given directory (it is created if it doesn't exist).
+         * Entries left by previous runs are taken over in order of their last use.
+         * @param dir Cache directory.
+         * @param budget Maximal size of all cached files in bytes.
+         * @returns true in case of success, false otherwise.
+         */
+        bool configure(const std::string &dir, uint64_t budget = CACHE_BUDGET);
+
+        /**
+         * @brief Checks if cache is enabled.
+         */
+        bool is_enabled();
+
+        /**
+         * @brief Looks up cached file and counts hit or miss.
+         * @param key Key of file (see make_key).
+         * @param size Size of file.
+         * @returns descriptor of cached file opened for reading (caller closes it)
+         * or -1 if file isn't cached.
+         */
+        int lookup(const std::string &key, uint64_t size);
+
+        /**
+         * @brief Creates temporary file in cache directory for file being downloaded.
+         * @param tmp Variable to store path of temporary file into.
+         * @returns descriptor of temporary file opened for writing or -1 in case of error.
+         */
+        int create(std::string &tmp);
+
+        /**
+         * @brief Turns completely downloaded temporary file into cache entry and
+         * evicts the least recently used entries if budget is exceeded.
+         * @param key Key of file.
+         * @param tmp Path of temporary file (returned by create).
+         * @param size Size of file.
+         * @returns true if file has been stored, false otherwise (temporary file is removed).
+         */
+        bool store(const std::string &key, const std::string &tmp, uint64_t size);
+
+        /**
+         * @brief Removes temporary file of failed download.
+         * @param tmp Path of temporary file.
+         */
+        void discard(const std::string &tmp);
+
+        /**
+         * @brief Checks if file of given size may be cached at all.
+         */
+        bool fits(uint64_t size);
+
+        /**
+         * @brief Getter for snapshot of statistics.
+         */
+        stats_t get_stats();
+
+        /**
+         * @brief Prints statistics of cache as one line.
+         * @param out Stream to print statistics into.
+         */
+        void print_stats(std::ostream &out);
+
+        /**
+         * @brief Static method. Creates key identifying version of file on server.
+         * @param address Address of server.
+         * @param port Port of server.
+         * @param filename Remote path of file.
+         * @param size Size of file announced by server (tsize).
+         */
+        static std::string make_key(const std::string &address, int port, const std::string &filename, uint64_t size);
+
+    private:
+        /**
+         * @brief Loads entries left in cache directory. Caller holds lock.
+         */
+        void load();
+
+        /**
+         * @brief Removes the least recently used entries till budget is kept. Caller holds lock.
+         */
+        void evict();
+
+        /**
+         * @brief Static method. Derives name of cache file from key.
+         */
+        static std::string entry_name(const std::string &key);
+};
+
+#endif
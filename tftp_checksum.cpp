@@ -0,0 +1,633 @@
+/*
+ * @author Jakub Šuráň (xsuran07)
+ * @file tftp_checksum.cpp
+ * @brief Implementation of incremental checksums of transferred data (CRC32C, XXH3, SHA-256).
+ */
+
+#include <iostream>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <vector>
+#include <algorithm>
+#include <string.h>
+#include <ctype.h>
+
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#endif
+
+#include "tftp_checksum.h"
+
+#define STRIPE_LEN 64
+#define SECRET_SIZE 192
+#define STRIPES_PER_BLOCK ((SECRET_SIZE - STRIPE_LEN) / 8)
+#define SECRET_LIMIT (SECRET_SIZE - STRIPE_LEN)
+#define MIDSIZE_MAX 240
+
+static const uint64_t PRIME32_1 = 0x9E3779B1ULL;
+static const uint64_t PRIME32_2 = 0x85EBCA77ULL;
+static const uint64_t PRIME32_3 = 0xC2B2AE3DULL;
+static const uint64_t PRIME64_1 = 0x9E3779B185EBCA87ULL;
+static const uint64_t PRIME64_2 = 0xC2B2AE3D27D4EB4FULL;
+static const uint64_t PRIME64_3 = 0x165667B19E3779F9ULL;
+static const uint64_t PRIME64_4 = 0x85EBCA77C2B2AE63ULL;
+static const uint64_t PRIME64_5 = 0x27D4EB2F165667C5ULL;
+static const uint64_t PRIME_MX1 = 0x165667919E3779F9ULL;
+static const uint64_t PRIME_MX2 = 0x9FB21C651E98DF25ULL;
+
+// default secret of XXH3
+static const uint8_t SECRET[SECRET_SIZE] = {
+    0xb8, 0xfe, 0x6c, 0x39, 0x23, 0xa4, 0x4b, 0xbe, 0x7c, 0x01, 0x81, 0x2c, 0xf7, 0x21, 0xad, 0x1c,
+    0xde, 0xd4, 0x6d, 0xe9, 0x83, 0x90, 0x97, 0xdb, 0x72, 0x40, 0xa4, 0xa4, 0xb7, 0xb3, 0x67, 0x1f,
+    0xcb, 0x79, 0xe6, 0x4e, 0xcc, 0xc0, 0xe5, 0x78, 0x82, 0x5a, 0xd0, 0x7d, 0xcc, 0xff, 0x72, 0x21,
+    0xb8, 0x08, 0x46, 0x74, 0xf7, 0x43, 0x24, 0x8e, 0xe0, 0x35, 0x90, 0xe6, 0x81, 0x3a, 0x26, 0x4c,
+    0x3c, 0x28, 0x52, 0xbb, 0x91, 0xc3, 0x00, 0xcb, 0x88, 0xd0, 0x65, 0x8b, 0x1b, 0x53, 0x2e, 0xa3,
+    0x71, 0x64, 0x48, 0x97, 0xa2, 0x0d, 0xf9, 0x4e, 0x38, 0x19, 0xef, 0x46, 0xa9, 0xde, 0xac, 0xd8,
+    0xa8, 0xfa, 0x76, 0x3f, 0xe3, 0x9c, 0x34, 0x3f, 0xf9, 0xdc, 0xbb, 0xc7, 0xc7, 0x0b, 0x4f, 0x1d,
+    0x8a, 0x51, 0xe0, 0x4b, 0xcd, 0xb4, 0x59, 0x31, 0xc8, 0x9f, 0x7e, 0xc9, 0xd9, 0x78, 0x73, 0x64,
+    0xea, 0xc5, 0xac, 0x83, 0x34, 0xd3, 0xeb, 0xc3, 0xc5, 0x81, 0xa0, 0xff, 0xfa, 0x13, 0x63, 0xeb,
+    0x17, 0x0d, 0xdd, 0x51, 0xb7, 0xf0, 0xda, 0x49, 0xd3, 0x16, 0x55, 0x26, 0x29, 0xd4, 0x68, 0x9e,
+    0x2b, 0x16, 0xbe, 0x58, 0x7d, 0x47, 0xa1, 0xfc, 0x8f, 0xf8, 0xb8, 0xd1, 0x7a, 0xd0, 0x31, 0xce,
+    0x45, 0xcb, 0x3a, 0x8f, 0x95, 0x16, 0x04, 0x28, 0xaf, 0xd7, 0xfb, 0xca, 0xbb, 0x4b, 0x40, 0x7e,
+};
+
+static const uint32_t SHA256_K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+// HELPERS
+
+static inline uint32_t read32(const uint8_t *p)
+{
+    uint32_t v;
+
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint64_t read64(const uint8_t *p)
+{
+    uint64_t v;
+
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint64_t rotl64(uint64_t v, int r)
+{
+    return (v << r) | (v >> (64 - r));
+}
+
+static inline uint32_t rotr32(uint32_t v, int r)
+{
+    return (v >> r) | (v << (32 - r));
+}
+
+static inline uint64_t mul128_fold64(uint64_t a, uint64_t b)
+{
+    __uint128_t product = (__uint128_t) a * b;
+
+    return (uint64_t) product ^ (uint64_t) (product >> 64);
+}
+
+static inline uint64_t xxh64_avalanche(uint64_t h)
+{
+    h ^= h >> 33;
+    h *= PRIME64_2;
+    h ^= h >> 29;
+    h *= PRIME64_3;
+    return h ^ (h >> 32);
+}
+
+static inline uint64_t xxh3_avalanche(uint64_t h)
+{
+    h ^= h >> 37;
+    h *= PRIME_MX1;
+    return h ^ (h >> 32);
+}
+
+static inline uint64_t xxh3_rrmxmx(uint64_t h, uint64_t len)
+{
+    h ^= rotl64(h, 49) ^ rotl64(h, 24);
+    h *= PRIME_MX2;
+    h ^= (h >> 35) + len;
+    h *= PRIME_MX2;
+    return h ^ (h >> 28);
+}
+
+static inline uint64_t xxh3_mix16(const uint8_t *input, const uint8_t *secret)
+{
+    return mul128_fold64(read64(input) ^ read64(secret), read64(input + 8) ^ read64(secret + 8));
+}
+
+// whole XXH3 of short input (up to 240 bytes)
+static uint64_t xxh3_short(const uint8_t *input, size_t len)
+{
+    uint64_t acc;
+
+    if(len == 0) {
+        return xxh64_avalanche(read64(SECRET + 56) ^ read64(SECRET + 64));
+    }
+
+    if(len <= 3) {
+        uint32_t combined = ((uint32_t) input[0] << 16) | ((uint32_t) input[len >> 1] << 24) |
+            input[len - 1] | ((uint32_t) len << 8);
+
+        return xxh64_avalanche(combined ^ (uint64_t) (read32(SECRET) ^ read32(SECRET + 4)));
+    }
+
+    if(len <= 8) {
+        uint64_t input64 = read32(input + len - 4) + ((uint64_t) read32(input) << 32);
+
+        return xxh3_rrmxmx(input64 ^ (read64(SECRET + 8) ^ read64(SECRET + 16)), len);
+    }
+
+    if(len <= 16) {
+        uint64_t lo = read64(input) ^ (read64(SECRET + 24) ^ read64(SECRET + 32));
+        uint64_t hi = read64(input + len - 8) ^ (read64(SECRET + 40) ^ read64(SECRET + 48));
+
+        return xxh3_avalanche(len + __builtin_bswap64(lo) + hi + mul128_fold64(lo, hi));
+    }
+
+    acc = len * PRIME64_1;
+
+    if(len <= 128) {
+        if(len > 32) {
+            if(len > 64) {
+                if(len > 96) {
+                    acc += xxh3_mix16(input + 48, SECRET + 96);
+                    acc += xxh3_mix16(input + len - 64, SECRET + 112);
+                }
+
+                acc += xxh3_mix16(input + 32, SECRET + 64);
+                acc += xxh3_mix16(input + len - 48, SECRET + 80);
+            }
+
+            acc += xxh3_mix16(input + 16, SECRET + 32);
+            acc += xxh3_mix16(input + len - 32, SECRET + 48);
+        }
+
+        acc += xxh3_mix16(input, SECRET);
+        acc += xxh3_mix16(input + len - 16, SECRET + 16);
+        return xxh3_avalanche(acc);
+    }
+
+    for(size_t i = 0; i < 8; i++) {
+        acc += xxh3_mix16(input + 16 * i, SECRET + 16 * i);
+    }
+
+    acc = xxh3_avalanche(acc);
+
+    for(size_t i = 8; i < len / 16; i++) {
+        acc += xxh3_mix16(input + 16 * i, SECRET + 16 * (i - 8) + 3);
+    }
+
+    acc += xxh3_mix16(input + len - 16, SECRET + 136 - 17);
+    return xxh3_avalanche(acc);
+}
+
+static inline void xxh3_accumulate_512(uint64_t *acc, const uint8_t *input, const uint8_t *secret)
+{
+    for(size_t i = 0; i < 8; i++) {
+        uint64_t value = read64(input + 8 * i);
+        uint64_t key = value ^ read64(secret + 8 * i);
+
+        acc[i ^ 1] += value;
+        acc[i] += (key & 0xFFFFFFFF) * (key >> 32);
+    }
+}
+
+static inline void xxh3_scramble(uint64_t *acc, const uint8_t *secret)
+{
+    for(size_t i = 0; i < 8; i++) {
+        uint64_t a = acc[i];
+
+        a ^= a >> 47;
+        a ^= read64(secret + 8 * i);
+        acc[i] = a * PRIME32_1;
+    }
+}
+
+// accumulates given stripes, block of stripes is closed by scrambling
+static void xxh3_consume(uint64_t *acc, size_t &stripes, const uint8_t *input, size_t count)
+{
+    while(count > 0) {
+        size_t n = std::min(count, STRIPES_PER_BLOCK - stripes);
+
+        for(size_t i = 0; i < n; i++) {
+            xxh3_accumulate_512(acc, input + i * STRIPE_LEN, SECRET + (stripes + i) * 8);
+        }
+
+        stripes += n;
+        input += n * STRIPE_LEN;
+        count -= n;
+
+        if(stripes == STRIPES_PER_BLOCK) {
+            xxh3_scramble(acc, SECRET + SECRET_LIMIT);
+            stripes = 0;
+        }
+    }
+}
+
+#if defined(__x86_64__)
+__attribute__((target("sse4.2")))
+static uint32_t crc32c_hw(uint32_t crc, const uint8_t *data, size_t len)
+{
+    uint64_t c = crc;
+
+    // 8 bytes per instruction, the rest byte by byte
+    for(; len >= 8; data += 8, len -= 8) {
+        c = _mm_crc32_u64(c, read64(data));
+    }
+
+    for(; len > 0; data++, len--) {
+        c = _mm_crc32_u8(c, *data);
+    }
+
+    return c;
+}
+#endif
+
+static uint32_t crc32c_sw(uint32_t crc, const uint8_t *data, size_t len)
+{
+    static uint32_t table[256];
+    static std::once_flag initialized;
+
+    std::call_once(initialized, [] {
+        for(uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+
+            for(int k = 0; k < 8; k++) {
+                c = (c & 1)? (c >> 1) ^ 0x82F63B78 : c >> 1;
+            }
+
+            table[i] = c;
+        }
+    });
+
+    for(; len > 0; data++, len--) {
+        crc = table[(crc ^ *data) & 0xFF] ^ (crc >> 8);
+    }
+
+    return crc;
+}
+
+// PUBLIC INSTANCE METHODS
+
+// constructor
+Tftp_checksum::Tftp_checksum(Tftp_parameters::checksum_t algorithm)
+{
+    reset(algorithm);
+}
+
+void Tftp_checksum::reset(Tftp_parameters::checksum_t algorithm)
+{
+    static const uint64_t init_acc[8] = {PRIME32_3, PRIME64_1, PRIME64_2, PRIME64_3, PRIME64_4, PRIME32_2, PRIME64_5, PRIME32_1};
+    static const uint32_t init_h[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+
+    this->algorithm = algorithm;
+    this->crc = 0;
+
+    memcpy(this->xxh3.acc, init_acc, sizeof(init_acc));
+    this->xxh3.buffered = 0;
+    this->xxh3.stripes = 0;
+    this->xxh3.total = 0;
+
+    memcpy(this->sha256.h, init_h, sizeof(init_h));
+    this->sha256.buffered = 0;
+    this->sha256.total = 0;
+}
+
+void Tftp_checksum::update(byte_span_t data)
+{
+    switch(this->algorithm) {
+    case Tftp_parameters::CHECKSUM_CRC32C:
+        this->crc = crc32c(this->crc, data);
+        break;
+    case Tftp_parameters::CHECKSUM_XXH3:
+        xxh3_update(data);
+        break;
+    case Tftp_parameters::CHECKSUM_SHA256:
+        sha256_update(data);
+        break;
+    default:
+        break;
+    }
+}
+
+std::string Tftp_checksum::digest()
+{
+    uint8_t out[32];
+    size_t len = 0;
+    std::string res;
+    uint64_t v;
+
+    switch(this->algorithm) {
+    case Tftp_parameters::CHECKSUM_CRC32C:
+        for(int i = 3; i >= 0; i--) {
+            out[len++] = this->crc >> (8 * i);
+        }
+        break;
+    case Tftp_parameters::CHECKSUM_XXH3:
+        v = xxh3_digest();
+        for(int i = 7; i >= 0; i--) {
+            out[len++] = v >> (8 * i);
+        }
+        break;
+    case Tftp_parameters::CHECKSUM_SHA256:
+        sha256_digest(out);
+        len = 32;
+        break;
+    default:
+        return "";
+    }
+
+    for(size_t i = 0; i < len; i++) {
+        res += "0123456789abcdef"[out[i] >> 4];
+        res += "0123456789abcdef"[out[i] & 0xF];
+    }
+
+    return res;
+}
+
+// STATIC METHODS
+
+const char *Tftp_checksum::get_name(Tftp_parameters::checksum_t algorithm)
+{
+    switch(algorithm) {
+    case Tftp_parameters::CHECKSUM_CRC32C:
+        return "crc32c";
+    case Tftp_parameters::CHECKSUM_XXH3:
+        return "xxh3";
+    case Tftp_parameters::CHECKSUM_SHA256:
+        return "sha256";
+    default:
+        return "none";
+    }
+}
+
+size_t Tftp_checksum::get_length(Tftp_parameters::checksum_t algorithm)
+{
+    switch(algorithm) {
+    case Tftp_parameters::CHECKSUM_CRC32C:
+        return 8;
+    case Tftp_parameters::CHECKSUM_XXH3:
+        return 16;
+    case Tftp_parameters::CHECKSUM_SHA256:
+        return 64;
+    default:
+        return 0;
+    }
+}
+
+bool Tftp_checksum::lookup_manifest(const std::string &manifest, const std::string &filename, std::string &digest)
+{
+    static std::mutex lock;
+    static std::map<std::string, std::map<std::string, std::string, std::less<>>> cache;
+    std::lock_guard<std::mutex> guard(lock);
+    auto it = cache.find(manifest);
+
+    // manifest is parsed only once for all jobs
+    if(it == cache.end()) {
+        std::ifstream in(manifest);
+        std::string line;
+
+        if(!in.is_open()) {
+            std::cerr << "Cannot open manifest " << manifest << "!" << std::endl;
+            return false;
+        }
+
+        it = cache.emplace(manifest, std::map<std::string, std::string, std::less<>>()).first;
+
+        while(std::getline(in, line)) {
+            size_t end = line.find_first_of(" \t");
+            size_t name = line.find_first_not_of(" \t*", end);
+
+            if(end == std::string::npos || name == std::string::npos) {
+                continue;
+            }
+
+            std::string value = line.substr(0, end);
+
+            std::transform(value.begin(), value.end(), value.begin(), ::tolower);
+            it->second[line.substr(name)] = value;
+        }
+    }
+
+    // the whole remote path or only name of file
+    std::string_view name(filename);
+    auto entry = it->second.find(name);
+
+    if(entry == it->second.end()) {
+        name.remove_prefix(name.rfind('/') + 1);
+        entry = it->second.find(name);
+    }
+
+    if(entry == it->second.end()) {
+        return false;
+    }
+
+    digest = entry->second;
+    return true;
+}
+
+uint32_t Tftp_checksum::crc32c(uint32_t crc, byte_span_t data)
+{
+#if defined(__x86_64__)
+    static const bool hw = __builtin_cpu_supports("sse4.2");
+
+    if(hw) {
+        return ~crc32c_hw(~crc, data.data, data.size);
+    }
+#endif
+
+    return crc32c_table(crc, data);
+}
+
+uint32_t Tftp_checksum::crc32c_table(uint32_t crc, byte_span_t data)
+{
+    return ~crc32c_sw(~crc, data.data, data.size);
+}
+
+// PRIVATE INSTANCE METHODS
+
+void Tftp_checksum::xxh3_update(byte_span_t data)
+{
+    xxh3_state_t &s = this->xxh3;
+    const uint8_t *input = data.data;
+    const uint8_t *end = data.data + data.size;
+
+    s.total += data.size;
+
+    // short input is only collected, it may be hashed by short variant
+    if(s.buffered + data.size <= XXH3_BUFFER) {
+        memcpy(s.buffer + s.buffered, input, data.size);
+        s.buffered += data.size;
+        return;
+    }
+
+    if(s.buffered > 0) {
+        size_t len = XXH3_BUFFER - s.buffered;
+
+        memcpy(s.buffer + s.buffered, input, len);
+        input += len;
+        xxh3_consume(s.acc, s.stripes, s.buffer, XXH3_BUFFER / STRIPE_LEN);
+        s.buffered = 0;
+    }
+
+    // at least one byte is always kept for digest (the last stripe is special)
+    if(end - input > XXH3_BUFFER) {
+        size_t count = (end - input - 1) / STRIPE_LEN;
+
+        xxh3_consume(s.acc, s.stripes, input, count);
+        input += count * STRIPE_LEN;
+
+        // the last stripe may be needed by digest
+        memcpy(s.buffer + XXH3_BUFFER - STRIPE_LEN, input - STRIPE_LEN, STRIPE_LEN);
+    }
+
+    memcpy(s.buffer, input, end - input);
+    s.buffered = end - input;
+}
+
+uint64_t Tftp_checksum::xxh3_digest()
+{
+    xxh3_state_t &s = this->xxh3;
+    uint8_t last[STRIPE_LEN];
+    const uint8_t *last_stripe;
+    uint64_t acc[8];
+    size_t stripes = s.stripes;
+    uint64_t result;
+
+    if(s.total <= MIDSIZE_MAX) {
+        return xxh3_short(s.buffer, s.total);
+    }
+
+    // state stays unchanged, so more data may be added later
+    memcpy(acc, s.acc, sizeof(acc));
+
+    if(s.buffered >= STRIPE_LEN) {
+        size_t count = (s.buffered - 1) / STRIPE_LEN;
+
+        xxh3_consume(acc, stripes, s.buffer, count);
+        last_stripe = s.buffer + s.buffered - STRIPE_LEN;
+    } else {
+        // the last stripe consists of end of previous data and buffered data
+        size_t catchup = STRIPE_LEN - s.buffered;
+
+        memcpy(last, s.buffer + XXH3_BUFFER - catchup, catchup);
+        memcpy(last + catchup, s.buffer, s.buffered);
+        last_stripe = last;
+    }
+
+    xxh3_accumulate_512(acc, last_stripe, SECRET + SECRET_LIMIT - 7);
+
+    result = s.total * PRIME64_1;
+    for(size_t i = 0; i < 4; i++) {
+        result += mul128_fold64(acc[2 * i] ^ read64(SECRET + 11 + 16 * i), acc[2 * i + 1] ^ read64(SECRET + 11 + 16 * i + 8));
+    }
+
+    return xxh3_avalanche(result);
+}
+
+void Tftp_checksum::sha256_update(byte_span_t data)
+{
+    sha256_state_t &s = this->sha256;
+    const uint8_t *input = data.data;
+    size_t len = data.size;
+
+    s.total += len;
+
+    if(s.buffered > 0) {
+        size_t n = std::min(len, SHA256_BLOCK - s.buffered);
+
+        memcpy(s.buffer + s.buffered, input, n);
+        s.buffered += n;
+        input += n;
+        len -= n;
+
+        if(s.buffered < SHA256_BLOCK) {
+            return;
+        }
+
+        sha256_block(s.buffer);
+        s.buffered = 0;
+    }
+
+    // whole blocks are processed directly from data
+    for(; len >= SHA256_BLOCK; input += SHA256_BLOCK, len -= SHA256_BLOCK) {
+        sha256_block(input);
+    }
+
+    memcpy(s.buffer, input, len);
+    s.buffered = len;
+}
+
+void Tftp_checksum::sha256_block(const uint8_t *block)
+{
+    uint32_t *h = this->sha256.h;
+    uint32_t w[64];
+    uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4], f = h[5], g = h[6], k = h[7];
+
+    for(int i = 0; i < 16; i++) {
+        w[i] = __builtin_bswap32(read32(block + 4 * i));
+    }
+
+    for(int i = 16; i < 64; i++) {
+        uint32_t s0 = rotr32(w[i - 15], 7) ^ rotr32(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = rotr32(w[i - 2], 17) ^ rotr32(w[i - 2], 19) ^ (w[i - 2] >> 10);
+
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    for(int i = 0; i < 64; i++) {
+        uint32_t t1 = k + (rotr32(e, 6) ^ rotr32(e, 11) ^ rotr32(e, 25)) + ((e & f) ^ (~e & g)) + SHA256_K[i] + w[i];
+        uint32_t t2 = (rotr32(a, 2) ^ rotr32(a, 13) ^ rotr32(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+
+        k = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+
+    h[0] += a;
+    h[1] += b;
+    h[2] += c;
+    h[3] += d;
+    h[4] += e;
+    h[5] += f;
+    h[6] += g;
+    h[7] += k;
+}
+
+void Tftp_checksum::sha256_digest(uint8_t *out)
+{
+    sha256_state_t &s = this->sha256;
+    uint64_t bits = s.total * 8;
+    uint8_t pad[SHA256_BLOCK * 2] = {0x80};
+    size_t len = (s.buffered < 56)? 56 - s.buffered : 120 - s.buffered;
+
+    for(int i = 0; i < 8; i++) {
+        pad[len + i] = bits >> (56 - 8 * i);
+    }
+
+    sha256_update({pad, len + 8});
+
+    for(int i = 0; i < 8; i++) {
+        uint32_t v = __builtin_bswap32(s.h[i]);
+
+        memcpy(out + 4 * i, &v, sizeof(v));
+    }
+}
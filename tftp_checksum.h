@@ -0,0 +1,149 @@
+/*
+ * @author Jakub Šuráň (xsuran07)
+ * @file tftp_checksum.h
+ * @brief Interface of incremental checksums of transferred data (CRC32C, XXH3, SHA-256).
+ */
+
+#ifndef __TFTP_CHECKSUM_H_
+#define __TFTP_CHECKSUM_H_
+
+#include <string>
+#include <string_view>
+#include <stdint.h>
+
+#include "tftp_codec.h"
+#include "tftp_parameters.h"
+
+#define XXH3_BUFFER 256 // data are passed to XXH3 accumulators in 4 stripes of 64 bytes
+#define SHA256_BLOCK 64
+
+/**
+ * @brief Checksum computed incrementally from data blocks as they are sent
+ * or received, so data don't have to be read again after transfer.
+ */
+class Tftp_checksum
+{
+    private:
+        /**
+         * @brief State of streaming XXH3 (64 bit variant, seed 0).
+         */
+        typedef struct {
+            uint64_t acc[8];
+            uint8_t buffer[XXH3_BUFFER];
+            size_t buffered;
+            size_t stripes; // number of stripes in current block
+            uint64_t total;
+        } xxh3_state_t;
+
+        /**
+         * @brief State of SHA-256.
+         */
+        typedef struct {
+            uint32_t h[8];
+            uint8_t buffer[SHA256_BLOCK];
+            size_t buffered;
+            uint64_t total;
+        } sha256_state_t;
+
+        Tftp_parameters::checksum_t algorithm;
+        uint32_t crc;
+        xxh3_state_t xxh3;
+        sha256_state_t sha256;
+
+    public:
+        /**
+         * @brief Constructor.
+         * @param algorithm Algorithm to compute (CHECKSUM_NONE computes nothing).
+         */
+        Tftp_checksum(Tftp_parameters::checksum_t algorithm = Tftp_parameters::CHECKSUM_NONE);
+
+        /**
+         * @brief Starts new computation.
+         * @param algorithm Algorithm to compute.
+         */
+        void reset(Tftp_parameters::checksum_t algorithm);
+
+        /**
+         * @brief Adds data to checksum.
+         * @param data Data to add.
+         */
+        void update(byte_span_t data);
+
+        /**
+         * @brief Returns checksum of all added data as lowercase hexadecimal string
+         * (big endian, same as sha256sum, xxhsum -H3 and crc32c tools print).
+         */
+        std::string digest();
+
+        /**
+         * @brief Getter for computed algorithm.
+         */
+        Tftp_parameters::checksum_t get_algorithm() const { return this->algorithm; };
+
+        /**
+         * @brief Static method. Returns name of algorithm.
+         */
+        static const char *get_name(Tftp_parameters::checksum_t algorithm);
+
+        /**
+         * @brief Static method. Returns number of hexadecimal digits of digest.
+         */
+        static size_t get_length(Tftp_parameters::checksum_t algorithm);
+
+        /**
+         * @brief Static method. Finds expected digest of file in manifest with lines
+         * "digest filename" (output of sha256sum, xxhsum, etc.). Filename matches either
+         * whole remote path or its last component. Manifests are loaded only once.
+         * @param manifest Path of manifest.
+         * @param filename Remote path of file.
+         * @param digest Found digest.
+         * @returns true if file has been found, false otherwise.
+         */
+        static bool lookup_manifest(const std::string &manifest, const std::string &filename, std::string &digest);
+
+        /**
+         * @brief Static method. Computes CRC32C (Castagnoli) - with SSE 4.2 instruction
+         * if processor supports it, by table otherwise.
+         * @param crc CRC of previous data (0 for the first call).
+         * @param data Data to add.
+         * @returns updated CRC.
+         */
+        static uint32_t crc32c(uint32_t crc, byte_span_t data);
+
+        /**
+         * @brief Static method. Computes CRC32C by table only (fallback of crc32c
+         * on processors without SSE 4.2).
+         * @param crc CRC of previous data (0 for the first call).
+         * @param data Data to add.
+         * @returns updated CRC.
+         */
+        static uint32_t crc32c_table(uint32_t crc, byte_span_t data);
+
+    private:
+        /**
+         * @brief Adds data to XXH3 state.
+         */
+        void xxh3_update(byte_span_t data);
+
+        /**
+         * @brief Returns XXH3 of all added data.
+         */
+        uint64_t xxh3_digest();
+
+        /**
+         * @brief Adds data to SHA-256 state.
+         */
+        void sha256_update(byte_span_t data);
+
+        /**
+         * @brief Processes one 64 byte block of SHA-256.
+         */
+        void sha256_block(const uint8_t *block);
+
+        /**
+         * @brief Returns SHA-256 of all added data (state is changed).
+         */
+        void sha256_digest(uint8_t *out);
+};
+
+#endif
@@ -17,21 +17,90 @@
 #include <net/if.h>
 #include <sys/types.h>
 #include <ifaddrs.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <poll.h>
+#include <algorithm>
 
 #include "tftp_client.h"
+#include "tftp_unpack.h"
+#include "tftp_cache.h"
+#include "tftp_sync.h"
+#include "tftp_flight.h"
+#include "tftp_mirrors.h"
+#include "tftp_resolver.h"
 
 #define TIMEOUT 5
 #define HARD_TIMEOUT (3*TIMEOUT + 1)
 #define UDP_HEADER 8
-#define TFTP_HEADER 4
 #define MAX_IP_HEADER 60
 #define MIN_BLOCK_SIZE 8
-#define MAX_REQUEST_SIZE 512
+#define MTU_CACHE_TTL 10000 // ms
+#define PACE_SLACK 1000000 // ns, shorter delay of packet is caught up by next packets
+#define MIRROR_STAGGER 250 // ms after which unanswered download request is sent to the next mirror too
+#define FAILOVER_RETRIES 2 // unanswered retransmissions after which stalled download continues from another mirror
 // #define DEBUG
 
+// HELPERS
+
+// converts ipv4 address into ipv4-mapped ipv6 address (for dual-stack socket)
+static void map_ipv4(struct sockaddr_storage *addr, size_t *len)
+{
+    struct sockaddr_in ipv4 = *(struct sockaddr_in *) addr;
+    struct sockaddr_in6 *ipv6 = (struct sockaddr_in6 *) addr;
+
+    if(addr->ss_family != AF_INET) {
+        return;
+    }
+
+    memset(addr, 0, sizeof(*addr));
+    ipv6->sin6_family = AF_INET6;
+    ipv6->sin6_port = ipv4.sin_port;
+    ipv6->sin6_addr.s6_addr[10] = 0xff;
+    ipv6->sin6_addr.s6_addr[11] = 0xff;
+    memcpy(&ipv6->sin6_addr.s6_addr[12], &ipv4.sin_addr.s_addr, 4);
+    *len = sizeof(struct sockaddr_in6);
+}
+
+// converts ipv4-mapped ipv6 address back into ipv4 one
+static struct sockaddr_storage unmap_ipv4(const struct sockaddr_storage *addr)
+{
+    struct sockaddr_storage res = *addr;
+    struct sockaddr_in6 *ipv6 = (struct sockaddr_in6 *) addr;
+    struct sockaddr_in *ipv4 = (struct sockaddr_in *) &res;
+
+    if(addr->ss_family == AF_INET6 && IN6_IS_ADDR_V4MAPPED(&ipv6->sin6_addr)) {
+        memset(&res, 0, sizeof(res));
+        ipv4->sin_family = AF_INET;
+        ipv4->sin_port = ipv6->sin6_port;
+        memcpy(&ipv4->sin_addr.s_addr, &ipv6->sin6_addr.s6_addr[12], 4);
+    }
+
+    return res;
+}
+
+// compares addresses without ports
+static bool same_host(const struct sockaddr_storage *a, const struct sockaddr_storage *b)
+{
+    if(a->ss_family != b->ss_family) {
+        return false;
+    }
+
+    if(a->ss_family == AF_INET) {
+        return ((struct sockaddr_in *) a)->sin_addr.s_addr == ((struct sockaddr_in *) b)->sin_addr.s_addr;
+    }
+
+    return memcmp(((struct sockaddr_in6 *) a)->sin6_addr.s6_addr, ((struct sockaddr_in6 *) b)->sin6_addr.s6_addr, 16) == 0;
+}
+
+// STATIC ATTRIBUTES
+
+std::mutex Tftp_client::output_lock;
+std::ostream *Tftp_client::log_stream = &std::cout;
+
 // STATIC METHODS
 
-void Tftp_client::print_timestamp()
+void Tftp_client::print_timestamp(std::ostream &out)
 {
     auto t = std::chrono::system_clock::now();
 
@@ -39,13 +108,16 @@ void Tftp_client::print_timestamp()
     auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(t.time_since_epoch()) % 1000;
 
     auto curr_time = std::chrono::system_clock::to_time_t(t);
-    std::tm tm = *std::localtime(&curr_time);
+    std::tm tm;
+
+    // unlike localtime, localtime_r doesn't reload time zone (and allocate) on every call
+    localtime_r(&curr_time, &tm);
 
-    std::cout << std::put_time(&tm, "[%Y-%m-%d %H:%M:%S.");
-    std::cout << std::setfill('0') << std::setw(3) << ms.count() << "] ";
+    out << std::put_time(&tm, "[%Y-%m-%d %H:%M:%S.");
+    out << std::setfill('0') << std::setw(3) << ms.count() << "] ";
 }
 
-void Tftp_client::ipv4_tostring(struct sockaddr_in *addr, std::string &s)
+int Tftp_client::ipv4_tostring(struct sockaddr_in *addr, char *s, size_t len)
 {
     char buf[INET_ADDRSTRLEN];
     uint16_t port;
@@ -54,12 +126,10 @@ void Tftp_client::ipv4_tostring(struct sockaddr_in *addr, std::string &s)
     inet_ntop(AF_INET, &addr->sin_addr.s_addr, buf, INET_ADDRSTRLEN);
     port = htons(addr->sin_port);
 
-    s += buf;
-    s += ":";
-    s += std::to_string(port);
+    return snprintf(s, len, "%s:%u", buf, port);
 }
 
-void Tftp_client::ipv6_tostring(struct sockaddr_in6 *addr, std::string &s)
+int Tftp_client::ipv6_tostring(struct sockaddr_in6 *addr, char *s, size_t len)
 {
     char buf[INET6_ADDRSTRLEN];
     uint16_t port;
@@ -68,52 +138,82 @@ void Tftp_client::ipv6_tostring(struct sockaddr_in6 *addr, std::string &s)
     inet_ntop(AF_INET6, &addr->sin6_addr.s6_addr, buf, INET6_ADDRSTRLEN);
     port = htons(addr->sin6_port);
 
-    s += "[";
-    s += buf;
-    s += "]:";
-    s += std::to_string(port);
+    return snprintf(s, len, "[%s]:%u", buf, port);
 }
 
-uint8_t *Tftp_client::resize(uint8_t *old_buf, uint64_t new_size)
+// PUBLIC INSTANCE METHODS
+
+// contstructor
+Tftp_client::Tftp_client()
+{
+    this->send_type = OPCODE_INVALID;
+    this->state = STATE_IDLE;
+    this->sock = -1;
+    this->cache_status = CACHE_NONE;
+    this->cache_fd = -1;
+    this->skipped = false;
+    this->follower = false;
+    this->error_code = ERR_CODE_NOT_DEF;
+
+    // take initial buffers from shared pool
+    if(this->out_buffer.reserve(MAX_SIZE) && this->in_buffer.reserve(MAX_SIZE)) {
+        this->size = MAX_SIZE;
+    } else {
+        this->size = 0;
+    }
+}
+
+// destructor
+Tftp_client::~Tftp_client()
 {
-    uint8_t *new_buf;
+    leave_flight();
 
-    // frees old buffer
-    if(old_buf != nullptr) {
-        delete[] old_buf;
+    if(this->sock >= 0) {
+        close(this->sock);
     }
+}
 
-    new_buf = new(std::nothrow) uint8_t[new_size];
+// handles communication with server
+bool Tftp_client::communicate(Tftp_parameters *params)
+{
+    struct pollfd pfd;
+    int64_t wait;
 
-    // set initial values
-    if(new_buf != nullptr) {
-        memset(new_buf, 0, new_size);
+    if(!start(*params)) {
+        return false;
     }
 
-    return new_buf;
-}
+    // communicate with server till error or successful transfer
+    while(!is_finished()) {
+        pfd.fd = this->sock;
+        pfd.events = POLLIN;
+        wait = std::max<int64_t>(get_deadline() - now_ms(), 0);
 
-// PUBLIC INSTANCE METHODS
+        if(poll(&pfd, 1, wait) > 0) {
+            on_readable();
+        }
 
-// contstructor
-Tftp_client::Tftp_client() : out_buffer(new uint8_t[MAX_SIZE]), in_buffer(new uint8_t[MAX_SIZE])
-{
-    this->size = MAX_SIZE;
-    this->send_type = OPCODE_INVALID;
+        // deadlines are checked even if packets keep coming
+        handle_timers(now_ms());
+    }
 
-    memset(static_cast<void *> (this->out_buffer.get()), 0, MAX_SIZE);
-    memset(static_cast<void *> (this->in_buffer.get()), 0, MAX_SIZE);
+    return is_successful();
 }
 
-// handles communication with server
-bool Tftp_client::communicate(Tftp_parameters *params)
+bool Tftp_client::start(const Tftp_parameters &params)
 {
-    bool ok = true;
+    this->params = params;
+    this->state = STATE_FAILED;
+
+    if(this->size == 0) {
+        std::cerr << "Packet buffers are not available!" << std::endl;
+        return false;
+    }
 
-    init(params);
+    init(&this->params);
 
     // process and store address of the server
-    if(!process_address(params)) {
+    if(!process_address(&this->params)) {
         return false;
     }
 
@@ -123,98 +223,245 @@ bool Tftp_client::communicate(Tftp_parameters *params)
     }
 
     // try to open specified file
-    if(!prepare_file(params)) {
-        close(this->sock);
+    if(!prepare_file(&this->params)) {
+        cleanup();
         return false;
     }
 
+    // the same version of file has already been uploaded
+    if(this->skipped) {
+        this->state = STATE_RUNNING;
+        finish(true);
+        return true;
+    }
+
+    // the same file is being downloaded => its data are taken over
+    if(join_flight()) {
+        return true;
+    }
+
     // set extension options values
-    set_options(params);
+    set_options(&this->params);
 
     // check if proposed block size can be satisfy with available MTU
-    if(!check_max_blksize(params->get_size())) {
+    if(!check_max_blksize(this->params.get_size())) {
         cleanup();
         return false;
     }
 
-    // communicate with server till error or successful transfer
-    do {
-        ok = handle_exchange(params);
-    } while(ok && !this->last);
+    this->state = STATE_RUNNING;
 
-    // report result of transfer
-    print_timestamp();
-    if(ok) {
-        std::cout << "Transfer completed without errors." << std::endl;
-    } else {
-        std::cout << "Transfer didn't complete sucessfully!" << std::endl;
+    // send request
+    if(!send_next()) {
+        finish(false);
+    } else if(this->last) {
+        finish(true);
     }
 
-    cleanup();
     return true;
 }
 
+void Tftp_client::on_readable()
+{
+    struct sockaddr_storage src_addr;
+    socklen_t size;
+    ssize_t ret;
+    uint64_t value;
+
+    // leader has ended shared download
+    if(this->follower) {
+        if(read(this->sock, &value, sizeof(value)) == sizeof(value)) {
+            finish(this->flight->is_successful(this));
+        }
+
+        return;
+    }
+
+    // read everything what is available (socket is nonblocking)
+    while(this->state == STATE_RUNNING) {
+        size = sizeof(struct sockaddr_storage);
+        ret = recvfrom_wrapper(&src_addr, &size);
+
+        if(ret <= 0) {
+            break;
+        }
+
+        this->resp_len = ret;
+
+        // packet from unexpected host is ignored
+        if(!check_address(&src_addr)) {
+            continue;
+        }
+
+        log_clear();
+
+        // process response and send next packet
+        if(!process_packet()) {
+            finish(false);
+        } else if(this->last) {
+            finish(true);
+        } else if(!send_next()) {
+            finish(false);
+        } else if(this->last) {
+            finish(true);
+        }
+    }
+}
+
+void Tftp_client::handle_timers(int64_t now)
+{
+    if(this->state != STATE_RUNNING) {
+        return;
+    }
+
+    // follower waits for leader which has its own time-outs
+    if(this->follower) {
+        this->timer = this->resend_timer = now + HARD_TIMEOUT * 1000;
+        return;
+    }
+
+    // packet delayed by rate limit
+    if(now >= this->pace_timer) {
+        this->pace_timer = INT64_MAX;
+
+        if(!transmit()) {
+            finish(false);
+        }
+
+        return;
+    }
+
+    // no response for too long
+    if(now >= this->timer) {
+        if(log_stream != nullptr) {
+            std::lock_guard<std::mutex> guard(output_lock);
+            print_timestamp(*log_stream);
+            *log_stream << "Transfer time-out!" << std::endl;
+        }
+
+        finish(false);
+    // timout expired => resend
+    } else if(now >= this->resend_timer && !resend_last()) {
+        finish(false);
+    }
+}
+
+int64_t Tftp_client::now_ms()
+{
+    auto t = std::chrono::steady_clock::now().time_since_epoch();
+
+    return std::chrono::duration_cast<std::chrono::milliseconds>(t).count();
+}
+
 // GENERAL PRIVATE INSTANCE METHODS
 
 void Tftp_client::logging(opcode_t type, bool sending)
 {
-    std::string str;
+    const char *action;
+    const char *name;
+    char address[INET6_ADDRSTRLEN + 10];
 
     if(sending && this->resend_rq) {
-        str += "Re-sent ";
+        action = "Re-sent";
         this->resend_rq = false;
     } else {
-        str += (sending)? "Sent " : "Recieved ";
+        action = (sending)? "Sent" : "Recieved";
+    }
+
+    // logging is turned off
+    if(log_stream == nullptr) {
+        return;
     }
 
     switch(type) {
         case OPCODE_SKIP:
             return;
         case OPCODE_ACK:
-            str += "ACK ";
+            name = "ACK";
             break;
         case OPCODE_DATA:
-            str += "DATA ";
-            if(this->binary && this->options.find("tsize") != this->options.end()) {
-                this->log += "(total " + std::to_string(this->cur_size) + "/" + std::to_string(this->tsize) + ")";
+            name = "DATA";
+            if(this->binary && this->report_total) {
+                log_append("(total ");
+                log_append(this->cur_size);
+                log_append("/");
+                log_append(this->tsize);
+                log_append(")");
             }
             break;
         case OPCODE_RRQ:
-            str += "RRQ ";
+            name = "RRQ";
             break;
         case OPCODE_WRQ:
-            str += "WRQ ";
+            name = "WRQ";
             break;
         case OPCODE_OACK:
-            str += "OACK ";
+            name = "OACK";
             break;
         default:
-            str += "ERROR ";
+            name = "ERROR";
             break;
     }
 
-    str += "packet ";
-    str += (sending)? "to " : "from ";
-
     if(this->addr.ss_family == AF_INET) {
-        ipv4_tostring((struct sockaddr_in *) &this->addr, str);
+        ipv4_tostring((struct sockaddr_in *) &this->addr, address, sizeof(address));
     } else {
-        ipv6_tostring((struct sockaddr_in6 *) &this->addr, str);
+        ipv6_tostring((struct sockaddr_in6 *) &this->addr, address, sizeof(address));
     }
 
-    print_timestamp();
-    std::cout << str;
-    if(!this->log.empty()) {
-        std::cout << " - " << this->log;
+    std::lock_guard<std::mutex> guard(output_lock);
+    print_timestamp(*log_stream);
+    *log_stream << action << " " << name << " packet " << ((sending)? "to " : "from ") << address;
+    if(this->log_len > 0) {
+        *log_stream << " - " << this->log;
     }
 
-    std::cout << std::endl;
+    *log_stream << std::endl;
+}
+
+void Tftp_client::log_clear()
+{
+    this->log_len = 0;
+    this->log[0] = '\0';
+}
+
+void Tftp_client::log_append(std::string_view str)
+{
+    int ret = snprintf(this->log + this->log_len, LOG_SIZE - this->log_len, "%.*s", (int) str.size(), str.data());
+
+    // message is truncated when log is full
+    this->log_len = std::min<size_t>(this->log_len + std::max(ret, 0), LOG_SIZE - 1);
+}
+
+void Tftp_client::log_append(uint64_t num)
+{
+    int ret = snprintf(this->log + this->log_len, LOG_SIZE - this->log_len, "%llu", (unsigned long long) num);
+
+    this->log_len = std::min<size_t>(this->log_len + std::max(ret, 0), LOG_SIZE - 1);
 }
 
 void Tftp_client::cleanup()
 {
+    // followers are woken before their data are released
+    leave_flight();
+
     close(this->sock);
-    this->file.close();
+    this->sock = -1;
+
+    // endpoints are released, so owner of endpoint learns that transfer has ended
+    this->source.reset();
+    this->sink.reset();
+
+    if(this->cache_fd != -1) {
+        close(this->cache_fd);
+        this->cache_fd = -1;
+    }
+
+    // incomplete copy of downloaded file
+    if(this->cache_sink) {
+        this->cache_sink.reset();
+        Tftp_cache::instance().discard(this->cache_tmp);
+    }
 }
 
 // PRIVATE INSTANCE METHODS FOR NECCESSARY PREPARATION BEFORE COMMUNICATION
@@ -230,194 +477,681 @@ void Tftp_client::init(Tftp_parameters *params)
     this->block_size = 512;
     this->cur_size = 0;
     this->tsize = 0;
+    this->raw_pos = 0;
+    this->raw_len = 0;
     this->original_TID = htons(params->get_port());
     this->resend_rq = false;
+    this->checksum.reset(params->get_checksum());
+    this->digest.clear();
+    this->cache_status = CACHE_NONE;
+    this->sync_size = -1;
+    this->sync_digest.clear();
+    this->skipped = false;
+    this->error_code = ERR_CODE_NOT_DEF;
+    this->abort_msg = "";
+    this->follower = false;
+    this->pace_timer = INT64_MAX;
+    this->rate.set_rate(params->get_rate());
 }
 
-bool Tftp_client::set_ipv4(Tftp_parameters *params)
+bool Tftp_client::join_flight()
 {
-    struct sockaddr_in *addr = (struct sockaddr_in *) &this->addr;
+    int event_fd;
+
+    // only plain downloads may be shared, sync mode decides by local file
+    if(this->params.get_req_type() != Tftp_parameters::READ || this->params.is_sync() || !Tftp_flight::is_enabled()) {
+        return false;
+    }
+
+    this->flight = Tftp_flight::join(Tftp_flight::make_key(this->params.get_address(), this->params.get_port(),
+        this->params.get_filename(), this->binary), this, event_fd);
 
-    if(inet_pton(AF_INET, params->get_address().c_str(), &addr->sin_addr.s_addr) <= 0) {
+    if(!this->flight || event_fd == -1) {
         return false;
     }
 
-    this->addr_len = sizeof(struct sockaddr_in);
-    addr->sin_port = htons(params->get_port());
+    // server isn't contacted at all, end of leader is signalled through event descriptor
+    close(this->sock);
+    this->sock = event_fd;
+    this->follower = true;
+    this->timer = this->resend_timer = now_ms() + HARD_TIMEOUT * 1000;
+    this->state = STATE_RUNNING;
+
+    if(log_stream != nullptr) {
+        std::lock_guard<std::mutex> guard(output_lock);
+        print_timestamp(*log_stream);
+        *log_stream << "Download of " << this->params.get_filename() << " joined running transfer of the same file." << std::endl;
+    }
+
     return true;
 }
 
-bool Tftp_client::set_ipv6(Tftp_parameters *params)
+void Tftp_client::leave_flight()
 {
-    struct sockaddr_in6 *addr = (struct sockaddr_in6 *) &this->addr;
+    if(!this->flight) {
+        return;
+    }
 
-    if(inet_pton(AF_INET6, params->get_address().c_str(), &addr->sin6_addr.s6_addr) <= 0) {
+    if(this->follower) {
+        this->flight->leave(this);
+    } else {
+        this->flight->complete(this->state == STATE_DONE);
+    }
+
+    this->flight.reset();
+}
+
+bool Tftp_client::set_ipv4(const std::string &address, uint16_t port, mirror_t &mirror)
+{
+    struct sockaddr_in *addr = (struct sockaddr_in *) &mirror.addr;
+
+    if(inet_pton(AF_INET, address.c_str(), &addr->sin_addr.s_addr) <= 0) {
+        return false;
+    }
+
+    mirror.addr_len = sizeof(struct sockaddr_in);
+    addr->sin_port = htons(port);
+    return true;
+}
+
+bool Tftp_client::set_ipv6(const std::string &address, uint16_t port, mirror_t &mirror)
+{
+    struct sockaddr_in6 *addr = (struct sockaddr_in6 *) &mirror.addr;
+    size_t scope = address.find('%');
+
+    if(inet_pton(AF_INET6, address.substr(0, scope).c_str(), &addr->sin6_addr.s6_addr) <= 0) {
         return false;
     }
 
-    this->addr_len = sizeof(struct sockaddr_in6);
-    addr->sin6_port = htons(params->get_port());
+    mirror.addr_len = sizeof(struct sockaddr_in6);
+    addr->sin6_port = htons(port);
     addr->sin6_scope_id = 0;
     addr->sin6_flowinfo = 0;
+
+    // scope given as name or index of interface (e.g. fe80::1%eth0)
+    if(scope != std::string::npos) {
+        std::string name = address.substr(scope + 1);
+        uint64_t index;
+
+        if((addr->sin6_scope_id = if_nametoindex(name.c_str())) == 0 && !Tftp_parameters::parse_number(name, index)) {
+            std::cerr << "Unknown scope of address " << address << "!" << std::endl;
+            return false;
+        }
+
+        if(addr->sin6_scope_id == 0) {
+            addr->sin6_scope_id = (uint32_t) index;
+        }
+    }
+
     return true;
 }
 
 bool Tftp_client::process_address(Tftp_parameters *params)
 {
-    this->addr.ss_family = params->get_addr_family();
+    std::vector<Tftp_parameters::mirror_t> given = params->get_mirrors();
+    std::vector<std::string> names;
+    std::vector<size_t> order;
+    std::string unresolved; // host names which couldn't be resolved
+
+    // server given by default values
+    if(given.empty()) {
+        given.push_back({params->get_address(), params->get_addr_family(), params->get_port()});
+    }
+
+    for(auto &server : given) {
+        names.push_back(server.address + "," + std::to_string(server.port));
+    }
+
+    // faster and more reliable mirrors are tried first
+    if(given.size() > 1) {
+        order = Tftp_mirrors::instance().order(names);
+    } else {
+        order.push_back(0);
+    }
+
+    this->mirrors.clear();
+
+    for(size_t i : order) {
+        mirror_t mirror;
+        std::vector<struct sockaddr_storage> addrs;
+        bool ok;
+
+        mirror.addr.ss_family = given[i].addr_family;
+        mirror.name = names[i];
+        mirror.sent = 0;
+        mirror.refused = false;
+
+        // every address of host name is tried as another mirror (happy eyeballs)
+        if(given[i].addr_family == AF_UNSPEC) {
+            if(!Tftp_resolver::instance().resolve(given[i].address, given[i].port, addrs)) {
+                unresolved += ((unresolved.empty())? "" : ", ") + given[i].address;
+                continue;
+            }
+
+            mirror.host = given[i].address;
+
+            for(auto &addr : addrs) {
+                mirror.addr = addr;
+                mirror.addr_len = (addr.ss_family == AF_INET)? sizeof(struct sockaddr_in) : sizeof(struct sockaddr_in6);
+                this->mirrors.push_back(mirror);
+            }
+
+            continue;
+        }
+
+        ok = (given[i].addr_family == AF_INET)? set_ipv4(given[i].address, given[i].port, mirror) :
+            set_ipv6(given[i].address, given[i].port, mirror);
+
+        if(!ok) {
+            return false;
+        }
+
+        this->mirrors.push_back(mirror);
+    }
+
+    // mirrors of other family than source address cannot be reached
+    if(!params->get_source().empty()) {
+        int family = (params->get_source().find(':') == std::string::npos)? AF_INET : AF_INET6;
+
+        this->mirrors.erase(std::remove_if(this->mirrors.begin(), this->mirrors.end(),
+            [family](const mirror_t &m) { return m.addr.ss_family != family; }), this->mirrors.end());
+    }
+
+    // transfer may go on while at least one of mirrors is known
+    if(this->mirrors.empty()) {
+        if(params->get_source().empty()) {
+            std::cerr << "Cannot resolve address of server " << unresolved << "!" << std::endl;
+        } else {
+            std::cerr << "No server reachable from source address " << params->get_source() << "!" << std::endl;
+        }
+
+        return false;
+    }
+
+    // link-local address without scope is reached through chosen interface
+    if(!params->get_device().empty()) {
+        for(auto &mirror : this->mirrors) {
+            struct sockaddr_in6 *addr = (struct sockaddr_in6 *) &mirror.addr;
+
+            if(mirror.addr.ss_family == AF_INET6 && IN6_IS_ADDR_LINKLOCAL(&addr->sin6_addr) && addr->sin6_scope_id == 0) {
+                addr->sin6_scope_id = if_nametoindex(params->get_device().c_str());
+            }
+        }
+    }
+
+    // both families are raced from one dual-stack socket
+    if(std::any_of(this->mirrors.begin(), this->mirrors.end(), [](const mirror_t &m) { return m.addr.ss_family == AF_INET; }) &&
+        std::any_of(this->mirrors.begin(), this->mirrors.end(), [](const mirror_t &m) { return m.addr.ss_family == AF_INET6; })) {
+        for(auto &mirror : this->mirrors) {
+            map_ipv4(&mirror.addr, &mirror.addr_len);
+        }
+    }
+
+    this->raced = 1;
+    this->failovers = 0;
+    this->retries = 0;
+    this->resume = 0;
+    use_mirror(0);
+    return true;
+}
+
+void Tftp_client::use_mirror(size_t index)
+{
+    this->mirror = index;
+    this->addr = this->mirrors[index].addr;
+    this->addr_len = this->mirrors[index].addr_len;
 
     if(this->addr.ss_family == AF_INET) {
-        return set_ipv4(params);
+        this->original_TID = ((struct sockaddr_in *) &this->addr)->sin_port;
     } else {
-        return set_ipv6(params);
+        this->original_TID = ((struct sockaddr_in6 *) &this->addr)->sin6_port;
     }
 }
 
 bool Tftp_client::create_socket()
 {
-    struct timeval timout = {TIMEOUT, 0};
-
-    this->sock = socket(this->addr.ss_family, SOCK_DGRAM, 0);
+    // socket is nonblocking - waiting for packets and timeouts is handled by caller
+    this->sock = socket(this->addr.ss_family, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
 
     if(sock == -1) {
         std::cerr << "socket() failed!" << std::endl;
         return false;
     }
 
-    // set timout for recieving
-    if(setsockopt(this->sock, SOL_SOCKET, SO_RCVTIMEO, &timout, sizeof(struct timeval)) < 0) {
+    // mirrors of both families are reached through ipv4-mapped addresses
+    if(this->addr.ss_family == AF_INET6) {
+        int off = 0;
+
+        setsockopt(this->sock, IPPROTO_IPV6, IPV6_V6ONLY, &off, sizeof(off));
+    }
+
+    this->device = this->params.get_device();
+
+    // routing table isn't consulted about outgoing interface (multi-homed hosts)
+    if(!this->device.empty() && setsockopt(this->sock, SOL_SOCKET, SO_BINDTODEVICE, this->device.c_str(),
+            this->device.size()) == -1) {
+        std::cerr << "Cannot bind socket to interface " << this->device << " - " << strerror(errno) << "!" << std::endl;
+        close(this->sock);
+        return false;
+    }
+
+    if(!this->params.get_source().empty() && !bind_source()) {
         close(this->sock);
         return false;
     }
 
+    // kernel paces socket too where qdisc supports it (fq), otherwise rate is kept by pace
+    if(this->params.get_rate() > 0) {
+        unsigned int rate = std::min<uint64_t>(this->params.get_rate(), UINT32_MAX - 1);
+
+        setsockopt(this->sock, SOL_SOCKET, SO_MAX_PACING_RATE, &rate, sizeof(rate));
+    }
+
+    return true;
+}
+
+bool Tftp_client::bind_source()
+{
+    struct sockaddr_storage addr;
+    std::string source = this->params.get_source();
+    socklen_t len;
+
+    memset(&addr, 0, sizeof(addr));
+
+    if(inet_pton(AF_INET, source.c_str(), &((struct sockaddr_in *) &addr)->sin_addr) == 1) {
+        addr.ss_family = AF_INET;
+        len = sizeof(struct sockaddr_in);
+    } else {
+        struct sockaddr_in6 *addr6 = (struct sockaddr_in6 *) &addr;
+
+        inet_pton(AF_INET6, source.c_str(), &addr6->sin6_addr);
+        addr.ss_family = AF_INET6;
+        len = sizeof(struct sockaddr_in6);
+
+        // link-local source address needs scope too
+        if(IN6_IS_ADDR_LINKLOCAL(&addr6->sin6_addr) && !this->device.empty()) {
+            addr6->sin6_scope_id = if_nametoindex(this->device.c_str());
+        }
+    }
+
+    if(bind(this->sock, (struct sockaddr *) &addr, len) == -1) {
+        std::cerr << "Cannot bind socket to address " << source << " - " << strerror(errno) << "!" << std::endl;
+        return false;
+    }
+
+    // MTU check considers interface owning address
+    if(this->device.empty()) {
+        this->device = find_device(addr);
+    }
+
+    return true;
+}
+
+bool Tftp_client::prepare_file(Tftp_parameters *params)
+{
+    std::vector<std::string_view> parts;
+    Tftp_parameters::split_string(params->get_filename(), '/', parts);
+    std::string name_of_file((params->get_local().empty())? parts.back() : params->get_local());
+
+    if(params->get_req_type() == Tftp_parameters::READ) {
+        // endpoint given by user of library
+        if(this->sink) {
+            return true;
+        }
+
+        // only expanded data are stored
+        if(params->get_unpack() != Tftp_parameters::UNPACK_NONE) {
+            return (this->sink = Tftp_unpack::create(*params)) != nullptr;
+        }
+
+        // data are streamed to pipeline instead of landing on disk
+        if(params->is_stdio()) {
+            this->sink = std::make_shared<Buffered_sink>(std::make_unique<Fd_sink>(STDOUT_FILENO), STDOUT_BUFFER);
+            return true;
+        }
+
+        this->local_path = name_of_file;
+
+        // existing file isn't truncated until it is clear that it will be downloaded
+        if(params->is_sync()) {
+            struct stat st;
+
+            if(stat(name_of_file.c_str(), &st) == 0 && S_ISREG(st.st_mode)) {
+                this->sync_size = st.st_size;
+                return true;
+            }
+        }
+
+        return open_sink();
+    } else {
+        if(this->source) {
+            return true;
+        }
+
+        // size of piped data isn't known => tsize is omitted
+        if(params->is_stdio()) {
+            this->source = std::make_shared<Fd_source>(STDIN_FILENO);
+            return true;
+        }
+
+        if(!(this->source = Fd_source::open_file(name_of_file))) {
+            std::cerr << "Cannot find file \"" + name_of_file + "\" in current directory!" << std::endl;
+            return false;
+        }
+
+        if(params->is_sync() && Tftp_sync::instance().is_enabled()) {
+            check_upload(params, name_of_file);
+        }
+    }
+
+    return true;
+}
+
+bool Tftp_client::open_sink()
+{
+    if(!(this->sink = Fd_sink::open_file(this->local_path))) {
+        std::cerr << "Opening of file \"" + this->local_path + "\" failed!" << std::endl;
+        return false;
+    }
+
     return true;
 }
 
-bool Tftp_client::prepare_file(Tftp_parameters *params)
+void Tftp_client::check_upload(Tftp_parameters *params, const std::string &path)
+{
+    uint64_t size;
+
+    if(!Tftp_sync::digest_file(path, size, this->sync_digest)) {
+        this->sync_digest.clear();
+        return;
+    }
+
+    this->sync_size = size;
+    this->skipped = Tftp_sync::instance().is_unchanged(
+        Tftp_sync::make_key(params->get_address(), params->get_port(), params->get_filename()), size, this->sync_digest);
+}
+
+void Tftp_client::set_options(Tftp_parameters *params)
+{
+    this->options.clear();
+
+    // get filesize when writing to server
+    if(params->get_req_type() == Tftp_parameters::WRITE) {
+        int64_t size = this->source->size();
+
+        // size of data from pipe or callback isn't known in advance
+        this->report_total = this->binary && size >= 0;
+        this->tsize = std::max<int64_t>(size, 0);
+    } else {
+        this->report_total = this->binary;
+    }
+
+    // for binary mode include tszie extension into packet (size already known from another mirror isn't sent)
+    if(this->report_total) {
+        this->options["tsize"] = (params->get_req_type() == Tftp_parameters::WRITE)? std::to_string(this->tsize) : "0";
+    }
+
+    // if requested, set option timeout value
+    if(params->get_timeout() > 0) {
+        this->options["timeout"] = std::to_string(params->get_timeout());
+    }
+
+    // set option blksize value for nondefault vaules
+    if(params->get_size() != 512) {
+        this->options["blksize"] = std::to_string(params->get_size());
+    }
+}
+
+int Tftp_client::get_min_mtu(int family, int sock, const std::string &device)
+{
+    static std::mutex lock;
+    static mtu_cache_t cache[2] = {{-1, 0}, {-1, 0}};
+    mtu_cache_t &entry = cache[(family == AF_INET)? 0 : 1];
+    int64_t now = now_ms();
+    struct ifaddrs *addrs;
+    struct ifreq ifr;
+    int min_mtu = -1;
+
+    // only interface transfer is bound to matters, one query is cheap
+    if(!device.empty()) {
+        memset(&ifr, 0, sizeof(struct ifreq));
+        strncpy(ifr.ifr_name, device.c_str(), sizeof(ifr.ifr_name) - 1);
+
+        return (ioctl(sock, SIOCGIFMTU, &ifr) == 0)? ifr.ifr_mtu : -1;
+    }
+
+    std::lock_guard<std::mutex> guard(lock);
+
+    // interfaces don't change often => value is shared by transfers for a while
+    if(now < entry.expires) {
+        return entry.mtu;
+    }
+
+    if(getifaddrs(&addrs) == -1) {
+        return -1;
+    }
+
+    // check all interefaces
+    for(struct ifaddrs *a = addrs; a != NULL; a = a->ifa_next) {
+        if(!a->ifa_addr) {
+            continue;
+        }
+
+        // we're interested only in address family same as our socket
+        if(a->ifa_addr->sa_family != family) {
+            continue;
+        }
+
+        memset(&ifr, 0, sizeof(struct ifreq));
+        strncpy(ifr.ifr_name, a->ifa_name, sizeof(ifr.ifr_name) - 1);
+
+        // get information about interface
+        if(ioctl(sock, SIOCGIFMTU, &ifr) != 0 || ifr.ifr_mtu < 0) {
+            continue;
+        }
+
+        // first assingment
+        if(min_mtu < 0) {
+            min_mtu = ifr.ifr_mtu;
+        } else {
+            min_mtu = (min_mtu > ifr.ifr_mtu)? ifr.ifr_mtu : min_mtu;
+        }
+    }
+
+    freeifaddrs(addrs);
+
+    entry.mtu = min_mtu;
+    entry.expires = now + MTU_CACHE_TTL;
+    return min_mtu;
+}
+
+std::string Tftp_client::find_device(const struct sockaddr_storage &addr)
+{
+    struct ifaddrs *addrs;
+    std::string res;
+
+    if(getifaddrs(&addrs) == -1) {
+        return res;
+    }
+
+    for(struct ifaddrs *a = addrs; a != NULL && res.empty(); a = a->ifa_next) {
+        if(a->ifa_addr && a->ifa_addr->sa_family == addr.ss_family &&
+            same_host((struct sockaddr_storage *) a->ifa_addr, &addr)) {
+            res = a->ifa_name;
+        }
+    }
+
+    freeifaddrs(addrs);
+    return res;
+}
+
+bool Tftp_client::check_max_blksize(int block_size)
+{
+    int min_mtu = get_min_mtu(this->addr.ss_family, this->sock, this->device);
+    const int headers = MAX_IP_HEADER + UDP_HEADER + TFTP_HEADER;
+
+    // make sure smallest mtu is big enough
+    if(min_mtu < headers + MIN_BLOCK_SIZE) {
+        std::cerr << "Not able find interface with MTU large enough" << std::endl;
+        return false;
+    }
+
+    min_mtu = min_mtu - headers;
+
+    if(block_size > min_mtu) {
+        this->options["blksize"] = std::to_string(min_mtu);
+
+        if(log_stream != nullptr) {
+            std::lock_guard<std::mutex> guard(output_lock);
+            *log_stream << "Warning! Proposed blocksize (" << block_size
+                << ") is too big! Value " << min_mtu << " will be used (based on available MTUs)." << std::endl;
+        }
+    }
+
+    return true;
+}
+
+// PRIVATE INSTANCE METHODS TO HADNLE COMMUNICATION ITSELF
+
+void Tftp_client::check_cache()
 {
-    std::string str;
-    std::vector<std::string> parts;
-    Tftp_parameters::split_string(params->get_filename(), "/", parts);
-    std::string name_of_file = parts[parts.size() - 1];
-    std::ios::openmode mode = std::fstream::binary;
+    Tftp_cache &cache = Tftp_cache::instance();
+    std::string key = Tftp_cache::make_key(this->params.get_address(), this->params.get_port(),
+        this->params.get_filename(), this->tsize);
+    int fd;
 
-    if(params->get_req_type() == Tftp_parameters::READ) {
-        mode |= std::fstream::out;
-        str = "Opening of file \"" + name_of_file + "\" failed!";
-    } else {
-        mode |= std::fstream::in;
-        str = "Cannot find file \"" + name_of_file + "\" in current directory!";
+    // the same version of file has already been downloaded => rest of transfer is refused
+    if((this->cache_fd = cache.lookup(key, this->tsize)) != -1) {
+        this->cache_status = CACHE_HIT;
+        this->abort_msg = "Transfer aborted - file is cached";
+        this->send_type = OPCODE_ERROR;
+        return;
     }
 
-    this->file.open(name_of_file, mode);
-    if(this->file.fail()) {
-        std::cerr << str << std::endl;
-        return false;
+    this->cache_status = CACHE_MISS;
+
+    if(!cache.fits(this->tsize) || (fd = cache.create(this->cache_tmp)) == -1) {
+        return;
     }
 
-    return true;
+    this->cache_key = key;
+    this->cache_sink = std::make_unique<Fd_sink>(fd, true);
 }
 
-void Tftp_client::get_filesize()
+bool Tftp_client::serve_cached()
 {
-    this->file.seekg(0, this->file.end);
-    this->tsize = this->file.tellg();
-    this->file.seekg(0, this->file.beg);
+    bool ok;
 
-#ifdef DEBUG
-    std::cout << "fds: " << this->tsize << "\n";
-#endif
-}
+    if(this->checksum.get_algorithm() == Tftp_parameters::CHECKSUM_NONE && !this->flight) {
+        ok = this->sink->write_file(this->cache_fd, this->tsize);
+    } else {
+        // data have to be read anyway to compute checksum or to pass them to followers
+        Callback_sink hashing([this](byte_span_t data) {
+            this->checksum.update(data);
 
-void Tftp_client::set_options(Tftp_parameters *params)
-{
-    this->options.clear();
+            if(this->flight) {
+                this->flight->publish(data);
+            }
 
-    // get filesize when writing to server
-    if(params->get_req_type() == Tftp_parameters::WRITE) {
-        get_filesize();
-    }
+            return this->sink->write(data);
+        });
 
-    // for binary mode include tszie extension into packet
-    if(this->binary) {
-        this->options["tsize"] = std::to_string(this->tsize);
+        ok = hashing.write_file(this->cache_fd, this->tsize);
     }
 
-    // if requested, set option timeout value
-    if(params->get_timeout() > 0) {
-        this->options["timeout"] = std::to_string(params->get_timeout());
+    if(!ok) {
+        std::cerr << "Error while storing cached copy of " << this->params.get_filename() << "!" << std::endl;
+        return false;
     }
 
-    // set option blksize value for nondefault vaules
-    if(params->get_size() != 512) {
-        this->options["blksize"] = std::to_string(params->get_size());
+    this->cur_size = this->tsize.load();
+
+    if(log_stream != nullptr) {
+        std::lock_guard<std::mutex> guard(output_lock);
+        print_timestamp(*log_stream);
+        *log_stream << "File " << this->params.get_filename() << " (" << this->tsize
+            << " bytes) has been taken from local cache." << std::endl;
     }
+
+    return true;
 }
 
-bool Tftp_client::check_max_blksize(int block_size)
+void Tftp_client::finish(bool ok)
 {
-    struct ifaddrs *addrs;
-    struct ifreq ifr;
-    int min_mtu = -1;
-    const int headers = MAX_IP_HEADER + UDP_HEADER + TFTP_HEADER;
+    // transfer has been refused in favour of cached copy
+    if(ok && this->cache_status == CACHE_HIT) {
+        ok = serve_cached();
+    }
 
-    getifaddrs(&addrs);
+    if(this->skipped && log_stream != nullptr) {
+        std::lock_guard<std::mutex> guard(output_lock);
+        print_timestamp(*log_stream);
+        *log_stream << "File " << this->params.get_filename() << " is up to date - transfer skipped." << std::endl;
+    }
 
-    // check all interefaces
-    for(struct ifaddrs *a = addrs; a != NULL; a = a->ifa_next) {
-        if(!a->ifa_addr) {
-            continue;
-        }
+    // nothing has been transferred to compute checksum of
+    if(this->checksum.get_algorithm() != Tftp_parameters::CHECKSUM_NONE && !this->skipped) {
+        this->digest = this->checksum.digest();
 
-        // we're interested only in address family same as our socket
-        if(a->ifa_addr->sa_family != this->addr.ss_family) {
-            continue;
+        // transferred data differ from expected ones
+        if(ok && !this->params.get_digest().empty() && this->params.get_digest() != this->digest) {
+            std::cerr << "Checksum mismatch of " << this->params.get_filename() << ": expected "
+                << this->params.get_digest() << ", got " << this->digest << "!" << std::endl;
+            ok = false;
         }
+    }
 
-        memset(&ifr, 0, sizeof(struct ifreq));
-        strncpy(ifr.ifr_name, a->ifa_name, sizeof(ifr.ifr_name));
-
-        // get information about interface
-        if(ioctl(this->sock, SIOCGIFMTU, &ifr) != 0 || ifr.ifr_mtu < 0) {
-            continue;
-        }
+    // server which doesn't announce size may still send different version of file
+    if(ok && this->binary && !this->skipped && this->params.get_req_type() == Tftp_parameters::READ &&
+        this->params.get_expected() > 0 && this->cur_size != this->params.get_expected()) {
+        std::cerr << "Size of " << this->params.get_filename() << " is " << this->cur_size << ", expected "
+            << this->params.get_expected() << "!" << std::endl;
+        ok = false;
+    }
 
-        // first assingment
-        if(min_mtu < 0) {
-            min_mtu = ifr.ifr_mtu;
-        } else {
-            min_mtu = (min_mtu > ifr.ifr_mtu)? ifr.ifr_mtu : min_mtu;
-        }
+    // sink may fail to complete data (e.g. to flush them)
+    if(this->sink && !this->sink->finish(ok)) {
+        ok = false;
     }
 
-    // make sure smallest mtu is big enough
-    if(min_mtu < headers + MIN_BLOCK_SIZE) {
-        std::cerr << "Not able find interface with MTU large enough" << std::endl;
-        return false;
+    // the next upload of the same version of file can be skipped
+    if(ok && !this->sync_digest.empty() && !this->skipped) {
+        Tftp_sync::instance().record(Tftp_sync::make_key(this->params.get_address(), this->params.get_port(),
+            this->params.get_filename()), this->sync_size, this->sync_digest);
     }
 
-    min_mtu = min_mtu - headers;
+    // complete copy of downloaded file is kept for next downloads
+    if(ok && this->cache_sink && this->cur_size == this->tsize) {
+        this->cache_sink.reset();
+        Tftp_cache::instance().store(this->cache_key, this->cache_tmp, this->tsize);
+    }
 
-    if(block_size > min_mtu) {
-        this->options["blksize"] = std::to_string(min_mtu);
+    this->state = (ok)? STATE_DONE : STATE_FAILED;
 
-        std::cout << "Warning! Proposed blocksize (" << block_size
-            << ") is too big! Value " << min_mtu << " will be used (based on available MTUs)." << std::endl;
+    // report result of transfer
+    if(log_stream != nullptr) {
+        std::lock_guard<std::mutex> guard(output_lock);
+        print_timestamp(*log_stream);
+        if(ok) {
+            *log_stream << "Transfer of " << this->params.get_filename() << " completed without errors." << std::endl;
+            if(!this->digest.empty()) {
+                print_timestamp(*log_stream);
+                *log_stream << Tftp_checksum::get_name(this->checksum.get_algorithm()) << " of "
+                    << this->params.get_filename() << ": " << this->digest << std::endl;
+            }
+        } else {
+            *log_stream << "Transfer of " << this->params.get_filename() << " didn't complete sucessfully!" << std::endl;
+        }
     }
 
-    freeifaddrs(addrs);
-    return true;
+    cleanup();
 }
 
-// PRIVATE INSTANCE METHODS TO HADNLE COMMUNICATION ITSELF
-
-bool Tftp_client::handle_exchange(Tftp_parameters *params)
+bool Tftp_client::send_next()
 {
-    time_t curr_time;
     bool ok = true;
     bool skip = false;
-    uint16_t resp_type;
-    this->log.clear();
+    log_clear();
 
     // fill packet to send according to setting
     switch(this->send_type) {
@@ -425,10 +1159,10 @@ bool Tftp_client::handle_exchange(Tftp_parameters *params)
         skip = true;
         break;
     case OPCODE_RRQ:
-        ok = fill_RRQ(params->get_filename().c_str());
+        ok = fill_RRQ(this->params.get_filename());
         break;
     case OPCODE_WRQ:
-        ok = fill_WRQ(params->get_filename().c_str());
+        ok = fill_WRQ(this->params.get_filename());
         break;
     case OPCODE_DATA:
         ok = fill_DATA();
@@ -436,6 +1170,9 @@ bool Tftp_client::handle_exchange(Tftp_parameters *params)
     case OPCODE_ACK:
         ok = fill_ACK();
         break;
+    case OPCODE_ERROR:
+        ok = fill_ERROR(ERR_CODE_PROBLEMATIC_OPTION, this->abort_msg);
+        break;
     default:
         send_ERROR(ERR_CODE_NOT_DEF, "Internal error!");
         std::cerr << "Cannot send this type of packet!" << std::endl;
@@ -448,33 +1185,87 @@ bool Tftp_client::handle_exchange(Tftp_parameters *params)
         return false;
     }
 
-    // send packet
-    if(!skip && !send_packet()) {
+    // packet is sent once it fits into rate limit
+    if(!skip && !pace() && !transmit()) {
+        return false;
+    }
+
+    // no response is expected => communication ends
+    if(!this->exp_resp) {
+        this->last = true;
+    }
+
+    return true;
+}
+
+bool Tftp_client::transmit()
+{
+    int64_t curr_time;
+
+    if(!send_packet()) {
         send_ERROR(ERR_CODE_NOT_DEF, "Internal error while sending packet!");
         return false;
     }
 
-    if(!skip) {
-        this->logging(this->send_type, true);
-        curr_time = std::time(0);
-        this->timer = curr_time + HARD_TIMEOUT;
-        this->resend_timer = curr_time + TIMEOUT;
+    this->logging(this->send_type, true);
+    curr_time = now_ms();
+    this->timer = curr_time + HARD_TIMEOUT * 1000;
+    this->resend_timer = curr_time + TIMEOUT * 1000;
+    this->retries = 0;
+
+    // answer to request is awaited from this mirror, the next one is asked soon if it doesn't come
+    if(this->send_type == OPCODE_RRQ || this->send_type == OPCODE_WRQ) {
+        this->mirrors[this->mirror].sent = curr_time;
+
+        if(this->raced < this->mirrors.size() && this->params.get_req_type() == Tftp_parameters::READ) {
+            this->resend_timer = curr_time + MIRROR_STAGGER;
+        }
     }
 
-    if(!this->exp_resp) {
-        this->last = true;
-        return true;
+    return true;
+}
+
+bool Tftp_client::pace()
+{
+    Tftp_rate &global = Tftp_rate::global();
+    uint64_t bytes;
+    int64_t now;
+    int64_t wait;
+
+    // ACK is charged for the next block it releases
+    if(this->send_type == OPCODE_DATA) {
+        bytes = this->out_curr_pos - TFTP_HEADER;
+    } else if(this->send_type == OPCODE_ACK) {
+        bytes = this->block_size;
+    } else {
+        return false;
     }
 
-    this->log.clear();
-    
-    // wait for packet
-    if(!recv_packet()) {
+    if(!this->rate.is_limited() && !global.is_limited()) {
+        return false;
+    }
+
+    now = Tftp_rate::now_ns();
+    wait = std::max(this->rate.reserve(bytes, now), global.reserve(bytes, now));
+
+    // the last packet ends transfer right after it is sent
+    if(wait < PACE_SLACK || this->last || !this->exp_resp) {
         return false;
     }
 
+    // response has already come, so nothing is resent while packet waits
+    this->pace_timer = now_ms() + (wait + 999999) / 1000000;
+    this->timer = this->resend_timer = INT64_MAX;
+    return true;
+}
+
+bool Tftp_client::process_packet()
+{
+    bool ok = true;
+    uint16_t resp_type;
+
     // extract type of recieved packet
-    if(!read_type(resp_type)) {
+    if((resp_type = Tftp_codec::peek_opcode(this->in_buffer.get(), this->resp_len)) == 0) {
         send_ERROR(ERR_CODE_NOT_DEF, "Internal error while!");
         return false;
     }
@@ -517,99 +1308,58 @@ bool Tftp_client::handle_exchange(Tftp_parameters *params)
 
 bool Tftp_client::check_address_ipv4(struct sockaddr_in *addr)
 {
-    char buf[INET_ADDRSTRLEN];
     struct sockaddr_in *origin = (struct sockaddr_in *) &this->addr;
-    
-    inet_ntop(AF_INET, &addr->sin_addr.s_addr, buf, INET_ADDRSTRLEN);
+
 #ifdef DEBUG
+    char buf[INET_ADDRSTRLEN];
+    inet_ntop(AF_INET, &addr->sin_addr.s_addr, buf, INET_ADDRSTRLEN);
     std::cout << "Address: " << buf << std::endl;
     std::cout << "PORT: " << ntohs(addr->sin_port) << std::endl;
 #endif
 
-    do {
-        // in case of first response, get server's TID
-        if(this->first) {
-            this->first = false;
-            origin->sin_port = addr->sin_port;
-        // check correctness of server's TID
-        } else if(addr->sin_port != origin->sin_port) {
-            break;
-        }
-
+    // in case of first response, get server's TID
+    if(this->first) {
+        this->first = false;
+        origin->sin_port = addr->sin_port;
         return true;
-    } while(0);
-
-    // backup
-    unsigned long orig_addr = origin->sin_addr.s_addr;
-    unsigned short orig_port = origin->sin_port;
-    uint8_t orig_buf[this->out_curr_pos];
-    memcpy(orig_buf, static_cast<void *> (this->out_buffer.get()), this->out_curr_pos);
-
-    // set temporary values
-    origin->sin_addr.s_addr = addr->sin_addr.s_addr;
-    origin->sin_port = addr->sin_port;
-
-    std::cerr << "Got packet with unknown TID (IPV4)" << std::endl;
-    send_ERROR(ERR_CODE_UNKNOWN_ID, "Unknown TID!");
-
-    // restore original values
-    origin->sin_addr.s_addr = orig_addr;
-    origin->sin_port = orig_port;
-    memcpy(static_cast<void *> (this->out_buffer.get()), orig_buf, this->out_curr_pos);
+    }
 
-    return false;
+    // check correctness of server's TID
+    return addr->sin_port == origin->sin_port && addr->sin_addr.s_addr == origin->sin_addr.s_addr;
 }
 
 bool Tftp_client::check_address_ipv6(struct sockaddr_in6 *addr)
 {
-    char buf[INET6_ADDRSTRLEN];
     struct sockaddr_in6 *origin = (struct sockaddr_in6 *) &this->addr;
 
-    inet_ntop(AF_INET, &addr->sin6_addr.s6_addr, buf, INET6_ADDRSTRLEN);
 #ifdef DEBUG
+    char buf[INET6_ADDRSTRLEN];
+    inet_ntop(AF_INET6, &addr->sin6_addr.s6_addr, buf, INET6_ADDRSTRLEN);
     std::cout << "Address: " << buf << std::endl;
     std::cout << "PORT: " << ntohs(addr->sin6_port) << std::endl;
 #endif
-    do {
-        // in case of first response, get server's TID
-        if(this->first) {
-            this->first = false;
-            origin->sin6_port = addr->sin6_port;
-            return true;
-        // check correctness of server's TID
-        } else if(addr->sin6_port != origin->sin6_port) {
-            break;
-        }
 
+    // in case of first response, get server's TID
+    if(this->first) {
+        this->first = false;
+        origin->sin6_port = addr->sin6_port;
         return true;
-    } while(0);
-
-    // backup
-    unsigned char orig_addr[16];
-    memcpy(orig_addr, origin->sin6_addr.s6_addr, 16);
-    unsigned short orig_port = origin->sin6_port;
-    uint8_t orig_buf[this->out_curr_pos];
-    memcpy(orig_buf, static_cast<void *> (this->out_buffer.get()), this->out_curr_pos);
-
-    // set temporary values
-    origin->sin6_port = addr->sin6_port;
-    memcpy(origin->sin6_addr.s6_addr, addr->sin6_addr.s6_addr, 16);
-
-    std::cerr << "Got packet with unknown TID (IPV6)" << std::endl;
-    send_ERROR(ERR_CODE_UNKNOWN_ID, "Unknown TID!");
-
-    // restore original values
-    memcpy(origin->sin6_addr.s6_addr, orig_addr, 16);
-    origin->sin6_port = orig_port;
-    memcpy(static_cast<void *> (this->out_buffer.get()), orig_buf, this->out_curr_pos);
+    }
 
-    return false;
+    // check correctness of server's TID
+    return addr->sin6_port == origin->sin6_port &&
+        memcmp(addr->sin6_addr.s6_addr, origin->sin6_addr.s6_addr, 16) == 0;
 }
 
 bool Tftp_client::check_address(struct sockaddr_storage *addr)
 {
     bool ret;
 
+    // the first answer decides which of mirrors serves transfer
+    if(this->first && this->mirrors.size() > 1) {
+        return select_mirror(addr);
+    }
+
     if(this->addr.ss_family == AF_INET) {
         ret = check_address_ipv4((struct sockaddr_in *) addr);
     } else {
@@ -617,14 +1367,210 @@ bool Tftp_client::check_address(struct sockaddr_storage *addr)
     }
 
     if(!ret) {
-        if(std::time(0) > this->resend_timer) {
-            resend_last();
-        }
+        std::cerr << "Got packet with unknown TID" << std::endl;
+        send_unknown_TID(addr);
     }
 
     return ret;
 }
 
+std::string Tftp_client::describe_mirror(mirror_t &mirror)
+{
+    struct sockaddr_storage addr = unmap_ipv4(&mirror.addr);
+    char address[INET6_ADDRSTRLEN + 10];
+
+    if(mirror.host.empty()) {
+        return mirror.name;
+    }
+
+    if(addr.ss_family == AF_INET) {
+        ipv4_tostring((struct sockaddr_in *) &addr, address, sizeof(address));
+    } else {
+        ipv6_tostring((struct sockaddr_in6 *) &addr, address, sizeof(address));
+    }
+
+    return mirror.name + " (" + address + ")";
+}
+
+bool Tftp_client::select_mirror(struct sockaddr_storage *addr)
+{
+    Tftp_mirrors &stats = Tftp_mirrors::instance();
+    ErrorView error;
+    size_t i;
+
+    for(i = 0; i < this->mirrors.size(); i++) {
+        if(this->mirrors[i].sent > 0 && same_host(addr, &this->mirrors[i].addr)) {
+            break;
+        }
+    }
+
+    // host hasn't been asked or its request has been taken over by another mirror
+    if(i == this->mirrors.size()) {
+        send_unknown_TID(addr);
+        return false;
+    }
+
+    mirror_t &answering = this->mirrors[i];
+
+    // refusal of one mirror doesn't end transfer while others may still answer
+    if(Tftp_codec::peek_opcode(this->in_buffer.get(), this->resp_len) == OPCODE_ERROR &&
+        error.parse(this->in_buffer.get(), this->resp_len) && error.code() != ERR_CODE_PROBLEMATIC_OPTION) {
+        size_t refused = std::count_if(this->mirrors.begin(), this->mirrors.end(),
+            [](const mirror_t &mirror) { return mirror.refused; });
+
+        if(answering.refused) {
+            return false;
+        }
+
+        if(refused + 1 < this->mirrors.size()) {
+            answering.refused = true;
+            stats.record_failure(answering.name);
+
+            if(log_stream != nullptr) {
+                std::lock_guard<std::mutex> guard(output_lock);
+                print_timestamp(*log_stream);
+                *log_stream << "Mirror " << describe_mirror(answering) << " refused request - code: " << error.code()
+                    << ", msg: " << error.message() << std::endl;
+            }
+
+            // the next mirror is asked right away
+            if(this->raced < this->mirrors.size() && !race_next()) {
+                finish(false);
+            }
+
+            return false;
+        }
+    }
+
+    stats.record_answer(answering.name, now_ms() - answering.sent);
+
+    // family which has answered is tried first next time
+    if(!answering.host.empty()) {
+        Tftp_resolver::instance().prefer(answering.host, unmap_ipv4(&answering.addr));
+    }
+
+    if(log_stream != nullptr && this->raced > 1) {
+        std::lock_guard<std::mutex> guard(output_lock);
+        print_timestamp(*log_stream);
+        *log_stream << "Mirror " << describe_mirror(answering) << " answered first (after " << now_ms() - answering.sent
+            << " ms)." << std::endl;
+    }
+
+    // mirrors asked earlier which haven't answered yet are considered slow, answers of all other mirrors get ERROR packet
+    for(auto &mirror : this->mirrors) {
+        if(mirror.sent > 0 && mirror.sent < answering.sent && mirror.name != answering.name) {
+            stats.record_failure(mirror.name);
+        }
+
+        mirror.sent = 0;
+    }
+
+    use_mirror(i);
+    this->raced = this->mirrors.size();
+    this->first = false;
+    this->addr = *addr;
+    return true;
+}
+
+bool Tftp_client::race_next()
+{
+    mirror_t &next = this->mirrors[this->raced++];
+    int64_t curr_time = now_ms();
+
+    // the same request goes to the next mirror, the first answer wins
+    if(sendto(this->sock, this->out_buffer.get(), this->out_curr_pos, 0, (struct sockaddr *) &next.addr, next.addr_len) == -1) {
+        std::cerr << "sendto() failed!" << std::endl;
+        return false;
+    }
+
+    next.sent = curr_time;
+    this->timer = curr_time + HARD_TIMEOUT * 1000;
+    this->resend_timer = curr_time + ((this->raced < this->mirrors.size())? MIRROR_STAGGER : TIMEOUT * 1000);
+
+    if(log_stream != nullptr) {
+        std::lock_guard<std::mutex> guard(output_lock);
+        print_timestamp(*log_stream);
+        *log_stream << "Request of " << this->params.get_filename() << " sent to mirror " << describe_mirror(next) << " too." << std::endl;
+    }
+
+    return true;
+}
+
+bool Tftp_client::can_fail_over()
+{
+    // data of upload would have to be read again, netascii decoding cannot continue in the middle
+    if(this->params.get_req_type() != Tftp_parameters::READ || !this->binary || this->mirrors.size() < 2) {
+        return false;
+    }
+
+    // every other mirror is tried at most once, unanswered requests are raced instead
+    if(this->failovers + 1 >= this->mirrors.size()) {
+        return false;
+    }
+
+    // new mirror has to send everything again => lost packet is retransmitted few times first
+    return (this->first)? this->failovers > 0 : this->retries >= FAILOVER_RETRIES;
+}
+
+bool Tftp_client::fail_over()
+{
+    Tftp_mirrors::instance().record_failure(this->mirrors[this->mirror].name);
+
+    for(auto &mirror : this->mirrors) {
+        mirror.sent = 0;
+    }
+
+    use_mirror((this->mirror + 1) % this->mirrors.size());
+    this->failovers++;
+    this->resume = this->cur_size;
+
+    if(log_stream != nullptr) {
+        std::lock_guard<std::mutex> guard(output_lock);
+        print_timestamp(*log_stream);
+        *log_stream << "Transfer of " << this->params.get_filename() << " stalled - continuing from mirror "
+            << describe_mirror(this->mirrors[this->mirror]) << " (" << this->resume << " bytes already received)." << std::endl;
+    }
+
+    // download starts again, already received data are skipped
+    this->first = true;
+    this->exp_resp = true;
+    this->last = false;
+    this->block_size = 512;
+    this->send_type = OPCODE_RRQ;
+    set_options(&this->params);
+
+    return check_max_blksize(this->params.get_size()) && send_next();
+}
+
+void Tftp_client::send_unknown_TID(struct sockaddr_storage *addr)
+{
+    const char *msg = "Unknown TID!";
+    uint8_t buf[Tftp_codec::error_size(12)];
+    char address[INET6_ADDRSTRLEN + 10];
+    size_t len = Tftp_codec::build_error(buf, sizeof(buf), ERR_CODE_UNKNOWN_ID, msg);
+    socklen_t addr_len = (addr->ss_family == AF_INET)? sizeof(struct sockaddr_in) : sizeof(struct sockaddr_in6);
+
+    // ERROR packet is sent to foreign host, current transfer isn't affected
+    if(sendto(this->sock, buf, len, 0, (struct sockaddr *) addr, addr_len) == -1) {
+        std::cerr << "sendto() failed!" << std::endl;
+        return;
+    }
+
+    if(log_stream == nullptr) {
+        return;
+    }
+
+    if(addr->ss_family == AF_INET) {
+        ipv4_tostring((struct sockaddr_in *) addr, address, sizeof(address));
+    } else {
+        ipv6_tostring((struct sockaddr_in6 *) addr, address, sizeof(address));
+    }
+
+    std::lock_guard<std::mutex> guard(output_lock);
+    print_timestamp(*log_stream);
+    *log_stream << "Sent ERROR packet to " << address << " - code: " << ERR_CODE_UNKNOWN_ID << ", msg: " << msg << std::endl;
+}
+
 void Tftp_client::reset_ipv4_TID()
 {
     struct sockaddr_in *addr = (struct sockaddr_in *) &this->addr;
@@ -662,50 +1608,26 @@ int Tftp_client::recvfrom_wrapper(struct sockaddr_storage *src_addr, socklen_t *
 
 bool Tftp_client::resend_last()
 {
-    print_timestamp();
-    this->resend_timer = std::time(0) + TIMEOUT;
-    std::cout << "Timout expired - re-sending last packet!" << std::endl;
-
-    return send_packet();
-}
-
-bool Tftp_client::recv_packet()
-{
-    struct sockaddr_storage src_addr;
-    socklen_t size = sizeof(struct sockaddr_storage);
-    ssize_t ret;
-    time_t curr_time = std::time(0);
-
-    // in case resending timeout was interrupt with other packets
-    if(curr_time > this->resend_timer) {
-        if(!resend_last()) {
-            return false;
-        }
+    // request hasn't been answered yet => the next mirror is asked too
+    if(this->first && this->raced < this->mirrors.size()) {
+        return race_next();
     }
 
-    while(1) {
-        ret = recvfrom_wrapper(&src_addr, &size);
-        curr_time = std::time(0);
+    // transfer has stalled => it continues from another mirror
+    if(can_fail_over()) {
+        return fail_over();
+    }
 
-        if (curr_time > this->timer) {
-            print_timestamp();
-            std::cout << "Transfer time-out!" << std::endl;
-            break;
-        }
+    this->resend_timer = now_ms() + TIMEOUT * 1000;
+    this->retries++;
 
-        if(ret > 0) { // successfully recieved some data
-            if(check_address(&src_addr)) {
-                this->resp_len = ret;
-                return true;
-            }
-        } else { // timout expired => resend
-            if(!resend_last()) {
-                break;
-            }
-        }
+    if(log_stream != nullptr) {
+        std::lock_guard<std::mutex> guard(output_lock);
+        print_timestamp(*log_stream);
+        *log_stream << "Timout expired - re-sending last packet!" << std::endl;
     }
 
-    return false;
+    return send_packet();
 }
 
 bool Tftp_client::send_packet()
@@ -731,7 +1653,7 @@ bool Tftp_client::send_packet()
 
 bool Tftp_client::check_packet_type(uint16_t resp_type)
 {
-    std::vector<std::string> types({"none", "RRQ", "WRQ", "DATA", "ACK", "ERROR"});
+    static const char *types[] = {"none", "RRQ", "WRQ", "DATA", "ACK", "ERROR", "OACK"};
 
     // error packet automaticaly matches everything
     if(resp_type == OPCODE_ERROR) {
@@ -759,14 +1681,17 @@ bool Tftp_client::check_packet_type(uint16_t resp_type)
 
     }
 
-    print_timestamp();
-    std::cout << "Recieved wrong type of packet! Expected " << types[this->exp_type] <<
-        ", got " << types[resp_type];
+    if(log_stream != nullptr) {
+        std::lock_guard<std::mutex> guard(output_lock);
+        print_timestamp(*log_stream);
+        *log_stream << "Recieved wrong type of packet! Expected " << types[this->exp_type] <<
+            ", got " << types[resp_type] << std::endl;
+    }
 
     return false;
 }
 
-void Tftp_client::send_ERROR(err_code_t code, std::string msg)
+void Tftp_client::send_ERROR(err_code_t code, const char *msg)
 {
     do {
         if(!fill_ERROR(code, msg)) {
@@ -783,113 +1708,148 @@ void Tftp_client::send_ERROR(err_code_t code, std::string msg)
 
 // PRIVATE INSTANCE METHODS TO SIMPLIFY FILLING OF DATA INTO PACKETS
 
-bool Tftp_client::write_two_bytes(uint8_t c1, uint8_t c2)
+bool Tftp_client::write_options()
 {
-    if(this->out_curr_pos + 1 >= this->size) {
-        return false;
+    size_t len;
+    uint8_t *buf = this->out_buffer.get();
+
+    if(this->options.empty()) {
+        return true;
     }
 
-    this->out_buffer[this->out_curr_pos] = c1;
-    this->out_curr_pos++;
+    log_append(", options:");
 
-    // c2 byte fits into current data block
-    if(this->out_curr_pos - 4 < this->block_size) {
-        this->out_buffer[this->out_curr_pos] = c2;
-        this->out_curr_pos++;
-    // c2 byte will be part of next data block
-    } else {
-        this->bytes_left.push_back(c2);
+    exp_type = OPCODE_OACK;
+
+    for(auto it = this->options.begin(); it != this->options.end(); ++it) {
+        // maximum size of request packet is 512 bytes
+        len = Tftp_codec::option_size(it->first.size(), it->second.size());
+        if(this->out_curr_pos + len > MAX_REQUEST_SIZE) {
+            if(log_stream != nullptr) {
+                std::lock_guard<std::mutex> guard(output_lock);
+                *log_stream << "Warning! Maximum allowed size of request packet is 512 - extra options has been stripped off." << std::endl;
+            }
+            break;
+        }
+
+        log_append((it == this->options.begin())? " " : ", ");
+        log_append(it->first);
+        log_append("(");
+        log_append(it->second);
+        log_append(")");
+
+        if((len = Tftp_codec::append_option(buf, this->size, this->out_curr_pos, it->first, it->second)) == 0) {
+            std::cerr << "Error while writing option - " << it->first << std::endl;
+            return false;
+        }
+
+        this->out_curr_pos = len;
     }
 
     return true;
 }
 
-bool Tftp_client::write_byte(uint8_t b)
+ssize_t Tftp_client::read_source(uint8_t *dst, size_t cap)
 {
-    if(this->out_curr_pos >= this->size) {
-        return false;
-    }
+    size_t pos = 0;
+    ssize_t ret;
 
-    if(!this->binary) {
-        // end of line is CR + LF in netascii
-        if(b == '\n') {
-            return write_two_bytes('\r', '\n');
-        // CR has to be followed by \0
-        } else if(b == '\r') {
-            return write_two_bytes('\r', '\0');
+    // sources like pipes may return less than requested
+    while(pos < cap) {
+        if((ret = this->source->read(dst + pos, cap - pos)) <= 0) {
+            return (ret == 0)? pos : -1;
         }
+
+        pos += ret;
     }
 
-    this->out_buffer[this->out_curr_pos] = b;
-    this->out_curr_pos++;
-    return true;
+    return pos;
 }
 
-bool Tftp_client::write_word(uint16_t w)
+ssize_t Tftp_client::read_netascii(uint8_t *dst, size_t cap)
 {
-    uint16_t converted;
+    size_t pos = 0;
+    ssize_t ret;
+    int c;
 
-    if(this->out_curr_pos + 1 >= this->size) {
-        return false;
+    // second byte of CR sequence which didn't fit into last block
+    if(!this->bytes_left.empty()) {
+        dst[pos++] = this->bytes_left[0];
+        this->bytes_left.clear();
     }
 
-    converted = htons(w);
-    memcpy(&this->out_buffer[this->out_curr_pos], &converted, 2);
+    while(pos < cap) {
+        if(this->raw_pos == this->raw_len) {
+            if((ret = this->source->read(this->raw, RAW_SIZE)) < 0) {
+                return -1;
+            }
 
-    this->out_curr_pos += 2;
-    return true;
-}
+            // end of file reached => last block
+            if(ret == 0) {
+                this->last = true;
+                break;
+            }
 
-bool Tftp_client::write_string(const char *str)
-{
-    size_t len = strlen(str);
+            this->raw_pos = 0;
+            this->raw_len = ret;
+        }
 
-    if(this->out_curr_pos + len + 1 >= this->size) {
-        return false;
-    }
+        c = this->raw[this->raw_pos++];
 
-    for(size_t i = 0; i < len; i++) {
-        if(!write_byte(str[i])) {
-            return false;
+        // end of line is CR + LF in netascii, CR has to be followed by \0
+        if(c == '\n' || c == '\r') {
+            dst[pos++] = '\r';
+            c = (c == '\n')? '\n' : '\0';
+
+            // second byte will be part of next data block
+            if(pos == cap) {
+                this->bytes_left.push_back(c);
+                break;
+            }
         }
 
+        dst[pos++] = c;
     }
 
-    return write_byte('\0');
+    return pos;
 }
 
-bool Tftp_client::write_options()
+bool Tftp_client::write_netascii(byte_span_t data)
 {
-    size_t len;
-
-    if(this->options.empty()) {
-        return true;
-    }
-
-    log += ", options:";
+    const uint8_t *start = data.data;
+    const uint8_t *end = data.data + data.size;
+    const uint8_t *cr;
+
+    while(start < end) {
+        // CR from previous byte (possibly from previous block)
+        if(this->active_cr) {
+            if(*start != '\n' && *start != '\0') {
+                return false;
+            }
 
-    exp_type = OPCODE_OACK;
+            // LF itself or CR represented by CR + \0
+            if(!this->sink->write({(*start == '\n')? start : (const uint8_t *) "\r", 1})) {
+                return false;
+            }
 
-    for(auto it = this->options.begin(); it != this->options.end(); ++it) {
-        // maximum size of request packet is 512 bytes
-        len = it->first.size() + it->second.size() + 2;
-        if(this->out_curr_pos + len > MAX_REQUEST_SIZE) {
-            std::cout << "Warning! Maximum allowed size of request packet is 512 - extra options has been stripped off." << std::endl;
-            break;
+            this->active_cr = false;
+            start++;
+            continue;
         }
 
-        log += (it == this->options.begin())? " " : ", ";
-        log += it->first + "(" + it->second + ")";
-
-        if(!write_string(it->first.c_str())) {
-            std::cerr << "Error while writing option name - " << it->first << std::endl;
-            return false;
+        // everything up to next CR can be stored as it is
+        cr = static_cast<const uint8_t *> (memchr(start, '\r', end - start));
+        if(cr == nullptr) {
+            cr = end;
+        } else {
+            this->active_cr = true;
         }
 
-        if(!write_string(it->second.c_str())) {
-            std::cerr << "Error while writing option value - " << it->second << std::endl;
+        if(cr > start && !this->sink->write({start, (size_t) (cr - start)})) {
             return false;
         }
+
+        start = (cr == end)? end : cr + 1;
     }
 
     return true;
@@ -897,43 +1857,35 @@ bool Tftp_client::write_options()
 
 // PRIVATE INSTANCE METHODS FOR FILLING TFPT PACKETS TO BE SENT
 
-bool Tftp_client::fill_RQ(std::string filename, opcode_t opcode)
+bool Tftp_client::fill_RQ(const std::string &filename, opcode_t opcode)
 {
-    std::string mode = (this->binary)? "octet" : "netascii";
-    this->out_curr_pos = 0; // reinitialize
+    const char *mode = (this->binary)? "octet" : "netascii";
+    uint8_t *buf = this->out_buffer.get();
     this->active_cr = false;
 
-    do {
-        // OPCODE
-        if(!write_word(opcode)) {
-            break;
-        }
-
-        // FILENAME
-        if(!write_string(filename.c_str())) {
-            break;
-        }
+    if(opcode == OPCODE_RRQ) {
+        this->out_curr_pos = Tftp_codec::build_rrq(buf, this->size, filename, mode);
+    } else {
+        this->out_curr_pos = Tftp_codec::build_wrq(buf, this->size, filename, mode);
+    }
 
-        // MODE
-        if(!write_string(mode.c_str())) {
-            break;
-        }
+    if(this->out_curr_pos == 0) {
+        std::cerr << "Error while creating RRQ/WRQ packet" << std::endl;
+        return false;
+    }
 
 #ifdef DEBUG
-        std::cout << "PACKET filled!" << std::endl;
+    std::cout << "PACKET filled!" << std::endl;
 #endif
 
-        log += "file: " + filename;
-
-        // OPTIONS
-        return write_options();
-    } while(0);
+    log_append("file: ");
+    log_append(filename);
 
-    std::cerr << "Error while creating RRQ/WRQ packet" << std::endl;
-    return false;
+    // OPTIONS
+    return write_options();
 }
 
-bool Tftp_client::fill_RRQ(std::string filename)
+bool Tftp_client::fill_RRQ(const std::string &filename)
 {
     this->block_num = 1;
     this->exp_type = OPCODE_DATA;
@@ -941,7 +1893,7 @@ bool Tftp_client::fill_RRQ(std::string filename)
     return fill_RQ(filename, OPCODE_RRQ);
 }
 
-bool Tftp_client::fill_WRQ(std::string filename)
+bool Tftp_client::fill_WRQ(const std::string &filename)
 {
     this->block_num = 0;
     this->exp_type = OPCODE_ACK;
@@ -951,194 +1903,78 @@ bool Tftp_client::fill_WRQ(std::string filename)
 
 bool Tftp_client::fill_ACK()
 {
-    this->out_curr_pos = 0; // reinitialize
     this->exp_type = OPCODE_DATA;
+    this->out_curr_pos = Tftp_codec::build_ack(this->out_buffer.get(), this->size, this->block_num);
 
-    do {
-        if(!write_word(OPCODE_ACK)) {
-            break;
-        }
-
-        if(!write_word(this->block_num)) {
-            break;
-        }
-
-        this->log += "block number " + std::to_string(block_num);
-        this->block_num++;
-        return true;
-    } while(0);
+    if(this->out_curr_pos == 0) {
+        std::cerr << "Error while creating ACK packet" << std::endl;
+        return false;
+    }
 
-    std::cerr << "Error while creating ACK packet" << std::endl;
-    return false;
+    log_append("block number ");
+    log_append(this->block_num);
+    this->block_num++;
+    return true;
 }
 
 bool Tftp_client::fill_DATA()
 {
-    int c;
-    bool ok = false;
+    uint8_t *payload = this->out_buffer.get() + TFTP_HEADER;
+    ssize_t len;
 
-    this->out_curr_pos = 0; // reinitialize
     this->exp_type = OPCODE_ACK;
 
-    do {
-        if(!write_word(OPCODE_DATA)) {
-           break;
-        }
-
-        if(!write_word(this->block_num)) {
-            break;
-        }
-
-        ok = true;
-    } while(0);
-
-    if(!ok) {
+    if(this->size < this->block_size + TFTP_HEADER) {
         std::cerr << "Error while creating DATA packet!" << std::endl;
         return false;
     }
 
-    if(!this->binary) {
-        this->binary = true;
-
-        // write bytes which were processed but didn't fit last block
-        for(size_t i = 0; i < this->bytes_left.size(); i++) {
-            if(!write_byte(this->bytes_left[i])) {
-                return false;
-            }
-        }
-
-        this->bytes_left.clear();
-        this->binary = false;
-    }
+    Tftp_codec::build_data_header(this->out_buffer.get(), this->block_num);
 
     // try to fill another block of data
-    while(this->out_curr_pos - 4 < this->block_size) {
-        c = this->file.get();
+    if(this->binary) {
+        len = read_source(payload, this->block_size);
 
         // end of file reached => last block
-        if(c == EOF) {
+        if(len >= 0 && (size_t) len < this->block_size) {
             this->last = true;
-            break;
-        }
-
-        if(!write_byte(c)) {
-            std::cerr << "Error while writing data into DATA packet!" << std::endl;
-            return false;
-        }
-    }
-
-    this->log += "block number " + std::to_string(block_num) + ", ";
-    this->log += std::to_string(this->out_curr_pos - 4) + " bytes ";
-    this->cur_size += this->out_curr_pos - 4;
-    return true;
-}
-
-bool Tftp_client::fill_ERROR(err_code_t code, std::string msg)
-{
-    this->out_curr_pos = 0; // reinitialize
-
-    do {
-        if(!write_word(OPCODE_ERROR)) {
-            break;
-        }
-
-        if(!write_word(code)) {
-            break;
-        }
-
-        if(!write_string(msg.c_str())) {
-            break;
         }
-
-        this->log += "code: " + std::to_string(code) + ", msg: " + msg;
-        this->exp_resp = false;
-       return true;
-    } while(0);
-
-    std::cerr << "Error while creating ERROR packet!" << std::endl;
-    return false;
-}
-
-// PRIVATE INSTANCE METHODS FOR ACCESSING DATA IN RECIEVED PACKETS
-
-bool Tftp_client::read_type(uint16_t &res)
-{
-    this->in_curr_pos = 0;
-
-    return read_word(res);
-}
-
-bool Tftp_client::read_cr(uint8_t &res)
-{
-    switch(this->in_buffer[this->in_curr_pos]) {
-    case '\n':
-        res = '\n';
-        break;
-    case '\0':
-        res = '\r';
-        break;
-    default:
-        return false;
+    } else {
+        len = read_netascii(payload, this->block_size);
     }
 
-    this->active_cr = false;
-    this->in_curr_pos++;
-    return true;
-}
-
-bool Tftp_client::read_byte(uint8_t &res)
-{
-    if(this->in_curr_pos >= this->resp_len) {
+    if(len < 0) {
+        std::cerr << "Error while writing data into DATA packet!" << std::endl;
         return false;
     }
 
-    if(this->active_cr) {
-        return read_cr(res);
-    }
+    this->checksum.update({payload, (size_t) len});
 
-    // netascii mode - current byte is CR
-    if(!this->binary && this->in_buffer[this->in_curr_pos] == '\r') {
-        this->active_cr = true;
-        this->in_curr_pos++;
-        return true;
-    }
+    this->out_curr_pos = TFTP_HEADER + len;
 
-    res = this->in_buffer[this->in_curr_pos];
-    this->in_curr_pos++;
+    log_append("block number ");
+    log_append(this->block_num);
+    log_append(", ");
+    log_append(len);
+    log_append(" bytes ");
+    this->cur_size += len;
     return true;
 }
 
-bool Tftp_client::read_word(uint16_t &res)
+bool Tftp_client::fill_ERROR(err_code_t code, const char *msg)
 {
-    uint16_t tmp;
+    this->out_curr_pos = Tftp_codec::build_error(this->out_buffer.get(), this->size, code, msg);
 
-    if(this->in_curr_pos + 1 >= this->resp_len) {
+    if(this->out_curr_pos == 0) {
+        std::cerr << "Error while creating ERROR packet!" << std::endl;
         return false;
     }
 
-    tmp = *((uint16_t *) &this->in_buffer[this->in_curr_pos]);
-    res = ntohs(tmp);
-
-    this->in_curr_pos += 2;
-    return true;
-}
-
-bool Tftp_client::read_string(std::string &res)
-{
-    uint8_t c;
-    res.clear();
-
-    while(true) {
-        if(!read_byte(c)) {
-            return false;
-     }
-
-        if(c == '\0') {
-            break;
-        }
-        res.push_back(c);
-    }
-
+    log_append("code: ");
+    log_append(code);
+    log_append(", msg: ");
+    log_append(msg);
+    this->exp_resp = false;
     return true;
 }
 
@@ -1146,70 +1982,58 @@ bool Tftp_client::read_string(std::string &res)
 
 bool Tftp_client::parse_ERROR()
 {
-    uint16_t err_code;
-    std::string err_msg;
+    ErrorView view;
     this->last = true;
 
-    do {
-        if(!read_word(err_code)) {
-            break;
-        }
-
-        if(!read_string(err_msg)) {
-            break;
-        }
+    if(!view.parse(this->in_buffer.get(), this->resp_len)) {
+        std::cerr << "Invalid ERROR packet format!" << std::endl;
+        return false;
+    }
 
-        if(this->in_curr_pos != this->resp_len) {
-            std::cerr << "Invalid ERROR packet format!" << std::endl;
+    log_append("code: ");
+    log_append(view.code());
+    log_append(", msg: ");
+    log_append(view.message());
+    this->error_code = (err_code_t) view.code();
+
+    // server refused some of the proposed extension options => try to modify request packet
+    if(this->exp_type == OPCODE_OACK && view.code() == ERR_CODE_PROBLEMATIC_OPTION) {
+        if(this->options.find("tsize") != this->options.end()) {
+            this->options.erase("tsize");
+            this->report_total = false;
+        } else if(this->options.find("timeout") != this->options.end()) {
+            this->options.erase("timeout");
+        } else if(this->options.find("blksize") != this->options.end()) {
+            this->options.erase("blksize");
+        } else {
             return false;
         }
 
-        this->log += "code: " + std::to_string(err_code) + ", msg: " + err_msg;
-
-        // server refused some of the proposed extension options => try to modify request packet
-        if(this->exp_type == OPCODE_OACK && err_code == ERR_CODE_PROBLEMATIC_OPTION) {
-            if(this->options.find("tsize") != this->options.end()) {
-                this->options.erase("tsize");
-            } else if(this->options.find("timeout") != this->options.end()) {
-                this->options.erase("timeout");
-            } else if(this->options.find("blksize") != this->options.end()) {
-                this->options.erase("blksize");
-            } else {
-                return false;
-            }
-
-            this->last = false;
-            this->first = true;
-            this->resend_rq = true;
-            reset_TID();
-        }
-        return true;
-    } while(0);
+        this->last = false;
+        this->first = true;
+        this->resend_rq = true;
+        reset_TID();
+    }
 
-    std::cerr << "Error while parsing ERROR packet!" << std::endl;
-    return false;
+    return true;
 }
 
 bool Tftp_client::parse_ACK()
 {
-    uint16_t block_num;
+    AckView view;
 
-    if(!read_word(block_num)) {
-        std::cerr << "Error while parsing ACK packet!" << std::endl;
-        return false;
-    }
-
-    if(this->in_curr_pos != this->resp_len) {
+    if(!view.parse(this->in_buffer.get(), this->resp_len)) {
         std::cerr << "Invalid ACK packet format!" << std::endl;
         return false;
     }
 
-    this->log += "block number " + std::to_string(block_num);
+    log_append("block number ");
+    log_append(view.block());
 
     // duplicate ACK packets are ignored
-    if(block_num < this->block_num) {
+    if(view.block() < this->block_num) {
         this->send_type = OPCODE_SKIP;
-        this->log += " (duplicate - will be ignored)";
+        log_append(" (duplicate - will be ignored)");
         return true;
     }
 
@@ -1220,87 +2044,112 @@ bool Tftp_client::parse_ACK()
 
 bool Tftp_client::parse_DATA()
 {
-    uint64_t data_size = this->resp_len - 4;
-    uint16_t block_num;
-    uint8_t c;
-    this->cur_size += data_size;
-    this->active_cr = false;
-    this->exp_resp = data_size == this->block_size;
-    this->send_type = OPCODE_ACK;
+    DataView view;
+    byte_span_t data;
 
-    if(!read_word(block_num)) {
+    if(!view.parse(this->in_buffer.get(), this->resp_len)) {
         std::cerr << "Error while reading block number from DATA packet!" << std::endl;
         return false;
     }
 
+    data = view.payload();
+    this->exp_resp = data.size == this->block_size;
+    this->send_type = OPCODE_ACK;
+
 #ifdef DEBUG
-    std::cout << "TFTP DATA - block: " << block_num << std::endl;
+    std::cout << "TFTP DATA - block: " << view.block() << std::endl;
 #endif
 
     // block number cannot be 0
-    if(block_num == 0) {
+    if(view.block() == 0) {
         return false;
     }
 
-    this->log += "block number " + std::to_string(block_num) + ", ";
+    log_append("block number ");
+    log_append(view.block());
+    log_append(", ");
 
     // duplicate DATA packet means resend of last ACK packet
-    if(block_num < this->block_num) {
-        this->log += " (duplicate - last ACK packet has been resent)";
+    if(view.block() < this->block_num) {
+        log_append(" (duplicate - last ACK packet has been resent)");
         this->send_type = OPCODE_SKIP;
-        this->resend_timer = std::time(0) + TIMEOUT;
+
+        // ACK delayed by rate limit hasn't been sent yet
+        if(this->pace_timer != INT64_MAX) {
+            return true;
+        }
+
+        this->resend_timer = now_ms() + TIMEOUT * 1000;
         return send_packet();
     }
 
-    // CR byte from previous data block
-    if(!this->bytes_left.empty()) {
+    // data received again from another mirror
+    if(this->resume > 0) {
+        size_t skip = std::min<uint64_t>(this->resume, data.size);
 
-        this->active_cr = true;
+        this->resume -= skip;
+        data.data += skip;
+        data.size -= skip;
     }
-    this->bytes_left.clear();
 
-#ifdef DEBUG
-    std::cout << "----------------------------------\n";
-#endif
-    // try to read and store recieved data block
-    while(this->in_curr_pos < this->resp_len) {
-        if(!read_byte(c)) {
-            std::cerr << "Error while reading DATA packet!" << std::endl;
-            return false;
-        }
+    if(!deliver(data)) {
+        return false;
+    }
 
-        if(!this->active_cr) {
-            this->file.put(c);
-#ifdef DEBUG
-            std::cout << c;
-#endif
-        }
+    // transfers of the same file get data as they were recieved
+    if(this->flight) {
+        this->flight->publish(data);
     }
-#ifdef DEBUG
-    std::cout << "----------------------------------\n";
-#endif
 
     // second byte of CR sequence didn't fit in this block
-    if(this->active_cr) {
+    if(this->active_cr && !this->exp_resp) {
         // invalid message in netascii - CR sequence
-        if(!this->exp_resp) {
-            std::cerr << "Error! CR sequence in last block wasn't end properly!" << std::endl;
+        std::cerr << "Error! CR sequence in last block wasn't end properly!" << std::endl;
+        return false;
+    }
+
+    // create log information
+    log_append(data.size);
+    log_append(" bytes ");
+
+    return true;
+}
+
+bool Tftp_client::deliver(byte_span_t data)
+{
+    this->cur_size += data.size;
+    this->checksum.update(data);
+
+    // server has ignored options, local file of sync mode hasn't been opened yet
+    if(!this->sink && !open_sink()) {
+        return false;
+    }
+
+    // try to store recieved data block
+    if(this->binary) {
+        if(!this->sink->write(data)) {
+            std::cerr << "Error while storing recieved data!" << std::endl;
             return false;
         }
 
-        this->bytes_left.push_back('\r');
+        // failure of copy for cache doesn't affect transfer itself
+        if(this->cache_sink && !this->cache_sink->write(data)) {
+            this->cache_sink.reset();
+            Tftp_cache::instance().discard(this->cache_tmp);
+        }
+    } else if(!write_netascii(data)) {
+        std::cerr << "Error while reading DATA packet!" << std::endl;
+        return false;
     }
 
-    // create log information
-    this->log += std::to_string(data_size) + " bytes ";
-
     return true;
 }
 
 bool Tftp_client::parse_OACK()
 {
-    std::string option;
-    std::string value;
+    OackView view;
+    std::string_view option;
+    std::string_view value;
 
     // duplicate OACK packet is ignored
     if(this->exp_type != OPCODE_OACK) {
@@ -1318,15 +2167,11 @@ bool Tftp_client::parse_OACK()
         this->block_num = 1;
     }
 
-    while(this->in_curr_pos < this->resp_len) {
-        if(!read_string(option)) {
-            return false;
-        }
-
-        if(!read_string(value)) {
-            return false;
-        }
+    if(!view.parse(this->in_buffer.get(), this->resp_len)) {
+        return false;
+    }
 
+    while(view.next(option, value)) {
         if(!validate_option(option, value)) {
             return false;
         }
@@ -1336,60 +2181,86 @@ bool Tftp_client::parse_OACK()
 #endif
     }
 
+    auto tsize = this->options.find("tsize");
+
+    // server has confirmed size of file
+    if(this->send_type == OPCODE_ACK && tsize != this->options.end() && tsize->second.empty()) {
+        // local file of the same size is considered up to date
+        if(this->sync_size >= 0 && (uint64_t) this->sync_size == this->tsize) {
+            this->skipped = true;
+            this->abort_msg = "Transfer aborted - file is up to date";
+            this->send_type = OPCODE_ERROR;
+        } else if(Tftp_cache::instance().is_enabled() && this->cache_status == CACHE_NONE) {
+            check_cache();
+        }
+    }
+
+    // local file is replaced only if data are going to be stored into it
+    if(this->params.get_req_type() == Tftp_parameters::READ && !this->skipped && !this->sink && !open_sink()) {
+        return false;
+    }
+
     for(auto it = this->options.begin(); it != this->options.end(); it++) {
-        log += (it == this->options.begin())? "" : ", ";
-        log += it->first;
-        log += (it->second.empty())? " (confirmed)" : " (not confirmed)"; 
+        log_append((it == this->options.begin())? "" : ", ");
+        log_append(it->first);
+        log_append((it->second.empty())? " (confirmed)" : " (not confirmed)");
     }
 
     return realloc_buffers();
 }
 
-bool Tftp_client::validate_option(std::string option, std::string value)
+bool Tftp_client::validate_option(std::string_view option, std::string_view value)
 {
+    auto it = this->options.find(option);
+    uint64_t proposed;
+    uint64_t size;
     bool ret = true;
 
-    if(this->options.find(option) == this->options.end()) {
+    if(it == this->options.end()) {
         return false;
     }
 
     if(option == "tsize") {
-        this->tsize = std::stoul(value);
-        ret = this->binary; // valid only for binary mode
+        ret = Tftp_parameters::parse_number(value, size) && this->binary; // valid only for binary mode
+
+        // file listed in manifest has changed on server
+        if(ret && this->params.get_expected() > 0 && size != this->params.get_expected()) {
+            std::cerr << "Server announces size " << size << " of " << this->params.get_filename() << ", expected "
+                << this->params.get_expected() << "!" << std::endl;
+            return false;
+        }
+
+        // another mirror has to offer the same version of file
+        if(ret && this->failovers > 0 && this->tsize > 0 && size != this->tsize) {
+            std::cerr << "Mirror " << this->mirrors[this->mirror].name << " offers different version of "
+                << this->params.get_filename() << "!" << std::endl;
+            return false;
+        }
+
+        this->tsize = size;
     } else if(option == "timeout") {
-        ret = this->options[option] == value; // timeout value must match
+        ret = it->second == value; // timeout value must match
     } else if(option == "blksize") {
-        this->block_size = std::stoul(value);
-        ret = this->block_size <= std::stoul(this->options[option]); // must by less than or equel than proposed
+        // must by less than or equel than proposed
+        ret = Tftp_parameters::parse_number(value, this->block_size) &&
+            Tftp_parameters::parse_number(it->second, proposed) && this->block_size <= proposed;
     }
 
-    this->options[option].clear();
+    it->second.clear();
     return ret;
 }
 
 bool Tftp_client::realloc_buffers()
 {
     const uint64_t new_size = this->block_size + TFTP_HEADER;
-    uint8_t *buf;
 
     if(this->size < new_size) {
-        // resieze output buffer
-        if((buf = resize(this->out_buffer.release(), new_size)) == nullptr) {
-            return false;
-        }
-
-        this->out_buffer.reset(buf);
-
-        // resieze input buffer
-        if((buf = resize(this->in_buffer.release(), new_size)) == nullptr) {
+        // buffers from pool are reused as they are - no need to clear them
+        if(!this->out_buffer.reserve(new_size) || !this->in_buffer.reserve(new_size)) {
             return false;
         }
 
-        this->in_buffer.reset(buf);
         this->size = new_size;
-
-        memset(static_cast<void *> (this->out_buffer.get()), 0, new_size);
-        memset(static_cast<void *> (this->in_buffer.get()), 0, new_size);
     }
 
     return true;
@@ -8,15 +8,28 @@
 #define __TFTP_CLIENT_H_
 
 #include <string>
+#include <algorithm>
 #include <stdint.h>
-#include <memory>
 #include <sys/socket.h>
-#include <fstream>
+#include <iostream>
 #include <map>
+#include <string_view>
+#include <mutex>
+#include <atomic>
+#include <memory>
 
 #include "tftp_parameters.h"
+#include "tftp_codec.h"
+#include "buffer_pool.h"
+#include "tftp_stream.h"
+#include "tftp_checksum.h"
+#include "tftp_rate.h"
 
 #define MAX_SIZE 1024
+#define LOG_SIZE 1024
+#define RAW_SIZE 512 // size of buffer for netascii encoding
+
+class Tftp_flight;
 
 /**
  * @brief Class representing TFTP client. It is able
@@ -24,6 +37,8 @@
  */
 class Tftp_client
 {
+    friend class Tftp_flight; // passes data of shared download to followers
+
     public:
         /**
          * @brief Types of TFTP packet opcodes + 
@@ -41,6 +56,34 @@ class Tftp_client
             OPCODE_SKIP,
         } opcode_t;
 
+        /**
+         * @brief States of transfer.
+         */
+        typedef enum {
+            STATE_IDLE,
+            STATE_RUNNING,
+            STATE_DONE,
+            STATE_FAILED,
+        } state_t;
+
+        /**
+         * @brief Usage of local cache by download.
+         */
+        typedef enum {
+            CACHE_NONE, // cache hasn't been consulted (disabled, upload, unknown size, etc.)
+            CACHE_MISS,
+            CACHE_HIT,
+        } cache_status_t;
+
+        /**
+         * @brief Snapshot of progress of transfer.
+         */
+        typedef struct {
+            state_t state;
+            uint64_t transferred; // number of transferred bytes
+            uint64_t total; // total size of file, 0 if it isn't known
+        } progress_t;
+
     typedef enum {
         ERR_CODE_NOT_DEF,
         ERR_CODE_NOT_FOUND,
@@ -54,19 +97,68 @@ class Tftp_client
     } err_code_t;
 
     private:
-        std::fstream file;
+        /**
+         * @brief Cached MTU of interfaces of one address family.
+         */
+        typedef struct {
+            int mtu;
+            int64_t expires; // time (in ms) when value has to be found out again
+        } mtu_cache_t;
+
+        /**
+         * @brief Mirror (server) which may serve transfer.
+         */
+        typedef struct {
+            struct sockaddr_storage addr;
+            size_t addr_len;
+            std::string name; // address,port (as given) used in statistics and log
+            std::string host; // host name address has been resolved from, empty for literal address
+            int64_t sent; // time (in ms) when request has been sent to mirror, 0 if its answer isn't expected
+            bool refused; // mirror has answered request with ERROR
+        } mirror_t;
+
+        static std::mutex output_lock; // transfers may run in more threads => lines are printed atomically
+        static std::ostream *log_stream; // stream for log of transfers, nullptr turns log off
+
+        Tftp_parameters params;
+        std::atomic<state_t> state; // may be polled from other threads
+        std::shared_ptr<Tftp_source> source; // local endpoint of WRQ
+        std::shared_ptr<Tftp_sink> sink; // local endpoint of RRQ
+        Tftp_checksum checksum; // checksum of transferred data
+        std::string digest; // computed checksum of completed transfer
+        cache_status_t cache_status;
+        int cache_fd; // cached copy of downloaded file, -1 if it isn't used
+        std::unique_ptr<Fd_sink> cache_sink; // copy of downloaded file being stored into cache
+        std::string cache_tmp; // temporary file of cache_sink
+        std::string cache_key;
+        std::string local_path; // local file of RRQ, in sync mode it is opened only once data arrive
+        int64_t sync_size; // size of local file compared with remote one in sync mode, -1 if it isn't compared
+        std::string sync_digest; // digest of uploaded file recorded in sync mode
+        bool skipped; // file hasn't changed => transfer has been skipped
+        const char *abort_msg; // message of ERROR refusing transfer right after OACK
+        std::shared_ptr<Tftp_flight> flight; // download shared with other transfers of the same file
+        bool follower; // data are received from another transfer, socket is event descriptor of flight
         int sock;
 
-        std::unique_ptr<uint8_t[]> out_buffer;
-        std::unique_ptr<uint8_t[]> in_buffer;
+        Pool_buffer out_buffer;
+        Pool_buffer in_buffer;
         uint64_t out_curr_pos;
-        uint64_t in_curr_pos;
         uint64_t resp_len;
-        std::string log;
-        time_t timer;
-        time_t resend_timer;
-
-        std::map<std::string, std::string> options;
+        char log[LOG_SIZE];
+        size_t log_len;
+        int64_t timer; // deadline (in ms) of whole exchange
+        int64_t resend_timer; // deadline (in ms) for resending of last packet
+        int64_t pace_timer; // time (in ms) when packet delayed by rate limit is sent, INT64_MAX if there is none
+        Tftp_rate rate; // rate limit of transfer
+        std::vector<mirror_t> mirrors; // servers given by parameters in order of preference
+        size_t mirror; // index of mirror serving transfer
+        size_t raced; // number of mirrors (from the first one) request has been sent to
+        size_t failovers; // number of switches to another mirror during transfer
+        size_t retries; // retransmissions of the last packet which haven't been answered
+        uint64_t resume; // number of bytes received again after switch to another mirror which are skipped
+        std::string device; // interface transfer is bound to (given or owning source address), empty if any
+
+        std::map<std::string, std::string, std::less<>> options;
         bool last;
         bool exp_resp;
         uint64_t block_size;
@@ -76,11 +168,15 @@ class Tftp_client
         bool binary;
         bool active_cr;
         std::string bytes_left;
-        uint64_t cur_size;
-        uint64_t tsize;
+        uint8_t raw[RAW_SIZE]; // data read from source, not yet encoded into netascii
+        size_t raw_pos;
+        size_t raw_len;
+        std::atomic<uint64_t> cur_size;
+        std::atomic<uint64_t> tsize;
         err_code_t error_code;
         uint16_t original_TID;
         bool resend_rq;
+        bool report_total;
 
         struct sockaddr_storage addr;
         size_t addr_len;
@@ -95,45 +191,174 @@ class Tftp_client
          */
         Tftp_client();
 
+        /**
+         * @brief Destructor. Closes socket of unfinished transfer.
+         */
+        ~Tftp_client();
+
+        /**
+         * @brief Sets source of uploaded data used instead of local file. It is
+         * released when transfer ends, so it has to be set before every start.
+         * @param source Source of data.
+         */
+        void set_source(std::shared_ptr<Tftp_source> source) { this->source = std::move(source); };
+
+        /**
+         * @brief Sets sink of downloaded data used instead of local file. It is
+         * released when transfer ends, so it has to be set before every start.
+         * @param sink Sink of data.
+         */
+        void set_sink(std::shared_ptr<Tftp_sink> sink) { this->sink = std::move(sink); };
+
         /**
          * @brief Handles communication with server. This includes preparation
          * of all necessary components according to given parameters + 
-         * controlling communication itself.
+         * controlling communication itself. Blocks till transfer ends.
          * @param params Structure with TFTP parameters for this communication - specifies
          * type of request, file to get/put, etc.
          * @returns true if communication was succesful, false otherwise.
          */
         bool communicate(Tftp_parameters *params);
 
+        /**
+         * @brief Prepares all necessary components according to given parameters
+         * and sends request to server. Rest of communication is driven by
+         * calls of on_readable and handle_timers.
+         * @param params Structure with TFTP parameters for this communication
+         * (it is copied).
+         * @returns true if transfer has been started, false otherwise.
+         */
+        bool start(const Tftp_parameters &params);
+
+        /**
+         * @brief Processes all packets waiting in socket and responds to them.
+         * Should be called whenever socket is readable.
+         */
+        void on_readable();
+
+        /**
+         * @brief Handles expired timeouts - resends last packet or ends
+         * transfer.
+         * @param now Current time in ms (see now_ms).
+         */
+        void handle_timers(int64_t now);
+
+        /**
+         * @brief Getter for the nearest time (in ms) when handle_timers has to be called.
+         */
+        int64_t get_deadline() { return std::min({this->timer, this->resend_timer, this->pace_timer}); };
+
+        /**
+         * @brief Getter for socket of transfer.
+         */
+        int get_socket() { return this->sock; };
+
+        /**
+         * @brief Getter for state of transfer.
+         */
+        state_t get_state() { return this->state; };
+
+        /**
+         * @brief Checks if transfer has already ended (successfully or not).
+         */
+        bool is_finished() { return this->state == STATE_DONE || this->state == STATE_FAILED; };
+
+        /**
+         * @brief Checks if transfer has ended successfully.
+         */
+        bool is_successful() { return this->state == STATE_DONE; };
+
+        /**
+         * @brief Getter for number of transferred bytes.
+         */
+        uint64_t get_transferred() { return this->cur_size; };
+
+        /**
+         * @brief Getter for error code sent by server (ERR_CODE_NOT_DEF if it hasn't sent any).
+         */
+        err_code_t get_error_code() { return this->error_code; };
+
+        /**
+         * @brief Getter for checksum of transferred data (lowercase hexadecimal digits),
+         * empty if transfer hasn't ended or checksum isn't computed.
+         */
+        const std::string &get_digest() { return this->digest; };
+
+        /**
+         * @brief Getter for usage of local cache by transfer.
+         */
+        cache_status_t get_cache_status() { return this->cache_status; };
+
+        /**
+         * @brief Checks if transfer has been skipped by sync mode because file hasn't changed.
+         */
+        bool is_skipped() { return this->skipped; };
+
+        /**
+         * @brief Checks if transfer has got data from another transfer of the same file.
+         */
+        bool is_follower() { return this->follower; };
+
+        /**
+         * @brief Getter for address and port of mirror serving transfer, empty
+         * if only one server has been given.
+         */
+        std::string get_mirror() { return (this->params.get_mirrors().size() > 1 && !this->follower)? this->mirrors[this->mirror].name : ""; };
+
+        /**
+         * @brief Returns progress of transfer. Doesn't block, so it may be called
+         * from any thread while transfer is running.
+         */
+        progress_t get_progress() const { return {this->state, this->cur_size, this->tsize}; };
+
+        /**
+         * @brief Getter for parameters of transfer.
+         */
+        const Tftp_parameters &get_params() { return this->params; };
+
+        /**
+         * @brief Static method. Returns current time of monotonic clock in ms.
+         */
+        static int64_t now_ms();
+
         /**
          * @brief Static method. Prints current timestamp in format
-         * YYYY-mm-dd HH:MM:SS.ms.
+         * YYYY-mm-dd HH:MM:SS.ms. Caller should hold output lock
+         * while printing rest of the line.
+         * @param out Stream to print timestamp into.
          */
-        static void print_timestamp();
+        static void print_timestamp(std::ostream &out = std::cout);
+
+        /**
+         * @brief Static method. Sets stream for log of all transfers (standard
+         * output by default). Errors are always printed to standard error output.
+         * @param out Stream to print log into, nullptr turns log off.
+         */
+        static void set_log_stream(std::ostream *out) { log_stream = out; };
+
+        /**
+         * @brief Static method. Returns lock which serializes lines printed
+         * by transfers running in different threads.
+         */
+        static std::mutex &get_output_lock() { return output_lock; };
 
         /**
          * @brief Converts given ipv4 address + port into string representation.
          * @param addr Sockaddr_in structure with ipv4 address to convert.
-         * @param s String to store result into.
+         * @param s Buffer to store result into.
+         * @param len Size of buffer.
+         * @returns value returned by snprintf function.
          */
-        static void ipv4_tostring(struct sockaddr_in *addr, std::string &s);
+        static int ipv4_tostring(struct sockaddr_in *addr, char *s, size_t len);
 
         /**
          * @brief Converts given ipv6 address + port into string representation.
          * @param addr Sockaddr_in6 structure with ipv6 address to convert.
-         * @param s String to store result into.
+         * @param s Buffer to store result into.
+         * @param len Size of buffer.
+         * @returns value returned by snprintf function.
          */
-        static void ipv6_tostring(struct sockaddr_in6 *addr, std::string &s);
-
-        /**
-         * @brief Frees old buffer and allocates space for new one with
-         * specified size.
-         * @param old_buf Pointert to old buffer, which shall be freed.
-         * @param new_size New size of buffer to allocate.
-         * @returns pointer to newly allocated buffer with specified size
-         * (if allocation failed, NULL is returned).
-         */
-        static uint8_t *resize(uint8_t *old_buf, uint64_t new_size);
+        static int ipv6_tostring(struct sockaddr_in6 *addr, char *s, size_t len);
 
     private:
         /**
@@ -145,12 +370,44 @@ class Tftp_client
          */
         void logging(opcode_t type, bool sending);
 
+        /**
+         * @brief Clears log message of current operation.
+         */
+        void log_clear();
+
+        /**
+         * @brief Appends given string to log message of current operation
+         * without any allocation (too long message is truncated).
+         * @param str String to append.
+         */
+        void log_append(std::string_view str);
+
+        /**
+         * @brief Appends decimal representation of given number to log
+         * message of current operation.
+         * @param num Number to append.
+         */
+        void log_append(uint64_t num);
+
         /**
          * @brief Release all sources - close socket, files, etc.
          */
         void cleanup();
 
 
+        /**
+         * @brief Attaches download to running transfer of the same file or
+         * makes it leader of new shared download.
+         * @returns true if transfer follows another one, false if it communicates
+         * with server itself.
+         */
+        bool join_flight();
+
+        /**
+         * @brief Ends shared download (leader) or detaches from it (follower).
+         */
+        void leave_flight();
+
         /**
          * @brief Sets initial value to some atributes before start of
          * communication.
@@ -158,43 +415,58 @@ class Tftp_client
         void init(Tftp_parameters *params);
 
         /**
-         * @brief Extracts ipv4 address + port from given parameters and
-         * correctly set them into attributes.
-         * @param params Structure with TFTP parameters to extract
-         * information from.
+         * @brief Converts ipv4 address + port into address of mirror.
+         * @param address Address to convert.
+         * @param port Port to convert.
+         * @param mirror Mirror to store address into.
          * @returns true in case of success, false otherwise.
          */
-        bool set_ipv4(Tftp_parameters *params);
+        bool set_ipv4(const std::string &address, uint16_t port, mirror_t &mirror);
 
         /**
-         * @brief Extracts ipv6 address + port from given parameters and
-         * correctly set them into attributes.
-         * @param params Structure with TFTP parameters to extract
-         * information from.
+         * @brief Converts ipv6 address + port into address of mirror.
+         * @param address Address to convert.
+         * @param port Port to convert.
+         * @param mirror Mirror to store address into.
          * @returns true in case of success, false otherwise.
          */
-        bool set_ipv6(Tftp_parameters *params);
+        bool set_ipv6(const std::string &address, uint16_t port, mirror_t &mirror);
 
         /**
-         * @brief Extracts server's address + port from given
-         * parameters and stores them into appropriate attributes.
-         * Manage both IPV4 and IPV4 addresses.
+         * @brief Extracts addresses + ports of all servers (mirrors) from given
+         * parameters, orders them by their statistics and prepares transfer
+         * for the most preferred one. Manage both IPV4 and IPV4 addresses, host
+         * names are resolved into all their addresses (raced as mirrors). Ipv4
+         * addresses are mapped into ipv6 ones if both families are used.
          * @param params Structure with TFTP parameters to extract
          * information from.
          * @returns true in case of success, false otherwise.
          */
         bool process_address(Tftp_parameters *params);
 
+        /**
+         * @brief Makes mirror with given index server of transfer.
+         * @param index Index of mirror.
+         */
+        void use_mirror(size_t index);
+
         /**
          * @brief Creates sokcet for communication. Socket's
-         * parameters are taken from attributes.
+         * parameters are taken from attributes. Socket is bound to
+         * interface and local address given by parameters.
          * @returns true in case of success, false otherwise.
          */
         bool create_socket();
 
+        /**
+         * @brief Binds socket to local address given by parameters.
+         * @returns true in case of success, false otherwise.
+         */
+        bool bind_source();
+
         /**
          * @brief According to supplied parameters, opens file
-         * in desired mode.
+         * in desired mode (unless source or sink has been set).
          * @param params Structure with TFTP parameters to take
          * necessary information from.
          * @returns true in case of success, false otherwise.
@@ -202,10 +474,18 @@ class Tftp_client
         bool prepare_file(Tftp_parameters *params);
 
         /**
-         * @brief Find out size of file that will be transfer to
-         * server and stores it into appropriate attribute.
+         * @brief Opens local file for downloaded data.
+         * @returns true in case of success, false otherwise.
+         */
+        bool open_sink();
+
+        /**
+         * @brief Checks in sync mode if uploaded file has changed since its last
+         * recorded upload.
+         * @param params Structure with TFTP parameters.
+         * @param path Path of local file.
          */
-        void get_filesize();
+        void check_upload(Tftp_parameters *params, const std::string &path);
 
         /**
          * @brief Extract values of TFPT extension paremeters from given structure
@@ -216,13 +496,48 @@ class Tftp_client
         void set_options(Tftp_parameters *params);
 
         /**
-         * @brief Handle exchange of packets pair from and to server - send
-         * neccessary type of packet, and process response.
-         * @param params Structue with TFTP parameters to take neccessary
-         * information from.
+         * @brief Looks up downloaded file in local cache once its size is known.
+         * On hit transfer is aborted, on miss copy of data is stored into cache.
+         */
+        void check_cache();
+
+        /**
+         * @brief Stores cached copy of downloaded file into sink.
+         * @returns true in case of success, false otherwise.
+         */
+        bool serve_cached();
+
+        /**
+         * @brief Ends transfer, reports its result and releases all sources.
+         * @param ok Determines if transfer has been successful.
+         */
+        void finish(bool ok);
+
+        /**
+         * @brief Fills and sends neccessary type of packet to server
+         * and sets timeouts for response.
          * @returns true in case of success, false otherwise.
          */
-        bool handle_exchange(Tftp_parameters *params);
+        bool send_next();
+
+        /**
+         * @brief Sends filled packet, logs it and sets timeouts for response.
+         * @returns true in case of success, false otherwise.
+         */
+        bool transmit();
+
+        /**
+         * @brief Reserves time slot of filled DATA or ACK packet in rate limits of
+         * transfer and of all transfers. Packet which doesn't fit is delayed.
+         * @returns true if packet has been delayed, false if it may be sent immediately.
+         */
+        bool pace();
+
+        /**
+         * @brief Processes packet recieved from server.
+         * @returns true in case of success, false otherwise.
+         */
+        bool process_packet();
 
         /**
          * @brief Send data stored in internal buffer to server.
@@ -240,13 +555,6 @@ class Tftp_client
          */
         int recvfrom_wrapper(struct sockaddr_storage *src_addr, socklen_t *size);
 
-        /**
-         * @brief Handle packet recieving - handle waiting, timeout handling, check
-         * of response verification, etc.
-         * @returns true in case of success, false otherwise.
-         */
-        bool recv_packet();
-
         /**
          * @brief Check if recieved packet has been sent by
          * expected server with correct TID and handles sending of ERROR packets
@@ -256,6 +564,47 @@ class Tftp_client
          */
         bool check_address(struct sockaddr_storage *addr);
 
+        /**
+         * @brief Creates description of mirror for log - address of resolved
+         * host name is appended to it.
+         * @param mirror Mirror to describe.
+         */
+        std::string describe_mirror(mirror_t &mirror);
+
+        /**
+         * @brief Chooses mirror by the first answer to request sent to more mirrors.
+         * ERROR packet is ignored as long as another mirror may answer.
+         * @param addr Address of answering host.
+         * @returns true if answer has been accepted, false otherwise.
+         */
+        bool select_mirror(struct sockaddr_storage *addr);
+
+        /**
+         * @brief Sends request to the next mirror too (without waiting for
+         * the previous ones any longer).
+         * @returns true in case of success, false otherwise.
+         */
+        bool race_next();
+
+        /**
+         * @brief Checks if stalled transfer may continue from another mirror.
+         */
+        bool can_fail_over();
+
+        /**
+         * @brief Restarts download on the next mirror. Data which have already
+         * been received are skipped.
+         * @returns true in case of success, false otherwise.
+         */
+        bool fail_over();
+
+        /**
+         * @brief Sends ERROR packet with code "Unknown transfer ID" to
+         * given host without affecting current transfer.
+         * @param addr Address of host to send packet to.
+         */
+        void send_unknown_TID(struct sockaddr_storage *addr);
+
         /**
          * @brief Perform address check for ipv4 host.
          * @param addr Structure with ipv4 address to be checked
@@ -288,6 +637,23 @@ class Tftp_client
          */
         void reset_ipv6_TID();
 
+        /**
+         * @brief Static method. Finds the smallest MTU of interfaces with given
+         * address family. Result is cached for all transfers for a while.
+         * @param family Address family of interfaces.
+         * @param sock Socket to query interfaces with.
+         * @param device Interface transfer is bound to - only its MTU is used (empty if any).
+         * @returns the smallest MTU or -1 if there is no such interface.
+         */
+        static int get_min_mtu(int family, int sock, const std::string &device);
+
+        /**
+         * @brief Static method. Finds interface which owns given local address.
+         * @param addr Local address.
+         * @returns name of interface or empty string if there is no such interface.
+         */
+        static std::string find_device(const struct sockaddr_storage &addr);
+
         /**
          * @brief Check if proposed block size can fit into available
          * MTUs.
@@ -298,7 +664,8 @@ class Tftp_client
 
         /**
          * @brief Check if negotiate size of block can fit
-         * into internal buffers and if not, handles reallocation.
+         * into internal buffers and if not, takes bigger ones
+         * from buffer pool.
          * @returns true in case of success, false otherwise.
          */
         bool realloc_buffers();
@@ -324,7 +691,7 @@ class Tftp_client
          * @param msg Human readable message to include into
          * ERROR packet.
          */
-        void send_ERROR(err_code_t code, std::string msg);
+        void send_ERROR(err_code_t code, const char *msg);
 
         /**
          * @brief Try to fill appropriate data into request packets (RRQ or WRQ)
@@ -334,21 +701,21 @@ class Tftp_client
          * (RRQ or WRQ).
          * @returns true in case of success, false otherwise.
          */
-        bool fill_RQ(std::string filename, opcode_t opcode);
+        bool fill_RQ(const std::string &filename, opcode_t opcode);
 
         /**
          * @brief Try to fill appropriate data into RRQ packet.
          * @param filename Determines name of file to include into request.
          * @returns true in case of success, false otherwise.
          */
-        bool fill_RRQ(std::string filename);
+        bool fill_RRQ(const std::string &filename);
 
         /**
          * @brief Try to fill appropriate data into WRQ packet.
          * @param filename Determines name of file to include into request.
          * @returns true in case of success, false otherwise.
          */
-        bool fill_WRQ(std::string filename);
+        bool fill_WRQ(const std::string &filename);
 
         /**
          * @brief Try to fill appropriate data into DATA packet.
@@ -368,43 +735,47 @@ class Tftp_client
          * @param msg Human readable message to include into buffer.
          * @returns true in case of success, false otherwise.
          */
-        bool fill_ERROR(err_code_t code, std::string msg);
+        bool fill_ERROR(err_code_t code, const char *msg);
 
         /**
-         * @brief Try to add provided two bytes into internal buffer.
-         * @param c1 First byte to add into internal buffer.
-         * @param c2 Second byte to add into internal buffer.
+         * @brief Try to add TFTP extension options from attribute
+         * into internal buffer.
          * @returns true in case of success, false otherwise.
          */
-        bool write_two_bytes(uint8_t c1, uint8_t c2);
+        bool write_options();
 
         /**
-         * @brief Try to add provided byte into internal buffer.
-         * @param b Byte to add into internal buffer.
-         * @returns true in case of success, false otherwise.
+         * @brief Reads data from source till given buffer is full or
+         * there are no more data.
+         * @param dst Buffer to store data into.
+         * @param cap Size of buffer.
+         * @returns number of stored bytes or -1 on error.
          */
-        bool write_byte(uint8_t b);
+        ssize_t read_source(uint8_t *dst, size_t cap);
 
         /**
-         * @brief Try to add provided word into internal buffer.
-         * @param w Word to add into internal buffer.
-         * @returns true in case of success, false otherwise.
+         * @brief Reads data from source and encodes them into netascii.
+         * Second byte of CR sequence which doesn't fit is kept for next block.
+         * @param dst Buffer to store encoded data into.
+         * @param cap Maximal number of bytes to store (size of data block).
+         * @returns number of stored bytes or -1 on error.
          */
-        bool write_word(uint16_t w);
+        ssize_t read_netascii(uint8_t *dst, size_t cap);
 
         /**
-         * @brief Try to add provided string into internal buffer.
-         * @param str String to add into internal buffer.
+         * @brief Decodes recieved netascii data and stores them into sink.
+         * CR sequence may be split between two data blocks.
+         * @param data Recieved data.
          * @returns true in case of success, false otherwise.
          */
-        bool write_string(const char *str);
+        bool write_netascii(byte_span_t data);
 
         /**
-         * @brief Try to add TFTP extension options from attribute
-         * into internal buffer.
+         * @brief Stores recieved data into sink (and copy for cache) and counts them.
+         * @param data Recieved data.
          * @returns true in case of success, false otherwise.
          */
-        bool write_options();
+        bool deliver(byte_span_t data);
 
 
         /**
@@ -435,43 +806,6 @@ class Tftp_client
          */
         bool parse_OACK();
 
-        /**
-         * @brief Try to extract TFTP packet type from
-         * recieved packet.
-         * @param res Varialbe to stored extracted type into.
-         * @returns true in case of success, false otherwise.
-         */
-        bool read_type(uint16_t &res);
-
-        /**
-         * @brief Handle reading of CR byte from recieved
-         * packet for netascii mode.
-         * @param res Variable to store result into.
-         * @returns true in case of success, false otherwise.
-         */
-        bool read_cr(uint8_t &res);
-
-        /**
-         * @brief Try to extract byte from recieved packet.
-         * @param res Variable to store result into.
-         * @returns true in case of success, false otherwise.
-         */
-        bool read_byte(uint8_t &res);
-
-        /**
-         * @brief Try to extract word from recieved packet.
-         * @param res Variable to store result into.
-         * @returns true in case of success, false otherwise.
-         */
-        bool read_word(uint16_t &res);
-
-        /**
-         * @brief Try to extract string from recieved packet.
-         * @param res Variable to store result into.
-         * @returns true in case of success, false otherwise.
-         */
-        bool read_string(std::string &res);
-
         /**
          * @brief Try to validate correctness of extension option
          * from recieved OACK packet (validation is based on appropriate
@@ -480,7 +814,7 @@ class Tftp_client
          * @param value Value of TFTP extension option to validate
          * @returns true in case of success, false otherwise.
          */
-        bool validate_option(std::string option, std::string value);
+        bool validate_option(std::string_view option, std::string_view value);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,271 @@
+/*
+ * @author Jakub Šuráň (xsuran07)
+ * @file tftp_codec.cpp
+ * @brief Implementation of TFTP packet codec.
+ */
+
+#include <string.h>
+#include <arpa/inet.h>
+
+#include "tftp_codec.h"
+
+// HELPERS
+
+static inline uint16_t get_word(const uint8_t *buf)
+{
+    uint16_t tmp;
+
+    memcpy(&tmp, buf, 2);
+    return ntohs(tmp);
+}
+
+static inline void put_word(uint8_t *buf, uint16_t w)
+{
+    uint16_t converted = htons(w);
+
+    memcpy(buf, &converted, 2);
+}
+
+// PACKET BUILDERS
+
+uint16_t Tftp_codec::peek_opcode(const uint8_t *buf, size_t len)
+{
+    if(len < 2) {
+        return 0;
+    }
+
+    return get_word(buf);
+}
+
+size_t Tftp_codec::put_string(uint8_t *buf, std::string_view str)
+{
+    memcpy(buf, str.data(), str.size());
+    buf[str.size()] = '\0';
+
+    return str.size() + 1;
+}
+
+size_t Tftp_codec::build_ack(uint8_t *buf, size_t cap, uint16_t block)
+{
+    if(cap < ack_size()) {
+        return 0;
+    }
+
+    put_word(buf, ACK);
+    put_word(buf + 2, block);
+    return ack_size();
+}
+
+size_t Tftp_codec::build_error(uint8_t *buf, size_t cap, uint16_t code, std::string_view msg)
+{
+    if(cap < error_size(msg.size())) {
+        return 0;
+    }
+
+    put_word(buf, ERROR);
+    put_word(buf + 2, code);
+    return TFTP_HEADER + put_string(buf + TFTP_HEADER, msg);
+}
+
+size_t Tftp_codec::build_request(uint8_t *buf, size_t cap, opcode_t opcode, std::string_view filename,
+    std::string_view mode)
+{
+    size_t len = 2;
+
+    if(cap < request_size(filename.size(), mode.size())) {
+        return 0;
+    }
+
+    put_word(buf, opcode);
+    len += put_string(buf + len, filename);
+    len += put_string(buf + len, mode);
+    return len;
+}
+
+size_t Tftp_codec::build_rrq(uint8_t *buf, size_t cap, std::string_view filename, std::string_view mode)
+{
+    return build_request(buf, cap, RRQ, filename, mode);
+}
+
+size_t Tftp_codec::build_wrq(uint8_t *buf, size_t cap, std::string_view filename, std::string_view mode)
+{
+    return build_request(buf, cap, WRQ, filename, mode);
+}
+
+size_t Tftp_codec::append_option(uint8_t *buf, size_t cap, size_t len, std::string_view name, std::string_view value)
+{
+    if(len + option_size(name.size(), value.size()) > cap) {
+        return 0;
+    }
+
+    len += put_string(buf + len, name);
+    len += put_string(buf + len, value);
+    return len;
+}
+
+size_t Tftp_codec::build_oack(uint8_t *buf, size_t cap)
+{
+    if(cap < 2) {
+        return 0;
+    }
+
+    put_word(buf, OACK);
+    return 2;
+}
+
+void Tftp_codec::build_data_header(uint8_t *buf, uint16_t block)
+{
+    put_word(buf, DATA);
+    put_word(buf + 2, block);
+}
+
+// PACKET VIEWS
+
+bool DataView::parse(const uint8_t *buf, size_t len)
+{
+    if(len < TFTP_HEADER || get_word(buf) != Tftp_codec::DATA) {
+        return false;
+    }
+
+    this->buf = buf;
+    this->len = len;
+    return true;
+}
+
+uint16_t DataView::block() const
+{
+    return get_word(this->buf + 2);
+}
+
+bool AckView::parse(const uint8_t *buf, size_t len)
+{
+    if(len != TFTP_HEADER || get_word(buf) != Tftp_codec::ACK) {
+        return false;
+    }
+
+    this->buf = buf;
+    return true;
+}
+
+uint16_t AckView::block() const
+{
+    return get_word(this->buf + 2);
+}
+
+bool ErrorView::parse(const uint8_t *buf, size_t len)
+{
+    // message has to be terminated by the very last byte of packet
+    if(len < TFTP_HEADER + 1 || get_word(buf) != Tftp_codec::ERROR || buf[len - 1] != '\0') {
+        return false;
+    }
+
+    if(memchr(buf + TFTP_HEADER, '\0', len - TFTP_HEADER) != buf + len - 1) {
+        return false;
+    }
+
+    this->buf = buf;
+    this->len = len;
+    return true;
+}
+
+uint16_t ErrorView::code() const
+{
+    return get_word(this->buf + 2);
+}
+
+std::string_view ErrorView::message() const
+{
+    return std::string_view((const char *) this->buf + TFTP_HEADER, this->len - TFTP_HEADER - 1);
+}
+
+bool RequestView::parse(const uint8_t *buf, size_t len)
+{
+    uint16_t opcode = Tftp_codec::peek_opcode(buf, len);
+    size_t strings = 0;
+
+    if((opcode != Tftp_codec::RRQ && opcode != Tftp_codec::WRQ) || len < 2 || buf[len - 1] != '\0') {
+        return false;
+    }
+
+    // filename and mode are followed by (name, value) pairs of zero terminated strings
+    for(size_t i = 2; i < len; i++) {
+        strings += buf[i] == '\0';
+    }
+
+    if(strings < 2 || strings % 2 != 0) {
+        return false;
+    }
+
+    this->buf = buf;
+    this->len = len;
+    this->file = std::string_view((const char *) buf + 2);
+    this->transfer_mode = std::string_view((const char *) buf + 2 + this->file.size() + 1);
+    this->pos = 2 + this->file.size() + 1 + this->transfer_mode.size() + 1;
+    return !this->file.empty();
+}
+
+uint16_t RequestView::opcode() const
+{
+    return get_word(this->buf);
+}
+
+bool RequestView::next(std::string_view &name, std::string_view &value)
+{
+    const char *start;
+
+    if(this->pos >= this->len) {
+        return false;
+    }
+
+    start = (const char *) this->buf + this->pos;
+    name = std::string_view(start);
+    this->pos += name.size() + 1;
+
+    start = (const char *) this->buf + this->pos;
+    value = std::string_view(start);
+    this->pos += value.size() + 1;
+
+    return true;
+}
+
+bool OackView::parse(const uint8_t *buf, size_t len)
+{
+    size_t strings = 0;
+
+    if(len < 2 || get_word(buf) != Tftp_codec::OACK) {
+        return false;
+    }
+
+    // packet has to consist of (name, value) pairs of zero terminated strings
+    for(size_t i = 2; i < len; i++) {
+        strings += buf[i] == '\0';
+    }
+
+    if(strings % 2 != 0 || (len > 2 && buf[len - 1] != '\0')) {
+        return false;
+    }
+
+    this->buf = buf;
+    this->len = len;
+    this->pos = 2;
+    return true;
+}
+
+bool OackView::next(std::string_view &name, std::string_view &value)
+{
+    const char *start;
+
+    if(this->pos >= this->len) {
+        return false;
+    }
+
+    start = (const char *) this->buf + this->pos;
+    name = std::string_view(start);
+    this->pos += name.size() + 1;
+
+    start = (const char *) this->buf + this->pos;
+    value = std::string_view(start);
+    this->pos += value.size() + 1;
+
+    return true;
+}
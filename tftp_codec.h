@@ -0,0 +1,305 @@
+/*
+ * @author Jakub Šuráň (xsuran07)
+ * @file tftp_codec.h
+ * @brief Interface of TFTP packet codec - typed views over recieved
+ * packets and builders of packets to send.
+ */
+
+#ifndef __TFTP_CODEC_H_
+#define __TFTP_CODEC_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string_view>
+
+#define TFTP_HEADER 4
+#define MAX_REQUEST_SIZE 512
+#define MIN_BLKSIZE 8 // range of blksize option (RFC 2348)
+#define MAX_BLKSIZE 65464
+#define MIN_TIMEOUT 1 // range of timeout option in s (RFC 2349)
+#define MAX_TIMEOUT 255
+
+/**
+ * @brief Contiguous sequence of bytes which is not owned by its holder.
+ */
+typedef struct {
+    const uint8_t *data;
+    size_t size;
+} byte_span_t;
+
+/**
+ * @brief Static helpers for encoding and decoding of TFTP packets. Builders
+ * check available space only once per packet, sizes of packets are computable
+ * in compile time (if lengths of strings are known).
+ */
+class Tftp_codec
+{
+    public:
+        /**
+         * @brief TFTP packet opcodes as they appear on the wire.
+         */
+        typedef enum {
+            RRQ = 1,
+            WRQ,
+            DATA,
+            ACK,
+            ERROR,
+            OACK,
+        } opcode_t;
+
+        /**
+         * @brief Size of ACK packet.
+         */
+        static constexpr size_t ack_size() { return TFTP_HEADER; };
+
+        /**
+         * @brief Size of ERROR packet with message of given length.
+         */
+        static constexpr size_t error_size(size_t msg_len) { return TFTP_HEADER + msg_len + 1; };
+
+        /**
+         * @brief Size of RRQ/WRQ packet (without options) with filename and mode of given lengths.
+         */
+        static constexpr size_t request_size(size_t file_len, size_t mode_len) { return 2 + file_len + 1 + mode_len + 1; };
+
+        /**
+         * @brief Size of one extension option in request packet.
+         */
+        static constexpr size_t option_size(size_t name_len, size_t value_len) { return name_len + 1 + value_len + 1; };
+
+        /**
+         * @brief Extracts opcode from recieved packet.
+         * @param buf Buffer with recieved packet.
+         * @param len Length of recieved packet.
+         * @returns opcode of packet or 0 if packet is too short.
+         */
+        static uint16_t peek_opcode(const uint8_t *buf, size_t len);
+
+        /**
+         * @brief Builds ACK packet.
+         * @param buf Buffer to build packet into.
+         * @param cap Size of buffer.
+         * @param block Block number to acknowledge.
+         * @returns size of built packet, 0 if it didn't fit into buffer.
+         */
+        static size_t build_ack(uint8_t *buf, size_t cap, uint16_t block);
+
+        /**
+         * @brief Builds ERROR packet.
+         * @param buf Buffer to build packet into.
+         * @param cap Size of buffer.
+         * @param code Error code.
+         * @param msg Human readable message.
+         * @returns size of built packet, 0 if it didn't fit into buffer.
+         */
+        static size_t build_error(uint8_t *buf, size_t cap, uint16_t code, std::string_view msg);
+
+        /**
+         * @brief Builds RRQ packet without options.
+         * @param buf Buffer to build packet into.
+         * @param cap Size of buffer.
+         * @param filename Name of requested file.
+         * @param mode Transfer mode (netascii or octet).
+         * @returns size of built packet, 0 if it didn't fit into buffer.
+         */
+        static size_t build_rrq(uint8_t *buf, size_t cap, std::string_view filename, std::string_view mode);
+
+        /**
+         * @brief Builds WRQ packet without options.
+         * @param buf Buffer to build packet into.
+         * @param cap Size of buffer.
+         * @param filename Name of file to write.
+         * @param mode Transfer mode (netascii or octet).
+         * @returns size of built packet, 0 if it didn't fit into buffer.
+         */
+        static size_t build_wrq(uint8_t *buf, size_t cap, std::string_view filename, std::string_view mode);
+
+        /**
+         * @brief Appends extension option to request packet.
+         * @param buf Buffer with request packet.
+         * @param cap Size of buffer.
+         * @param len Current size of request packet.
+         * @param name Name of option.
+         * @param value Value of option.
+         * @returns new size of packet, 0 if option didn't fit into buffer.
+         */
+        static size_t append_option(uint8_t *buf, size_t cap, size_t len, std::string_view name, std::string_view value);
+
+        /**
+         * @brief Builds OACK packet without options (they are appended by append_option).
+         * @param buf Buffer to build packet into.
+         * @param cap Size of buffer.
+         * @returns size of built packet, 0 if it didn't fit into buffer.
+         */
+        static size_t build_oack(uint8_t *buf, size_t cap);
+
+        /**
+         * @brief Writes header of DATA packet. Payload is supposed to be
+         * written right behind header by caller.
+         * @param buf Buffer to build packet into (at least TFTP_HEADER bytes).
+         * @param block Number of data block.
+         */
+        static void build_data_header(uint8_t *buf, uint16_t block);
+
+    private:
+        /**
+         * @brief Builds RRQ or WRQ packet.
+         */
+        static size_t build_request(uint8_t *buf, size_t cap, opcode_t opcode, std::string_view filename,
+            std::string_view mode);
+
+        /**
+         * @brief Copies given string including terminating zero byte into buffer
+         * (space has to be checked by caller).
+         * @returns number of written bytes.
+         */
+        static size_t put_string(uint8_t *buf, std::string_view str);
+};
+
+/**
+ * @brief View of DATA packet in recieve buffer.
+ */
+class DataView
+{
+    private:
+        const uint8_t *buf;
+        size_t len;
+
+    public:
+        /**
+         * @brief Checks format of packet in given buffer and binds view to it.
+         * @returns true if buffer holds valid DATA packet, false otherwise.
+         */
+        bool parse(const uint8_t *buf, size_t len);
+
+        /**
+         * @brief Getter for block number.
+         */
+        uint16_t block() const;
+
+        /**
+         * @brief Getter for transferred data.
+         */
+        byte_span_t payload() const { return {this->buf + TFTP_HEADER, this->len - TFTP_HEADER}; };
+};
+
+/**
+ * @brief View of ACK packet in recieve buffer.
+ */
+class AckView
+{
+    private:
+        const uint8_t *buf;
+
+    public:
+        /**
+         * @brief Checks format of packet in given buffer and binds view to it.
+         * @returns true if buffer holds valid ACK packet, false otherwise.
+         */
+        bool parse(const uint8_t *buf, size_t len);
+
+        /**
+         * @brief Getter for acknowledged block number.
+         */
+        uint16_t block() const;
+};
+
+/**
+ * @brief View of ERROR packet in recieve buffer.
+ */
+class ErrorView
+{
+    private:
+        const uint8_t *buf;
+        size_t len;
+
+    public:
+        /**
+         * @brief Checks format of packet in given buffer and binds view to it.
+         * @returns true if buffer holds valid ERROR packet, false otherwise.
+         */
+        bool parse(const uint8_t *buf, size_t len);
+
+        /**
+         * @brief Getter for error code.
+         */
+        uint16_t code() const;
+
+        /**
+         * @brief Getter for error message (it is always followed by zero byte in buffer).
+         */
+        std::string_view message() const;
+};
+
+/**
+ * @brief View of RRQ/WRQ packet in recieve buffer. Options following
+ * transfer mode are accessed sequentially by method next.
+ */
+class RequestView
+{
+    private:
+        const uint8_t *buf;
+        size_t len;
+        size_t pos;
+        std::string_view file;
+        std::string_view transfer_mode;
+
+    public:
+        /**
+         * @brief Checks format of packet in given buffer and binds view to it.
+         * @returns true if buffer holds valid RRQ or WRQ packet, false otherwise.
+         */
+        bool parse(const uint8_t *buf, size_t len);
+
+        /**
+         * @brief Getter for opcode (RRQ or WRQ).
+         */
+        uint16_t opcode() const;
+
+        /**
+         * @brief Getter for name of requested file.
+         */
+        std::string_view filename() const { return this->file; };
+
+        /**
+         * @brief Getter for transfer mode (as sent by client).
+         */
+        std::string_view mode() const { return this->transfer_mode; };
+
+        /**
+         * @brief Extracts next option from packet.
+         * @param name Variable to store name of option into.
+         * @param value Variable to store value of option into.
+         * @returns true if option has been extracted, false if there are no more options.
+         */
+        bool next(std::string_view &name, std::string_view &value);
+};
+
+/**
+ * @brief View of OACK packet in recieve buffer. Options are accessed
+ * sequentially by method next.
+ */
+class OackView
+{
+    private:
+        const uint8_t *buf;
+        size_t len;
+        size_t pos;
+
+    public:
+        /**
+         * @brief Checks format of packet in given buffer and binds view to it.
+         * @returns true if buffer holds valid OACK packet, false otherwise.
+         */
+        bool parse(const uint8_t *buf, size_t len);
+
+        /**
+         * @brief Extracts next option from packet.
+         * @param name Variable to store name of option into.
+         * @param value Variable to store value of option into.
+         * @returns true if option has been extracted, false if there are no more options.
+         */
+        bool next(std::string_view &name, std::string_view &value);
+};
+
+#endif
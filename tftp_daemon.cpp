@@ -0,0 +1,413 @@
+/*
+ * @author Jakub Šuráň (xsuran07)
+ * @file tftp_daemon.cpp
+ * @brief Implementation of long-running daemon accepting transfer jobs on local socket.
+ */
+
+#include <iostream>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/stat.h>
+#include <sys/epoll.h>
+
+#include "tftp_daemon.h"
+#include "tftp_executor.h"
+
+#define MAX_EVENTS 64
+#define MAX_LINE 4096 // maximal length of request line
+#define MAX_PENDING (1024 * 1024) // maximal size of unsent responses of one connection
+
+#define ID_LISTEN 0 // epoll identifier of listening socket
+#define ID_ENGINE 1 // epoll identifier of engine
+#define ID_FIRST_CONN 2 // epoll identifier of the first connection
+
+// PUBLIC INSTANCE METHODS
+
+// constructor
+Tftp_daemon::Tftp_daemon(const std::string &path)
+{
+    this->path = path;
+    this->listen_fd = -1;
+    this->epfd = -1;
+    this->running = false;
+    this->next_conn = ID_FIRST_CONN;
+    this->next_job = 0;
+    this->next_progress = 0;
+}
+
+// destructor
+Tftp_daemon::~Tftp_daemon()
+{
+    while(!this->connections.empty()) {
+        close_connection(this->connections.begin()->first);
+    }
+
+    if(this->listen_fd != -1) {
+        close(this->listen_fd);
+        unlink(this->path.c_str());
+    }
+
+    if(this->epfd != -1) {
+        close(this->epfd);
+    }
+}
+
+bool Tftp_daemon::run()
+{
+    struct epoll_event events[MAX_EVENTS];
+    int64_t wait;
+    int n;
+
+    if(!init()) {
+        return false;
+    }
+
+    while(this->running || this->engine.get_active() > 0) {
+        // drive transfers - it also arms timers of newly started ones
+        this->engine.step(0);
+
+        if(!this->jobs.empty() && Tftp_client::now_ms() >= this->next_progress) {
+            report_progress();
+        }
+
+        wait = (this->jobs.empty())? -1 : std::max<int64_t>(this->next_progress - Tftp_client::now_ms(), 0);
+
+        if((n = epoll_wait(this->epfd, events, MAX_EVENTS, wait)) == -1) {
+            if(errno != EINTR) {
+                std::cerr << "epoll_wait() failed!" << std::endl;
+                return false;
+            }
+
+            n = 0;
+        }
+
+        for(int i = 0; i < n; i++) {
+            if(events[i].data.u64 == ID_LISTEN) {
+                accept_connections();
+            } else if(events[i].data.u64 != ID_ENGINE) {
+                handle_connection(events[i].data.u64, events[i].events);
+            }
+        }
+    }
+
+    return true;
+}
+
+// PRIVATE INSTANCE METHODS
+
+bool Tftp_daemon::init()
+{
+    struct sockaddr_un addr;
+    struct epoll_event ev;
+    struct stat st;
+
+    if(this->path.size() >= sizeof(addr.sun_path)) {
+        std::cerr << "Path of socket is too long!" << std::endl;
+        return false;
+    }
+
+    if(this->engine.get_fd() == -1) {
+        return false;
+    }
+
+    if((this->listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0)) == -1) {
+        std::cerr << "socket() failed!" << std::endl;
+        return false;
+    }
+
+    // socket left by previous instance
+    if(stat(this->path.c_str(), &st) == 0 && S_ISSOCK(st.st_mode)) {
+        unlink(this->path.c_str());
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    memcpy(addr.sun_path, this->path.c_str(), this->path.size());
+
+    if(bind(this->listen_fd, (struct sockaddr *) &addr, sizeof(addr)) == -1) {
+        std::cerr << "bind() failed - " << strerror(errno) << "!" << std::endl;
+        close(this->listen_fd);
+        this->listen_fd = -1;
+        return false;
+    }
+
+    if(listen(this->listen_fd, SOMAXCONN) == -1) {
+        std::cerr << "listen() failed!" << std::endl;
+        return false;
+    }
+
+    if((this->epfd = epoll_create1(EPOLL_CLOEXEC)) == -1) {
+        std::cerr << "epoll_create1() failed!" << std::endl;
+        return false;
+    }
+
+    ev.events = EPOLLIN;
+    ev.data.u64 = ID_LISTEN;
+    if(epoll_ctl(this->epfd, EPOLL_CTL_ADD, this->listen_fd, &ev) == -1) {
+        std::cerr << "epoll_ctl() failed!" << std::endl;
+        return false;
+    }
+
+    // engine is nested - its epoll descriptor is readable when transfers need attention
+    ev.events = EPOLLIN;
+    ev.data.u64 = ID_ENGINE;
+    if(epoll_ctl(this->epfd, EPOLL_CTL_ADD, this->engine.get_fd(), &ev) == -1) {
+        std::cerr << "epoll_ctl() failed!" << std::endl;
+        return false;
+    }
+
+    this->running = true;
+    return true;
+}
+
+void Tftp_daemon::accept_connections()
+{
+    struct epoll_event ev;
+    int fd;
+
+    while((fd = accept4(this->listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC)) != -1) {
+        uint64_t id = this->next_conn++;
+
+        ev.events = EPOLLIN;
+        ev.data.u64 = id;
+
+        if(epoll_ctl(this->epfd, EPOLL_CTL_ADD, fd, &ev) == -1) {
+            std::cerr << "epoll_ctl() failed!" << std::endl;
+            close(fd);
+            continue;
+        }
+
+        this->connections[id] = {fd, "", "", 0, 0, false, false};
+    }
+
+    if(errno != EAGAIN && errno != EWOULDBLOCK) {
+        std::cerr << "accept4() failed!" << std::endl;
+    }
+}
+
+void Tftp_daemon::handle_connection(uint64_t id, uint32_t events)
+{
+    char buf[MAX_LINE];
+    size_t pos;
+    ssize_t n;
+
+    if(events & EPOLLOUT) {
+        flush(id);
+    }
+
+    if(!(events & (EPOLLIN | EPOLLHUP | EPOLLERR))) {
+        return;
+    }
+
+    // read everything what is available
+    while(true) {
+        auto it = this->connections.find(id);
+
+        if(it == this->connections.end()) {
+            return;
+        }
+
+        n = recv(it->second.fd, buf, sizeof(buf), 0);
+
+        if(n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        }
+
+        // client has gone
+        if(n <= 0) {
+            close_connection(id);
+            return;
+        }
+
+        it->second.in.append(buf, n);
+
+        // perform all complete lines
+        while((pos = it->second.in.find('\n')) != std::string::npos) {
+            std::string line = it->second.in.substr(0, pos);
+
+            it->second.in.erase(0, pos + 1);
+            perform_line(id, line);
+
+            // connection may be closed by response
+            if((it = this->connections.find(id)) == this->connections.end()) {
+                return;
+            }
+        }
+
+        if(it->second.in.size() > MAX_LINE) {
+            std::cerr << "Request line is too long!" << std::endl;
+            close_connection(id);
+            return;
+        }
+    }
+}
+
+void Tftp_daemon::perform_line(uint64_t id, std::string_view line)
+{
+    connection_t &conn = this->connections[id];
+
+    if(!line.empty() && line.back() == '\r') {
+        line.remove_suffix(1);
+    }
+
+    if(line.find_first_not_of(" \t") == std::string_view::npos) {
+        return;
+    }
+
+    if(line == "quit") {
+        conn.closing = true;
+        flush(id);
+        return;
+    }
+
+    // no new connections, daemon ends once running transfers end
+    if(line == "shutdown") {
+        if(this->listen_fd != -1) {
+            close(this->listen_fd);
+            unlink(this->path.c_str());
+            this->listen_fd = -1;
+        }
+
+        this->running = false;
+        return;
+    }
+
+    size_t number = ++conn.jobs;
+
+    // standard input/output of daemon isn't connected to client
+    this->p.set_options(line);
+    if(this->p.parse_command() != Parser::TFTP || this->p.get_params()->is_stdio()) {
+        respond(id, "invalid job=" + std::to_string(number));
+        return;
+    }
+
+    uint64_t key = this->next_job++;
+
+    this->jobs[key] = {id, number, nullptr, Tftp_client::now_ms(), 0};
+    conn.running++;
+    respond(id, "accepted job=" + std::to_string(number));
+
+    // callback is called during stepping of engine, never from inside of add
+    Tftp_client &client = this->engine.add(*this->p.get_params(), [this, key](Tftp_client &session) {
+        complete(key, session);
+    });
+
+    this->jobs[key].client = &client;
+}
+
+void Tftp_daemon::respond(uint64_t id, const std::string &line)
+{
+    auto it = this->connections.find(id);
+
+    if(it == this->connections.end()) {
+        return;
+    }
+
+    // client doesn't read responses
+    if(it->second.out.size() + line.size() > MAX_PENDING) {
+        std::cerr << "Client doesn't read responses - closing connection!" << std::endl;
+        close_connection(id);
+        return;
+    }
+
+    it->second.out += line;
+    it->second.out += '\n';
+    flush(id);
+}
+
+void Tftp_daemon::flush(uint64_t id)
+{
+    auto it = this->connections.find(id);
+    struct epoll_event ev;
+    ssize_t n;
+
+    if(it == this->connections.end()) {
+        return;
+    }
+
+    connection_t &conn = it->second;
+
+    while(!conn.out.empty()) {
+        n = send(conn.fd, conn.out.data(), conn.out.size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+
+        if(n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        }
+
+        if(n == -1) {
+            close_connection(id);
+            return;
+        }
+
+        conn.out.erase(0, n);
+    }
+
+    if(conn.closing && conn.running == 0 && conn.out.empty()) {
+        close_connection(id);
+        return;
+    }
+
+    // watch for writability only while there is something to send
+    if(conn.writing != !conn.out.empty()) {
+        conn.writing = !conn.out.empty();
+        ev.events = (conn.writing)? (uint32_t) (EPOLLIN | EPOLLOUT) : (uint32_t) EPOLLIN;
+        ev.data.u64 = id;
+        epoll_ctl(this->epfd, EPOLL_CTL_MOD, conn.fd, &ev);
+    }
+}
+
+void Tftp_daemon::close_connection(uint64_t id)
+{
+    auto it = this->connections.find(id);
+
+    if(it == this->connections.end()) {
+        return;
+    }
+
+    // closed descriptor is removed from epoll automatically
+    close(it->second.fd);
+    this->connections.erase(it);
+}
+
+void Tftp_daemon::report_progress()
+{
+    for(auto &item : this->jobs) {
+        job_t &job = item.second;
+        uint64_t bytes = job.client->get_transferred();
+
+        if(bytes == job.reported || job.client->is_finished()) {
+            continue;
+        }
+
+        job.reported = bytes;
+        respond(job.conn, "progress job=" + std::to_string(job.number) + " bytes=" + std::to_string(bytes));
+    }
+
+    this->next_progress = Tftp_client::now_ms() + DAEMON_PROGRESS_INTERVAL;
+}
+
+void Tftp_daemon::complete(uint64_t key, Tftp_client &client)
+{
+    auto it = this->jobs.find(key);
+
+    if(it == this->jobs.end()) {
+        return;
+    }
+
+    job_t &job = it->second;
+    Tftp_executor::result_t result = Tftp_executor::make_result(job.number - 1, client, job.started);
+    uint64_t id = job.conn;
+    auto conn = this->connections.find(id);
+
+    this->jobs.erase(it);
+
+    // results of closed connection are dropped
+    if(conn == this->connections.end()) {
+        return;
+    }
+
+    conn->second.running--;
+    respond(id, "result " + Tftp_executor::format_result(result));
+}
@@ -0,0 +1,152 @@
+/*
+ * @author Jakub Šuráň (xsuran07)
+ * @file tftp_daemon.h
+ * @brief Interface of long-running daemon accepting transfer jobs on local socket.
+ */
+
+#ifndef __TFTP_DAEMON_H_
+#define __TFTP_DAEMON_H_
+
+#include <string>
+#include <string_view>
+#include <map>
+#include <stdint.h>
+
+#include "parser.h"
+#include "tftp_engine.h"
+
+#define DAEMON_PROGRESS_INTERVAL 500 // ms between progress reports of running job
+
+/**
+ * @brief Long-running daemon which accepts transfer jobs on Unix domain socket.
+ * All jobs are run by one engine, so buffers, cached MTUs, etc. stay warm
+ * between jobs. Protocol is line based - every request line has the same
+ * format as TFTP request in interactive terminal and daemon answers with lines:
+ *  - accepted job=N - request has been accepted and transfer has been started
+ *  - invalid job=N - request couldn't be parsed
+ *  - progress job=N bytes=B - transfer is running (sent periodically)
+ *  - result job=N status=ok|failed bytes=B time_ms=T file=F - transfer has ended
+ * Jobs are numbered from 1 within every connection. Line "quit" closes connection
+ * once all its jobs end, line "shutdown" stops accepting of connections and daemon
+ * ends as soon as all running transfers end.
+ */
+class Tftp_daemon
+{
+    private:
+        /**
+         * @brief Representation of one connected client.
+         */
+        typedef struct {
+            int fd;
+            std::string in; // incomplete request line
+            std::string out; // unsent responses
+            size_t jobs; // number of jobs submitted by client
+            size_t running; // number of jobs which haven't ended yet
+            bool writing; // socket is watched for writability
+            bool closing; // connection is closed once its jobs end and responses are sent
+        } connection_t;
+
+        /**
+         * @brief Representation of one running job.
+         */
+        typedef struct {
+            uint64_t conn; // identifier of connection which submitted job
+            size_t number; // number of job within connection
+            Tftp_client *client;
+            int64_t started;
+            uint64_t reported; // number of bytes in last progress report
+        } job_t;
+
+        std::string path;
+        int listen_fd;
+        int epfd;
+        bool running;
+        Tftp_engine engine;
+        Parser p;
+        std::map<uint64_t, connection_t> connections;
+        uint64_t next_conn;
+        std::map<uint64_t, job_t> jobs;
+        uint64_t next_job;
+        int64_t next_progress;
+
+    public:
+        /**
+         * @brief Constructor.
+         * @param path Path of Unix domain socket to listen on.
+         */
+        Tftp_daemon(const std::string &path);
+
+        /**
+         * @brief Destructor. Closes all connections and removes socket.
+         */
+        ~Tftp_daemon();
+
+        Tftp_daemon(const Tftp_daemon &) = delete;
+        Tftp_daemon &operator=(const Tftp_daemon &) = delete;
+
+        /**
+         * @brief Accepts and performs jobs till shutdown is requested.
+         * @returns true if daemon ended properly, false if it couldn't be started.
+         */
+        bool run();
+
+    private:
+        /**
+         * @brief Creates listening socket and epoll instance.
+         * @returns true in case of success, false otherwise.
+         */
+        bool init();
+
+        /**
+         * @brief Accepts all pending connections.
+         */
+        void accept_connections();
+
+        /**
+         * @brief Reads requests from connection or sends pending responses.
+         * @param id Identifier of connection.
+         * @param events Events reported by epoll.
+         */
+        void handle_connection(uint64_t id, uint32_t events);
+
+        /**
+         * @brief Performs one request line.
+         * @param id Identifier of connection which sent request.
+         * @param line Request line (without line terminator).
+         */
+        void perform_line(uint64_t id, std::string_view line);
+
+        /**
+         * @brief Queues response line for connection and tries to send it.
+         * @param id Identifier of connection.
+         * @param line Response line (without line terminator).
+         */
+        void respond(uint64_t id, const std::string &line);
+
+        /**
+         * @brief Sends as much of pending responses as possible without blocking
+         * and closes connection if it is supposed to be closed.
+         * @param id Identifier of connection.
+         */
+        void flush(uint64_t id);
+
+        /**
+         * @brief Closes connection (its running jobs continue, results are dropped).
+         * @param id Identifier of connection.
+         */
+        void close_connection(uint64_t id);
+
+        /**
+         * @brief Sends progress of running jobs to their clients.
+         */
+        void report_progress();
+
+        /**
+         * @brief Sends result of ended job to its client.
+         * @param key Identifier of job.
+         * @param client Ended transfer.
+         */
+        void complete(uint64_t key, Tftp_client &client);
+};
+
+#endif
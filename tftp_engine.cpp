@@ -0,0 +1,337 @@
+/*
+ * @author Jakub Šuráň (xsuran07)
+ * @file tftp_engine.cpp
+ * @brief Implementation of class running many TFTP transfers concurrently.
+ */
+
+#include <iostream>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <sys/eventfd.h>
+
+#include "tftp_engine.h"
+#include "tftp_resolver.h"
+
+#define MAX_EVENTS 64
+
+// PUBLIC INSTANCE METHODS
+
+// constructor
+Tftp_engine::Tftp_engine() : wheel(Tftp_client::now_ms())
+{
+    struct epoll_event ev;
+
+    this->running = 0;
+    this->waiting = 0;
+    this->failed = 0;
+    this->armed = -1;
+    this->epfd = epoll_create1(EPOLL_CLOEXEC);
+    this->tfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    this->efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    do {
+        if(this->epfd == -1) {
+            std::cerr << "epoll_create1() failed!" << std::endl;
+            break;
+        }
+
+        if(this->tfd == -1) {
+            std::cerr << "timerfd_create() failed!" << std::endl;
+            break;
+        }
+
+        // timerfd is recognized by empty pointer
+        ev.events = EPOLLIN;
+        ev.data.ptr = nullptr;
+
+        if(epoll_ctl(this->epfd, EPOLL_CTL_ADD, this->tfd, &ev) == -1) {
+            std::cerr << "epoll_ctl() failed!" << std::endl;
+            break;
+        }
+
+        // without eventfd names are resolved in place (start of transfer blocks)
+        ev.data.ptr = &this->efd;
+
+        if(this->efd != -1 && epoll_ctl(this->epfd, EPOLL_CTL_ADD, this->efd, &ev) == -1) {
+            close(this->efd);
+            this->efd = -1;
+        }
+
+        return;
+    } while(0);
+
+    // engine is unusable without both descriptors
+    if(this->epfd != -1) {
+        close(this->epfd);
+        this->epfd = -1;
+    }
+}
+
+// destructor
+Tftp_engine::~Tftp_engine()
+{
+    if(this->epfd != -1) {
+        close(this->epfd);
+    }
+
+    if(this->tfd != -1) {
+        close(this->tfd);
+    }
+
+    if(this->efd != -1) {
+        Tftp_resolver::instance().forget(this->efd);
+        close(this->efd);
+    }
+}
+
+Tftp_client &Tftp_engine::add(const Tftp_parameters &params, done_cb_t on_done,
+    std::unique_ptr<Tftp_client> client)
+{
+    session_t *session;
+
+    this->sessions.push_back(std::make_unique<session_t>());
+    session = this->sessions.back().get();
+    session->client = (client)? std::move(client) : std::make_unique<Tftp_client>();
+    session->on_done = on_done;
+    Timer_wheel::init_timer(&session->timer, session);
+
+    // transfer is started once resolver has names of its servers
+    if(this->epfd != -1 && this->efd != -1 && !names_ready(params)) {
+        session->params = std::make_unique<Tftp_parameters>(params);
+        this->waiting++;
+        return *session->client;
+    }
+
+    begin(session, params);
+    return *session->client;
+}
+
+void Tftp_engine::step(int64_t max_wait)
+{
+    struct epoll_event events[MAX_EVENTS];
+    int n;
+
+    // nothing to wait for, stale deadline would keep nesting loop awake
+    if(this->running == 0 && this->waiting == 0) {
+        reap();
+        arm_timerfd();
+        return;
+    }
+
+    arm_timerfd();
+
+    if((n = epoll_wait(this->epfd, events, MAX_EVENTS, max_wait)) == -1) {
+        if(errno != EINTR) {
+            std::cerr << "epoll_wait() failed!" << std::endl;
+        }
+
+        n = 0;
+    }
+
+    for(int i = 0; i < n; i++) {
+        session_t *session = static_cast<session_t *> (events[i].data.ptr);
+
+        if(session == nullptr) {
+            handle_timers();
+            continue;
+        }
+
+        if(events[i].data.ptr == &this->efd) {
+            resume_waiting();
+            continue;
+        }
+
+        if(session->client->get_state() != Tftp_client::STATE_RUNNING) {
+            continue;
+        }
+
+        // packet moves deadlines of transfer => timer is rearmed
+        session->client->on_readable();
+        update_timer(session);
+    }
+
+    reap();
+
+    // deadlines moved by handled packets (e.g. pacing) have to wake loop which nests engine
+    arm_timerfd();
+}
+
+size_t Tftp_engine::run()
+{
+    size_t failed = this->failed;
+
+    while(!this->sessions.empty()) {
+        step(-1);
+    }
+
+    return this->failed - failed;
+}
+
+// PRIVATE INSTANCE METHODS
+
+void Tftp_engine::begin(session_t *session, const Tftp_parameters &params)
+{
+    struct epoll_event ev;
+
+    if(this->epfd == -1 || !session->client->start(params)) {
+        return;
+    }
+
+    // transfer may end right after request has been sent
+    if(session->client->is_finished()) {
+        return;
+    }
+
+    // even transfer which cannot be watched ends by its deadline (engine may be nested
+    // into other loop, which doesn't call step till something happens)
+    this->running++;
+    update_timer(session);
+    arm_timerfd();
+
+    ev.events = EPOLLIN;
+    ev.data.ptr = session;
+
+    if(epoll_ctl(this->epfd, EPOLL_CTL_ADD, session->client->get_socket(), &ev) == -1) {
+        std::cerr << "epoll_ctl() failed!" << std::endl;
+    }
+}
+
+bool Tftp_engine::names_ready(const Tftp_parameters &params)
+{
+    std::vector<Tftp_parameters::mirror_t> servers = params.get_mirrors();
+    bool ready = true;
+
+    // server given by default values
+    if(servers.empty()) {
+        servers.push_back({params.get_address(), params.get_addr_family(), params.get_port()});
+    }
+
+    // all names are resolved at once
+    for(auto &server : servers) {
+        if(server.addr_family == AF_UNSPEC && !Tftp_resolver::instance().prepare(server.address, this->efd)) {
+            ready = false;
+        }
+    }
+
+    return ready;
+}
+
+void Tftp_engine::resume_waiting()
+{
+    uint64_t count;
+
+    // eventfd has to be read, otherwise it stays readable
+    if(read(this->efd, &count, sizeof(count)) == -1 && errno != EAGAIN) {
+        std::cerr << "read() from eventfd failed!" << std::endl;
+    }
+
+    // started transfers stay in place, so indices remain valid
+    for(size_t i = 0; i < this->sessions.size(); i++) {
+        session_t *session = this->sessions[i].get();
+
+        if(!session->params || !names_ready(*session->params)) {
+            continue;
+        }
+
+        std::unique_ptr<Tftp_parameters> params = std::move(session->params);
+
+        this->waiting--;
+        begin(session, *params);
+    }
+}
+
+void Tftp_engine::handle_timers()
+{
+    uint64_t expirations;
+    int64_t now = Tftp_client::now_ms();
+
+    // timerfd has to be read, otherwise it stays readable
+    if(read(this->tfd, &expirations, sizeof(expirations)) == -1 && errno != EAGAIN) {
+        std::cerr << "read() from timerfd failed!" << std::endl;
+    }
+
+    this->armed = -1;
+    this->expired.clear();
+    this->wheel.advance(now, this->expired);
+
+    for(auto *timer : this->expired) {
+        session_t *session = static_cast<session_t *> (timer->data);
+
+        session->client->handle_timers(now);
+        update_timer(session);
+    }
+}
+
+void Tftp_engine::update_timer(session_t *session)
+{
+    Tftp_client *client = session->client.get();
+
+    // socket is closed by transfer itself, so it is removed from epoll automatically
+    if(client->is_finished()) {
+        this->wheel.cancel(&session->timer);
+        this->running--;
+        return;
+    }
+
+    // most packets don't change the nearest deadline
+    if(session->timer.slot < 0 || session->timer.expires != client->get_deadline()) {
+        this->wheel.schedule(&session->timer, client->get_deadline());
+    }
+}
+
+void Tftp_engine::arm_timerfd()
+{
+    int64_t next = this->wheel.next_expiry();
+    struct itimerspec spec = {};
+
+    if(next == this->armed) {
+        return;
+    }
+
+    // zero value disarms timer
+    if(next >= 0) {
+        spec.it_value.tv_sec = next / 1000;
+        spec.it_value.tv_nsec = (next % 1000) * 1000000;
+
+        // zero would disarm timer instead of firing immediately
+        if(next == 0) {
+            spec.it_value.tv_nsec = 1;
+        }
+    }
+
+    if(timerfd_settime(this->tfd, TFD_TIMER_ABSTIME, &spec, nullptr) == -1) {
+        std::cerr << "timerfd_settime() failed!" << std::endl;
+        return;
+    }
+
+    this->armed = next;
+}
+
+void Tftp_engine::reap()
+{
+    size_t i = 0;
+
+    while(i < this->sessions.size()) {
+        session_t *session = this->sessions[i].get();
+
+        if(!session->client->is_finished()) {
+            i++;
+            continue;
+        }
+
+        this->wheel.cancel(&session->timer);
+        this->failed += !session->client->is_successful();
+
+        if(session->on_done) {
+            session->on_done(*session->client);
+        }
+
+        // order of transfers doesn't matter => swap with last one
+        if(i != this->sessions.size() - 1) {
+            std::swap(this->sessions[i], this->sessions.back());
+        }
+
+        this->sessions.pop_back();
+    }
+}
@@ -0,0 +1,151 @@
+/*
+ * @author Jakub Šuráň (xsuran07)
+ * @file tftp_engine.h
+ * @brief Interface of class running many TFTP transfers concurrently.
+ */
+
+#ifndef __TFTP_ENGINE_H_
+#define __TFTP_ENGINE_H_
+
+#include <vector>
+#include <memory>
+#include <functional>
+
+#include "tftp_client.h"
+#include "tftp_parameters.h"
+#include "timer_wheel.h"
+
+/**
+ * @brief Event driven engine which runs many TFTP transfers concurrently
+ * from one thread. Sockets of all transfers are watched by one epoll
+ * instance, deadlines of all transfers are kept in timing wheel driven
+ * by one timerfd watched by the same epoll instance. Transfer whose server
+ * is given by host name waits till the name is resolved on background thread,
+ * so other transfers aren't stalled by slow DNS.
+ */
+class Tftp_engine
+{
+    public:
+        /**
+         * @brief Callback called when transfer ends (successfully or not).
+         * Transfer is destroyed right after callback returns.
+         */
+        typedef std::function<void(Tftp_client &session)> done_cb_t;
+
+    private:
+        /**
+         * @brief Representation of one transfer.
+         */
+        typedef struct {
+            std::unique_ptr<Tftp_client> client;
+            done_cb_t on_done;
+            wheel_timer_t timer; // the nearest deadline of transfer
+            std::unique_ptr<Tftp_parameters> params; // kept till names of servers are resolved
+        } session_t;
+
+        int epfd;
+        int tfd; // timerfd set to the nearest expiry of wheel
+        int64_t armed; // time timerfd is set to, -1 if it is disarmed
+        int efd; // eventfd written by resolver when names of waiting transfers are resolved
+        Timer_wheel wheel;
+        std::vector<wheel_timer_t *> expired;
+        std::vector<std::unique_ptr<session_t>> sessions;
+        size_t running;
+        size_t waiting; // transfers waiting for resolution of names
+        size_t failed;
+
+    public:
+        /**
+         * @brief Constructor.
+         */
+        Tftp_engine();
+
+        /**
+         * @brief Destructor.
+         */
+        ~Tftp_engine();
+
+        Tftp_engine(const Tftp_engine &) = delete;
+        Tftp_engine &operator=(const Tftp_engine &) = delete;
+
+        /**
+         * @brief Starts new transfer with given parameters. Transfer is driven
+         * by methods step and run.
+         * @param params Parameters of transfer (they are copied).
+         * @param on_done Callback called when transfer ends (optional).
+         * @param client Transfer prepared by caller, e.g. with its own source or sink
+         * (optional, new one is created otherwise).
+         * @returns transfer, which is valid till its callback returns (transfer
+         * which couldn't be started is already finished, callback is called anyway).
+         */
+        Tftp_client &add(const Tftp_parameters &params, done_cb_t on_done = nullptr,
+            std::unique_ptr<Tftp_client> client = nullptr);
+
+        /**
+         * @brief Waits for one batch of events (packets or expired timeouts) and handles it.
+         * @param max_wait Maximal time to wait in ms (-1 means no limit).
+         */
+        void step(int64_t max_wait);
+
+        /**
+         * @brief Drives all started transfers till they end.
+         * @returns number of transfers which didn't end successfully.
+         */
+        size_t run();
+
+        /**
+         * @brief Getter for epoll descriptor of engine. It becomes readable when
+         * engine has work to do, so engine can be nested into another event loop
+         * (method step has to be called with zero wait then).
+         */
+        int get_fd() { return this->epfd; };
+
+        /**
+         * @brief Getter for number of transfers which haven't ended yet.
+         */
+        size_t get_active() { return this->sessions.size(); };
+
+    private:
+        /**
+         * @brief Starts transfer and watches its socket and deadlines.
+         * @param session Transfer.
+         * @param params Parameters of transfer.
+         */
+        void begin(session_t *session, const Tftp_parameters &params);
+
+        /**
+         * @brief Checks that all host names of servers of transfer are cached, so
+         * start of transfer doesn't block. Resolution of the others is started.
+         * @param params Parameters of transfer.
+         * @returns true if all names are cached, false otherwise.
+         */
+        bool names_ready(const Tftp_parameters &params);
+
+        /**
+         * @brief Starts transfers whose names have been resolved meanwhile.
+         */
+        void resume_waiting();
+
+        /**
+         * @brief Handles expired timeouts of transfers.
+         */
+        void handle_timers();
+
+        /**
+         * @brief Moves timer of running transfer to its current deadline or removes
+         * it from wheel if transfer has just ended.
+         */
+        void update_timer(session_t *session);
+
+        /**
+         * @brief Sets timerfd to the nearest expiry of wheel (if it has changed).
+         */
+        void arm_timerfd();
+
+        /**
+         * @brief Calls callbacks of ended transfers and destroys them.
+         */
+        void reap();
+};
+
+#endif
@@ -0,0 +1,296 @@
+/*
+ * @author Jakub Šuráň (xsuran07)
+ * @file tftp_executor.cpp
+ * @brief Implementation of class distributing TFTP transfers among worker threads.
+ */
+
+#include <algorithm>
+#include <sys/stat.h>
+
+#include "tftp_executor.h"
+#include "tftp_engine.h"
+#include "tftp_client.h"
+#include "tftp_checksum.h"
+
+// HELPERS
+
+// the earliest virtual deadline is on top of heap
+template<typename T>
+static bool later_deadline(const T &a, const T &b)
+{
+    return a.deadline > b.deadline;
+}
+
+// PUBLIC INSTANCE METHODS
+
+// constructor
+Tftp_executor::Tftp_executor(size_t threads, size_t sessions)
+{
+    if(threads == 0) {
+        threads = std::max(std::thread::hardware_concurrency(), 1U);
+    }
+
+    for(size_t i = 0; i < threads; i++) {
+        this->workers.push_back(std::make_unique<worker_t>());
+        this->workers.back()->sessions = std::max<size_t>(sessions, 1);
+    }
+
+    this->next_worker = 0;
+    this->next_report = 0;
+}
+
+void Tftp_executor::set_concurrency(size_t concurrency)
+{
+    // worker without any allowed transfer would only steal
+    if(concurrency < this->workers.size()) {
+        this->workers.resize(std::max<size_t>(concurrency, 1));
+    }
+
+    for(size_t i = 0; i < this->workers.size(); i++) {
+        this->workers[i]->sessions = std::max<size_t>(concurrency / this->workers.size() +
+            (i < concurrency % this->workers.size()), 1);
+    }
+
+    this->next_worker %= this->workers.size();
+}
+
+size_t Tftp_executor::submit(const Tftp_parameters &params)
+{
+    size_t id = this->results.size();
+    worker_t &worker = *this->workers[this->next_worker];
+    int64_t now = Tftp_client::now_ms();
+
+    this->next_worker = (this->next_worker + 1) % this->workers.size();
+    this->results.push_back({id, false, 0, 0, params.get_filename(), "", "", false, false, ""});
+    this->completed.push_back(false);
+
+    std::lock_guard<std::mutex> guard(worker.lock);
+    auto &jobs = worker.jobs[params.get_priority()];
+
+    jobs.push_back({id, params, now, now + (int64_t) (estimate_size(params) / SCHED_RATE)});
+    std::push_heap(jobs.begin(), jobs.end(), later_deadline<job_t>);
+    worker.submitted[params.get_priority()].insert(now);
+
+    return id;
+}
+
+size_t Tftp_executor::run()
+{
+    size_t failed = 0;
+    size_t used = std::min(this->workers.size(), this->results.size() - this->next_report);
+
+    // there is no reason to start more threads than jobs, the rest is stolen
+    for(size_t i = 0; i < used; i++) {
+        this->workers[i]->thread = std::thread(&Tftp_executor::work, this, i);
+    }
+
+    for(size_t i = 0; i < used; i++) {
+        this->workers[i]->thread.join();
+    }
+
+    for(auto &result : this->results) {
+        failed += !result.ok;
+    }
+
+    return failed;
+}
+
+void Tftp_executor::clear()
+{
+    this->results.clear();
+    this->completed.clear();
+    this->next_report = 0;
+}
+
+// STATIC METHODS
+
+std::string Tftp_executor::format_result(const result_t &result)
+{
+    std::string line;
+
+    line += "job=" + std::to_string(result.id + 1);
+    line += (result.ok)? " status=ok" : " status=failed";
+    line += " bytes=" + std::to_string(result.bytes);
+    line += " time_ms=" + std::to_string(result.duration);
+    if(result.skipped) {
+        line += " sync=skipped";
+    }
+    if(!result.cache.empty()) {
+        line += " cache=" + result.cache;
+    }
+    if(result.shared) {
+        line += " flight=joined";
+    }
+    if(!result.mirror.empty()) {
+        line += " mirror=" + result.mirror;
+    }
+    if(!result.checksum.empty()) {
+        line += " " + result.checksum;
+    }
+    line += " file=" + result.filename;
+
+    return line;
+}
+
+Tftp_executor::result_t Tftp_executor::make_result(size_t id, Tftp_client &client, int64_t started)
+{
+    std::string checksum;
+    std::string cache;
+
+    if(!client.get_digest().empty()) {
+        checksum = std::string(Tftp_checksum::get_name(client.get_params().get_checksum())) + "=" + client.get_digest();
+    }
+
+    if(client.get_cache_status() != Tftp_client::CACHE_NONE) {
+        cache = (client.get_cache_status() == Tftp_client::CACHE_HIT)? "hit" : "miss";
+    }
+
+    return {id, client.is_successful(), client.get_transferred(), Tftp_client::now_ms() - started,
+        client.get_params().get_filename(), checksum, cache, client.is_skipped(), client.is_follower(), client.get_mirror()};
+}
+
+uint64_t Tftp_executor::estimate_size(const Tftp_parameters &params)
+{
+    std::vector<std::string_view> parts;
+    struct stat st;
+
+    // size of piped data isn't known in advance
+    if(params.is_stdio()) {
+        return SCHED_UNKNOWN_SIZE;
+    }
+
+    // size listed in manifest is the most reliable estimate
+    if(params.get_expected() > 0) {
+        return params.get_expected();
+    }
+
+    Tftp_parameters::split_string(params.get_filename(), '/', parts);
+    std::string path((params.get_local().empty())? std::string(parts.back()) : params.get_local());
+
+    // downloaded file is expected to be as big as its local version
+    if(stat(path.c_str(), &st) == 0 && S_ISREG(st.st_mode)) {
+        return st.st_size;
+    }
+
+    return SCHED_UNKNOWN_SIZE;
+}
+
+int Tftp_executor::choose_class(const int64_t *oldest, int last, int64_t now)
+{
+    int best = -1;
+    int64_t best_rank = 0;
+    int64_t best_wait = 0;
+
+    // class is raised by one for every SCHED_AGING ms its oldest job waits (without bound,
+    // so long waiting job may overtake even jobs of higher class which wait shorter)
+    for(int c = Tftp_parameters::PRIORITY_HIGH; c <= last; c++) {
+        if(oldest[c] == -1) {
+            continue;
+        }
+
+        int64_t wait = now - oldest[c];
+        int64_t rank = (int64_t) c * SCHED_AGING - wait;
+
+        if(best == -1 || rank < best_rank || (rank == best_rank && wait > best_wait)) {
+            best = c;
+            best_rank = rank;
+            best_wait = wait;
+        }
+    }
+
+    return best;
+}
+
+// PRIVATE INSTANCE METHODS
+
+void Tftp_executor::work(size_t index)
+{
+    Tftp_engine engine;
+    job_t job;
+    size_t bulk = 0; // running transfers of class PRIORITY_LOW
+    size_t sessions = this->workers[index]->sessions;
+
+    while(true) {
+        // fill engine up to its limit, urgent jobs take slots of bulk transfers instead of waiting for them;
+        // jobs dealt to other workers are left to them unless this one has almost nothing to do
+        while(engine.get_active() < sessions + bulk &&
+            take_job(index, job, engine.get_active() >= sessions, engine.get_active() < SCHED_STEAL_LOW)) {
+            size_t id = job.id;
+            int64_t started = Tftp_client::now_ms();
+            bool low = job.params.get_priority() == Tftp_parameters::PRIORITY_LOW;
+
+            bulk += low;
+            engine.add(job.params, [this, id, started, low, &bulk](Tftp_client &session) {
+                bulk -= low;
+                complete(make_result(id, session, started));
+            });
+        }
+
+        // all queues are empty and nothing new can come during run
+        if(engine.get_active() == 0) {
+            break;
+        }
+
+        engine.step(-1);
+    }
+}
+
+bool Tftp_executor::take_job(size_t index, job_t &job, bool urgent, bool steal)
+{
+    int64_t now = Tftp_client::now_ms();
+    size_t queues = (steal)? this->workers.size() : 1;
+
+    // own jobs first, then jobs of other workers are stolen
+    for(size_t i = 0; i < queues; i++) {
+        worker_t &worker = *this->workers[(index + i) % this->workers.size()];
+        std::lock_guard<std::mutex> guard(worker.lock);
+
+        if(pick_job(worker, job, urgent, now)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool Tftp_executor::pick_job(worker_t &worker, job_t &job, bool urgent, int64_t now)
+{
+    int last = (urgent)? Tftp_parameters::PRIORITY_HIGH : Tftp_parameters::PRIORITY_LOW;
+    int64_t oldest[Tftp_parameters::PRIORITY_LOW + 1];
+
+    // heap is ordered by deadlines, the oldest job of class is kept aside
+    for(int c = Tftp_parameters::PRIORITY_HIGH; c <= Tftp_parameters::PRIORITY_LOW; c++) {
+        oldest[c] = (worker.submitted[c].empty())? -1 : *worker.submitted[c].begin();
+    }
+
+    int best = choose_class(oldest, last, now);
+
+    if(best == -1) {
+        return false;
+    }
+
+    auto &jobs = worker.jobs[best];
+
+    std::pop_heap(jobs.begin(), jobs.end(), later_deadline<job_t>);
+    job = std::move(jobs.back());
+    jobs.pop_back();
+    worker.submitted[best].erase(worker.submitted[best].find(job.submitted));
+    return true;
+}
+
+void Tftp_executor::complete(const result_t &result)
+{
+    std::lock_guard<std::mutex> guard(this->results_lock);
+
+    this->results[result.id] = result;
+    this->completed[result.id] = true;
+
+    // report results in order of submission
+    while(this->next_report < this->results.size() && this->completed[this->next_report]) {
+        if(this->on_result) {
+            this->on_result(this->results[this->next_report]);
+        }
+
+        this->next_report++;
+    }
+}
@@ -0,0 +1,216 @@
+/*
+ * @author Jakub Šuráň (xsuran07)
+ * @file tftp_executor.h
+ * @brief Interface of class distributing TFTP transfers among worker threads.
+ */
+
+#ifndef __TFTP_EXECUTOR_H_
+#define __TFTP_EXECUTOR_H_
+
+#include <vector>
+#include <set>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <string>
+#include <functional>
+#include <stdint.h>
+
+#include "tftp_parameters.h"
+
+class Tftp_client;
+
+#define WORKER_SESSIONS 64 // default maximum of concurrent transfers of one worker
+#define SCHED_RATE 1000 // expected throughput of transfer (bytes per ms) used to compare sizes of jobs
+#define SCHED_UNKNOWN_SIZE (1024 * 1024) // expected size of job whose size cannot be found out
+#define SCHED_AGING 30000 // ms of waiting after which job competes as equal with jobs of one class higher
+#define SCHED_STEAL_LOW 2 // worker steals jobs of others only when it runs fewer transfers
+
+/**
+ * @brief Executor running TFTP transfers on more cores. Every worker thread
+ * owns its own engine (with its sockets and transfers) and queue of jobs.
+ * Jobs are distributed among queues round-robin, worker which has nothing
+ * to do steals jobs from other queues. Within priority class the shortest job
+ * goes first - job gets virtual deadline derived from time of submission and
+ * expected size, so a big job is overtaken only by jobs submitted soon enough
+ * after it and cannot starve. Jobs waiting too long compete with higher class.
+ */
+class Tftp_executor
+{
+    public:
+        /**
+         * @brief Result of one transfer.
+         */
+        typedef struct {
+            size_t id; // index of job in order of submission
+            bool ok;
+            uint64_t bytes; // number of transferred bytes
+            int64_t duration; // duration of transfer in ms
+            std::string filename;
+            std::string checksum; // algorithm=digest of transferred data, empty if it hasn't been computed
+            std::string cache; // hit or miss, empty if cache hasn't been consulted
+            bool skipped; // file hasn't changed => transfer has been skipped by sync mode
+            bool shared; // data have been taken from another transfer of the same file
+            std::string mirror; // address,port of mirror which has served file, empty if only one server has been given
+        } result_t;
+
+        /**
+         * @brief Callback called for results of transfers - in order of submission.
+         */
+        typedef std::function<void(const result_t &result)> report_cb_t;
+
+    private:
+        /**
+         * @brief Transfer waiting for worker.
+         */
+        typedef struct {
+            size_t id;
+            Tftp_parameters params;
+            int64_t submitted; // time of submission in ms
+            int64_t deadline; // virtual deadline in ms, jobs of one class start in its order
+        } job_t;
+
+        /**
+         * @brief Representation of one worker thread.
+         */
+        typedef struct {
+            std::mutex lock;
+            std::vector<job_t> jobs[Tftp_parameters::PRIORITY_LOW + 1]; // heap of jobs for every priority class
+            std::multiset<int64_t> submitted[Tftp_parameters::PRIORITY_LOW + 1]; // times of submission of waiting jobs
+            std::thread thread;
+            size_t sessions; // maximum of concurrent transfers of worker
+        } worker_t;
+
+        std::vector<std::unique_ptr<worker_t>> workers;
+        size_t next_worker;
+
+        std::mutex results_lock;
+        std::vector<result_t> results;
+        std::vector<bool> completed;
+        size_t next_report;
+        report_cb_t on_result;
+
+    public:
+        /**
+         * @brief Constructor.
+         * @param threads Number of worker threads (0 means one per core).
+         * @param sessions Maximum of concurrent transfers of one worker.
+         */
+        Tftp_executor(size_t threads = 0, size_t sessions = WORKER_SESSIONS);
+
+        Tftp_executor(const Tftp_executor &) = delete;
+        Tftp_executor &operator=(const Tftp_executor &) = delete;
+
+        /**
+         * @brief Sets callback for results of transfers.
+         */
+        void set_report(report_cb_t on_result) { this->on_result = on_result; };
+
+        /**
+         * @brief Limits concurrent transfers of all workers together. Limit is spread
+         * evenly (the first workers get remainder), so there are at most as many
+         * workers as allowed transfers. Has to be called before jobs are submitted.
+         * @param concurrency Maximum of concurrent transfers (has to be positive).
+         */
+        void set_concurrency(size_t concurrency);
+
+        /**
+         * @brief Queues new transfer. Transfers are started by method run.
+         * @param params Parameters of transfer (they are copied).
+         * @returns identifier of job (index in order of submission).
+         */
+        size_t submit(const Tftp_parameters &params);
+
+        /**
+         * @brief Runs all queued transfers and waits till they end.
+         * @returns number of transfers which didn't end successfully.
+         */
+        size_t run();
+
+        /**
+         * @brief Forgets results of finished transfers, so the next
+         * submitted job gets identifier 0 again.
+         */
+        void clear();
+
+        /**
+         * @brief Getter for results of transfers from last run (in order of submission).
+         */
+        const std::vector<result_t> &get_results() { return this->results; };
+
+        /**
+         * @brief Static method. Converts result of transfer into machine-readable
+         * line (without line terminator) - job=N status=ok|failed bytes=B time_ms=T [sync=skipped] [cache=hit|miss] [flight=joined] [mirror=address,port] [algorithm=digest] file=F.
+         * @param result Result to convert.
+         * @returns converted result.
+         */
+        static std::string format_result(const result_t &result);
+
+        /**
+         * @brief Static method. Creates result of ended transfer.
+         * @param id Index of job.
+         * @param client Ended transfer.
+         * @param started Time (in ms) when transfer has started.
+         * @returns created result.
+         */
+        static result_t make_result(size_t id, Tftp_client &client, int64_t started);
+
+        /**
+         * @brief Static method. Finds out expected size of transfer - size of
+         * uploaded file or of previous version of downloaded one.
+         * @param params Parameters of transfer.
+         * @returns size in bytes or SCHED_UNKNOWN_SIZE.
+         */
+        static uint64_t estimate_size(const Tftp_parameters &params);
+
+        /**
+         * @brief Static method. Chooses class whose job starts next. Rank of class is its priority
+         * times SCHED_AGING decreased by waiting time of its oldest job, the lowest rank wins and
+         * equal ranks are decided by longer waiting (then by priority).
+         * @param oldest Time (in ms) of submission of the oldest waiting job of every class, -1 if class has no job.
+         * @param last The lowest priority class which may be chosen.
+         * @param now Current time in ms.
+         * @returns chosen class, -1 if no class has a job.
+         */
+        static int choose_class(const int64_t *oldest, int last, int64_t now);
+
+        /**
+         * @brief Getter for number of worker threads.
+         */
+        size_t get_threads() { return this->workers.size(); };
+
+    private:
+        /**
+         * @brief Main loop of worker thread with given index.
+         */
+        void work(size_t index);
+
+        /**
+         * @brief Takes job for worker with given index - from its own queue
+         * or (if it is empty) from queue of another worker.
+         * @param index Index of worker.
+         * @param job Variable to store taken job into.
+         * @param urgent Determines if only jobs of class PRIORITY_HIGH may be taken.
+         * @param steal Determines if jobs of other workers may be taken (worker is nearly idle).
+         * @returns true if job has been taken, false if there are no suitable jobs.
+         */
+        bool take_job(size_t index, job_t &job, bool urgent, bool steal);
+
+        /**
+         * @brief Takes the most preferred job from queue of given worker. Caller holds its lock.
+         * @param worker Worker to take job from.
+         * @param job Variable to store taken job into.
+         * @param urgent Determines if only jobs of class PRIORITY_HIGH may be taken.
+         * @param now Current time in ms.
+         * @returns true if job has been taken, false if there is no suitable job.
+         */
+        bool pick_job(worker_t &worker, job_t &job, bool urgent, int64_t now);
+
+        /**
+         * @brief Stores result of transfer and reports all results which
+         * are already complete in order of submission.
+         */
+        void complete(const result_t &result);
+};
+
+#endif
@@ -0,0 +1,219 @@
+/*
+ * @author Jakub Šuráň (xsuran07)
+ * @file tftp_flight.cpp
+ * @brief Implementation of sharing of identical downloads running at the same time.
+ */
+
+#include <iostream>
+#include <algorithm>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/eventfd.h>
+
+#include "tftp_flight.h"
+#include "tftp_client.h"
+
+#define REPLAY_CHUNK (64 * 1024)
+
+// STATIC ATTRIBUTES
+
+std::mutex Tftp_flight::registry_lock;
+std::unordered_map<std::string, std::shared_ptr<Tftp_flight>> Tftp_flight::registry;
+bool Tftp_flight::enabled = false;
+uint64_t Tftp_flight::spool_limit = FLIGHT_SPOOL_LIMIT;
+
+// PUBLIC INSTANCE METHODS
+
+// constructor
+Tftp_flight::Tftp_flight(const std::string &key)
+{
+    this->key = key;
+    this->spool = -1;
+    this->size = 0;
+    this->limit = spool_limit;
+    this->done = false;
+    this->ok = false;
+}
+
+// destructor
+Tftp_flight::~Tftp_flight()
+{
+    if(this->spool != -1) {
+        close(this->spool);
+    }
+}
+
+void Tftp_flight::publish(byte_span_t data)
+{
+    std::lock_guard<std::mutex> guard(this->lock);
+
+    for(auto &follower : this->followers) {
+        if(!follower.failed && !follower.client->deliver(data)) {
+            follower.failed = true;
+        }
+    }
+
+    if(data.size == 0 || !is_joinable()) {
+        this->size += data.size;
+        return;
+    }
+
+    // memory file is created with first data and kept only while download fits into limit
+    if(this->spool == -1 && this->size + data.size <= this->limit &&
+            (this->spool = memfd_create("tftp-flight", MFD_CLOEXEC)) == -1) {
+        std::cerr << "memfd_create() failed!" << std::endl;
+    }
+
+    // too big download isn't kept, transfers started later run on their own
+    if(this->spool != -1 && (this->size + data.size > this->limit ||
+            pwrite(this->spool, data.data, data.size, this->size) != (ssize_t) data.size)) {
+        close(this->spool);
+        this->spool = -1;
+    }
+
+    this->size += data.size;
+}
+
+void Tftp_flight::complete(bool ok)
+{
+    uint64_t one = 1;
+
+    // transfers started from now on have to download file again
+    {
+        std::lock_guard<std::mutex> guard(registry_lock);
+        auto it = registry.find(this->key);
+
+        if(it != registry.end() && it->second.get() == this) {
+            registry.erase(it);
+        }
+    }
+
+    std::lock_guard<std::mutex> guard(this->lock);
+
+    this->done = true;
+    this->ok = ok;
+
+    for(auto &follower : this->followers) {
+        if(write(follower.event_fd, &one, sizeof(one)) == -1) {
+            std::cerr << "write() to eventfd failed!" << std::endl;
+        }
+    }
+}
+
+void Tftp_flight::leave(Tftp_client *client)
+{
+    std::lock_guard<std::mutex> guard(this->lock);
+
+    this->followers.erase(std::remove_if(this->followers.begin(), this->followers.end(),
+        [client](const follower_t &follower) { return follower.client == client; }), this->followers.end());
+}
+
+bool Tftp_flight::is_successful(Tftp_client *client)
+{
+    std::lock_guard<std::mutex> guard(this->lock);
+
+    for(auto &follower : this->followers) {
+        if(follower.client == client) {
+            return this->done && this->ok && !follower.failed;
+        }
+    }
+
+    return false;
+}
+
+// STATIC METHODS
+
+void Tftp_flight::set_enabled(bool enable)
+{
+    std::lock_guard<std::mutex> guard(registry_lock);
+
+    enabled = enable;
+}
+
+bool Tftp_flight::is_enabled()
+{
+    std::lock_guard<std::mutex> guard(registry_lock);
+
+    return enabled;
+}
+
+void Tftp_flight::set_spool_limit(uint64_t limit)
+{
+    std::lock_guard<std::mutex> guard(registry_lock);
+
+    spool_limit = limit;
+}
+
+std::shared_ptr<Tftp_flight> Tftp_flight::join(const std::string &key, Tftp_client *client, int &event_fd)
+{
+    std::lock_guard<std::mutex> guard(registry_lock);
+    auto it = registry.find(key);
+
+    event_fd = -1;
+
+    if(!enabled) {
+        return nullptr;
+    }
+
+    // nobody downloads file => transfer leads new flight
+    if(it == registry.end()) {
+        auto flight = std::make_shared<Tftp_flight>(key);
+
+        registry[key] = flight;
+        return flight;
+    }
+
+    Tftp_flight &flight = *it->second;
+    std::lock_guard<std::mutex> flight_guard(flight.lock);
+
+    // beginning of data isn't available anymore
+    if(!flight.is_joinable()) {
+        return nullptr;
+    }
+
+    if((event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) == -1) {
+        std::cerr << "eventfd() failed!" << std::endl;
+        return nullptr;
+    }
+
+    flight.followers.push_back({client, event_fd, !flight.replay(client)});
+    return it->second;
+}
+
+std::string Tftp_flight::make_key(const std::string &address, int port, const std::string &filename, bool binary)
+{
+    return address + "," + std::to_string(port) + ":" + filename + ((binary)? ":octet" : ":netascii");
+}
+
+// PRIVATE INSTANCE METHODS
+
+bool Tftp_flight::is_joinable()
+{
+    return this->spool != -1 || this->size == 0;
+}
+
+bool Tftp_flight::replay(Tftp_client *client)
+{
+    uint8_t buf[REPLAY_CHUNK];
+    uint64_t pos = 0;
+    ssize_t n;
+
+    while(pos < this->size) {
+        if((n = pread(this->spool, buf, std::min<uint64_t>(sizeof(buf), this->size - pos), pos)) <= 0) {
+            if(n == -1 && errno == EINTR) {
+                continue;
+            }
+
+            return false;
+        }
+
+        if(!client->deliver({buf, (size_t) n})) {
+            return false;
+        }
+
+        pos += n;
+    }
+
+    return true;
+}
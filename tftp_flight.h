@@ -0,0 +1,146 @@
+/*
+ * @author Jakub Šuráň (xsuran07)
+ * @file tftp_flight.h
+ * @brief Interface of sharing of identical downloads running at the same time.
+ */
+
+#ifndef __TFTP_FLIGHT_H_
+#define __TFTP_FLIGHT_H_
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <stdint.h>
+
+#include "tftp_codec.h"
+
+#define FLIGHT_SPOOL_LIMIT (8 * 1024 * 1024) // default of bytes after which transfers cannot be joined
+
+class Tftp_client;
+
+/**
+ * @brief Download shared by more transfers (single-flight). The first transfer
+ * of file (leader) communicates with server, transfers of the same file started
+ * while it runs (followers) get all its data without any communication. Data
+ * received so far are kept in memory file (only up to spool limit, leader which
+ * exceeds it cannot be joined anymore), so follower attached in the middle
+ * of download gets them first and then follows leader. Followers are woken by
+ * event descriptor once leader ends. Data are passed to followers on leader's
+ * thread, so transfers may run in different engines.
+ */
+class Tftp_flight
+{
+    private:
+        /**
+         * @brief Transfer attached to flight.
+         */
+        typedef struct {
+            Tftp_client *client;
+            int event_fd; // signalled when flight ends, owned by client
+            bool failed; // client has refused data
+        } follower_t;
+
+        static std::mutex registry_lock;
+        static std::unordered_map<std::string, std::shared_ptr<Tftp_flight>> registry; // running flights by key
+        static bool enabled;
+        static uint64_t spool_limit; // bytes kept for followers joining in the middle of download
+
+        std::string key;
+        std::vector<follower_t> followers;
+        int spool; // memory file with received data, -1 until first data and once limit is exceeded
+        uint64_t size; // number of bytes received by leader
+        uint64_t limit; // spool limit valid when flight has started
+        bool done;
+        bool ok;
+        std::mutex lock;
+
+    public:
+        /**
+         * @brief Constructor. Caller holds registry lock.
+         * @param key Key of downloaded file.
+         */
+        Tftp_flight(const std::string &key);
+
+        /**
+         * @brief Destructor. Releases memory file.
+         */
+        ~Tftp_flight();
+
+        Tftp_flight(const Tftp_flight &) = delete;
+        Tftp_flight &operator=(const Tftp_flight &) = delete;
+
+        /**
+         * @brief Passes data received by leader to all followers.
+         * @param data Received data.
+         */
+        void publish(byte_span_t data);
+
+        /**
+         * @brief Ends flight (called by leader) and wakes all followers.
+         * @param ok Determines if download has been successful.
+         */
+        void complete(bool ok);
+
+        /**
+         * @brief Detaches follower from flight (e.g. when it is destroyed).
+         * @param client Follower to detach.
+         */
+        void leave(Tftp_client *client);
+
+        /**
+         * @brief Checks if follower has got all data successfully.
+         * @param client Follower to check.
+         */
+        bool is_successful(Tftp_client *client);
+
+        /**
+         * @brief Static method. Enables or disables sharing of downloads (disabled by default).
+         */
+        static void set_enabled(bool enable);
+
+        /**
+         * @brief Static method. Checks if downloads are shared.
+         */
+        static bool is_enabled();
+
+        /**
+         * @brief Static method. Sets number of bytes a download may receive while it still can be joined.
+         * @param limit Limit in bytes, 0 means only before first data.
+         */
+        static void set_spool_limit(uint64_t limit);
+
+        /**
+         * @brief Static method. Attaches transfer to running flight of the same file
+         * or starts new flight led by given transfer.
+         * @param key Key of downloaded file (see make_key).
+         * @param client Transfer to attach.
+         * @param event_fd Variable to store descriptor of follower into, -1 for leader.
+         * @returns flight or nullptr if transfer has to run on its own.
+         */
+        static std::shared_ptr<Tftp_flight> join(const std::string &key, Tftp_client *client, int &event_fd);
+
+        /**
+         * @brief Static method. Creates key identifying download.
+         * @param address Address of server.
+         * @param port Port of server.
+         * @param filename Remote path of file.
+         * @param binary Determines transfer mode.
+         */
+        static std::string make_key(const std::string &address, int port, const std::string &filename, bool binary);
+
+    private:
+        /**
+         * @brief Checks if all data received so far are available to new follower. Caller holds lock.
+         */
+        bool is_joinable();
+
+        /**
+         * @brief Passes data received so far to new follower. Caller holds lock.
+         * @returns true in case of success, false otherwise.
+         */
+        bool replay(Tftp_client *client);
+};
+
+#endif
@@ -0,0 +1,59 @@
+/*
+ * @author Jakub Šuráň (xsuran07)
+ * @file tftp_mirrors.cpp
+ * @brief Implementation of statistics of mirrors serving the same files.
+ */
+
+#include <algorithm>
+#include <numeric>
+
+#include "tftp_mirrors.h"
+
+#define RTT_WEIGHT 8 // new sample makes 1/RTT_WEIGHT of smoothed time
+
+// PUBLIC INSTANCE METHODS
+
+Tftp_mirrors &Tftp_mirrors::instance()
+{
+    static Tftp_mirrors mirrors;
+
+    return mirrors;
+}
+
+void Tftp_mirrors::record_answer(const std::string &name, int64_t rtt)
+{
+    std::lock_guard<std::mutex> guard(this->lock);
+    auto it = this->mirrors.try_emplace(name, stats_t{-1, 0}).first;
+
+    it->second.rtt = (it->second.rtt < 0)? rtt : (it->second.rtt * (RTT_WEIGHT - 1) + rtt) / RTT_WEIGHT;
+    it->second.failures = 0;
+}
+
+void Tftp_mirrors::record_failure(const std::string &name)
+{
+    std::lock_guard<std::mutex> guard(this->lock);
+
+    this->mirrors.try_emplace(name, stats_t{-1, 0}).first->second.failures++;
+}
+
+std::vector<size_t> Tftp_mirrors::order(const std::vector<std::string> &names)
+{
+    std::lock_guard<std::mutex> guard(this->lock);
+    std::vector<int64_t> scores;
+    std::vector<size_t> res(names.size());
+
+    for(auto &name : names) {
+        auto it = this->mirrors.find(name);
+
+        if(it == this->mirrors.end()) {
+            scores.push_back(-1);
+        } else {
+            scores.push_back(std::max<int64_t>(it->second.rtt, 0) + it->second.failures * MIRROR_FAILURE_PENALTY);
+        }
+    }
+
+    std::iota(res.begin(), res.end(), 0);
+    std::stable_sort(res.begin(), res.end(), [&scores](size_t a, size_t b) { return scores[a] < scores[b]; });
+
+    return res;
+}
@@ -0,0 +1,73 @@
+/*
+ * @author Jakub Šuráň (xsuran07)
+ * @file tftp_mirrors.h
+ * @brief Interface of statistics of mirrors serving the same files.
+ */
+
+#ifndef __TFTP_MIRRORS_H_
+#define __TFTP_MIRRORS_H_
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <stdint.h>
+
+#define MIRROR_FAILURE_PENALTY 1000 // ms added to score of mirror for every failure since its last answer
+
+/**
+ * @brief Statistics of mirrors shared by all transfers. Every mirror keeps
+ * smoothed time of its answers to requests and number of failures (refused
+ * requests, stalled transfers), so transfers try faster and reliable mirrors first.
+ */
+class Tftp_mirrors
+{
+    private:
+        /**
+         * @brief Statistics of one mirror.
+         */
+        typedef struct {
+            int64_t rtt; // smoothed time of answer in ms, -1 if mirror hasn't answered yet
+            uint64_t failures;
+        } stats_t;
+
+        std::unordered_map<std::string, stats_t> mirrors; // address,port => statistics
+        std::mutex lock;
+
+    public:
+        /**
+         * @brief Constructor.
+         */
+        Tftp_mirrors() = default;
+
+        Tftp_mirrors(const Tftp_mirrors &) = delete;
+        Tftp_mirrors &operator=(const Tftp_mirrors &) = delete;
+
+        /**
+         * @brief Static method. Returns statistics shared by all transfers.
+         */
+        static Tftp_mirrors &instance();
+
+        /**
+         * @brief Records answer of mirror to request.
+         * @param name Address and port of mirror.
+         * @param rtt Time between request and answer in ms.
+         */
+        void record_answer(const std::string &name, int64_t rtt);
+
+        /**
+         * @brief Records failure of mirror.
+         * @param name Address and port of mirror.
+         */
+        void record_failure(const std::string &name);
+
+        /**
+         * @brief Sorts mirrors from the most preferred one. Mirrors without any
+         * statistics keep their order and go first, so each of them is tried.
+         * @param names Addresses and ports of mirrors.
+         * @returns indices of mirrors in preferred order.
+         */
+        std::vector<size_t> order(const std::vector<std::string> &names);
+};
+
+#endif
@@ -5,11 +5,19 @@
  */
 
 #include <iostream>
-#include <regex>
+#include <charconv>
+#include <algorithm>
+#include <ctype.h>
+#include <errno.h>
+#include <string.h>
+#include <sys/stat.h>
 #include <arpa/inet.h>
 #include <netinet/in.h>
+#include <net/if.h>
 
 #include "tftp_parameters.h"
+#include "tftp_checksum.h"
+#include "tftp_codec.h"
 
 // METHODS FOR DEBUGGING
 
@@ -17,6 +25,7 @@ void Tftp_parameters::print_params()
 {
  std::cout << "Request_type: " << this->params.req_type << std::endl;   
  std::cout << "Filename: " << this->params.filename << std::endl;   
+ std::cout << "Local: " << this->params.local << std::endl;
  std::cout << "Timeout: " << this->params.timeout << std::endl;   
  std::cout << "Size: " << this->params.size << std::endl;   
  std::cout << "Multicast: " << this->params.multicast << std::endl;   
@@ -26,19 +35,30 @@ void Tftp_parameters::print_params()
  std::cout << "Port: " << this->params.port << std::endl;   
 }
 
+// STATIC ATTRIBUTES
+
+std::string Tftp_parameters::default_device;
+std::string Tftp_parameters::default_source;
+
 // STATIC METHODS
 
-int Tftp_parameters::convert_to_number(std::string str, std::string option = "")
+int Tftp_parameters::convert_to_number(std::string_view str, const char *option = "")
 {
-    char *end;
-    int res = std::strtol(str.c_str(), &end, 10);
+    int res = 0;
+
+    // explicit plus sign is accepted (as strtol does)
+    if(!str.empty() && str.front() == '+') {
+        str.remove_prefix(1);
+    }
+
+    auto ret = std::from_chars(str.data(), str.data() + str.size(), res);
 
-    if(*end) {
+    if(ret.ptr != str.data() + str.size()) {
         std::cerr << option << " may consist of digits only! " << std::endl;
         return -1;       
     }
 
-    if(res <= 0) {
+    if(ret.ec != std::errc() || res <= 0) {
         std::cerr << option << " must be a number larger than 0 (or overflow)!" << std::endl;
         return -1;       
     }
@@ -46,16 +66,116 @@ int Tftp_parameters::convert_to_number(std::string str, std::string option = "")
     return res;
 }
 
-bool Tftp_parameters::split_string(std::string str, std::string pattern, std::vector<std::string> &vec)
+bool Tftp_parameters::parse_size(std::string_view str, uint64_t &res)
 {
-    bool ret = true;
+    size_t pos = std::string_view("KMG").find((str.empty())? '\0' : str.back());
+    uint64_t unit = 1;
+
+    if(pos != std::string_view::npos) {
+        unit = 1ULL << (10 * (pos + 1));
+        str.remove_suffix(1);
+    }
+
+    auto ret = std::from_chars(str.data(), str.data() + str.size(), res);
+
+    if(ret.ec != std::errc() || ret.ptr != str.data() + str.size() || res > UINT64_MAX / unit) {
+        return false;
+    }
+
+    res *= unit;
+    return true;
+}
+
+bool Tftp_parameters::parse_number(std::string_view str, uint64_t &res)
+{
+    auto ret = std::from_chars(str.data(), str.data() + str.size(), res);
+
+    return ret.ec == std::errc() && ret.ptr == str.data() + str.size() && !str.empty();
+}
+
+std::string Tftp_parameters::lower(std::string_view str)
+{
+    std::string res(str);
+
+    std::transform(res.begin(), res.end(), res.begin(), [](unsigned char c) { return tolower(c); });
+    return res;
+}
+
+std::string Tftp_parameters::join_path(const std::string &dir, std::string_view name)
+{
+    std::string res(dir);
+
+    if(res.empty() || res.back() != '/') {
+        res.push_back('/');
+    }
+
+    return res.append(name);
+}
+
+bool Tftp_parameters::make_dirs(const std::string &file, size_t from)
+{
+    for(size_t pos = file.find('/', from + 1); pos != std::string::npos; pos = file.find('/', pos + 1)) {
+        std::string dir = file.substr(0, pos);
+
+        if(mkdir(dir.c_str(), 0755) == -1 && errno != EEXIST) {
+            std::cerr << "Cannot create directory " << dir << " - " << strerror(errno) << "!" << std::endl;
+            return false;
+        }
+    }
 
-    std::regex reg(pattern);
-    std::sregex_token_iterator start(str.begin(), str.end(), reg, -1);
-    std::sregex_token_iterator end;
+    return true;
+}
+
+bool Tftp_parameters::set_default_binding(const std::string &device, const std::string &source)
+{
+    if((!device.empty() && !check_device(device)) || (!source.empty() && !check_source(source))) {
+        return false;
+    }
+
+    default_device = device;
+    default_source = source;
+    return true;
+}
+
+bool Tftp_parameters::check_device(std::string_view str)
+{
+    if(str.empty() || str.size() >= IFNAMSIZ || str.find('/') != std::string_view::npos) {
+        std::cerr << "Invalid name of interface \"" << str << "\"!" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+bool Tftp_parameters::check_source(std::string_view str)
+{
+    std::string address(str);
+    struct in6_addr addr;
+
+    if(inet_pton(AF_INET, address.c_str(), &addr) != 1 && inet_pton(AF_INET6, address.c_str(), &addr) != 1) {
+        std::cerr << "Invalid source address \"" << str << "\" (neighter ipv4 nor ipv6)!" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+bool Tftp_parameters::split_string(std::string_view str, char sep, std::vector<std::string_view> &vec)
+{
+    bool ret = true;
+    size_t start = 0;
+    size_t end;
 
     vec.clear();
-    vec.insert(vec.end(), start, end);
+
+    while(start < str.size()) {
+        if((end = str.find(sep, start)) == std::string_view::npos) {
+            end = str.size();
+        }
+
+        vec.push_back(str.substr(start, end - start));
+        start = end + 1;
+    }
 
     //first string is empty
     if(!vec.empty() && vec.begin()->empty()) {
@@ -82,6 +202,17 @@ void Tftp_parameters::init_values()
 
     this->params.req_type = UNKNOWN;
     this->params.filename = "";
+    this->params.local = "";
+    this->params.unpack = UNPACK_NONE;
+    this->params.checksum = CHECKSUM_NONE;
+    this->params.digest = "";
+    this->params.manifest = "";
+    this->params.sync = false;
+    this->params.priority = PRIORITY_NORMAL;
+    this->params.rate = 0;
+    this->params.device = default_device;
+    this->params.source = default_source;
+    this->params.expected = 0;
     this->params.timeout = -1;
     this->params.size = 512;
     this->params.multicast = false;
@@ -89,9 +220,10 @@ void Tftp_parameters::init_values()
     this->params.addr_family = AF_INET;
     this->params.address = "127.0.0.1";
     this->params.port = 69;
+    this->params.mirrors.clear();
 }
 
-bool Tftp_parameters::parse(size_t &curr, std::vector<std::string> options)
+bool Tftp_parameters::parse(size_t &curr, const std::vector<std::string_view> &options)
 {
     bool ret;
 
@@ -107,6 +239,10 @@ bool Tftp_parameters::parse(size_t &curr, std::vector<std::string> options)
     } else if(options[curr] == "-m") {
         ret = true;
         this->params.multicast = true;
+    // skip unchanged files
+    } else if(options[curr] == "-S") {
+        ret = true;
+        this->params.sync = true;
     // file to upload/download
     } else if(options[curr] == "-d") {
         this->param_with_arg = DATA;
@@ -127,6 +263,38 @@ bool Tftp_parameters::parse(size_t &curr, std::vector<std::string> options)
     } else if(options[curr] == "-a") {
         this->param_with_arg = ADDRESS_PORT;
         ret = require_arg(curr, options);
+    // local file
+    } else if(options[curr] == "-l") {
+        this->param_with_arg = LOCAL;
+        ret = require_arg(curr, options);
+    // unpacking of downloaded data
+    } else if(options[curr] == "-x") {
+        this->param_with_arg = UNPACK;
+        ret = require_arg(curr, options);
+    // checksum of transferred data
+    } else if(options[curr] == "-k") {
+        this->param_with_arg = CHECKSUM;
+        ret = require_arg(curr, options);
+    // manifest with expected checksums
+    } else if(options[curr] == "-M") {
+        this->param_with_arg = MANIFEST;
+        ret = require_arg(curr, options);
+    // priority of queued transfer
+    } else if(options[curr] == "-P") {
+        this->param_with_arg = PRIORITY;
+        ret = require_arg(curr, options);
+    // rate limit
+    } else if(options[curr] == "-r") {
+        this->param_with_arg = RATE;
+        ret = require_arg(curr, options);
+    // interface to send through
+    } else if(options[curr] == "-i") {
+        this->param_with_arg = DEVICE;
+        ret = require_arg(curr, options);
+    // local address to send from
+    } else if(options[curr] == "-B") {
+        this->param_with_arg = SOURCE;
+        ret = require_arg(curr, options);
     // invalid option
     } else {
         ret = false;
@@ -136,6 +304,46 @@ bool Tftp_parameters::parse(size_t &curr, std::vector<std::string> options)
     return ret;
 }
 
+bool Tftp_parameters::set_values(const params_t &values)
+{
+    init_values();
+
+    if(values.size < MIN_BLKSIZE || values.size > MAX_BLKSIZE) {
+        std::cerr << "Only values from range 8-65464 are valid for blksize option!" << std::endl;
+        return false;
+    }
+
+    if((values.timeout >= 0 && values.timeout < MIN_TIMEOUT) || values.timeout > MAX_TIMEOUT) {
+        std::cerr << "Only values from range 1-255 are valid for timeout option!" << std::endl;
+        return false;
+    }
+
+    this->params.req_type = values.req_type;
+    this->params.size = values.size;
+    this->params.timeout = (values.timeout < 0)? -1 : values.timeout;
+    this->params.multicast = values.multicast;
+    this->params.mode = values.mode;
+    this->params.port = values.port;
+    this->params.mirrors = values.mirrors;
+    this->params.unpack = values.unpack;
+    this->params.checksum = values.checksum;
+    this->params.digest = values.digest;
+    this->params.manifest = values.manifest;
+    this->params.sync = values.sync;
+    this->params.priority = values.priority;
+    this->params.rate = values.rate;
+    this->params.expected = values.expected;
+
+    if((!values.device.empty() && !check_device(values.device)) || (!values.source.empty() && !check_source(values.source))) {
+        return false;
+    }
+
+    this->params.device = values.device;
+    this->params.source = values.source;
+
+    return set_local(values.local) && set_filename(values.filename) && set_address(values.address) && set_properly();
+}
+
 bool Tftp_parameters::set_properly()
 {
     // -R or -W has to be used
@@ -150,24 +358,68 @@ bool Tftp_parameters::set_properly()
         return false;
     }
 
+    // the first mirror is contacted if there is only one
+    if(!this->params.mirrors.empty()) {
+        this->params.address = this->params.mirrors.front().address;
+        this->params.addr_family = this->params.mirrors.front().addr_family;
+        this->params.port = this->params.mirrors.front().port;
+    }
+
+    // data are unpacked as they arrive
+    if(this->params.unpack != UNPACK_NONE && (this->params.req_type != READ || this->params.mode != BINARY)) {
+        std::cerr << "Option -x can be used only for download in binary mode!" << std::endl;
+        return false;
+    }
+
+    if(!check_digest()) {
+        return false;
+    }
+
+    // sizes are compared with local file
+    if(this->params.sync && (this->params.mode != BINARY || this->params.unpack != UNPACK_NONE ||
+            this->params.local == "-")) {
+        std::cerr << "Option -S can be used only for local files in binary mode (without -x)!" << std::endl;
+        return false;
+    }
+
+    // archive is extracted into directory
+    if((this->params.unpack == UNPACK_TAR || this->params.unpack == UNPACK_TAR_GZIP ||
+            this->params.unpack == UNPACK_TAR_ZSTD) && this->params.local == "-") {
+        std::cerr << "Archive cannot be extracted to standard output!" << std::endl;
+        return false;
+    }
+
     return true;
 }
 
 // PRIVATE INSTANCE METHODS
 
-bool Tftp_parameters::set_address(std::string str)
+bool Tftp_parameters::set_address(std::string_view str)
 {
     struct in_addr ipv4_addr;
     struct in6_addr ipv6_addr;
+    char buf[INET6_ADDRSTRLEN] = "";
+    size_t scope = str.find('%');
+
+    // inet_pton needs zero terminated string (too long one cannot be valid anyway), scope of ipv6 address is checked later
+    if(scope < str.size() - 1 && str.size() - scope <= IFNAMSIZ) {
+        str.substr(0, scope).copy(buf, std::min<size_t>(scope, INET6_ADDRSTRLEN - 1));
+    } else if(str.size() < INET6_ADDRSTRLEN) {
+        str.copy(buf, str.size());
+        buf[str.size()] = '\0';
+    }
 
     // valid ipv4 address
-    if(inet_pton(AF_INET, str.c_str(), &ipv4_addr) == 1) {
+    if(scope == std::string_view::npos && inet_pton(AF_INET, buf, &ipv4_addr) == 1) {
         this->params.addr_family = AF_INET;
-    //valid ipv6 address
-    } else if(inet_pton(AF_INET6, str.c_str(), &ipv6_addr) == 1) {
+    //valid ipv6 address (with optional scope, e.g. fe80::1%eth0)
+    } else if(inet_pton(AF_INET6, buf, &ipv6_addr) == 1) {
         this->params.addr_family = AF_INET6;
+    // host name is resolved when transfer starts
+    } else if(is_hostname(str)) {
+        this->params.addr_family = AF_UNSPEC;
     } else {
-        std::cerr << "Invalid type address given (neighter ipv4 nor ipv6)!" << std::endl;
+        std::cerr << "Invalid type address given (neighter ipv4, ipv6 nor host name)!" << std::endl;
         return false;
     }
 
@@ -175,9 +427,42 @@ bool Tftp_parameters::set_address(std::string str)
     return true;
 }
 
-bool Tftp_parameters::set_filename(std::string str)
+bool Tftp_parameters::is_hostname(std::string_view str)
 {
-    if(str.empty() || str.at(0) != '/' || str.at(str.size() - 1) == '/') {
+    std::vector<std::string_view> labels;
+
+    if(str.empty() || str.size() > 253) {
+        return false;
+    }
+
+    // trailing dot of fully qualified name
+    if(str.back() == '.') {
+        str.remove_suffix(1);
+    }
+
+    // leading dot isn't allowed
+    if(!split_string(str, '.', labels)) {
+        return false;
+    }
+
+    for(auto label : labels) {
+        if(label.empty() || label.size() > 63 || label.front() == '-' || label.back() == '-') {
+            return false;
+        }
+
+        for(char c : label) {
+            if(!isalnum((unsigned char) c) && c != '-' && c != '_') {
+                return false;
+            }
+        }
+    }
+
+    return !labels.empty();
+}
+
+bool Tftp_parameters::set_filename(std::string_view str)
+{
+    if(str.empty() || str.front() != '/' || str.back() == '/') {
         std::cerr << "Invalid form of argument for option -d (HINT absolute path/filename)!" << std::endl;
         return false;
     }
@@ -186,7 +471,109 @@ bool Tftp_parameters::set_filename(std::string str)
     return true;
 } 
 
-bool Tftp_parameters::set_mode(std::string str)
+bool Tftp_parameters::set_unpack(std::string_view str)
+{
+    if(str == "gzip" || str == "gz") {
+        this->params.unpack = UNPACK_GZIP;
+    } else if(str == "zstd" || str == "zst") {
+        this->params.unpack = UNPACK_ZSTD;
+    } else if(str == "tar") {
+        this->params.unpack = UNPACK_TAR;
+    } else if(str == "tar.gz" || str == "tgz") {
+        this->params.unpack = UNPACK_TAR_GZIP;
+    } else if(str == "tar.zst") {
+        this->params.unpack = UNPACK_TAR_ZSTD;
+    } else {
+        std::cerr << "Unsuported argument for option -x (gzip, zstd, tar, tar.gz or tar.zst)!" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+bool Tftp_parameters::set_checksum(std::string_view str)
+{
+    size_t pos = str.find(':');
+    std::string_view name = str.substr(0, pos);
+
+    if(name == "crc32c") {
+        this->params.checksum = CHECKSUM_CRC32C;
+    } else if(name == "xxh3") {
+        this->params.checksum = CHECKSUM_XXH3;
+    } else if(name == "sha256") {
+        this->params.checksum = CHECKSUM_SHA256;
+    } else {
+        std::cerr << "Unsuported argument for option -k (crc32c, xxh3 or sha256)!" << std::endl;
+        return false;
+    }
+
+    // digest is validated once all options are known
+    this->params.digest = (pos == std::string_view::npos)? "" : str.substr(pos + 1);
+    std::transform(this->params.digest.begin(), this->params.digest.end(), this->params.digest.begin(), ::tolower);
+    return true;
+}
+
+bool Tftp_parameters::set_priority(std::string_view str)
+{
+    if(str == "high") {
+        this->params.priority = PRIORITY_HIGH;
+    } else if(str == "normal") {
+        this->params.priority = PRIORITY_NORMAL;
+    } else if(str == "low") {
+        this->params.priority = PRIORITY_LOW;
+    } else {
+        std::cerr << "Unsuported argument for option -P (high, normal or low)!" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+bool Tftp_parameters::check_digest()
+{
+    if(this->params.checksum == CHECKSUM_NONE) {
+        if(!this->params.digest.empty() || !this->params.manifest.empty()) {
+            std::cerr << "Algorithm of checksum has to be specified by option -k!" << std::endl;
+            return false;
+        }
+
+        return true;
+    }
+
+    // netascii data differ from local file
+    if(this->params.mode != BINARY) {
+        std::cerr << "Checksum can be computed only in binary mode!" << std::endl;
+        return false;
+    }
+
+    if(this->params.digest.empty() && !this->params.manifest.empty() &&
+            !Tftp_checksum::lookup_manifest(this->params.manifest, this->params.filename, this->params.digest)) {
+        std::cerr << "File " << this->params.filename << " isn't listed in manifest!" << std::endl;
+        return false;
+    }
+
+    if(!this->params.digest.empty() && (this->params.digest.size() != Tftp_checksum::get_length(this->params.checksum) ||
+            this->params.digest.find_first_not_of("0123456789abcdef") != std::string::npos)) {
+        std::cerr << "Invalid form of expected " << Tftp_checksum::get_name(this->params.checksum) << " checksum!" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+bool Tftp_parameters::set_local(std::string_view str)
+{
+    // directory cannot be used as file
+    if(!str.empty() && str.back() == '/') {
+        std::cerr << "Invalid form of argument for option -l (HINT local file or -)!" << std::endl;
+        return false;
+    }
+
+    this->params.local = str;
+    return true;
+}
+
+bool Tftp_parameters::set_mode(std::string_view str)
 {
     if(str == "ascii" || str == "netascii") {
         this->params.mode = ASCII;
@@ -200,7 +587,7 @@ bool Tftp_parameters::set_mode(std::string str)
     return true;
 }
 
-bool Tftp_parameters::set_port(std::string str)
+bool Tftp_parameters::set_port(std::string_view str)
 {
     long ret;
 
@@ -212,7 +599,7 @@ bool Tftp_parameters::set_port(std::string str)
     return true;
 }
 
-bool Tftp_parameters::set_size(std::string str)
+bool Tftp_parameters::set_size(std::string_view str)
 {
     long ret;
 
@@ -220,7 +607,7 @@ bool Tftp_parameters::set_size(std::string str)
         return false;
     }
 
-    if(ret < 8 || ret > 65464) {
+    if(ret < MIN_BLKSIZE || ret > MAX_BLKSIZE) {
         std::cerr << "Only values from range 8-65464 are valid for blksize option!" << std::endl;
         return false;
     }
@@ -229,7 +616,7 @@ bool Tftp_parameters::set_size(std::string str)
     return true;
 }
 
-bool Tftp_parameters::set_timeout(std::string str)
+bool Tftp_parameters::set_timeout(std::string_view str)
 {
     int ret;
 
@@ -237,7 +624,7 @@ bool Tftp_parameters::set_timeout(std::string str)
         return false;
     }
 
-    if(ret == 0 || ret > 255) {
+    if(ret < MIN_TIMEOUT || ret > MAX_TIMEOUT) {
         std::cerr << "Only values from range 1-255 are valid for timeout option!" << std::endl;
         return false;
     }
@@ -248,7 +635,7 @@ bool Tftp_parameters::set_timeout(std::string str)
 
 bool Tftp_parameters::check_req_type(request_type_t option)
 {
-    std::vector<std::string> types{ "-R", "-W" };
+    static const char *types[] = { "-R", "-W" };
 
     if(this->params.req_type != UNKNOWN && this->params.req_type != option) {
         std::cerr <<  "Type of request already specified! Cannot combine \"" 
@@ -259,12 +646,12 @@ bool Tftp_parameters::check_req_type(request_type_t option)
     return true;
 }
 
-bool Tftp_parameters::parse_addr_with_sep(size_t curr, std::vector<std::string> options)
+bool Tftp_parameters::parse_addr_with_sep(size_t curr, const std::vector<std::string_view> &options)
 {
-    std::string str = options[curr];
+    std::string_view str = options[curr];
 
-    if(str[str.size() - 1] == this->separator) {
-        str.erase(str.end() - 1);
+    if(!str.empty() && str.back() == this->separator) {
+        str.remove_suffix(1);
 
         return set_address(str) && (curr + 1) < options.size();
     }
@@ -272,17 +659,17 @@ bool Tftp_parameters::parse_addr_with_sep(size_t curr, std::vector<std::string>
     return false;
 }
 
-bool Tftp_parameters::parse_port_with_sep(size_t curr, std::vector<std::string> options)
+bool Tftp_parameters::parse_port_with_sep(size_t curr, const std::vector<std::string_view> &options)
 {
-    std::string str;
+    std::string_view str;
 
     if(curr + 1 >= options.size()) {
         return false;
     }
 
     str = options[curr + 1];
-    if(str[0] == this->separator) {
-        str.erase(str.begin());
+    if(!str.empty() && str.front() == this->separator) {
+        str.remove_prefix(1);
 
         return set_address(options[curr]) && set_port(str);
     }
@@ -290,9 +677,9 @@ bool Tftp_parameters::parse_port_with_sep(size_t curr, std::vector<std::string>
     return false;
 }
 
-bool Tftp_parameters::parse_addr_with_spaces(size_t &curr, std::vector<std::string> options)
+bool Tftp_parameters::parse_addr_with_spaces(size_t &curr, const std::vector<std::string_view> &options)
 {
-    std::string sep;
+    std::string_view sep;
 
     //need addrses, separator and port number
     if(curr + 2 >= options.size()) {
@@ -302,7 +689,7 @@ bool Tftp_parameters::parse_addr_with_spaces(size_t &curr, std::vector<std::stri
     sep = options[curr + 1];
 
     //check separator
-    if(sep[sep.size() - 1] != this->separator) {
+    if(sep.empty() || sep.back() != this->separator) {
         std::cerr << "Invalid separator!" << std::endl;
         return false;
     }
@@ -310,18 +697,20 @@ bool Tftp_parameters::parse_addr_with_spaces(size_t &curr, std::vector<std::stri
     return set_address(options[curr]);
 }
 
-bool Tftp_parameters::parse_addr_with_port(std::string str)
+bool Tftp_parameters::parse_addr_with_port(std::string_view str)
 {
-    std::vector<std::string> vec;
+    size_t pos = str.find(this->separator);
 
-    if(!split_string(str, ",", vec) || vec.size() != 2) {
+    // exactly one separator with nonempty address and port around
+    if(pos == std::string_view::npos || pos == 0 || pos + 1 == str.size() ||
+        str.find(this->separator, pos + 1) != std::string_view::npos) {
         return false;
     }
 
-    return set_address(vec[0]) && set_port(vec[1]);
+    return set_address(str.substr(0, pos)) && set_port(str.substr(pos + 1));
 }
 
-bool Tftp_parameters::set_address_port(size_t &curr, std::vector<std::string> options)
+bool Tftp_parameters::set_address_port(size_t &curr, const std::vector<std::string_view> &options)
 {
     //<ADDRESS>,<PORT>
     if(parse_addr_with_port(options[curr])) {
@@ -343,7 +732,7 @@ bool Tftp_parameters::set_address_port(size_t &curr, std::vector<std::string> op
     return set_port(options[curr]);
 }
 
-bool Tftp_parameters::require_arg(size_t &curr, std::vector<std::string> options)
+bool Tftp_parameters::require_arg(size_t &curr, const std::vector<std::string_view> &options)
 {
     if(this->param_with_arg == NOT_DEFINED) {
         return false;
@@ -365,7 +754,37 @@ bool Tftp_parameters::require_arg(size_t &curr, std::vector<std::string> options
     case MODE:
         return set_mode(options[curr]);
     case ADDRESS_PORT:
-        return set_address_port(curr, options);
+        // every occurrence of option adds another mirror
+        if(!set_address_port(curr, options)) {
+            return false;
+        }
+
+        this->params.mirrors.push_back({this->params.address, this->params.addr_family, this->params.port});
+        return true;
+    case LOCAL:
+        return set_local(options[curr]);
+    case UNPACK:
+        return set_unpack(options[curr]);
+    case CHECKSUM:
+        return set_checksum(options[curr]);
+    case MANIFEST:
+        this->params.manifest = options[curr];
+        return true;
+    case PRIORITY:
+        return set_priority(options[curr]);
+    case RATE:
+        if(!parse_size(options[curr], this->params.rate) || this->params.rate == 0) {
+            std::cerr << "Rate has to be positive number of bytes per second (with optional suffix K, M or G)!" << std::endl;
+            return false;
+        }
+
+        return true;
+    case DEVICE:
+        this->params.device = options[curr];
+        return check_device(options[curr]);
+    case SOURCE:
+        this->params.source = options[curr];
+        return check_source(options[curr]);
     default:
         return false;
     }
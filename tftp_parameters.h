@@ -8,6 +8,7 @@
 #define __TFTP_PARAMETERS_H_
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <stdint.h>
 
@@ -29,6 +30,14 @@ class Tftp_parameters
             SIZE,
             MODE,
             ADDRESS_PORT,
+            LOCAL,
+            UNPACK,
+            CHECKSUM,
+            MANIFEST,
+            PRIORITY,
+            RATE,
+            DEVICE,
+            SOURCE,
         } req_arg_t;
 
     public:
@@ -52,9 +61,44 @@ class Tftp_parameters
         /**
          * @brief Structure with parameters for TFTP client's request.
          */
+        typedef enum {
+            UNPACK_NONE,
+            UNPACK_GZIP,
+            UNPACK_ZSTD,
+            UNPACK_TAR,
+            UNPACK_TAR_GZIP,
+            UNPACK_TAR_ZSTD,
+        } unpack_t;
+
+        typedef enum {
+            CHECKSUM_NONE,
+            CHECKSUM_CRC32C,
+            CHECKSUM_XXH3,
+            CHECKSUM_SHA256,
+        } checksum_t;
+
+        /**
+         * @brief Priority classes of queued transfers.
+         */
+        typedef enum {
+            PRIORITY_HIGH, // urgent transfers, may take slots of running PRIORITY_LOW ones
+            PRIORITY_NORMAL,
+            PRIORITY_LOW, // bulk transfers
+        } priority_t;
+
+        /**
+         * @brief Server serving transferred file (one of mirrors).
+         */
+        typedef struct {
+            std::string address;
+            int addr_family; // AF_UNSPEC for host name
+            uint16_t port;
+        } mirror_t;
+
         typedef struct {
             request_type_t req_type; // determines type of request to server (READ or WRITE)
             std::string filename; // abs_path/file to send/recieved (abs_path on server)
+            std::string local; // local file, empty means name of remote file, "-" means stdout/stdin
             int timeout; // timeout for tftp communication
             uint64_t size; // size of data block for tftp communication
             bool multicast;
@@ -62,9 +106,23 @@ class Tftp_parameters
             int addr_family;
             std::string address;
             uint16_t port;
+            std::vector<mirror_t> mirrors; // all servers given by option -a, the first one is also in address and port
+            unpack_t unpack; // how downloaded data are decompressed/unpacked
+            checksum_t checksum; // algorithm of checksum computed from transferred data
+            std::string digest; // expected checksum (lowercase hex), empty means that it is only reported
+            std::string manifest; // file with expected checksums
+            bool sync; // transfer is skipped if file hasn't changed
+            priority_t priority; // class in which transfer waits for start
+            uint64_t rate; // maximal rate of transfer in bytes per second, 0 means unlimited
+            std::string device; // interface socket is bound to, empty means any
+            std::string source; // local address socket is bound to, empty means any
+            uint64_t expected; // expected size of downloaded file (e.g. from manifest), 0 if it is unknown
         } params_t;
 
     private:
+        static std::string default_device; // used by transfers without option -i
+        static std::string default_source; // used by transfers without option -B
+
         params_t params;
         req_arg_t param_with_arg;
         char separator;
@@ -79,42 +137,117 @@ class Tftp_parameters
         /**
          * @brief Getter for address attribute.
          */
-        std::string get_address() { return this->params.address; };
+        const std::string &get_address() const { return this->params.address; };
 
         /**
          * @brief Getter for addr_family attribute.
          */
-        int get_addr_family() { return this->params.addr_family; };
+        int get_addr_family() const { return this->params.addr_family; };
+
+        /**
+         * @brief Getter for mirrors attribute (empty if option -a hasn't been used).
+         */
+        const std::vector<mirror_t> &get_mirrors() const { return this->params.mirrors; };
 
         /**
          * @brief Getter for filename attribute.
          */
-        std::string get_filename() { return this->params.filename; };
+        const std::string &get_filename() const { return this->params.filename; };
+
+        /**
+         * @brief Getter for local attribute.
+         */
+        const std::string &get_local() const { return this->params.local; };
+
+        /**
+         * @brief Checks if data are streamed through standard output (READ)
+         * or standard input (WRITE) instead of local file.
+         */
+        bool is_stdio() const { return this->params.local == "-"; };
+
+        /**
+         * @brief Getter for unpack attribute.
+         */
+        unpack_t get_unpack() const { return this->params.unpack; };
+
+        /**
+         * @brief Getter for checksum attribute.
+         */
+        checksum_t get_checksum() const { return this->params.checksum; };
+
+        /**
+         * @brief Getter for sync attribute.
+         */
+        bool is_sync() const { return this->params.sync; };
+
+        /**
+         * @brief Getter for priority attribute.
+         */
+        priority_t get_priority() const { return this->params.priority; };
+
+        /**
+         * @brief Getter for rate attribute.
+         */
+        uint64_t get_rate() const { return this->params.rate; };
+
+        /**
+         * @brief Getter for device attribute.
+         */
+        const std::string &get_device() const { return this->params.device; };
+
+        /**
+         * @brief Getter for source attribute.
+         */
+        const std::string &get_source() const { return this->params.source; };
+
+        /**
+         * @brief Getter for expected attribute.
+         */
+        uint64_t get_expected() const { return this->params.expected; };
+
+        /**
+         * @brief Getter for digest attribute.
+         */
+        const std::string &get_digest() const { return this->params.digest; };
 
         /**
          * @brief Getter for port attribute.
          */
-        uint16_t get_port() { return this->params.port; };
+        uint16_t get_port() const { return this->params.port; };
 
         /**
          * @brief Getter for mode attribute.
          */
-        transfer_mode_t get_mode() { return this->params.mode; };
+        transfer_mode_t get_mode() const { return this->params.mode; };
 
         /**
          * @brief Getter for req_type attribute.
          */
-        request_type_t get_req_type() { return this->params.req_type; };
+        request_type_t get_req_type() const { return this->params.req_type; };
 
         /**
          * @brief Getter for size attribute.
          */
-        uint64_t get_size() {return this->params.size; };
+        uint64_t get_size() const {return this->params.size; };
 
         /**
          * @brief Getter for timeout attribute.
          */
-        int get_timeout() { return this->params.timeout; };
+        int get_timeout() const { return this->params.timeout; };
+
+        /**
+         * @brief Getter for all parameters at once.
+         */
+        const params_t &get_values() const { return this->params; };
+
+        /**
+         * @brief Sets all parameters at once (without command line parsing) and
+         * validates them the same way as parser does. Address family is derived
+         * from address.
+         * @param values Structure with parameters.
+         * @returns true if parameters are valid, false otherwise.
+         */
+        bool set_values(const params_t &values);
 
         /**
          * @brief Sets default values to all parameters.
@@ -128,7 +261,7 @@ class Tftp_parameters
          * @param options Vector with options to parse.
          * @returns true if parsing succeeds, false otherwise.
          */
-        bool parse(size_t &curr, std::vector<std::string> options);
+        bool parse(size_t &curr, const std::vector<std::string_view> &options);
 
         /**
          * @brief Checks if parameters are set properly - all required options
@@ -149,60 +282,159 @@ class Tftp_parameters
          * @param option String to add into error message (optional).
          * @returns Converted number if successful, -1 on error.
          */
-        static int convert_to_number(std::string str, std::string option);
+        static int convert_to_number(std::string_view str, const char *option);
 
         /**
-         * @brief Static method. Splits given string with specified pattern and stores parts into given
-         * vector.
+         * @brief Static method. Splits given string with specified separator and stores parts into given
+         * vector (parts refer to given string, nothing is copied).
          * @param str String to split.
-         * @param pattern Pattern to split string with.
+         * @param sep Separator to split string with.
          * @param vec Vectore where result will be stored.
          * @returns true if splitting succeeds, false otherwise.
          */
-        static bool split_string(std::string str, std::string pattern, std::vector<std::string> &vec);
+        static bool split_string(std::string_view str, char sep, std::vector<std::string_view> &vec);
+
+        /**
+         * @brief Static method. Parses size with optional suffix K, M or G (powers of 1024).
+         * @param str String to parse.
+         * @param res Parsed size.
+         * @returns true in case of success, false otherwise.
+         */
+        static bool parse_size(std::string_view str, uint64_t &res);
+
+        /**
+         * @brief Static method. Parses whole string as unsigned decimal number.
+         * @param str String to parse.
+         * @param res Parsed number.
+         * @returns true in case of success, false otherwise.
+         */
+        static bool parse_number(std::string_view str, uint64_t &res);
+
+        /**
+         * @brief Static method. Converts string to lower case (keywords, names of options).
+         * @param str String to convert.
+         * @returns Converted string.
+         */
+        static std::string lower(std::string_view str);
+
+        /**
+         * @brief Static method. Appends relative path to path of directory.
+         * @param dir Path of directory.
+         * @param name Relative path to append.
+         * @returns Joined path.
+         */
+        static std::string join_path(const std::string &dir, std::string_view name);
+
+        /**
+         * @brief Static method. Creates all missing directories of path of file.
+         * @param file Path of file (path ending by '/' creates also the last directory).
+         * @param from Length of prefix of path which already exists (e.g. root directory).
+         * @returns true in case of success, false otherwise.
+         */
+        static bool make_dirs(const std::string &file, size_t from = 0);
+
+        /**
+         * @brief Static method. Sets interface and local address used by transfers
+         * which don't specify their own (options -i and -B).
+         * @param device Name of interface, empty means any.
+         * @param source Local ipv4 or ipv6 address, empty means any.
+         * @returns true in case of success, false otherwise.
+         */
+        static bool set_default_binding(const std::string &device, const std::string &source);
 
     private:
         /**
-         * @brief Validates correctness of given address and stores it into
-         * appropriate attribute.
+         * @brief Validates correctness of given address (ipv4, ipv6 or host name)
+         * and stores it into appropriate attribute.
          * @returns true on success, false otherwise.
          */
-        bool set_address(std::string str);
+        bool set_address(std::string_view str);
+
+        /**
+         * @brief Static method. Checks if given string is valid host name.
+         */
+        static bool is_hostname(std::string_view str);
 
         /**
          * @brief Validates correctness of given filename and stores it into
          * appropriate attribute.
          * @returns true on success, false otherwise.
          */
-        bool set_filename(std::string str);
+        bool set_filename(std::string_view str);
 
         /**
          * @brief Validates correctness of given port and stores it into
          * appropriate attribute.
          * @returns true on success, false otherwise.
          */
-        bool set_port(std::string str);
+        bool set_port(std::string_view str);
+
+        /**
+         * @brief Validates correctness of given format of downloaded data and stores
+         * it into appropriate attribute.
+         * @returns true on success, false otherwise.
+         */
+        bool set_unpack(std::string_view str);
+
+        /**
+         * @brief Validates correctness of given checksum algorithm (optionally followed
+         * by ':' and expected digest) and stores it into appropriate attributes.
+         * @returns true on success, false otherwise.
+         */
+        bool set_checksum(std::string_view str);
+
+        /**
+         * @brief Validates correctness of given priority class and stores it into
+         * appropriate attribute.
+         * @returns true on success, false otherwise.
+         */
+        bool set_priority(std::string_view str);
+
+        /**
+         * @brief Static method. Validates name of interface.
+         * @returns true if name is valid, false otherwise.
+         */
+        static bool check_device(std::string_view str);
+
+        /**
+         * @brief Static method. Validates local address (ipv4 or ipv6).
+         * @returns true if address is valid, false otherwise.
+         */
+        static bool check_source(std::string_view str);
+
+        /**
+         * @brief Validates expected digest and finds it in manifest if it is necessary.
+         * @returns true on success, false otherwise.
+         */
+        bool check_digest();
+
+        /**
+         * @brief Validates correctness of given local file and stores it into
+         * appropriate attribute.
+         * @returns true on success, false otherwise.
+         */
+        bool set_local(std::string_view str);
 
         /**
          * @brief Validates correctness of given given transfer mode and stores it into
          * appropriate attribute.
          * @returns true on success, false otherwise.
          */
-        bool set_mode(std::string str);
+        bool set_mode(std::string_view str);
 
         /**
          * @brief Validates correctness of given block size and stores it into
          * appropriate attribute.
          * @returns true on success, false otherwise.
          */
-        bool set_size(std::string str);
+        bool set_size(std::string_view str);
 
         /**
          * @brief Validates correctness of given timeout and stores it into
          * appropriate attribute.
          * @returns true on success, false otherwise.
          */
-        bool set_timeout(std::string str);
+        bool set_timeout(std::string_view str);
 
         /**
          * @brief Validates correctness of given address+port number and stores it into
@@ -211,7 +443,7 @@ class Tftp_parameters
          * @param options Vector with options to parse.
          * @returns true on success, false otherwise.
          */
-        bool set_address_port(size_t &curr, std::vector<std::string> options);
+        bool set_address_port(size_t &curr, const std::vector<std::string_view> &options);
 
 
         /**
@@ -226,7 +458,7 @@ class Tftp_parameters
          * @param options Vector with options to parse.
          * @returns true on success, false otherwise.
          */
-        bool require_arg(size_t &curr, std::vector<std::string> options);
+        bool require_arg(size_t &curr, const std::vector<std::string_view> &options);
 
 
         /**
@@ -234,28 +466,28 @@ class Tftp_parameters
          * when arguments are in format - ADDRESS,PORT
          * @returns true on success, false otherwise.
          */
-        bool parse_addr_with_port(std::string str);
+        bool parse_addr_with_port(std::string_view str);
 
         /**
          * @brief Handles parsing of -a option for case
          * when arguments are in format - ADDRESS, PORT
          * @returns true on success, false otherwise.
          */
-        bool parse_addr_with_sep(size_t curr, std::vector<std::string> options);
+        bool parse_addr_with_sep(size_t curr, const std::vector<std::string_view> &options);
 
         /**
          * @brief Handles parsing of -a option for case
          * when arguments are in format - ADDRESS ,PORT
          * @returns true on success, false otherwise.
          */
-        bool parse_port_with_sep(size_t curr, std::vector<std::string> options);
+        bool parse_port_with_sep(size_t curr, const std::vector<std::string_view> &options);
 
         /**
          * @brief Handles parsing of -a option for case
          * when arguments are in format - ADDRESS , PORT
          * @returns true on success, false otherwise.
          */
-        bool parse_addr_with_spaces(size_t &curr, std::vector<std::string> options);
+        bool parse_addr_with_spaces(size_t &curr, const std::vector<std::string_view> &options);
 };
 
 #endif
\ No newline at end of file
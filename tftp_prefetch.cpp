@@ -0,0 +1,194 @@
+/*
+ * @author Jakub Šuráň (xsuran07)
+ * @file tftp_prefetch.cpp
+ * @brief Implementation of prefetch of boot file sets.
+ */
+
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+
+#include "tftp_prefetch.h"
+
+// HELPERS
+
+// splits line into words separated by white space
+static void split_words(std::string_view line, std::vector<std::string_view> &words)
+{
+    size_t start = 0;
+
+    words.clear();
+
+    while((start = line.find_first_not_of(" \t\r", start)) != std::string_view::npos) {
+        size_t end = line.find_first_of(" \t\r", start);
+
+        words.push_back(line.substr(start, end - start));
+        start = end;
+    }
+}
+
+// PUBLIC INSTANCE METHODS
+
+bool Tftp_prefetch::load_manifest(const std::string &file)
+{
+    if(file == "-") {
+        return read_manifest(std::cin);
+    }
+
+    std::ifstream in(file);
+
+    if(!in.is_open()) {
+        std::cerr << "Cannot open manifest " << file << "!" << std::endl;
+        return false;
+    }
+
+    return read_manifest(in);
+}
+
+bool Tftp_prefetch::load_config(const std::string &file)
+{
+    std::ifstream in(file);
+    std::vector<std::string_view> words;
+    std::vector<std::string_view> files;
+    std::vector<std::string_view> list;
+    std::string line;
+
+    if(!in.is_open()) {
+        std::cerr << "Cannot open boot configuration " << file << "!" << std::endl;
+        return false;
+    }
+
+    while(std::getline(in, line)) {
+        split_words(line, words);
+
+        if(words.empty() || words.front().front() == '#') {
+            continue;
+        }
+
+        std::string keyword = Tftp_parameters::lower(words.front());
+
+        files.clear();
+
+        // kernel (or device tree) is followed by its arguments
+        if((keyword == "kernel" || keyword == "linux" || keyword == "linuxefi" || keyword == "linux16" ||
+            keyword == "fdt" || keyword == "devicetree") && words.size() > 1) {
+            files.push_back(words[1]);
+        } else if(keyword == "initrd" || keyword == "initrdefi" || keyword == "initrd16") {
+            // grub lists initrds as words, pxelinux separates them by commas
+            for(size_t i = 1; i < words.size(); i++) {
+                Tftp_parameters::split_string(words[i], ',', list);
+                files.insert(files.end(), list.begin(), list.end());
+            }
+        } else if(keyword == "append") {
+            for(size_t i = 1; i < words.size(); i++) {
+                if(words[i].substr(0, 7) == "initrd=") {
+                    Tftp_parameters::split_string(words[i].substr(7), ',', list);
+                    files.insert(files.end(), list.begin(), list.end());
+                }
+            }
+        }
+
+        for(auto path : files) {
+            // grub device prefix (e.g. "(tftp)"), pxelinux prefix of absolute path
+            if(path.substr(0, 1) == "(" && path.find(')') != std::string_view::npos) {
+                path.remove_prefix(path.find(')') + 1);
+            } else if(path.substr(0, 2) == "::") {
+                path.remove_prefix(2);
+            }
+
+            // value of variable isn't known, URL points to other server
+            if(path.empty() || path.find('$') != std::string_view::npos || path.find("://") != std::string_view::npos) {
+                continue;
+            }
+
+            if(!add(path, 0)) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+bool Tftp_prefetch::make_jobs(const Tftp_parameters &tmpl, std::vector<Tftp_parameters> &jobs)
+{
+    std::string root((tmpl.get_local().empty())? "." : tmpl.get_local());
+
+    for(auto &entry : this->entries) {
+        Tftp_parameters::params_t values = tmpl.get_values();
+        Tftp_parameters params;
+
+        values.filename = Tftp_parameters::join_path(tmpl.get_filename(), entry.path);
+        values.local = Tftp_parameters::join_path(root, entry.path);
+        values.expected = entry.size;
+
+        if(!Tftp_parameters::make_dirs(values.local) || !params.set_values(values)) {
+            return false;
+        }
+
+        jobs.push_back(params);
+    }
+
+    return true;
+}
+
+// PRIVATE INSTANCE METHODS
+
+bool Tftp_prefetch::read_manifest(std::istream &in)
+{
+    std::vector<std::string_view> words;
+    std::string line;
+    size_t line_num = 0;
+
+    while(std::getline(in, line)) {
+        uint64_t size = 0;
+
+        line_num++;
+        split_words(line, words);
+
+        // skip empty lines and comments
+        if(words.empty() || words.front().front() == '#') {
+            continue;
+        }
+
+        if(words.size() > 2 || (words.size() == 2 && !Tftp_parameters::parse_size(words[1], size)) ||
+            !add(words[0], size)) {
+            std::cerr << "Invalid entry on line " << line_num << " of manifest!" << std::endl;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool Tftp_prefetch::add(std::string_view path, uint64_t size)
+{
+    std::vector<std::string_view> parts;
+
+    // paths are relative to prefix of template
+    while(!path.empty() && path.front() == '/') {
+        path.remove_prefix(1);
+    }
+
+    Tftp_parameters::split_string(path, '/', parts);
+
+    // file would be stored outside of local tree
+    if(path.empty() || path.back() == '/' || std::any_of(parts.begin(), parts.end(), [](auto part) { return part == ".."; })) {
+        std::cerr << "Invalid path " << path << " of prefetched file!" << std::endl;
+        return false;
+    }
+
+    auto it = this->index.find(std::string(path));
+
+    if(it != this->index.end()) {
+        if(size > 0) {
+            this->entries[it->second].size = size;
+        }
+
+        return true;
+    }
+
+    this->index[std::string(path)] = this->entries.size();
+    this->entries.push_back({std::string(path), size});
+    return true;
+}
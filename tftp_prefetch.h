@@ -0,0 +1,94 @@
+/*
+ * @author Jakub Šuráň (xsuran07)
+ * @file tftp_prefetch.h
+ * @brief Interface of prefetch of boot file sets.
+ */
+
+#ifndef __TFTP_PREFETCH_H_
+#define __TFTP_PREFETCH_H_
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <istream>
+#include <stdint.h>
+
+#include "tftp_parameters.h"
+
+/**
+ * @brief Set of files to download ahead of boot. Files are listed by manifest
+ * (one "path [size]" per line) or collected from pxelinux or grub configuration
+ * (kernels, initrds and device trees it refers to). Every file is downloaded by
+ * its own job made from template request - remote path is appended to path of
+ * template and the same relative path is created under its local directory.
+ */
+class Tftp_prefetch
+{
+    private:
+        /**
+         * @brief File of set.
+         */
+        typedef struct {
+            std::string path; // remote path relative to prefix given by template
+            uint64_t size; // expected size, 0 if it is unknown
+        } entry_t;
+
+        std::vector<entry_t> entries; // in order they have been listed
+        std::unordered_map<std::string, size_t> index; // path => position in entries
+
+    public:
+        /**
+         * @brief Constructor.
+         */
+        Tftp_prefetch() = default;
+
+        /**
+         * @brief Loads manifest - every line contains path of file optionally followed
+         * by its size (N[K|M|G]), empty lines and lines starting with '#' are skipped.
+         * @param file Path of manifest ('-' means standard input).
+         * @returns true in case of success, false otherwise.
+         */
+        bool load_manifest(const std::string &file);
+
+        /**
+         * @brief Collects files referred to by pxelinux or grub configuration
+         * (KERNEL/LINUX, INITRD, APPEND initrd=, FDT; linux, initrd, devicetree).
+         * Paths containing variables cannot be resolved and are skipped.
+         * @param file Path of configuration file.
+         * @returns true in case of success, false otherwise.
+         */
+        bool load_config(const std::string &file);
+
+        /**
+         * @brief Makes download job for every file and creates local directories of them.
+         * @param tmpl Template request (download) - its path is prefix of remote paths,
+         * its local path (if any) is root of local tree.
+         * @param jobs Vector to store jobs into.
+         * @returns true in case of success, false otherwise.
+         */
+        bool make_jobs(const Tftp_parameters &tmpl, std::vector<Tftp_parameters> &jobs);
+
+        /**
+         * @brief Getter for number of files in set.
+         */
+        size_t size() const { return this->entries.size(); };
+
+    private:
+        /**
+         * @brief Reads manifest from given stream.
+         * @param in Stream to read manifest from.
+         * @returns true if all lines are valid, false otherwise.
+         */
+        bool read_manifest(std::istream &in);
+
+        /**
+         * @brief Adds file into set, size of file already present is updated if it is known.
+         * @param path Path of file (as listed).
+         * @param size Expected size of file (0 if it is unknown).
+         * @returns true in case of success, false if path is invalid.
+         */
+        bool add(std::string_view path, uint64_t size);
+};
+
+#endif
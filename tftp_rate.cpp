@@ -0,0 +1,68 @@
+/*
+ * @author Jakub Šuráň (xsuran07)
+ * @file tftp_rate.cpp
+ * @brief Implementation of rate limiter of transfers.
+ */
+
+#include <chrono>
+#include <algorithm>
+
+#include "tftp_rate.h"
+
+#define NS_PER_SEC 1000000000LL
+
+// PUBLIC INSTANCE METHODS
+
+// constructor
+Tftp_rate::Tftp_rate(uint64_t rate)
+{
+    this->rate = rate;
+    this->next = 0;
+}
+
+Tftp_rate &Tftp_rate::global()
+{
+    static Tftp_rate rate;
+
+    return rate;
+}
+
+void Tftp_rate::set_rate(uint64_t rate)
+{
+    std::lock_guard<std::mutex> guard(this->lock);
+
+    this->rate = rate;
+    this->next = 0;
+}
+
+bool Tftp_rate::is_limited()
+{
+    std::lock_guard<std::mutex> guard(this->lock);
+
+    return this->rate > 0;
+}
+
+int64_t Tftp_rate::reserve(uint64_t bytes, int64_t now)
+{
+    std::lock_guard<std::mutex> guard(this->lock);
+    int64_t start;
+
+    if(this->rate == 0) {
+        return 0;
+    }
+
+    // idle time doesn't accumulate => packets never go in burst
+    start = std::max(this->next, now);
+    this->next = start + (int64_t) (bytes * NS_PER_SEC / this->rate);
+
+    return start - now;
+}
+
+// STATIC METHODS
+
+int64_t Tftp_rate::now_ns()
+{
+    auto t = std::chrono::steady_clock::now().time_since_epoch();
+
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(t).count();
+}
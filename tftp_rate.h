@@ -0,0 +1,67 @@
+/*
+ * @author Jakub Šuráň (xsuran07)
+ * @file tftp_rate.h
+ * @brief Interface of rate limiter of transfers.
+ */
+
+#ifndef __TFTP_RATE_H_
+#define __TFTP_RATE_H_
+
+#include <mutex>
+#include <stdint.h>
+
+/**
+ * @brief Rate limiter (token bucket without burst). Every packet reserves
+ * its time slot - the earliest time when it fits into rate after all packets
+ * reserved before it. Time is counted in ns, so rate stays accurate even if
+ * packets are sent more often than every ms and timers of caller are less precise
+ * (delay of one packet is caught up by next ones).
+ */
+class Tftp_rate
+{
+    private:
+        uint64_t rate; // bytes per second, 0 means unlimited
+        int64_t next; // time (in ns) from which next packet fits into rate
+        std::mutex lock;
+
+    public:
+        /**
+         * @brief Constructor.
+         * @param rate Maximal rate in bytes per second, 0 means unlimited.
+         */
+        Tftp_rate(uint64_t rate = 0);
+
+        Tftp_rate(const Tftp_rate &) = delete;
+        Tftp_rate &operator=(const Tftp_rate &) = delete;
+
+        /**
+         * @brief Static method. Returns limiter shared by all transfers.
+         */
+        static Tftp_rate &global();
+
+        /**
+         * @brief Sets maximal rate and forgets reserved slots.
+         * @param rate Maximal rate in bytes per second, 0 means unlimited.
+         */
+        void set_rate(uint64_t rate);
+
+        /**
+         * @brief Checks if rate is limited at all.
+         */
+        bool is_limited();
+
+        /**
+         * @brief Reserves time slot for packet.
+         * @param bytes Size of packet (data carried by it).
+         * @param now Current time in ns (see now_ns).
+         * @returns time in ns for which packet has to wait, 0 if it may be sent immediately.
+         */
+        int64_t reserve(uint64_t bytes, int64_t now);
+
+        /**
+         * @brief Static method. Returns current time of monotonic clock in ns.
+         */
+        static int64_t now_ns();
+};
+
+#endif
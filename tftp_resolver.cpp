@@ -0,0 +1,239 @@
+/*
+ * @author Jakub Šuráň (xsuran07)
+ * @file tftp_resolver.cpp
+ * @brief Implementation of resolution of host names with cache.
+ */
+
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <string.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <netinet/in.h>
+
+#include "tftp_resolver.h"
+
+// HELPERS
+
+// compares addresses without ports
+static bool same_address(const struct sockaddr_storage &a, const struct sockaddr_storage &b)
+{
+    if(a.ss_family != b.ss_family) {
+        return false;
+    }
+
+    if(a.ss_family == AF_INET) {
+        return ((struct sockaddr_in *) &a)->sin_addr.s_addr == ((struct sockaddr_in *) &b)->sin_addr.s_addr;
+    }
+
+    return memcmp(((struct sockaddr_in6 *) &a)->sin6_addr.s6_addr, ((struct sockaddr_in6 *) &b)->sin6_addr.s6_addr, 16) == 0;
+}
+
+// orders addresses so that families alternate (RFC 8305), family of the first address goes first
+static std::vector<struct sockaddr_storage> interleave(const std::vector<struct sockaddr_storage> &addrs)
+{
+    std::vector<struct sockaddr_storage> first;
+    std::vector<struct sockaddr_storage> second;
+    std::vector<struct sockaddr_storage> res;
+
+    for(auto &addr : addrs) {
+        ((first.empty() || first.front().ss_family == addr.ss_family)? first : second).push_back(addr);
+    }
+
+    for(size_t i = 0; i < std::max(first.size(), second.size()); i++) {
+        if(i < first.size()) {
+            res.push_back(first[i]);
+        }
+
+        if(i < second.size()) {
+            res.push_back(second[i]);
+        }
+    }
+
+    return res;
+}
+
+// PUBLIC INSTANCE METHODS
+
+Tftp_resolver &Tftp_resolver::instance()
+{
+    // never destroyed - background resolution may outlive main
+    static Tftp_resolver *resolver = new Tftp_resolver();
+
+    return *resolver;
+}
+
+bool Tftp_resolver::resolve(const std::string &host, uint16_t port, std::vector<struct sockaddr_storage> &addrs)
+{
+    int64_t now = now_ms();
+    bool cached = false;
+
+    addrs.clear();
+
+    {
+        std::lock_guard<std::mutex> guard(this->lock);
+        auto it = this->entries.find(host);
+
+        // failed resolution is cached too, name isn't asked for again till it expires
+        if(it != this->entries.end() && it->second.expires > now) {
+            addrs = it->second.addrs;
+            cached = true;
+        }
+    }
+
+    // name isn't cached => it is resolved without lock, so other transfers aren't blocked
+    if(!cached) {
+        lookup(host, addrs);
+
+        std::lock_guard<std::mutex> guard(this->lock);
+
+        evict(now);
+        this->entries[host] = {addrs, now + ((addrs.empty())? RESOLVE_FAILURE_TTL : RESOLVE_TTL)};
+    }
+
+    for(auto &addr : addrs) {
+        if(addr.ss_family == AF_INET) {
+            ((struct sockaddr_in *) &addr)->sin_port = htons(port);
+        } else {
+            ((struct sockaddr_in6 *) &addr)->sin6_port = htons(port);
+        }
+    }
+
+    return !addrs.empty();
+}
+
+bool Tftp_resolver::prepare(const std::string &host, int notify)
+{
+    std::lock_guard<std::mutex> guard(this->lock);
+    auto it = this->entries.find(host);
+
+    if(it != this->entries.end() && it->second.expires > now_ms()) {
+        return true;
+    }
+
+    auto &waiting = this->pending[host];
+
+    // one resolution serves all loops waiting for name
+    if(waiting.empty()) {
+        std::thread(&Tftp_resolver::resolve_async, this, host).detach();
+    }
+
+    if(std::find(waiting.begin(), waiting.end(), notify) == waiting.end()) {
+        waiting.push_back(notify);
+    }
+
+    return false;
+}
+
+void Tftp_resolver::forget(int notify)
+{
+    std::lock_guard<std::mutex> guard(this->lock);
+
+    for(auto &waiting : this->pending) {
+        waiting.second.erase(std::remove(waiting.second.begin(), waiting.second.end(), notify), waiting.second.end());
+    }
+}
+
+void Tftp_resolver::prefer(const std::string &host, const struct sockaddr_storage &addr)
+{
+    std::lock_guard<std::mutex> guard(this->lock);
+    auto it = this->entries.find(host);
+
+    if(it == this->entries.end()) {
+        return;
+    }
+
+    auto &addrs = it->second.addrs;
+    auto found = std::find_if(addrs.begin(), addrs.end(), [&addr](auto &a) { return same_address(a, addr); });
+
+    // the answering address goes first, the rest keeps alternating families
+    if(found != addrs.end()) {
+        std::rotate(addrs.begin(), found, found + 1);
+        addrs = interleave(addrs);
+    }
+}
+
+// PRIVATE INSTANCE METHODS
+
+void Tftp_resolver::resolve_async(const std::string &host)
+{
+    std::vector<struct sockaddr_storage> addrs;
+    uint64_t one = 1;
+
+    lookup(host, addrs);
+
+    std::lock_guard<std::mutex> guard(this->lock);
+    int64_t now = now_ms();
+
+    evict(now);
+    this->entries[host] = {addrs, now + ((addrs.empty())? RESOLVE_FAILURE_TTL : RESOLVE_TTL)};
+
+    for(int notify : this->pending[host]) {
+        if(write(notify, &one, sizeof(one)) == -1) {
+            std::cerr << "write() to eventfd failed!" << std::endl;
+        }
+    }
+
+    this->pending.erase(host);
+}
+
+void Tftp_resolver::evict(int64_t now)
+{
+    if(this->entries.size() < RESOLVE_CACHE_SIZE) {
+        return;
+    }
+
+    for(auto it = this->entries.begin(); it != this->entries.end();) {
+        it = (it->second.expires <= now)? this->entries.erase(it) : std::next(it);
+    }
+
+    if(this->entries.size() >= RESOLVE_CACHE_SIZE) {
+        this->entries.clear();
+    }
+}
+
+// STATIC METHODS
+
+void Tftp_resolver::lookup(const std::string &host, std::vector<struct sockaddr_storage> &addrs)
+{
+    struct addrinfo hints;
+    struct addrinfo *res;
+    int ret;
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_DGRAM;
+    hints.ai_flags = AI_ADDRCONFIG;
+
+    if((ret = getaddrinfo(host.c_str(), nullptr, &hints, &res)) != 0) {
+        std::cerr << "Cannot resolve " << host << " - " << gai_strerror(ret) << "!" << std::endl;
+        return;
+    }
+
+    // order of system address selection is kept within family
+    for(struct addrinfo *ai = res; ai != nullptr; ai = ai->ai_next) {
+        struct sockaddr_storage addr;
+
+        if((ai->ai_family != AF_INET && ai->ai_family != AF_INET6) || ai->ai_addrlen > sizeof(addr)) {
+            continue;
+        }
+
+        memset(&addr, 0, sizeof(addr));
+        memcpy(&addr, ai->ai_addr, ai->ai_addrlen);
+
+        if(std::none_of(addrs.begin(), addrs.end(), [&addr](auto &a) { return same_address(a, addr); })) {
+            addrs.push_back(addr);
+        }
+    }
+
+    freeaddrinfo(res);
+    addrs = interleave(addrs);
+}
+
+int64_t Tftp_resolver::now_ms()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
@@ -0,0 +1,118 @@
+/*
+ * @author Jakub Šuráň (xsuran07)
+ * @file tftp_resolver.h
+ * @brief Interface of resolution of host names with cache.
+ */
+
+#ifndef __TFTP_RESOLVER_H_
+#define __TFTP_RESOLVER_H_
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <stdint.h>
+#include <sys/socket.h>
+
+#define RESOLVE_TTL 60000 // ms for which resolved addresses are reused
+#define RESOLVE_FAILURE_TTL 5000 // ms for which failed resolution is reused
+#define RESOLVE_CACHE_SIZE 256 // maximal number of cached names
+
+/**
+ * @brief Resolution of host names shared by all transfers. Addresses of name
+ * are kept for bounded time (resolver library doesn't tell real TTL), so batch
+ * of transfers from the same server asks DNS only once. Failed resolution is
+ * kept too, so jobs for unknown host don't ask DNS again and again. Addresses
+ * are ordered for happy eyeballs - families alternate and family which has
+ * answered the last time goes first. Event loops don't block in resolver
+ * library - they let names be resolved on background thread (method prepare)
+ * and start transfers once names are cached.
+ */
+class Tftp_resolver
+{
+    private:
+        /**
+         * @brief Cached resolution of one name.
+         */
+        typedef struct {
+            std::vector<struct sockaddr_storage> addrs; // empty if resolution has failed
+            int64_t expires; // ms (steady clock)
+        } entry_t;
+
+        std::unordered_map<std::string, entry_t> entries; // host name => addresses
+        std::unordered_map<std::string, std::vector<int>> pending; // host name being resolved => eventfds to notify
+        std::mutex lock;
+
+    public:
+        /**
+         * @brief Constructor.
+         */
+        Tftp_resolver() = default;
+
+        Tftp_resolver(const Tftp_resolver &) = delete;
+        Tftp_resolver &operator=(const Tftp_resolver &) = delete;
+
+        /**
+         * @brief Static method. Returns resolver shared by all transfers.
+         */
+        static Tftp_resolver &instance();
+
+        /**
+         * @brief Resolves host name (or takes its addresses from cache).
+         * @param host Host name to resolve.
+         * @param port Port to store into addresses.
+         * @param addrs Variable to store addresses into (in order they should be tried).
+         * @returns true in case of success, false otherwise.
+         */
+        bool resolve(const std::string &host, uint16_t port, std::vector<struct sockaddr_storage> &addrs);
+
+        /**
+         * @brief Checks whether host name is cached (resolved or failed), so method resolve
+         * doesn't block. Otherwise name is resolved on background thread, which writes to
+         * given eventfd once it is cached.
+         * @param host Host name.
+         * @param notify Eventfd to write to when resolution ends.
+         * @returns true if name is cached, false if it is being resolved.
+         */
+        bool prepare(const std::string &host, int notify);
+
+        /**
+         * @brief Stops notifying given eventfd (it is going to be closed).
+         * @param notify Eventfd passed to method prepare.
+         */
+        void forget(int notify);
+
+        /**
+         * @brief Moves address which has answered in front of other addresses of name.
+         * @param host Resolved host name.
+         * @param addr Address which has answered.
+         */
+        void prefer(const std::string &host, const struct sockaddr_storage &addr);
+
+    private:
+        /**
+         * @brief Removes expired entries, the whole cache is flushed if it is still full. Caller holds lock.
+         * @param now Current time in ms.
+         */
+        void evict(int64_t now);
+
+        /**
+         * @brief Resolves name on background thread, caches result and notifies waiting eventfds.
+         * @param host Host name.
+         */
+        void resolve_async(const std::string &host);
+
+        /**
+         * @brief Static method. Asks resolver library for addresses of name (it may block).
+         * @param host Host name.
+         * @param addrs Variable to store addresses into (without ports, in order they should be tried).
+         */
+        static void lookup(const std::string &host, std::vector<struct sockaddr_storage> &addrs);
+
+        /**
+         * @brief Static method. Returns current time of steady clock in ms.
+         */
+        static int64_t now_ms();
+};
+
+#endif
@@ -0,0 +1,1357 @@
+/*
+ * @author Jakub Šuráň (xsuran07)
+ * @file tftp_server.cpp
+ * @brief Implementation of TFTP server serving local directory.
+ */
+
+#include <iostream>
+#include <algorithm>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/syscall.h>
+#include <linux/openat2.h>
+
+#include "tftp_server.h"
+#include "tftp_codec.h"
+#include "tftp_client.h"
+
+#define MAX_EVENTS 64
+
+#define ID_LISTEN 0 // epoll identifier of listening socket
+#define ID_SIGNAL 1 // epoll identifier of signal descriptor
+#define ID_ENGINE 2 // epoll identifier of engine downloading from upstream server
+#define ID_FIRST_SESSION 3 // transfers are identified by numbers from this one
+#define TEMP_ATTEMPTS 16 // names tried for temporary file
+
+// HELPERS
+
+// returns "address,port" of client
+static std::string format_address(const struct sockaddr_storage &addr)
+{
+    char buf[INET6_ADDRSTRLEN] = "";
+    uint16_t port;
+
+    if(addr.ss_family == AF_INET) {
+        inet_ntop(AF_INET, &((struct sockaddr_in *) &addr)->sin_addr, buf, sizeof(buf));
+        port = ntohs(((struct sockaddr_in *) &addr)->sin_port);
+    } else {
+        inet_ntop(AF_INET6, &((struct sockaddr_in6 *) &addr)->sin6_addr, buf, sizeof(buf));
+        port = ntohs(((struct sockaddr_in6 *) &addr)->sin6_port);
+    }
+
+    return std::string(buf) + "," + std::to_string(port);
+}
+
+// LF is sent as CR LF, CR as CR NUL
+static std::vector<uint8_t> encode_netascii(const std::vector<uint8_t> &raw)
+{
+    std::vector<uint8_t> res;
+
+    res.reserve(raw.size() + raw.size() / 16);
+
+    for(uint8_t c : raw) {
+        if(c == '\n') {
+            res.push_back('\r');
+            res.push_back('\n');
+        } else if(c == '\r') {
+            res.push_back('\r');
+            res.push_back('\0');
+        } else {
+            res.push_back(c);
+        }
+    }
+
+    return res;
+}
+
+// writes whole buffer into file
+static bool write_all(int fd, const uint8_t *data, size_t len)
+{
+    while(len > 0) {
+        ssize_t n = write(fd, data, len);
+
+        if(n == -1) {
+            if(errno == EINTR) {
+                continue;
+            }
+
+            return false;
+        }
+
+        data += n;
+        len -= n;
+    }
+
+    return true;
+}
+
+// reads up to size bytes of file (less if it has been truncated meanwhile)
+static std::vector<uint8_t> read_all(int fd, uint64_t size)
+{
+    std::vector<uint8_t> raw(size);
+    size_t done = 0;
+    ssize_t n;
+
+    while(done < raw.size() && (n = pread(fd, raw.data() + done, raw.size() - done, done)) > 0) {
+        done += n;
+    }
+
+    raw.resize(done);
+    return raw;
+}
+
+// closes descriptor without changing errno
+static void close_quietly(int fd)
+{
+    int err = errno;
+
+    close(fd);
+    errno = err;
+}
+
+// PUBLIC INSTANCE METHODS
+
+// constructor
+Tftp_server::Tftp_server(const std::string &root, const struct sockaddr_storage &addr, socklen_t addr_len,
+    uint64_t budget) : wheel(Tftp_client::now_ms())
+{
+    this->root = root;
+    this->root_fd = -1;
+    this->writable = false;
+    this->next_tmp = 0;
+    this->addr = addr;
+    this->addr_len = addr_len;
+    this->listen_fd = -1;
+    this->sfd = -1;
+    this->epfd = -1;
+    this->running = false;
+    this->next_id = ID_FIRST_SESSION;
+    this->budget = budget;
+    this->used = 0;
+    this->in.resize(MAX_BLKSIZE + TFTP_HEADER);
+    this->log = nullptr;
+    this->stats = {0, 0, 0, 0, 0, 0};
+    this->relay = false;
+
+    // requested paths are appended to served directory
+    while(this->root.size() > 1 && this->root.back() == '/') {
+        this->root.pop_back();
+    }
+}
+
+// destructor
+Tftp_server::~Tftp_server()
+{
+    // transfers interrupted by error of event loop
+    for(auto &it : this->sessions) {
+        session_t *session = it.second.get();
+
+        close(session->fd);
+
+        if(session->file != -1) {
+            close(session->file);
+        }
+
+        if(!session->tmp.empty()) {
+            unlinkat(session->dir, session->tmp.c_str(), 0);
+        }
+
+        if(session->dir != -1) {
+            close(session->dir);
+        }
+    }
+
+    // downloads interrupted by error of event loop leave no temporary files
+    for(auto &it : this->fills) {
+        unlinkat(this->root_fd, it.second->tmp.c_str(), 0);
+        close(it.second->file);
+    }
+
+    if(this->root_fd != -1) {
+        close(this->root_fd);
+    }
+
+    if(this->listen_fd != -1) {
+        close(this->listen_fd);
+    }
+
+    if(this->sfd != -1) {
+        close(this->sfd);
+    }
+
+    if(this->epfd != -1) {
+        close(this->epfd);
+    }
+}
+
+void Tftp_server::set_upstream(const Tftp_parameters &tmpl)
+{
+    this->upstream = tmpl;
+    this->relay = true;
+}
+
+bool Tftp_server::run()
+{
+    struct epoll_event events[MAX_EVENTS];
+    struct signalfd_siginfo info;
+    int n;
+
+    if(!init()) {
+        return false;
+    }
+
+    while(this->running || !this->sessions.empty() || this->engine.get_active() > 0) {
+        int64_t next;
+
+        // drive downloads from upstream server, transfers may continue with data they have brought
+        if(this->relay) {
+            this->engine.step(0);
+
+            for(auto &fill : this->fills) {
+                wake(fill.second.get());
+            }
+        }
+
+        next = this->wheel.next_expiry();
+        int wait = (next < 0)? -1 : (int) std::max<int64_t>(next - Tftp_client::now_ms(), 0);
+
+        if((n = epoll_wait(this->epfd, events, MAX_EVENTS, wait)) == -1) {
+            if(errno != EINTR) {
+                std::cerr << "epoll_wait() failed!" << std::endl;
+                return false;
+            }
+
+            n = 0;
+        }
+
+        for(int i = 0; i < n; i++) {
+            uint64_t id = events[i].data.u64;
+
+            // deadlines of downloads (waiting transfers have none) are armed on descriptor of engine,
+            // so wait of loop covers only own transfers; engine is stepped at the top of loop
+            if(id == ID_ENGINE) {
+                continue;
+            } else if(id == ID_LISTEN) {
+                accept_requests();
+            } else if(id == ID_SIGNAL) {
+                // new requests aren't accepted, running transfers are finished
+                if(read(this->sfd, &info, sizeof(info)) == sizeof(info) && this->listen_fd != -1) {
+                    close(this->listen_fd);
+                    this->listen_fd = -1;
+                    this->running = false;
+                }
+            } else {
+                auto it = this->sessions.find(id);
+
+                // transfer may have ended while handling previous events
+                if(it != this->sessions.end()) {
+                    handle_packets(it->second.get());
+                }
+            }
+        }
+
+        handle_timers();
+    }
+
+    return true;
+}
+
+void Tftp_server::print_stats(std::ostream &out)
+{
+    out << "server transfers=" << this->stats.transfers << " failed=" << this->stats.failed << " bytes="
+        << this->stats.bytes << " hits=" << this->stats.hits << " misses=" << this->stats.misses << " cached="
+        << this->used;
+
+    if(this->relay) {
+        out << " fetched=" << this->stats.fetched;
+    }
+
+    out << std::endl;
+}
+
+// STATIC METHODS
+
+bool Tftp_server::parse_listen(std::string_view str, struct sockaddr_storage &addr, socklen_t &addr_len)
+{
+    char buf[INET6_ADDRSTRLEN];
+    size_t comma = str.rfind(',');
+    uint64_t port = SERVER_PORT;
+    std::string_view host = str.substr(0, comma);
+
+    if(comma != std::string_view::npos &&
+        (!Tftp_parameters::parse_number(str.substr(comma + 1), port) || port == 0 || port > 65535)) {
+        return false;
+    }
+
+    if(host.size() >= sizeof(buf)) {
+        return false;
+    }
+
+    host.copy(buf, host.size());
+    buf[host.size()] = '\0';
+    memset(&addr, 0, sizeof(addr));
+
+    if(inet_pton(AF_INET, buf, &((struct sockaddr_in *) &addr)->sin_addr) == 1) {
+        addr.ss_family = AF_INET;
+        ((struct sockaddr_in *) &addr)->sin_port = htons(port);
+        addr_len = sizeof(struct sockaddr_in);
+    } else if(inet_pton(AF_INET6, buf, &((struct sockaddr_in6 *) &addr)->sin6_addr) == 1) {
+        addr.ss_family = AF_INET6;
+        ((struct sockaddr_in6 *) &addr)->sin6_port = htons(port);
+        addr_len = sizeof(struct sockaddr_in6);
+    } else {
+        return false;
+    }
+
+    return true;
+}
+
+// PRIVATE INSTANCE METHODS
+
+bool Tftp_server::init()
+{
+    struct epoll_event ev;
+    sigset_t mask;
+    int on = 1;
+    int off = 0;
+
+    // requested paths are resolved beneath descriptor, not by name
+    if((this->root_fd = open(this->root.c_str(), O_PATH | O_DIRECTORY | O_CLOEXEC)) == -1) {
+        std::cerr << "Cannot open served directory " << this->root << " - " << strerror(errno) << "!" << std::endl;
+        return false;
+    }
+
+    if((this->listen_fd = socket(this->addr.ss_family, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0)) == -1) {
+        std::cerr << "socket() failed!" << std::endl;
+        return false;
+    }
+
+    setsockopt(this->listen_fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+    // address request has been sent to is used as source of transfer (server may have more addresses)
+    if(this->addr.ss_family == AF_INET6) {
+        setsockopt(this->listen_fd, IPPROTO_IPV6, IPV6_V6ONLY, &off, sizeof(off));
+        setsockopt(this->listen_fd, IPPROTO_IPV6, IPV6_RECVPKTINFO, &on, sizeof(on));
+    } else {
+        setsockopt(this->listen_fd, IPPROTO_IP, IP_PKTINFO, &on, sizeof(on));
+    }
+
+    if(bind(this->listen_fd, (struct sockaddr *) &this->addr, this->addr_len) == -1) {
+        std::cerr << "Cannot listen on " << format_address(this->addr) << " - " << strerror(errno) << "!" << std::endl;
+        return false;
+    }
+
+    // signals end server in order (they are delivered only through descriptor)
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGINT);
+    sigaddset(&mask, SIGTERM);
+
+    if(sigprocmask(SIG_BLOCK, &mask, nullptr) == -1 || (this->sfd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC)) == -1) {
+        std::cerr << "signalfd() failed!" << std::endl;
+        return false;
+    }
+
+    if((this->epfd = epoll_create1(EPOLL_CLOEXEC)) == -1) {
+        std::cerr << "epoll_create1() failed!" << std::endl;
+        return false;
+    }
+
+    ev.events = EPOLLIN;
+    ev.data.u64 = ID_LISTEN;
+    if(epoll_ctl(this->epfd, EPOLL_CTL_ADD, this->listen_fd, &ev) == -1) {
+        std::cerr << "epoll_ctl() failed!" << std::endl;
+        return false;
+    }
+
+    ev.data.u64 = ID_SIGNAL;
+    if(epoll_ctl(this->epfd, EPOLL_CTL_ADD, this->sfd, &ev) == -1) {
+        std::cerr << "epoll_ctl() failed!" << std::endl;
+        return false;
+    }
+
+    // engine is nested - its epoll descriptor is readable when downloads need attention
+    if(this->relay) {
+        ev.data.u64 = ID_ENGINE;
+        if(this->engine.get_fd() == -1 || epoll_ctl(this->epfd, EPOLL_CTL_ADD, this->engine.get_fd(), &ev) == -1) {
+            std::cerr << "epoll_ctl() failed!" << std::endl;
+            return false;
+        }
+    }
+
+    this->running = true;
+    return true;
+}
+
+void Tftp_server::accept_requests()
+{
+    alignas(struct cmsghdr) char control[CMSG_SPACE(sizeof(struct in6_pktinfo))];
+    struct sockaddr_storage peer;
+    struct sockaddr_storage local;
+    struct iovec iov;
+    struct msghdr msg;
+    ssize_t n;
+
+    while(this->listen_fd != -1) {
+        memset(&msg, 0, sizeof(msg));
+        iov = {this->in.data(), MAX_REQUEST_SIZE};
+        msg.msg_name = &peer;
+        msg.msg_namelen = sizeof(peer);
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+
+        if((n = recvmsg(this->listen_fd, &msg, 0)) == -1) {
+            break;
+        }
+
+        // listening address with port chosen by system, unless packet tells the real one
+        local = this->addr;
+
+        for(struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+            if(cmsg->cmsg_level == IPPROTO_IP && cmsg->cmsg_type == IP_PKTINFO) {
+                memcpy(&((struct sockaddr_in *) &local)->sin_addr,
+                    &((struct in_pktinfo *) CMSG_DATA(cmsg))->ipi_spec_dst, sizeof(struct in_addr));
+            } else if(cmsg->cmsg_level == IPPROTO_IPV6 && cmsg->cmsg_type == IPV6_PKTINFO) {
+                memcpy(&((struct sockaddr_in6 *) &local)->sin6_addr,
+                    &((struct in6_pktinfo *) CMSG_DATA(cmsg))->ipi6_addr, sizeof(struct in6_addr));
+            }
+        }
+
+        if(local.ss_family == AF_INET) {
+            ((struct sockaddr_in *) &local)->sin_port = 0;
+        } else {
+            ((struct sockaddr_in6 *) &local)->sin6_port = 0;
+        }
+
+        start(this->in.data(), n, peer, msg.msg_namelen, local);
+    }
+}
+
+void Tftp_server::start(const uint8_t *buf, size_t len, const struct sockaddr_storage &peer, socklen_t peer_len,
+    const struct sockaddr_storage &local)
+{
+    std::string_view name;
+    std::string_view value;
+    std::string peer_name = format_address(peer);
+    std::string msg;
+    struct epoll_event ev;
+    RequestView view;
+    session_t *session;
+    int off = 0;
+    int code;
+
+    // retransmitted request of running transfer
+    if(this->peers.count(peer_name) > 0) {
+        return;
+    }
+
+    auto ptr = std::make_unique<session_t>();
+    session = ptr.get();
+    session->id = this->next_id++;
+    session->peer = peer_name;
+    session->write = false;
+    session->binary = true;
+    session->file = -1;
+    session->dir = -1;
+    session->replied = false;
+    session->waiting = false;
+    session->size = 0;
+    session->offset = 0;
+    session->len = 0;
+    session->block = 0;
+    session->blksize = 512;
+    session->timeout = SERVER_TIMEOUT * 1000;
+    session->retries = 0;
+    session->last = false;
+    session->cr = false;
+    session->pkt.resize(MAX_REQUEST_SIZE);
+    session->pkt_len = 0;
+    session->bytes = 0;
+    session->started = Tftp_client::now_ms();
+    Timer_wheel::init_timer(&session->timer, session);
+
+    // transfer has its own port (TID), packets from other ports are filtered out by kernel
+    if((session->fd = socket(local.ss_family, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0)) == -1) {
+        std::cerr << "socket() failed!" << std::endl;
+        return;
+    }
+
+    if(local.ss_family == AF_INET6) {
+        setsockopt(session->fd, IPPROTO_IPV6, IPV6_V6ONLY, &off, sizeof(off));
+    }
+
+    if(bind(session->fd, (struct sockaddr *) &local, this->addr_len) == -1 ||
+        connect(session->fd, (struct sockaddr *) &peer, peer_len) == -1) {
+        std::cerr << "Cannot create socket of transfer for " << peer_name << " - " << strerror(errno) << "!" << std::endl;
+        close(session->fd);
+        return;
+    }
+
+    ev.events = EPOLLIN;
+    ev.data.u64 = session->id;
+    if(epoll_ctl(this->epfd, EPOLL_CTL_ADD, session->fd, &ev) == -1) {
+        std::cerr << "epoll_ctl() failed!" << std::endl;
+        close(session->fd);
+        return;
+    }
+
+    this->peers[peer_name] = session->id;
+    this->sessions[session->id] = std::move(ptr);
+
+    if(!view.parse(buf, len)) {
+        send_error(session, Tftp_client::ERR_CODE_ILEGAL_OP, "Invalid request");
+        return;
+    }
+
+    std::string mode = Tftp_parameters::lower(view.mode());
+
+    if(mode != "octet" && mode != "netascii") {
+        send_error(session, Tftp_client::ERR_CODE_ILEGAL_OP, "Unsupported transfer mode");
+        return;
+    }
+
+    session->name = view.filename();
+    session->write = view.opcode() == Tftp_codec::WRQ;
+    session->binary = mode == "octet";
+
+    if((session->relative = resolve(view.filename())).empty()) {
+        send_error(session, Tftp_client::ERR_CODE_ACCESS_VIOLATION, "Access violation");
+        return;
+    }
+
+    session->path = Tftp_parameters::join_path(this->root, session->relative);
+
+    // relay is cache of upstream server, uploads would make it inconsistent
+    if(session->write && this->relay) {
+        send_error(session, Tftp_client::ERR_CODE_ACCESS_VIOLATION, "Relay doesn't accept uploads");
+        return;
+    }
+
+    // any client could overwrite served files
+    if(session->write && !this->writable) {
+        send_error(session, Tftp_client::ERR_CODE_ACCESS_VIOLATION, "Uploads aren't allowed");
+        return;
+    }
+
+    // options are answered once size of file is known (it may be fetched from upstream server)
+    while(view.next(name, value)) {
+        session->options.push_back({Tftp_parameters::lower(name), std::string(value)});
+    }
+
+    if(!((session->write)? open_write(session, code, msg) : open_read(session, code, msg))) {
+        send_error(session, code, msg);
+        return;
+    }
+
+    proceed(session);
+}
+
+bool Tftp_server::respond(session_t *session)
+{
+    uint64_t number;
+    size_t olen;
+    size_t next;
+
+    session->replied = true;
+
+    // the same rules as client proposes them - unknown options and invalid values are ignored
+    olen = Tftp_codec::build_oack(session->pkt.data(), session->pkt.size());
+
+    for(auto &option : session->options) {
+        std::string reply;
+
+        if(option.first == "blksize" && Tftp_parameters::parse_number(option.second, number) && number >= MIN_BLKSIZE) {
+            session->blksize = std::min<uint64_t>(number, MAX_BLKSIZE);
+            reply = std::to_string(session->blksize);
+        } else if(option.first == "timeout" && Tftp_parameters::parse_number(option.second, number) &&
+            number >= MIN_TIMEOUT && number <= MAX_TIMEOUT) {
+            session->timeout = number * 1000;
+            reply = std::to_string(number);
+        } else if(option.first == "tsize" && Tftp_parameters::parse_number(option.second, number)) {
+            // size of downloaded file is announced, size of uploaded one is confirmed
+            reply = (session->write)? std::to_string(number) : std::to_string(session->size);
+        } else {
+            continue;
+        }
+
+        if((next = Tftp_codec::append_option(session->pkt.data(), session->pkt.size(), olen, option.first, reply)) > 0) {
+            olen = next;
+        }
+    }
+
+    // OACK is acknowledged by ACK 0 (RRQ) or answered by DATA 1 (WRQ)
+    if(olen > 2) {
+        session->pkt_len = olen;
+    } else if(session->write) {
+        session->pkt_len = Tftp_codec::build_ack(session->pkt.data(), session->pkt.size(), 0);
+    } else {
+        // the first block may still be being fetched
+        return proceed(session);
+    }
+
+    if(!send_packet(session)) {
+        finish(session, false);
+        return false;
+    }
+
+    return true;
+}
+
+bool Tftp_server::proceed(session_t *session)
+{
+    fill_t *fill = session->fill.get();
+    std::string msg;
+    int code;
+
+    if(fill) {
+        if(fill->failed) {
+            code = (fill->code == Tftp_client::ERR_CODE_NOT_FOUND)? fill->code : Tftp_client::ERR_CODE_NOT_DEF;
+            send_error(session, code, (code == Tftp_client::ERR_CODE_NOT_FOUND)? "File not found" :
+                "Cannot fetch file from upstream server");
+            return false;
+        }
+
+        // answer of request needs announced size, the next block needs its data (netascii is encoded from stored file)
+        bool ready = fill->complete || (session->binary && ((!session->replied)?
+            fill->size > 0 || std::none_of(session->options.begin(), session->options.end(),
+            [](auto &option) { return option.first == "tsize"; }) :
+            fill->received >= session->offset + session->len + session->blksize));
+
+        if(!ready) {
+            // client keeps waiting for the last packet, retransmissions would only waste its time
+            session->waiting = true;
+            fill->waiting.push_back(session->id);
+            this->wheel.cancel(&session->timer);
+            return true;
+        }
+
+        if(!session->binary) {
+            session->fill.reset();
+
+            if(!open_read(session, code, msg)) {
+                send_error(session, code, msg);
+                return false;
+            }
+        } else {
+            session->size = (fill->complete)? fill->received : std::max<uint64_t>(fill->size, fill->received);
+        }
+    }
+
+    if(!session->replied) {
+        return respond(session);
+    }
+
+    if(!send_block(session)) {
+        send_error(session, Tftp_client::ERR_CODE_NOT_DEF, "Cannot read file");
+        return false;
+    }
+
+    return true;
+}
+
+bool Tftp_server::open_read(session_t *session, int &code, std::string &msg)
+{
+    std::string key = (session->binary)? session->path : session->path + "\nnetascii";
+    struct stat st;
+    int64_t mtime;
+    int fd;
+
+    // file is being fetched from upstream server
+    if(this->relay && this->fills.count(session->path) > 0) {
+        session->fill = this->fills[session->path];
+        return attach(session, code, msg);
+    }
+
+    // opening of FIFO wouldn't block (it is refused as any other special file)
+    if((fd = open_beneath(session->relative, O_RDONLY | O_NONBLOCK)) == -1) {
+        if(errno == ENOENT && this->relay) {
+            return fetch(session, code, msg);
+        }
+
+        // symlink leading out of served directory
+        msg = (errno == ENOENT)? "File not found" : (errno == EXDEV || errno == ELOOP)? "Access violation" :
+            strerror(errno);
+        code = (errno == ENOENT)? Tftp_client::ERR_CODE_NOT_FOUND : Tftp_client::ERR_CODE_ACCESS_VIOLATION;
+        return false;
+    }
+
+    if(fstat(fd, &st) == -1 || !S_ISREG(st.st_mode)) {
+        close(fd);
+        msg = "Not a regular file";
+        code = Tftp_client::ERR_CODE_ACCESS_VIOLATION;
+        return false;
+    }
+
+    // file changed on disk is read again
+    mtime = st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+
+    if((session->data = lookup(key, mtime, st.st_size))) {
+        close(fd);
+        this->stats.hits++;
+        session->size = session->data->size();
+        return true;
+    }
+
+    this->stats.misses++;
+
+    // big file would push hot ones out of memory
+    if((uint64_t) st.st_size > SERVER_CACHE_FILE) {
+        if(!session->binary) {
+            close(fd);
+            msg = "File is too big for netascii mode";
+            code = Tftp_client::ERR_CODE_NOT_DEF;
+            return false;
+        }
+
+        session->file = fd;
+        session->size = st.st_size;
+        return true;
+    }
+
+    std::vector<uint8_t> raw = read_all(fd, st.st_size);
+
+    close(fd);
+
+    auto data = std::make_shared<const std::vector<uint8_t>>((session->binary)? std::move(raw) : encode_netascii(raw));
+
+    store(key, data, mtime, st.st_size);
+    session->data = data;
+    session->size = data->size();
+    return true;
+}
+
+bool Tftp_server::fetch(session_t *session, int &code, std::string &msg)
+{
+    Tftp_parameters::params_t values = this->upstream.get_values();
+    Tftp_parameters params;
+    auto fill = std::make_shared<fill_t>();
+    auto client = std::make_unique<Tftp_client>();
+    Tftp_client *ptr = client.get();
+    size_t slash = session->relative.rfind('/');
+
+    // path relative to served directory is appended to path of template
+    values.filename = Tftp_parameters::join_path(this->upstream.get_filename(), session->relative);
+    values.local = "";
+    values.expected = 0;
+    values.mode = Tftp_parameters::BINARY;
+
+    if(!params.set_values(values)) {
+        msg = "Invalid request for upstream server";
+        code = Tftp_client::ERR_CODE_NOT_DEF;
+        return false;
+    }
+
+    fill->path = session->path;
+    fill->relative = session->relative;
+    fill->received = 0;
+    fill->size = 0;
+    fill->complete = false;
+    fill->failed = false;
+    fill->code = Tftp_client::ERR_CODE_NOT_DEF;
+
+    // directories of file are created only once it has been fetched (client could ask for any path)
+    if((fill->file = create_temp(this->root_fd, session->relative.substr(slash + 1), fill->tmp)) == -1) {
+        std::cerr << "Cannot store " << fill->path << " fetched from upstream server - " << strerror(errno) << "!"
+            << std::endl;
+        msg = "Cannot store file fetched from upstream server";
+        code = Tftp_client::ERR_CODE_NOT_DEF;
+        return false;
+    }
+
+    // data are only appended here, waiting transfers are woken from event loop and read them from spool
+    client->set_sink(std::make_shared<Callback_sink>([fill, ptr](byte_span_t data) {
+        if(fill->size == 0 && ptr->get_progress().total > 0) {
+            fill->size = ptr->get_progress().total;
+        }
+
+        if(!write_all(fill->file, data.data, data.size)) {
+            return false;
+        }
+
+        fill->received += data.size;
+        return true;
+    }));
+
+    // download may end (e.g. by unknown host) before engine returns
+    session->fill = fill;
+
+    if(!attach(session, code, msg)) {
+        unlinkat(this->root_fd, fill->tmp.c_str(), 0);
+        close(fill->file);
+        return false;
+    }
+
+    this->fills[fill->path] = fill;
+    this->stats.fetched++;
+    this->engine.add(params, [this, fill](Tftp_client &client) {
+        complete_fill(fill, client.is_successful(), client.get_error_code());
+    }, std::move(client));
+
+    return true;
+}
+
+bool Tftp_server::attach(session_t *session, int &code, std::string &msg)
+{
+    // netascii transfer waits for complete file and encodes it
+    if(!session->binary) {
+        return true;
+    }
+
+    // binary one reads blocks from spool as they arrive
+    if((session->file = fcntl(session->fill->file, F_DUPFD_CLOEXEC, 0)) == -1) {
+        msg = strerror(errno);
+        code = Tftp_client::ERR_CODE_NOT_DEF;
+        return false;
+    }
+
+    return true;
+}
+
+void Tftp_server::complete_fill(std::shared_ptr<fill_t> fill, bool ok, int code)
+{
+    size_t slash = fill->relative.rfind('/');
+    const char *name = fill->relative.c_str() + slash + 1;
+    struct stat st;
+    int dir = -1;
+
+    this->fills.erase(fill->path);
+
+    // spool is renamed into place like upload - complete file appears at once
+    if(ok && (fstat(fill->file, &st) == -1 ||
+        (dir = open_dir((slash == std::string::npos)? "" : fill->relative.substr(0, slash), true)) == -1 ||
+        renameat(this->root_fd, fill->tmp.c_str(), dir, name) == -1)) {
+        std::cerr << "Cannot store " << fill->path << " fetched from upstream server - " << strerror(errno) << "!"
+            << std::endl;
+        unlinkat(this->root_fd, fill->tmp.c_str(), 0);
+    } else if(!ok) {
+        unlinkat(this->root_fd, fill->tmp.c_str(), 0);
+    } else if(fill->received <= SERVER_CACHE_FILE) {
+        // small file is kept in memory as if it had been read from disk
+        store(fill->path, std::make_shared<const std::vector<uint8_t>>(read_all(fill->file, fill->received)),
+            st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec, st.st_size);
+    }
+
+    // binary transfers have their own descriptors of spool, file which couldn't be stored is fetched again next time
+    if(dir != -1) {
+        close(dir);
+    }
+
+    close(fill->file);
+    fill->file = -1;
+    fill->complete = ok;
+    fill->failed = !ok;
+    fill->code = code;
+    wake(fill.get());
+}
+
+void Tftp_server::wake(fill_t *fill)
+{
+    std::vector<uint64_t> waiting;
+
+    // transfers which still cannot continue wait again
+    waiting.swap(fill->waiting);
+
+    for(uint64_t id : waiting) {
+        auto it = this->sessions.find(id);
+
+        if(it != this->sessions.end() && it->second->waiting) {
+            it->second->waiting = false;
+            proceed(it->second.get());
+        }
+    }
+}
+
+bool Tftp_server::open_write(session_t *session, int &code, std::string &msg)
+{
+    size_t slash = session->relative.rfind('/');
+    std::string name = session->relative.substr(slash + 1);
+    struct stat st;
+
+    // file is created only in existing directory
+    if((session->dir = open_dir((slash == std::string::npos)? "" : session->relative.substr(0, slash), false)) == -1) {
+        msg = (errno == ENOENT)? "Directory not found" : (errno == EXDEV || errno == ELOOP || errno == ENOTDIR)?
+            "Access violation" : strerror(errno);
+        code = (errno == ENOENT)? Tftp_client::ERR_CODE_NOT_FOUND : Tftp_client::ERR_CODE_ACCESS_VIOLATION;
+        return false;
+    }
+
+    // symlink itself would be replaced
+    if(fstatat(session->dir, name.c_str(), &st, AT_SYMLINK_NOFOLLOW) == 0 && !S_ISREG(st.st_mode)) {
+        msg = "Not a regular file";
+        code = Tftp_client::ERR_CODE_ACCESS_VIOLATION;
+        return false;
+    }
+
+    if((session->file = create_temp(session->dir, name, session->tmp)) == -1) {
+        msg = strerror(errno);
+        code = Tftp_client::ERR_CODE_ACCESS_VIOLATION;
+        return false;
+    }
+
+    return true;
+}
+
+void Tftp_server::handle_packets(session_t *session)
+{
+    ssize_t n;
+
+    while(true) {
+        if((n = recv(session->fd, this->in.data(), this->in.size(), 0)) == -1) {
+            // client doesn't listen anymore (ICMP port unreachable)
+            if(errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                finish(session, false);
+            }
+
+            return;
+        }
+
+        uint16_t opcode = Tftp_codec::peek_opcode(this->in.data(), n);
+        bool alive;
+
+        if(opcode == Tftp_codec::ERROR) {
+            // client has aborted transfer
+            finish(session, false);
+            return;
+        }
+
+        if(!session->write && opcode == Tftp_codec::ACK) {
+            alive = handle_ack(session, this->in.data(), n);
+        } else if(session->write && opcode == Tftp_codec::DATA) {
+            alive = handle_data(session, this->in.data(), n);
+        } else {
+            send_error(session, Tftp_client::ERR_CODE_ILEGAL_OP, "Illegal TFTP operation");
+            return;
+        }
+
+        if(!alive) {
+            return;
+        }
+    }
+}
+
+bool Tftp_server::handle_ack(session_t *session, const uint8_t *buf, size_t len)
+{
+    AckView view;
+
+    if(!view.parse(buf, len)) {
+        send_error(session, Tftp_client::ERR_CODE_ILEGAL_OP, "Invalid ACK packet");
+        return false;
+    }
+
+    // duplicate ACK isn't answered, otherwise every block would be sent twice from now on
+    if(view.block() != session->block || session->waiting) {
+        return true;
+    }
+
+    if(session->last) {
+        finish(session, true);
+        return false;
+    }
+
+    return proceed(session);
+}
+
+bool Tftp_server::handle_data(session_t *session, const uint8_t *buf, size_t len)
+{
+    DataView view;
+
+    if(!view.parse(buf, len)) {
+        send_error(session, Tftp_client::ERR_CODE_ILEGAL_OP, "Invalid DATA packet");
+        return false;
+    }
+
+    byte_span_t payload = view.payload();
+
+    // our ACK has been lost
+    if(view.block() == session->block && session->block != 0) {
+        if(!send_packet(session)) {
+            finish(session, false);
+            return false;
+        }
+
+        return true;
+    }
+
+    if(session->last || view.block() != (uint16_t) (session->block + 1)) {
+        return true;
+    }
+
+    if(payload.size > session->blksize) {
+        send_error(session, Tftp_client::ERR_CODE_ILEGAL_OP, "Block is bigger than negotiated");
+        return false;
+    }
+
+    if(!write_data(session, payload.data, payload.size)) {
+        send_error(session, Tftp_client::ERR_CODE_DISK_FULL, "Cannot write file");
+        return false;
+    }
+
+    session->block++;
+    session->bytes += payload.size;
+    session->retries = 0;
+    session->last = payload.size < session->blksize;
+
+    // complete file replaces the old one at once, duplicates of the last block are acknowledged till timeout
+    if(session->last) {
+        bool ok = (session->binary || !session->cr || write_all(session->file, (const uint8_t *) "\r", 1)) &&
+            close(session->file) == 0;
+
+        session->file = -1;
+
+        if(!ok || renameat(session->dir, session->tmp.c_str(), session->dir,
+            session->relative.c_str() + session->relative.rfind('/') + 1) == -1) {
+            send_error(session, Tftp_client::ERR_CODE_ACCESS_VIOLATION, "Cannot store file");
+            return false;
+        }
+
+        session->tmp.clear();
+        invalidate(session->path);
+    }
+
+    session->pkt_len = Tftp_codec::build_ack(session->pkt.data(), session->pkt.size(), session->block);
+
+    if(!send_packet(session)) {
+        finish(session, false);
+        return false;
+    }
+
+    return true;
+}
+
+void Tftp_server::handle_timers()
+{
+    this->expired.clear();
+    this->wheel.advance(Tftp_client::now_ms(), this->expired);
+
+    for(auto *timer : this->expired) {
+        session_t *session = static_cast<session_t *> (timer->data);
+
+        // upload has ended and client hasn't resent its last block
+        if(session->write && session->last) {
+            finish(session, true);
+        } else if(++session->retries > SERVER_RETRIES || !send_packet(session)) {
+            finish(session, false);
+        }
+    }
+}
+
+bool Tftp_server::send_block(session_t *session)
+{
+    session->offset += session->len;
+    session->block++;
+    session->len = std::min<uint64_t>(session->blksize, session->size - session->offset);
+    session->last = session->len < session->blksize;
+    session->retries = 0;
+    session->bytes += session->len;
+
+    // block in memory is sent directly from cached file
+    if(session->data) {
+        session->pkt_len = 0;
+        return send_packet(session);
+    }
+
+    if(session->pkt.size() < session->blksize + TFTP_HEADER) {
+        session->pkt.resize(session->blksize + TFTP_HEADER);
+    }
+
+    Tftp_codec::build_data_header(session->pkt.data(), session->block);
+
+    if(pread(session->file, session->pkt.data() + TFTP_HEADER, session->len, session->offset) != (ssize_t) session->len) {
+        return false;
+    }
+
+    session->pkt_len = TFTP_HEADER + session->len;
+    return send_packet(session);
+}
+
+bool Tftp_server::send_packet(session_t *session)
+{
+    ssize_t n;
+
+    if(session->pkt_len == 0) {
+        uint8_t header[TFTP_HEADER];
+        struct iovec iov[2];
+        struct msghdr msg;
+
+        Tftp_codec::build_data_header(header, session->block);
+        iov[0] = {header, TFTP_HEADER};
+        iov[1] = {(void *) (session->data->data() + session->offset), session->len};
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iov;
+        msg.msg_iovlen = 2;
+
+        n = sendmsg(session->fd, &msg, 0);
+    } else {
+        n = send(session->fd, session->pkt.data(), session->pkt_len, 0);
+    }
+
+    this->wheel.schedule(&session->timer, Tftp_client::now_ms() + session->timeout);
+
+    // packet dropped by full socket buffer is retransmitted after timeout
+    return n != -1 || errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS;
+}
+
+void Tftp_server::send_error(session_t *session, int code, std::string_view msg)
+{
+    size_t len = Tftp_codec::build_error(session->pkt.data(), session->pkt.size(), code, msg);
+
+    if(len > 0 && send(session->fd, session->pkt.data(), len, 0) == -1) {
+        std::cerr << "Cannot send error to " << session->peer << "!" << std::endl;
+    }
+
+    finish(session, false);
+}
+
+bool Tftp_server::write_data(session_t *session, const uint8_t *data, size_t len)
+{
+    std::vector<uint8_t> decoded;
+
+    if(session->binary) {
+        return write_all(session->file, data, len);
+    }
+
+    // CR LF means LF, CR NUL means CR (pair may be split between blocks)
+    decoded.reserve(len + 1);
+
+    for(size_t i = 0; i < len; i++) {
+        uint8_t c = data[i];
+
+        if(session->cr) {
+            session->cr = false;
+
+            if(c == '\n' || c == '\0') {
+                decoded.push_back((c == '\n')? '\n' : '\r');
+                continue;
+            }
+
+            decoded.push_back('\r');
+        }
+
+        if(c == '\r') {
+            session->cr = true;
+        } else {
+            decoded.push_back(c);
+        }
+    }
+
+    return write_all(session->file, decoded.data(), decoded.size());
+}
+
+void Tftp_server::finish(session_t *session, bool ok)
+{
+    uint64_t id = session->id;
+
+    this->wheel.cancel(&session->timer);
+    close(session->fd);
+
+    if(session->file != -1) {
+        close(session->file);
+    }
+
+    // incomplete upload doesn't replace original file
+    if(!session->tmp.empty()) {
+        unlinkat(session->dir, session->tmp.c_str(), 0);
+    }
+
+    if(session->dir != -1) {
+        close(session->dir);
+    }
+
+    this->stats.transfers++;
+    this->stats.failed += !ok;
+    this->stats.bytes += session->bytes;
+
+    if(this->log) {
+        *this->log << ((session->write)? "WRQ " : "RRQ ") << session->name << " from " << session->peer << " status="
+            << ((ok)? "ok" : "failed") << " bytes=" << session->bytes << " time_ms="
+            << Tftp_client::now_ms() - session->started << std::endl;
+    }
+
+    this->peers.erase(session->peer);
+    this->sessions.erase(id);
+}
+
+std::shared_ptr<const std::vector<uint8_t>> Tftp_server::lookup(const std::string &key, int64_t mtime, uint64_t size)
+{
+    auto it = this->index.find(key);
+
+    if(it == this->index.end()) {
+        return nullptr;
+    }
+
+    // file has been changed on disk
+    if(it->second->mtime != mtime || it->second->size != size) {
+        this->used -= it->second->data->size();
+        this->lru.erase(it->second);
+        this->index.erase(it);
+        return nullptr;
+    }
+
+    this->lru.splice(this->lru.begin(), this->lru, it->second);
+    return it->second->data;
+}
+
+void Tftp_server::store(const std::string &key, std::shared_ptr<const std::vector<uint8_t>> data, int64_t mtime,
+    uint64_t size)
+{
+    auto it = this->index.find(key);
+
+    if(data->size() > this->budget) {
+        return;
+    }
+
+    if(it != this->index.end()) {
+        this->used -= it->second->data->size();
+        this->lru.erase(it->second);
+    }
+
+    this->lru.push_front({key, data, mtime, size});
+    this->index[key] = this->lru.begin();
+    this->used += data->size();
+
+    // files still being sent stay alive in their transfers
+    while(this->used > this->budget) {
+        this->used -= this->lru.back().data->size();
+        this->index.erase(this->lru.back().key);
+        this->lru.pop_back();
+    }
+}
+
+void Tftp_server::invalidate(const std::string &path)
+{
+    for(auto &key : {path, path + "\nnetascii"}) {
+        auto it = this->index.find(key);
+
+        if(it != this->index.end()) {
+            this->used -= it->second->data->size();
+            this->lru.erase(it->second);
+            this->index.erase(it);
+        }
+    }
+}
+
+std::string Tftp_server::resolve(std::string_view filename)
+{
+    std::string path;
+    size_t start = 0;
+
+    while(start <= filename.size()) {
+        size_t end = std::min(filename.find('/', start), filename.size());
+        std::string_view part = filename.substr(start, end - start);
+
+        start = end + 1;
+
+        if(part.empty() || part == ".") {
+            continue;
+        }
+
+        // file would lie outside of served directory
+        if(part == "..") {
+            return "";
+        }
+
+        path += (path.empty())? "" : "/";
+        path += part;
+    }
+
+    return path;
+}
+
+int Tftp_server::open_beneath(const std::string &relative, int flags)
+{
+    struct open_how how;
+    size_t start = 0;
+    size_t end;
+    int dir = this->root_fd;
+    int fd;
+
+    memset(&how, 0, sizeof(how));
+    how.flags = flags | O_CLOEXEC;
+    how.resolve = RESOLVE_BENEATH | RESOLVE_NO_MAGICLINKS;
+
+    if((fd = syscall(SYS_openat2, this->root_fd, relative.c_str(), &how, sizeof(how))) != -1 || errno != ENOSYS) {
+        return fd;
+    }
+
+    // kernel without openat2 - no symlink is followed
+    while((end = relative.find('/', start)) != std::string::npos) {
+        int next = openat(dir, relative.substr(start, end - start).c_str(), O_PATH | O_DIRECTORY | O_NOFOLLOW |
+            O_CLOEXEC);
+
+        if(dir != this->root_fd) {
+            close_quietly(dir);
+        }
+
+        if((dir = next) == -1) {
+            return -1;
+        }
+
+        start = end + 1;
+    }
+
+    fd = openat(dir, relative.c_str() + start, flags | O_NOFOLLOW | O_CLOEXEC);
+
+    if(dir != this->root_fd) {
+        close_quietly(dir);
+    }
+
+    return fd;
+}
+
+int Tftp_server::open_dir(const std::string &relative, bool create)
+{
+    size_t slash = relative.rfind('/');
+    const char *name = relative.c_str() + ((slash == std::string::npos)? 0 : slash + 1);
+    int dir;
+    int fd;
+
+    if((fd = open_beneath((relative.empty())? "." : relative, O_PATH | O_DIRECTORY)) != -1 || errno != ENOENT ||
+        !create) {
+        return fd;
+    }
+
+    // missing directory is created in its (opened) parent, so it cannot appear out of served directory
+    if((dir = open_dir((slash == std::string::npos)? "" : relative.substr(0, slash), true)) == -1) {
+        return -1;
+    }
+
+    if(mkdirat(dir, name, 0755) == -1 && errno != EEXIST) {
+        close_quietly(dir);
+        return -1;
+    }
+
+    fd = openat(dir, name, O_PATH | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    close_quietly(dir);
+    return fd;
+}
+
+int Tftp_server::create_temp(int dir, std::string_view name, std::string &tmp)
+{
+    int fd = -1;
+
+    // name is unique within server, files of other processes are kept by O_EXCL
+    for(int i = 0; i < TEMP_ATTEMPTS; i++) {
+        tmp = "." + std::string(name) + "." + std::to_string(getpid()) + "." + std::to_string(this->next_tmp++);
+
+        if((fd = openat(dir, tmp.c_str(), O_RDWR | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC, 0644)) != -1 ||
+            errno != EEXIST) {
+            break;
+        }
+    }
+
+    if(fd == -1) {
+        tmp.clear();
+    }
+
+    return fd;
+}
@@ -0,0 +1,416 @@
+/*
+ * @author Jakub Šuráň (xsuran07)
+ * @file tftp_server.h
+ * @brief Interface of TFTP server serving local directory.
+ */
+
+#ifndef __TFTP_SERVER_H_
+#define __TFTP_SERVER_H_
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <list>
+#include <map>
+#include <unordered_map>
+#include <memory>
+#include <ostream>
+#include <stdint.h>
+#include <sys/socket.h>
+
+#include "timer_wheel.h"
+#include "tftp_engine.h"
+#include "tftp_parameters.h"
+
+#define SERVER_PORT 69
+#define SERVER_TIMEOUT 1 // retransmission timeout in s unless client negotiates other one
+#define SERVER_RETRIES 5 // retransmissions of one packet before transfer is abandoned
+#define SERVER_CACHE_BUDGET (256ULL * 1024 * 1024) // default maximal size of files kept in memory
+#define SERVER_CACHE_FILE (32ULL * 1024 * 1024) // bigger files are read from disk block by block
+
+/**
+ * @brief TFTP server serving files of local directory (RRQ and WRQ with options
+ * blksize, timeout and tsize) to many concurrent clients from one epoll loop.
+ * Every transfer has its own socket connected to client (its TID), deadlines
+ * of all transfers are kept in timing wheel. Hot files are kept in memory
+ * (the least recently used ones are evicted when budget is exceeded) and sent
+ * without copying, file changed on disk is read again. Uploaded file is written
+ * into temporary file and renamed into place once it is complete, so readers
+ * never see partial file. Server ends on SIGINT or SIGTERM once running
+ * transfers end.
+ *
+ * In relay mode served directory is local cache of upstream server. File
+ * missing in it is downloaded from upstream server (one download per file no
+ * matter how many clients ask for it) into temporary file and streamed from it
+ * to waiting clients block by block as it arrives, complete file is renamed
+ * into place and later requests are served locally.
+ */
+class Tftp_server
+{
+    public:
+        /**
+         * @brief Statistics of server.
+         */
+        typedef struct {
+            uint64_t transfers; // ended transfers
+            uint64_t failed; // transfers which haven't been successful
+            uint64_t bytes; // payload sent and received
+            uint64_t hits; // downloads served from memory cache
+            uint64_t misses; // downloads which had to read file from disk
+            uint64_t fetched; // files downloaded from upstream server (relay mode)
+        } stats_t;
+
+    private:
+        /**
+         * @brief File kept in memory.
+         */
+        typedef struct {
+            std::string key; // local path (and mode of transfer)
+            std::shared_ptr<const std::vector<uint8_t>> data; // content as it is sent
+            int64_t mtime; // time of modification of file in ns
+            uint64_t size; // size of file on disk
+        } cached_t;
+
+        /**
+         * @brief File being downloaded from upstream server (relay mode).
+         */
+        typedef struct {
+            std::string path; // local path file is stored to
+            std::string relative; // path relative to served directory
+            std::string tmp; // temporary file received data are spooled into (in served directory)
+            int file; // descriptor of temporary file
+            uint64_t received; // number of spooled bytes
+            uint64_t size; // size announced by upstream server, 0 if it isn't known yet
+            bool complete;
+            bool failed;
+            int code; // error code sent by upstream server
+            std::vector<uint64_t> waiting; // transfers waiting for more data
+        } fill_t;
+
+        /**
+         * @brief Representation of one transfer.
+         */
+        typedef struct {
+            uint64_t id;
+            int fd; // socket connected to client
+            std::string peer; // address,port of client
+            std::string name; // requested file
+            std::string path; // local path of file
+            std::string relative; // path relative to served directory
+            std::string tmp; // temporary file of upload (in directory dir)
+            int dir; // directory of uploaded file
+            bool write;
+            bool binary;
+            std::shared_ptr<const std::vector<uint8_t>> data; // served content in memory, empty if it is read from disk
+            std::shared_ptr<fill_t> fill; // download from upstream server file is streamed from
+            std::vector<std::pair<std::string, std::string>> options; // requested options
+            bool replied; // request has been answered
+            bool waiting; // transfer waits for data from upstream server
+            int file; // descriptor of file read from disk or written
+            uint64_t size; // size of served content
+            uint64_t offset; // offset of current block
+            size_t len; // size of current block
+            uint16_t block; // number of the last sent (RRQ) or received (WRQ) block
+            size_t blksize;
+            int64_t timeout; // ms
+            int retries; // retransmissions of the last packet
+            bool last; // the last block has been sent (RRQ) or received (WRQ)
+            bool cr; // uploaded netascii data end with CR
+            std::vector<uint8_t> pkt; // packet to retransmit
+            size_t pkt_len; // 0 if block in memory is retransmitted
+            uint64_t bytes; // transferred payload
+            int64_t started;
+            wheel_timer_t timer;
+        } session_t;
+
+        std::string root;
+        int root_fd; // served directory, all files are opened beneath it
+        bool writable; // clients may upload files
+        uint64_t next_tmp; // suffix of the next temporary file
+        struct sockaddr_storage addr; // address to listen on
+        socklen_t addr_len;
+        int listen_fd;
+        int sfd; // signal descriptor
+        int epfd;
+        bool running;
+        Timer_wheel wheel;
+        std::vector<wheel_timer_t *> expired;
+        std::unordered_map<uint64_t, std::unique_ptr<session_t>> sessions;
+        std::map<std::string, uint64_t> peers; // address,port of client => its transfer
+        uint64_t next_id;
+        uint64_t budget; // maximal size of files in memory
+        uint64_t used;
+        std::list<cached_t> lru; // the most recently used file first
+        std::unordered_map<std::string, std::list<cached_t>::iterator> index; // key => cached file
+        std::vector<uint8_t> in; // receive buffer
+        std::ostream *log;
+        stats_t stats;
+        bool relay;
+        Tftp_parameters upstream; // template of downloads from upstream server
+        Tftp_engine engine; // downloads from upstream server
+        std::unordered_map<std::string, std::shared_ptr<fill_t>> fills; // local path => running download
+
+    public:
+        /**
+         * @brief Constructor.
+         * @param root Served directory.
+         * @param addr Address (and port) to listen on.
+         * @param addr_len Length of address.
+         * @param budget Maximal size of files kept in memory in bytes (0 disables cache).
+         */
+        Tftp_server(const std::string &root, const struct sockaddr_storage &addr, socklen_t addr_len,
+            uint64_t budget = SERVER_CACHE_BUDGET);
+
+        /**
+         * @brief Destructor.
+         */
+        ~Tftp_server();
+
+        Tftp_server(const Tftp_server &) = delete;
+        Tftp_server &operator=(const Tftp_server &) = delete;
+
+        /**
+         * @brief Setter for stream every ended transfer is logged into (nullptr turns log off).
+         */
+        void set_log(std::ostream *log) { this->log = log; };
+
+        /**
+         * @brief Setter for writable attribute - uploads (WRQ) are refused unless they are allowed.
+         */
+        void set_writable(bool writable) { this->writable = writable; };
+
+        /**
+         * @brief Turns server into relay - files missing in served directory are downloaded from upstream server.
+         * @param tmpl Template request (download) - its address is upstream server, its path is prefix
+         * of requested paths.
+         */
+        void set_upstream(const Tftp_parameters &tmpl);
+
+        /**
+         * @brief Serves requests till SIGINT or SIGTERM.
+         * @returns true if server ended properly, false if it couldn't be started.
+         */
+        bool run();
+
+        /**
+         * @brief Getter for statistics.
+         */
+        const stats_t &get_stats() { return this->stats; };
+
+        /**
+         * @brief Prints statistics of server as one line.
+         * @param out Stream to print statistics into.
+         */
+        void print_stats(std::ostream &out);
+
+        /**
+         * @brief Static method. Parses address to listen on ("address[,port]").
+         * @param str String to parse.
+         * @param addr Variable to store address into.
+         * @param addr_len Variable to store length of address into.
+         * @returns true in case of success, false otherwise.
+         */
+        static bool parse_listen(std::string_view str, struct sockaddr_storage &addr, socklen_t &addr_len);
+
+    private:
+        /**
+         * @brief Creates listening socket, signal descriptor and epoll instance.
+         * @returns true in case of success, false otherwise.
+         */
+        bool init();
+
+        /**
+         * @brief Reads all pending requests from listening socket and starts their transfers.
+         */
+        void accept_requests();
+
+        /**
+         * @brief Starts transfer requested by client.
+         * @param buf Received request.
+         * @param len Length of request.
+         * @param peer Address of client.
+         * @param peer_len Length of address of client.
+         * @param local Address request has been sent to.
+         */
+        void start(const uint8_t *buf, size_t len, const struct sockaddr_storage &peer, socklen_t peer_len,
+            const struct sockaddr_storage &local);
+
+        /**
+         * @brief Opens file to send (from memory cache or from disk).
+         * @param session Transfer.
+         * @param code Variable to store TFTP error code into.
+         * @param msg Variable to store error message into.
+         * @returns true in case of success, false otherwise.
+         */
+        bool open_read(session_t *session, int &code, std::string &msg);
+
+        /**
+         * @brief Starts download of file from upstream server (relay mode) and streams it to transfer.
+         * @param session Transfer.
+         * @param code Variable to store TFTP error code into.
+         * @param msg Variable to store error message into.
+         * @returns true in case of success, false otherwise.
+         */
+        bool fetch(session_t *session, int &code, std::string &msg);
+
+        /**
+         * @brief Attaches transfer to download from upstream server (session->fill) - binary
+         * transfer gets its own descriptor of spooled file.
+         * @param session Transfer.
+         * @param code Variable to store TFTP error code into.
+         * @param msg Variable to store error message into.
+         * @returns true in case of success, false otherwise.
+         */
+        bool attach(session_t *session, int &code, std::string &msg);
+
+        /**
+         * @brief Renames downloaded file into place (or removes incomplete one) and wakes transfers waiting for it.
+         * @param fill Ended download.
+         * @param ok Determines if download has been successful.
+         * @param code Error code sent by upstream server.
+         */
+        void complete_fill(std::shared_ptr<fill_t> fill, bool ok, int code);
+
+        /**
+         * @brief Lets transfers waiting for download continue if it has received enough data.
+         * @param fill Download.
+         */
+        void wake(fill_t *fill);
+
+        /**
+         * @brief Creates temporary file for uploaded data.
+         * @param session Transfer.
+         * @param code Variable to store TFTP error code into.
+         * @param msg Variable to store error message into.
+         * @returns true in case of success, false otherwise.
+         */
+        bool open_write(session_t *session, int &code, std::string &msg);
+
+        /**
+         * @brief Answers request - negotiates options and sends OACK, ACK 0 or the first block.
+         * @returns false if transfer has ended, true otherwise.
+         */
+        bool respond(session_t *session);
+
+        /**
+         * @brief Sends the next packet of download (answer of request or next block) unless
+         * transfer has to wait for data from upstream server.
+         * @returns false if transfer has ended, true otherwise.
+         */
+        bool proceed(session_t *session);
+
+        /**
+         * @brief Handles all packets received by transfer.
+         * @param session Transfer.
+         */
+        void handle_packets(session_t *session);
+
+        /**
+         * @brief Handles acknowledgement of sent block.
+         * @returns false if transfer has ended, true otherwise.
+         */
+        bool handle_ack(session_t *session, const uint8_t *buf, size_t len);
+
+        /**
+         * @brief Handles block of uploaded data.
+         * @returns false if transfer has ended, true otherwise.
+         */
+        bool handle_data(session_t *session, const uint8_t *buf, size_t len);
+
+        /**
+         * @brief Handles expired deadlines of transfers.
+         */
+        void handle_timers();
+
+        /**
+         * @brief Sends next block of file.
+         * @returns true in case of success, false otherwise.
+         */
+        bool send_block(session_t *session);
+
+        /**
+         * @brief Sends packet prepared in buffer of transfer (or current block in memory)
+         * and moves its deadline.
+         * @returns true in case of success, false otherwise.
+         */
+        bool send_packet(session_t *session);
+
+        /**
+         * @brief Sends ERROR packet and ends transfer.
+         * @param session Transfer.
+         * @param code TFTP error code.
+         * @param msg Error message.
+         */
+        void send_error(session_t *session, int code, std::string_view msg);
+
+        /**
+         * @brief Writes uploaded data into temporary file (netascii is decoded).
+         * @returns true in case of success, false otherwise.
+         */
+        bool write_data(session_t *session, const uint8_t *data, size_t len);
+
+        /**
+         * @brief Ends transfer - uploaded file is moved into place (or removed if
+         * transfer has failed), transfer is logged and destroyed.
+         * @param session Transfer.
+         * @param ok Determines if transfer has been successful.
+         */
+        void finish(session_t *session, bool ok);
+
+        /**
+         * @brief Looks up file in memory cache.
+         * @param key Key of file (local path and mode).
+         * @param mtime Time of modification of file on disk.
+         * @param size Size of file on disk.
+         * @returns content of file or empty pointer if it isn't cached (or it has changed).
+         */
+        std::shared_ptr<const std::vector<uint8_t>> lookup(const std::string &key, int64_t mtime, uint64_t size);
+
+        /**
+         * @brief Stores file into memory cache and evicts the least recently used files
+         * if budget is exceeded.
+         */
+        void store(const std::string &key, std::shared_ptr<const std::vector<uint8_t>> data, int64_t mtime,
+            uint64_t size);
+
+        /**
+         * @brief Removes all cached versions of file (it has been uploaded).
+         * @param path Local path of file.
+         */
+        void invalidate(const std::string &path);
+
+        /**
+         * @brief Maps requested file to path relative to served directory.
+         * @param filename Requested file.
+         * @returns relative path or empty string if file lies outside of served directory.
+         */
+        std::string resolve(std::string_view filename);
+
+        /**
+         * @brief Opens file beneath served directory - symlinks cannot lead out of it
+         * (openat2 with RESOLVE_BENEATH, symlinks aren't followed at all on older kernels).
+         * @param relative Path relative to served directory.
+         * @param flags Flags of open.
+         * @returns descriptor or -1 in case of error (errno is set).
+         */
+        int open_beneath(const std::string &relative, int flags);
+
+        /**
+         * @brief Opens directory beneath served directory.
+         * @param relative Path relative to served directory (empty for served directory itself).
+         * @param create Determines if missing directories are created.
+         * @returns descriptor (O_PATH) or -1 in case of error (errno is set).
+         */
+        int open_dir(const std::string &relative, bool create);
+
+        /**
+         * @brief Creates hidden temporary file next to file which it later replaces.
+         * @param dir Directory of file.
+         * @param name Name of file.
+         * @param tmp Variable to store name of temporary file into.
+         * @returns descriptor or -1 in case of error (errno is set).
+         */
+        int create_temp(int dir, std::string_view name, std::string &tmp);
+};
+
+#endif
@@ -0,0 +1,221 @@
+/*
+ * @author Jakub Šuráň (xsuran07)
+ * @file tftp_stream.cpp
+ * @brief Implementation of data sources and sinks - local endpoints of TFTP transfers.
+ */
+
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/ioctl.h>
+#include <linux/fs.h>
+
+#include "tftp_stream.h"
+
+#define COPY_CHUNK (64 * 1024) // size of chunks in which files are passed to sinks
+
+// SINK
+
+bool Tftp_sink::write_file(int fd, uint64_t len)
+{
+    std::vector<uint8_t> buf(std::min<uint64_t>(len, COPY_CHUNK));
+    ssize_t ret;
+
+    while(len > 0) {
+        if((ret = ::read(fd, buf.data(), std::min<uint64_t>(len, buf.size()))) == -1 && errno == EINTR) {
+            continue;
+        }
+
+        // file is shorter than expected
+        if(ret <= 0 || !write({buf.data(), (size_t) ret})) {
+            return false;
+        }
+
+        len -= ret;
+    }
+
+    return true;
+}
+
+// FD SOURCE
+
+Fd_source::~Fd_source()
+{
+    if(this->owner) {
+        close(this->fd);
+    }
+}
+
+ssize_t Fd_source::read(uint8_t *buf, size_t len)
+{
+    ssize_t ret;
+
+    while((ret = ::read(this->fd, buf, len)) == -1 && errno == EINTR);
+
+    return ret;
+}
+
+int64_t Fd_source::size()
+{
+    struct stat st;
+
+    if(fstat(this->fd, &st) == -1 || !S_ISREG(st.st_mode)) {
+        return -1;
+    }
+
+    return st.st_size;
+}
+
+std::unique_ptr<Fd_source> Fd_source::open_file(const std::string &path)
+{
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+
+    if(fd == -1) {
+        return nullptr;
+    }
+
+    return std::make_unique<Fd_source>(fd, true);
+}
+
+// FD SINK
+
+Fd_sink::~Fd_sink()
+{
+    if(this->owner) {
+        close(this->fd);
+    }
+}
+
+bool Fd_sink::write(byte_span_t data)
+{
+    ssize_t ret;
+
+    // write may be partial (e.g. pipes)
+    while(data.size > 0) {
+        if((ret = ::write(this->fd, data.data, data.size)) == -1) {
+            if(errno == EINTR) {
+                continue;
+            }
+
+            return false;
+        }
+
+        data.data += ret;
+        data.size -= ret;
+    }
+
+    return true;
+}
+
+bool Fd_sink::write_file(int fd, uint64_t len)
+{
+    struct stat st;
+    ssize_t ret;
+
+    // extents of empty regular file may be shared with source (btrfs, xfs)
+    if(fstat(this->fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size == 0 &&
+        ioctl(this->fd, FICLONE, fd) == 0) {
+        return lseek(this->fd, len, SEEK_SET) != -1;
+    }
+
+    // in-kernel copy, data don't pass through user space
+    while(len > 0) {
+        if((ret = copy_file_range(fd, nullptr, this->fd, nullptr, len, 0)) == -1) {
+            if(errno == EINTR) {
+                continue;
+            }
+
+            break;
+        }
+
+        // file is shorter than expected
+        if(ret == 0) {
+            return false;
+        }
+
+        len -= ret;
+    }
+
+    // descriptor doesn't support copy_file_range (e.g. pipe)
+    return len == 0 || Tftp_sink::write_file(fd, len);
+}
+
+std::unique_ptr<Fd_sink> Fd_sink::open_file(const std::string &path)
+{
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+
+    if(fd == -1) {
+        return nullptr;
+    }
+
+    return std::make_unique<Fd_sink>(fd, true);
+}
+
+// BUFFERED SINK
+
+Buffered_sink::Buffered_sink(std::unique_ptr<Tftp_sink> next, size_t capacity)
+{
+    this->next = std::move(next);
+    this->capacity = capacity;
+    this->buffer.reserve(capacity);
+}
+
+bool Buffered_sink::write(byte_span_t data)
+{
+    if(this->buffer.size() + data.size > this->capacity && !flush()) {
+        return false;
+    }
+
+    // data which wouldn't fit anyway are passed without copying
+    if(data.size >= this->capacity) {
+        return this->next->write(data);
+    }
+
+    this->buffer.insert(this->buffer.end(), data.data, data.data + data.size);
+    return true;
+}
+
+bool Buffered_sink::write_file(int fd, uint64_t len)
+{
+    return flush() && this->next->write_file(fd, len);
+}
+
+bool Buffered_sink::finish(bool ok)
+{
+    bool flushed = flush();
+
+    return this->next->finish(ok) && flushed;
+}
+
+bool Buffered_sink::flush()
+{
+    bool ret = this->buffer.empty() || this->next->write({this->buffer.data(), this->buffer.size()});
+
+    this->buffer.clear();
+    return ret;
+}
+
+// MEMORY SOURCE
+
+ssize_t Memory_source::read(uint8_t *buf, size_t len)
+{
+    len = std::min(len, this->len - this->pos);
+    memcpy(buf, this->data + this->pos, len);
+    this->pos += len;
+
+    return len;
+}
+
+// MEMORY SINK
+
+bool Memory_sink::write(byte_span_t data)
+{
+    if(this->limit > 0 && this->data.size() + data.size > this->limit) {
+        return false;
+    }
+
+    this->data.insert(this->data.end(), data.data, data.data + data.size);
+    return true;
+}
@@ -0,0 +1,279 @@
+/*
+ * @author Jakub Šuráň (xsuran07)
+ * @file tftp_stream.h
+ * @brief Interface of data sources and sinks - local endpoints of TFTP transfers.
+ */
+
+#ifndef __TFTP_STREAM_H_
+#define __TFTP_STREAM_H_
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <memory>
+#include <algorithm>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "tftp_codec.h"
+
+#define STDOUT_BUFFER (1024 * 1024) // downloaded data are written to stdout in large chunks
+
+/**
+ * @brief Source of data uploaded to server (WRQ).
+ */
+class Tftp_source
+{
+    public:
+        virtual ~Tftp_source() = default;
+
+        /**
+         * @brief Reads next data. Fewer bytes than requested doesn't mean end of data.
+         * @param buf Buffer to store data into.
+         * @param len Size of buffer.
+         * @returns number of stored bytes, 0 at the end of data, -1 on error.
+         */
+        virtual ssize_t read(uint8_t *buf, size_t len) = 0;
+
+        /**
+         * @brief Returns total size of data (for tsize option) or -1 if it isn't known.
+         */
+        virtual int64_t size() { return -1; };
+};
+
+/**
+ * @brief Sink of data downloaded from server (RRQ).
+ */
+class Tftp_sink
+{
+    public:
+        virtual ~Tftp_sink() = default;
+
+        /**
+         * @brief Stores next part of downloaded data.
+         * @param data Data to store (valid only during the call).
+         * @returns true in case of success, false if transfer has to be aborted.
+         */
+        virtual bool write(byte_span_t data) = 0;
+
+        /**
+         * @brief Stores content of local file (e.g. cached copy of downloaded file)
+         * as next part of data. By default file is read and passed to write.
+         * @param fd Descriptor of file opened for reading (positioned at its start).
+         * @param len Size of file.
+         * @returns true in case of success, false if transfer has to be aborted.
+         */
+        virtual bool write_file(int fd, uint64_t len);
+
+        /**
+         * @brief Called once when transfer ends.
+         * @param ok Determines if transfer has been successful.
+         * @returns false if data couldn't be completed (transfer fails), true otherwise.
+         */
+        virtual bool finish(bool ok) { (void) ok; return true; };
+};
+
+/**
+ * @brief Source reading from file descriptor.
+ */
+class Fd_source : public Tftp_source
+{
+    private:
+        int fd;
+        bool owner; // descriptor is closed by destructor
+
+    public:
+        /**
+         * @brief Constructor.
+         * @param fd Descriptor to read from.
+         * @param owner Determines if descriptor should be closed by destructor.
+         */
+        Fd_source(int fd, bool owner = false) : fd(fd), owner(owner) {};
+
+        /**
+         * @brief Destructor. Closes owned descriptor.
+         */
+        ~Fd_source() override;
+
+        Fd_source(const Fd_source &) = delete;
+        Fd_source &operator=(const Fd_source &) = delete;
+
+        ssize_t read(uint8_t *buf, size_t len) override;
+
+        /**
+         * @brief Returns size of regular file, -1 for pipes, sockets, etc.
+         */
+        int64_t size() override;
+
+        /**
+         * @brief Static method. Opens local file for reading.
+         * @param path Path of file.
+         * @returns source owning opened file or nullptr in case of error.
+         */
+        static std::unique_ptr<Fd_source> open_file(const std::string &path);
+};
+
+/**
+ * @brief Sink writing into file descriptor.
+ */
+class Fd_sink : public Tftp_sink
+{
+    private:
+        int fd;
+        bool owner; // descriptor is closed by destructor
+
+    public:
+        /**
+         * @brief Constructor.
+         * @param fd Descriptor to write into.
+         * @param owner Determines if descriptor should be closed by destructor.
+         */
+        Fd_sink(int fd, bool owner = false) : fd(fd), owner(owner) {};
+
+        /**
+         * @brief Destructor. Closes owned descriptor.
+         */
+        ~Fd_sink() override;
+
+        Fd_sink(const Fd_sink &) = delete;
+        Fd_sink &operator=(const Fd_sink &) = delete;
+
+        bool write(byte_span_t data) override;
+
+        /**
+         * @brief Clones file if filesystem supports sharing of extents (reflink),
+         * otherwise data are copied inside kernel.
+         */
+        bool write_file(int fd, uint64_t len) override;
+
+        /**
+         * @brief Static method. Creates (or truncates) local file for writing.
+         * @param path Path of file.
+         * @returns sink owning opened file or nullptr in case of error.
+         */
+        static std::unique_ptr<Fd_sink> open_file(const std::string &path);
+};
+
+/**
+ * @brief Sink collecting small writes into large ones before passing them to
+ * another sink (e.g. pipe on standard output).
+ */
+class Buffered_sink : public Tftp_sink
+{
+    private:
+        std::unique_ptr<Tftp_sink> next;
+        std::vector<uint8_t> buffer;
+        size_t capacity;
+
+    public:
+        /**
+         * @brief Constructor.
+         * @param next Sink to pass data to.
+         * @param capacity Size of buffer.
+         */
+        Buffered_sink(std::unique_ptr<Tftp_sink> next, size_t capacity);
+
+        /**
+         * @brief Stores data into buffer, full buffer is passed to next sink.
+         */
+        bool write(byte_span_t data) override;
+
+        /**
+         * @brief Passes buffered data and then whole file to next sink.
+         */
+        bool write_file(int fd, uint64_t len) override;
+
+        /**
+         * @brief Passes rest of buffered data to next sink and finishes it.
+         */
+        bool finish(bool ok) override;
+
+    private:
+        /**
+         * @brief Passes buffered data to next sink.
+         * @returns true in case of success, false otherwise.
+         */
+        bool flush();
+};
+
+/**
+ * @brief Source reading from memory owned by caller (it has to live till transfer ends).
+ */
+class Memory_source : public Tftp_source
+{
+    private:
+        const uint8_t *data;
+        size_t len;
+        size_t pos;
+
+    public:
+        /**
+         * @brief Constructor.
+         * @param data Data to upload.
+         * @param len Size of data.
+         */
+        Memory_source(const void *data, size_t len) : data((const uint8_t *) data), len(len), pos(0) {};
+
+        ssize_t read(uint8_t *buf, size_t len) override;
+
+        int64_t size() override { return this->len; };
+};
+
+/**
+ * @brief Sink collecting downloaded data in memory.
+ */
+class Memory_sink : public Tftp_sink
+{
+    private:
+        std::vector<uint8_t> data;
+        size_t limit;
+
+    public:
+        /**
+         * @brief Constructor.
+         * @param limit Maximal size of data (transfer is aborted when it is exceeded),
+         * 0 means no limit.
+         */
+        Memory_sink(size_t limit = 0) : limit(limit) {};
+
+        bool write(byte_span_t data) override;
+
+        /**
+         * @brief Getter for downloaded data.
+         */
+        const std::vector<uint8_t> &get_data() const { return this->data; };
+
+        /**
+         * @brief Moves downloaded data out of sink.
+         */
+        std::vector<uint8_t> take_data() { return std::move(this->data); };
+};
+
+/**
+ * @brief Sink passing every received DATA payload to callback without copying.
+ */
+class Callback_sink : public Tftp_sink
+{
+    public:
+        typedef std::function<bool(byte_span_t)> data_cb_t;
+        typedef std::function<bool(bool)> finish_cb_t;
+
+    private:
+        data_cb_t on_data;
+        finish_cb_t on_finish;
+
+    public:
+        /**
+         * @brief Constructor.
+         * @param on_data Called for every part of data, returns false to abort transfer.
+         * @param on_finish Called once transfer ends (optional), see Tftp_sink::finish.
+         */
+        Callback_sink(data_cb_t on_data, finish_cb_t on_finish = nullptr)
+            : on_data(std::move(on_data)), on_finish(std::move(on_finish)) {};
+
+        bool write(byte_span_t data) override { return this->on_data(data); };
+
+        bool finish(bool ok) override { return (this->on_finish)? this->on_finish(ok) : true; };
+};
+
+#endif
@@ -0,0 +1,139 @@
+/*
+ * @author Jakub Šuráň (xsuran07)
+ * @file tftp_sync.cpp
+ * @brief Implementation of record of uploaded files used by sync mode.
+ */
+
+#include <iostream>
+#include <fstream>
+#include <charconv>
+#include <vector>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "tftp_sync.h"
+#include "tftp_checksum.h"
+
+#define DIGEST_CHUNK (256 * 1024) // size of chunks in which local files are read
+
+// PUBLIC INSTANCE METHODS
+
+Tftp_sync &Tftp_sync::instance()
+{
+    static Tftp_sync sync;
+
+    return sync;
+}
+
+bool Tftp_sync::configure(const std::string &path)
+{
+    std::lock_guard<std::mutex> guard(this->lock);
+    std::ifstream in(path);
+    std::string line;
+    int fd;
+
+    // manifest has to be writable, the first run creates it
+    if((fd = open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644)) == -1) {
+        std::cerr << "Cannot open sync manifest " << path << " - " << strerror(errno) << "!" << std::endl;
+        return false;
+    }
+
+    close(fd);
+    this->records.clear();
+
+    // later lines override earlier ones, remote path may contain spaces
+    while(std::getline(in, line)) {
+        size_t first = line.find(' ');
+        size_t second = line.find(' ', first + 1);
+        uint64_t size = 0;
+
+        if(first == std::string::npos || second == std::string::npos ||
+            std::from_chars(line.data() + first + 1, line.data() + second, size).ptr != line.data() + second) {
+            continue;
+        }
+
+        this->records[line.substr(second + 1)] = {size, line.substr(0, first)};
+    }
+
+    this->path = path;
+    return true;
+}
+
+bool Tftp_sync::is_enabled()
+{
+    std::lock_guard<std::mutex> guard(this->lock);
+
+    return !this->path.empty();
+}
+
+bool Tftp_sync::is_unchanged(const std::string &key, uint64_t size, const std::string &digest)
+{
+    std::lock_guard<std::mutex> guard(this->lock);
+    auto it = this->records.find(key);
+
+    return it != this->records.end() && it->second.size == size && it->second.digest == digest;
+}
+
+void Tftp_sync::record(const std::string &key, uint64_t size, const std::string &digest)
+{
+    std::lock_guard<std::mutex> guard(this->lock);
+    std::string line = digest + " " + std::to_string(size) + " " + key + "\n";
+    int fd;
+
+    if(this->path.empty()) {
+        return;
+    }
+
+    this->records[key] = {size, digest};
+
+    // one write per line => lines of more processes aren't mixed
+    if((fd = open(this->path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644)) == -1 ||
+        write(fd, line.data(), line.size()) != (ssize_t) line.size()) {
+        std::cerr << "Cannot record upload into sync manifest " << this->path << "!" << std::endl;
+    }
+
+    if(fd != -1) {
+        close(fd);
+    }
+}
+
+// STATIC METHODS
+
+std::string Tftp_sync::make_key(const std::string &address, int port, const std::string &filename)
+{
+    return address + "," + std::to_string(port) + ":" + filename;
+}
+
+bool Tftp_sync::digest_file(const std::string &path, uint64_t &size, std::string &digest)
+{
+    Tftp_checksum hash(Tftp_parameters::CHECKSUM_XXH3);
+    std::vector<uint8_t> buf(DIGEST_CHUNK);
+    ssize_t n;
+    int fd;
+
+    if((fd = open(path.c_str(), O_RDONLY | O_CLOEXEC)) == -1) {
+        return false;
+    }
+
+    size = 0;
+
+    while((n = read(fd, buf.data(), buf.size())) != 0) {
+        if(n == -1) {
+            if(errno == EINTR) {
+                continue;
+            }
+
+            close(fd);
+            return false;
+        }
+
+        hash.update({buf.data(), (size_t) n});
+        size += n;
+    }
+
+    close(fd);
+    digest = hash.digest();
+    return true;
+}
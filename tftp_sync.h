@@ -0,0 +1,97 @@
+/*
+ * @author Jakub Šuráň (xsuran07)
+ * @file tftp_sync.h
+ * @brief Interface of record of uploaded files used by sync mode.
+ */
+
+#ifndef __TFTP_SYNC_H_
+#define __TFTP_SYNC_H_
+
+#include <string>
+#include <unordered_map>
+#include <mutex>
+#include <stdint.h>
+
+/**
+ * @brief Record of files uploaded in sync mode (option -S). Size and digest
+ * (XXH3) of every successfully uploaded file are appended to manifest, so upload
+ * of unchanged file can be skipped next time without any communication with
+ * server. Manifest is shared by all transfers and it is loaded only once.
+ */
+class Tftp_sync
+{
+    private:
+        /**
+         * @brief Recorded upload.
+         */
+        typedef struct {
+            uint64_t size;
+            std::string digest;
+        } record_t;
+
+        std::string path; // path of manifest, empty if it isn't used
+        std::unordered_map<std::string, record_t> records; // key of file => the last upload
+        std::mutex lock;
+
+    public:
+        /**
+         * @brief Constructor. Uploads aren't recorded until configure is called.
+         */
+        Tftp_sync() = default;
+
+        Tftp_sync(const Tftp_sync &) = delete;
+        Tftp_sync &operator=(const Tftp_sync &) = delete;
+
+        /**
+         * @brief Static method. Returns record shared by all transfers.
+         */
+        static Tftp_sync &instance();
+
+        /**
+         * @brief Loads manifest with lines "digest size address,port:path" (it doesn't
+         * have to exist yet) and appends further uploads to it.
+         * @param path Path of manifest.
+         * @returns true in case of success, false otherwise.
+         */
+        bool configure(const std::string &path);
+
+        /**
+         * @brief Checks if uploads are recorded.
+         */
+        bool is_enabled();
+
+        /**
+         * @brief Checks if file has already been uploaded in the same version.
+         * @param key Key of file (see make_key).
+         * @param size Size of local file.
+         * @param digest Digest of local file.
+         */
+        bool is_unchanged(const std::string &key, uint64_t size, const std::string &digest);
+
+        /**
+         * @brief Records successful upload.
+         * @param key Key of file.
+         * @param size Size of uploaded file.
+         * @param digest Digest of uploaded file.
+         */
+        void record(const std::string &key, uint64_t size, const std::string &digest);
+
+        /**
+         * @brief Static method. Creates key identifying file on server.
+         * @param address Address of server.
+         * @param port Port of server.
+         * @param filename Remote path of file.
+         */
+        static std::string make_key(const std::string &address, int port, const std::string &filename);
+
+        /**
+         * @brief Static method. Computes size and digest of local file.
+         * @param path Path of file.
+         * @param size Variable to store size into.
+         * @param digest Variable to store digest into.
+         * @returns true in case of success, false otherwise.
+         */
+        static bool digest_file(const std::string &path, uint64_t &size, std::string &digest);
+};
+
+#endif
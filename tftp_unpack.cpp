@@ -0,0 +1,707 @@
+/*
+ * @author Jakub Šuráň (xsuran07)
+ * @file tftp_unpack.cpp
+ * @brief Implementation of sinks decompressing and unpacking downloaded data on the fly.
+ */
+
+#include <iostream>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <charconv>
+
+#ifdef TFTP_ZLIB
+#include <zlib.h>
+#endif
+
+#ifdef TFTP_ZSTD
+#include <zstd.h>
+#endif
+
+#include "tftp_unpack.h"
+
+// ASYNC SINK
+
+Async_sink::Async_sink(std::unique_ptr<Tftp_sink> next)
+{
+    this->next = std::move(next);
+    this->queued = 0;
+    this->closed = false;
+    this->cancelled = false;
+    this->failed = false;
+    this->pending.reserve(ASYNC_CHUNK);
+    this->worker = std::thread(&Async_sink::work, this);
+}
+
+Async_sink::~Async_sink()
+{
+    stop(true);
+}
+
+bool Async_sink::write(byte_span_t data)
+{
+    while(data.size > 0) {
+        size_t len = std::min(data.size, ASYNC_CHUNK - this->pending.size());
+
+        this->pending.insert(this->pending.end(), data.data, data.data + len);
+        data.data += len;
+        data.size -= len;
+
+        // data are handed over in large chunks => worker isn't woken up for every block
+        if(this->pending.size() == ASYNC_CHUNK && !push()) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool Async_sink::finish(bool ok)
+{
+    if(ok && !this->pending.empty()) {
+        push();
+    }
+
+    // failed transfer doesn't need the rest of data
+    stop(!ok);
+
+    return this->next->finish(ok && !this->failed) && ok && !this->failed;
+}
+
+bool Async_sink::push()
+{
+    std::unique_lock<std::mutex> guard(this->lock);
+
+    // worker is too slow => wait, otherwise memory would grow without limit
+    this->cond.wait(guard, [this] { return this->queued < ASYNC_LIMIT || this->failed; });
+
+    if(this->failed) {
+        return false;
+    }
+
+    this->queued += this->pending.size();
+    this->queue.push_back(std::move(this->pending));
+    this->pending = std::vector<uint8_t>();
+    this->pending.reserve(ASYNC_CHUNK);
+    this->cond.notify_all();
+
+    return true;
+}
+
+void Async_sink::stop(bool cancel)
+{
+    if(!this->worker.joinable()) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(this->lock);
+
+        this->closed = true;
+        this->cancelled = cancel;
+        this->cond.notify_all();
+    }
+
+    this->worker.join();
+}
+
+void Async_sink::work()
+{
+    std::unique_lock<std::mutex> guard(this->lock);
+
+    while(true) {
+        this->cond.wait(guard, [this] { return !this->queue.empty() || this->closed; });
+
+        if(this->queue.empty() || this->cancelled) {
+            return;
+        }
+
+        std::vector<uint8_t> chunk = std::move(this->queue.front());
+        this->queue.pop_front();
+
+        // next sink runs without lock, so writer can add more data meanwhile
+        guard.unlock();
+        bool ok = this->next->write({chunk.data(), chunk.size()});
+        guard.lock();
+
+        this->queued -= chunk.size();
+        this->cond.notify_all();
+
+        if(!ok) {
+            this->failed = true;
+            this->cond.notify_all();
+            return;
+        }
+    }
+}
+
+// INFLATE SINK
+
+#ifdef TFTP_ZLIB
+
+Inflate_sink::Inflate_sink(std::unique_ptr<Tftp_sink> next)
+{
+    z_stream *zs = new z_stream();
+
+    // 32 means automatic detection of gzip or zlib header
+    if(inflateInit2(zs, 15 + 32) != Z_OK) {
+        delete zs;
+        zs = nullptr;
+    }
+
+    this->next = std::move(next);
+    this->stream = zs;
+    this->ended = false;
+    this->out.resize(UNPACK_BUFFER);
+}
+
+Inflate_sink::~Inflate_sink()
+{
+    z_stream *zs = static_cast<z_stream *> (this->stream);
+
+    if(zs != nullptr) {
+        inflateEnd(zs);
+        delete zs;
+    }
+}
+
+bool Inflate_sink::write(byte_span_t data)
+{
+    z_stream *zs = static_cast<z_stream *> (this->stream);
+    int ret;
+
+    if(zs == nullptr) {
+        return false;
+    }
+
+    zs->next_in = (Bytef *) data.data;
+    zs->avail_in = data.size;
+
+    // full output buffer means that zlib may have more output even without input
+    do {
+        // next member of multi-member gzip file
+        if(this->ended && zs->avail_in > 0) {
+            if(inflateReset(zs) != Z_OK) {
+                return false;
+            }
+
+            this->ended = false;
+        }
+
+        zs->next_out = this->out.data();
+        zs->avail_out = this->out.size();
+
+        ret = inflate(zs, Z_NO_FLUSH);
+        if(ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR) {
+            std::cerr << "Downloaded data aren't valid gzip stream!" << std::endl;
+            return false;
+        }
+
+        size_t len = this->out.size() - zs->avail_out;
+
+        if(len > 0 && !this->next->write({this->out.data(), len})) {
+            return false;
+        }
+
+        this->ended = ret == Z_STREAM_END;
+
+        // the rest of input is buffered inside of zlib
+        if(ret == Z_BUF_ERROR && len == 0) {
+            break;
+        }
+    } while(zs->avail_in > 0 || zs->avail_out == 0);
+
+    return true;
+}
+
+bool Inflate_sink::finish(bool ok)
+{
+    if(ok && !this->ended) {
+        std::cerr << "Downloaded gzip stream is incomplete!" << std::endl;
+        ok = false;
+    }
+
+    return this->next->finish(ok) && ok;
+}
+
+#else
+
+Inflate_sink::Inflate_sink(std::unique_ptr<Tftp_sink> next)
+{
+    this->next = std::move(next);
+    this->stream = nullptr;
+    this->ended = false;
+}
+
+Inflate_sink::~Inflate_sink()
+{
+}
+
+bool Inflate_sink::write(byte_span_t data)
+{
+    (void) data;
+    return false;
+}
+
+bool Inflate_sink::finish(bool ok)
+{
+    (void) ok;
+    return this->next->finish(false) && false;
+}
+
+#endif
+
+// ZSTD SINK
+
+#ifdef TFTP_ZSTD
+
+Zstd_sink::Zstd_sink(std::unique_ptr<Tftp_sink> next)
+{
+    this->next = std::move(next);
+    this->stream = ZSTD_createDStream();
+    this->ended = false;
+    this->out.resize(ZSTD_DStreamOutSize());
+
+    if(this->stream != nullptr && ZSTD_isError(ZSTD_initDStream(static_cast<ZSTD_DStream *> (this->stream)))) {
+        ZSTD_freeDStream(static_cast<ZSTD_DStream *> (this->stream));
+        this->stream = nullptr;
+    }
+}
+
+Zstd_sink::~Zstd_sink()
+{
+    if(this->stream != nullptr) {
+        ZSTD_freeDStream(static_cast<ZSTD_DStream *> (this->stream));
+    }
+}
+
+bool Zstd_sink::write(byte_span_t data)
+{
+    ZSTD_inBuffer in = {data.data, data.size, 0};
+    size_t ret;
+
+    if(this->stream == nullptr) {
+        return false;
+    }
+
+    ZSTD_outBuffer out = {this->out.data(), this->out.size(), 0};
+
+    // full output buffer means that zstd may have more output even without input
+    while(in.pos < in.size || out.pos == out.size) {
+        out.pos = 0;
+
+        ret = ZSTD_decompressStream(static_cast<ZSTD_DStream *> (this->stream), &out, &in);
+        if(ZSTD_isError(ret)) {
+            std::cerr << "Downloaded data aren't valid zstd stream!" << std::endl;
+            return false;
+        }
+
+        if(out.pos > 0 && !this->next->write({this->out.data(), out.pos})) {
+            return false;
+        }
+
+        // 0 means that frame has been completed and flushed
+        this->ended = ret == 0;
+    }
+
+    return true;
+}
+
+bool Zstd_sink::finish(bool ok)
+{
+    if(ok && !this->ended) {
+        std::cerr << "Downloaded zstd stream is incomplete!" << std::endl;
+        ok = false;
+    }
+
+    return this->next->finish(ok) && ok;
+}
+
+bool Zstd_sink::is_available()
+{
+    return true;
+}
+
+#else
+
+Zstd_sink::Zstd_sink(std::unique_ptr<Tftp_sink> next)
+{
+    this->next = std::move(next);
+    this->stream = nullptr;
+    this->ended = false;
+}
+
+Zstd_sink::~Zstd_sink()
+{
+}
+
+bool Zstd_sink::write(byte_span_t data)
+{
+    (void) data;
+    return false;
+}
+
+bool Zstd_sink::finish(bool ok)
+{
+    (void) ok;
+    return this->next->finish(false) && false;
+}
+
+bool Zstd_sink::is_available()
+{
+    return false;
+}
+
+#endif
+
+// UNTAR SINK
+
+Untar_sink::Untar_sink(const std::string &dir)
+{
+    this->dir = (dir.empty())? "." : dir;
+    this->state = TAR_HEADER;
+    this->header_len = 0;
+    this->remaining = 0;
+    this->padding = 0;
+    this->fd = -1;
+    this->type = 0;
+    this->zero_blocks = 0;
+}
+
+Untar_sink::~Untar_sink()
+{
+    if(this->fd != -1) {
+        close(this->fd);
+    }
+}
+
+bool Untar_sink::write(byte_span_t data)
+{
+    while(data.size > 0) {
+        size_t len;
+
+        switch(this->state) {
+        case TAR_HEADER:
+            len = std::min(data.size, TAR_BLOCK - this->header_len);
+            memcpy(this->header + this->header_len, data.data, len);
+            this->header_len += len;
+
+            if(this->header_len == TAR_BLOCK && !process_header()) {
+                return false;
+            }
+            break;
+        case TAR_DATA:
+            len = std::min<uint64_t>(data.size, this->remaining);
+
+            if(!process_data({data.data, len})) {
+                return false;
+            }
+            break;
+        case TAR_PADDING:
+            len = std::min<uint64_t>(data.size, this->remaining);
+            this->remaining -= len;
+
+            if(this->remaining == 0) {
+                this->state = TAR_HEADER;
+            }
+            break;
+        default:
+            // everything after end of archive is ignored
+            return true;
+        }
+
+        data.data += len;
+        data.size -= len;
+    }
+
+    return true;
+}
+
+bool Untar_sink::finish(bool ok)
+{
+    if(this->fd != -1) {
+        ok = close(this->fd) == 0 && ok;
+        this->fd = -1;
+    }
+
+    // archive may end without zero blocks, but not in the middle of entry
+    if(ok && (this->state != TAR_END && (this->state != TAR_HEADER || this->header_len != 0))) {
+        std::cerr << "Downloaded archive is incomplete!" << std::endl;
+        return false;
+    }
+
+    return ok;
+}
+
+bool Untar_sink::process_header()
+{
+    std::string name;
+    uint64_t size;
+    uint64_t mode;
+
+    this->header_len = 0;
+
+    // two zero blocks mark end of archive
+    if(std::all_of(this->header, this->header + TAR_BLOCK, [](uint8_t c) { return c == 0; })) {
+        if(++this->zero_blocks == 2) {
+            this->state = TAR_END;
+        }
+
+        return true;
+    }
+
+    this->zero_blocks = 0;
+
+    if(!parse_octal(this->header + 124, 12, size) || !parse_octal(this->header + 100, 8, mode)) {
+        std::cerr << "Downloaded data aren't valid tar archive!" << std::endl;
+        return false;
+    }
+
+    this->type = this->header[156];
+    this->remaining = size;
+    this->padding = (TAR_BLOCK - size % TAR_BLOCK) % TAR_BLOCK;
+    this->state = (size > 0)? TAR_DATA : TAR_HEADER;
+    this->meta.clear();
+
+    // long name of the next entry
+    if(this->type == 'L' || this->type == 'x') {
+        return true;
+    }
+
+    if(!this->long_name.empty()) {
+        name.swap(this->long_name);
+    } else {
+        // ustar splits long names into prefix and name
+        name.assign((const char *) this->header, strnlen((const char *) this->header, 100));
+        if(memcmp(this->header + 257, "ustar", 5) == 0 && this->header[345] != '\0') {
+            name = std::string((const char *) this->header + 345, strnlen((const char *) this->header + 345, 155)) + "/" + name;
+        }
+    }
+
+    // regular files and directories only, links could point anywhere
+    if(this->type != '0' && this->type != '\0' && this->type != '5') {
+        return true;
+    }
+
+    if(!is_safe(name)) {
+        std::cerr << "Entry \"" << name << "\" of archive is refused - it leads outside of directory!" << std::endl;
+        return true;
+    }
+
+    std::string path = this->dir + "/" + name;
+
+    if(this->type == '5') {
+        return Tftp_parameters::make_dirs(path + "/", this->dir.size());
+    }
+
+    if(!Tftp_parameters::make_dirs(path, this->dir.size())) {
+        return false;
+    }
+
+    this->fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, (mode & 0777) | 0600);
+    if(this->fd == -1) {
+        std::cerr << "Cannot create file \"" << name << "\" - " << strerror(errno) << "!" << std::endl;
+        return false;
+    }
+
+    // empty file is complete right now
+    if(size == 0) {
+        close(this->fd);
+        this->fd = -1;
+    }
+
+    return true;
+}
+
+bool Untar_sink::process_data(byte_span_t data)
+{
+    ssize_t ret;
+
+    if(this->type == 'L' || this->type == 'x') {
+        this->meta.append((const char *) data.data, data.size);
+    }
+
+    for(size_t pos = 0; this->fd != -1 && pos < data.size; pos += ret) {
+        if((ret = ::write(this->fd, data.data + pos, data.size - pos)) == -1) {
+            if(errno == EINTR) {
+                ret = 0;
+                continue;
+            }
+
+            std::cerr << "Cannot write extracted file - " << strerror(errno) << "!" << std::endl;
+            return false;
+        }
+    }
+
+    this->remaining -= data.size;
+    if(this->remaining > 0) {
+        return true;
+    }
+
+    // entry is complete
+    if(this->fd != -1) {
+        if(close(this->fd) != 0) {
+            this->fd = -1;
+            return false;
+        }
+
+        this->fd = -1;
+    }
+
+    process_meta();
+
+    this->remaining = this->padding;
+    this->state = (this->padding > 0)? TAR_PADDING : TAR_HEADER;
+    return true;
+}
+
+void Untar_sink::process_meta()
+{
+    size_t pos = 0;
+
+    if(this->type == 'L') {
+        this->long_name.assign(this->meta.c_str());
+        return;
+    }
+
+    if(this->type != 'x') {
+        return;
+    }
+
+    // pax records have format "length key=value\n"
+    while(pos < this->meta.size()) {
+        size_t space = this->meta.find(' ', pos);
+        size_t len = 0;
+
+        auto ret = std::from_chars(this->meta.data() + pos, this->meta.data() + this->meta.size(), len);
+        if(space == std::string::npos || ret.ptr != this->meta.data() + space || len == 0 ||
+                pos + len > this->meta.size() || space + 2 > pos + len) {
+            return;
+        }
+
+        std::string_view record(this->meta.data() + space + 1, pos + len - space - 2);
+
+        if(record.substr(0, 5) == "path=") {
+            this->long_name = record.substr(5);
+        }
+
+        pos += len;
+    }
+}
+
+bool Untar_sink::is_safe(const std::string &path)
+{
+    std::vector<std::string_view> parts;
+
+    if(path.empty() || path.front() == '/') {
+        return false;
+    }
+
+    Tftp_parameters::split_string(path, '/', parts);
+
+    return std::none_of(parts.begin(), parts.end(), [](std::string_view part) { return part == ".."; });
+}
+
+bool Untar_sink::parse_octal(const uint8_t *field, size_t len, uint64_t &res)
+{
+    size_t pos = 0;
+
+    res = 0;
+
+    // leading spaces are allowed, number ends by space or \0
+    while(pos < len && field[pos] == ' ') {
+        pos++;
+    }
+
+    for(; pos < len && field[pos] >= '0' && field[pos] <= '7'; pos++) {
+        res = res * 8 + (field[pos] - '0');
+    }
+
+    return pos == len || field[pos] == ' ' || field[pos] == '\0';
+}
+
+// TFTP UNPACK
+
+std::shared_ptr<Tftp_sink> Tftp_unpack::create(const Tftp_parameters &params)
+{
+    Tftp_parameters::unpack_t unpack = params.get_unpack();
+    std::unique_ptr<Tftp_sink> sink;
+    std::string local = local_name(params);
+
+    bool tar = unpack == Tftp_parameters::UNPACK_TAR || unpack == Tftp_parameters::UNPACK_TAR_GZIP ||
+        unpack == Tftp_parameters::UNPACK_TAR_ZSTD;
+    bool gzip = unpack == Tftp_parameters::UNPACK_GZIP || unpack == Tftp_parameters::UNPACK_TAR_GZIP;
+    bool zstd = unpack == Tftp_parameters::UNPACK_ZSTD || unpack == Tftp_parameters::UNPACK_TAR_ZSTD;
+
+#ifndef TFTP_ZLIB
+    if(gzip) {
+        std::cerr << "Support of gzip hasn't been compiled in!" << std::endl;
+        return nullptr;
+    }
+#endif
+
+    if(zstd && !Zstd_sink::is_available()) {
+        std::cerr << "Support of zstd hasn't been compiled in!" << std::endl;
+        return nullptr;
+    }
+
+    // the last stage stores expanded data
+    if(tar) {
+        struct stat st;
+
+        if(stat(local.c_str(), &st) == -1 || !S_ISDIR(st.st_mode)) {
+            std::cerr << "Directory \"" << local << "\" for extracted archive doesn't exist!" << std::endl;
+            return nullptr;
+        }
+
+        sink = std::make_unique<Untar_sink>(local);
+    } else if(params.is_stdio()) {
+        sink = std::make_unique<Buffered_sink>(std::make_unique<Fd_sink>(STDOUT_FILENO), STDOUT_BUFFER);
+    } else if(!(sink = Fd_sink::open_file(local))) {
+        std::cerr << "Opening of file \"" + local + "\" failed!" << std::endl;
+        return nullptr;
+    }
+
+    if(gzip) {
+        sink = std::make_unique<Inflate_sink>(std::move(sink));
+    } else if(zstd) {
+        sink = std::make_unique<Zstd_sink>(std::move(sink));
+    }
+
+    // decompression runs in parallel with receiving of data
+    return std::make_shared<Async_sink>(std::move(sink));
+}
+
+std::string Tftp_unpack::local_name(const Tftp_parameters &params)
+{
+    std::vector<std::string_view> parts;
+    std::string_view name;
+
+    if(!params.get_local().empty()) {
+        return params.get_local();
+    }
+
+    // archive is extracted into current directory
+    switch(params.get_unpack()) {
+    case Tftp_parameters::UNPACK_TAR:
+    case Tftp_parameters::UNPACK_TAR_GZIP:
+    case Tftp_parameters::UNPACK_TAR_ZSTD:
+        return ".";
+    default:
+        break;
+    }
+
+    Tftp_parameters::split_string(params.get_filename(), '/', parts);
+    name = parts.back();
+
+    for(std::string_view suffix : {".gz", ".zst"}) {
+        if(name.size() > suffix.size() && name.substr(name.size() - suffix.size()) == suffix) {
+            name.remove_suffix(suffix.size());
+            break;
+        }
+    }
+
+    return std::string(name);
+}
@@ -0,0 +1,267 @@
+/*
+ * @author Jakub Šuráň (xsuran07)
+ * @file tftp_unpack.h
+ * @brief Interface of sinks decompressing and unpacking downloaded data on the fly.
+ */
+
+#ifndef __TFTP_UNPACK_H_
+#define __TFTP_UNPACK_H_
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <stdint.h>
+
+#include "tftp_stream.h"
+#include "tftp_parameters.h"
+
+#define ASYNC_CHUNK (64 * 1024) // data are passed to worker thread in chunks of this size
+#define ASYNC_LIMIT (16 * 1024 * 1024) // maximal amount of data waiting for worker thread
+#define UNPACK_BUFFER (64 * 1024) // size of buffer for decompressed data
+#define TAR_BLOCK 512
+
+/**
+ * @brief Sink passing data to another sink running on separate thread, so slow
+ * processing (e.g. decompression) doesn't delay acknowledging of received blocks.
+ * Writer blocks only when too much data waits for worker thread.
+ */
+class Async_sink : public Tftp_sink
+{
+    private:
+        std::unique_ptr<Tftp_sink> next;
+        std::thread worker;
+        std::mutex lock;
+        std::condition_variable cond;
+        std::deque<std::vector<uint8_t>> queue;
+        std::vector<uint8_t> pending; // chunk being filled by writer
+        size_t queued; // number of bytes in queue
+        bool closed; // writer won't add more data
+        bool cancelled; // queued data should be dropped
+        bool failed; // next sink has failed
+
+    public:
+        /**
+         * @brief Constructor. Starts worker thread.
+         * @param next Sink to pass data to (it is used only by worker thread).
+         */
+        Async_sink(std::unique_ptr<Tftp_sink> next);
+
+        /**
+         * @brief Destructor. Stops worker thread if transfer hasn't been finished.
+         */
+        ~Async_sink() override;
+
+        Async_sink(const Async_sink &) = delete;
+        Async_sink &operator=(const Async_sink &) = delete;
+
+        bool write(byte_span_t data) override;
+
+        /**
+         * @brief Waits till worker thread processes all data and finishes next sink.
+         */
+        bool finish(bool ok) override;
+
+    private:
+        /**
+         * @brief Moves filled chunk into queue (waits if queue is full).
+         * @returns false if next sink has failed, true otherwise.
+         */
+        bool push();
+
+        /**
+         * @brief Stops worker thread.
+         * @param cancel Determines if queued data should be dropped.
+         */
+        void stop(bool cancel);
+
+        /**
+         * @brief Body of worker thread.
+         */
+        void work();
+};
+
+/**
+ * @brief Sink decompressing gzip (or zlib) stream, possibly with more members.
+ */
+class Inflate_sink : public Tftp_sink
+{
+    private:
+        std::unique_ptr<Tftp_sink> next;
+        void *stream; // z_stream, zlib isn't exposed to users of this header
+        bool ended; // end of compressed stream has been reached
+        std::vector<uint8_t> out;
+
+    public:
+        /**
+         * @brief Constructor.
+         * @param next Sink to pass decompressed data to.
+         */
+        Inflate_sink(std::unique_ptr<Tftp_sink> next);
+
+        /**
+         * @brief Destructor.
+         */
+        ~Inflate_sink() override;
+
+        Inflate_sink(const Inflate_sink &) = delete;
+        Inflate_sink &operator=(const Inflate_sink &) = delete;
+
+        bool write(byte_span_t data) override;
+
+        /**
+         * @brief Checks that compressed stream is complete and finishes next sink.
+         */
+        bool finish(bool ok) override;
+};
+
+/**
+ * @brief Sink decompressing zstd stream (available only if library
+ * has been built with zstd).
+ */
+class Zstd_sink : public Tftp_sink
+{
+    private:
+        std::unique_ptr<Tftp_sink> next;
+        void *stream; // ZSTD_DStream
+        bool ended; // the last frame has been completed
+        std::vector<uint8_t> out;
+
+    public:
+        /**
+         * @brief Constructor.
+         * @param next Sink to pass decompressed data to.
+         */
+        Zstd_sink(std::unique_ptr<Tftp_sink> next);
+
+        /**
+         * @brief Destructor.
+         */
+        ~Zstd_sink() override;
+
+        Zstd_sink(const Zstd_sink &) = delete;
+        Zstd_sink &operator=(const Zstd_sink &) = delete;
+
+        bool write(byte_span_t data) override;
+
+        /**
+         * @brief Checks that compressed stream is complete and finishes next sink.
+         */
+        bool finish(bool ok) override;
+
+        /**
+         * @brief Static method. Checks if zstd is available.
+         */
+        static bool is_available();
+};
+
+/**
+ * @brief Sink extracting tar archive (ustar with GNU and pax long names) into
+ * directory. Only regular files and directories are extracted, entries leading
+ * outside of directory are refused.
+ */
+class Untar_sink : public Tftp_sink
+{
+    private:
+        /**
+         * @brief States of parsing of archive.
+         */
+        typedef enum {
+            TAR_HEADER,
+            TAR_DATA,
+            TAR_PADDING,
+            TAR_END,
+        } tar_state_t;
+
+        std::string dir;
+        tar_state_t state;
+        uint8_t header[TAR_BLOCK];
+        size_t header_len;
+        uint64_t remaining; // bytes of current entry (or its padding) to process
+        uint64_t padding; // padding following data of current entry
+        int fd; // extracted file, -1 if data of entry are skipped
+        char type; // type flag of current entry
+        std::string meta; // data of entry with long name of the next one
+        std::string long_name; // name given by previous GNU or pax entry
+        size_t zero_blocks;
+
+    public:
+        /**
+         * @brief Constructor.
+         * @param dir Directory to extract archive into.
+         */
+        Untar_sink(const std::string &dir);
+
+        /**
+         * @brief Destructor. Closes extracted file.
+         */
+        ~Untar_sink() override;
+
+        Untar_sink(const Untar_sink &) = delete;
+        Untar_sink &operator=(const Untar_sink &) = delete;
+
+        bool write(byte_span_t data) override;
+
+        /**
+         * @brief Checks that archive is complete.
+         */
+        bool finish(bool ok) override;
+
+    private:
+        /**
+         * @brief Processes complete header of entry.
+         * @returns true in case of success, false otherwise.
+         */
+        bool process_header();
+
+        /**
+         * @brief Processes data of current entry.
+         * @param data Data of entry.
+         * @returns true in case of success, false otherwise.
+         */
+        bool process_data(byte_span_t data);
+
+        /**
+         * @brief Processes complete data of entry with long name of the next one.
+         */
+        void process_meta();
+
+        /**
+         * @brief Static method. Checks that path doesn't lead outside of target directory.
+         */
+        static bool is_safe(const std::string &path);
+
+        /**
+         * @brief Static method. Parses octal number from header field.
+         * @returns true in case of success, false otherwise.
+         */
+        static bool parse_octal(const uint8_t *field, size_t len, uint64_t &res);
+};
+
+/**
+ * @brief Builds sink pipelines for unpacking of downloaded data.
+ */
+class Tftp_unpack
+{
+    public:
+        /**
+         * @brief Static method. Creates sink which unpacks data according to
+         * given parameters and stores result into local file, standard output
+         * or directory (tar). Unpacking runs on separate thread.
+         * @param params Parameters of transfer.
+         * @returns created sink or nullptr in case of error.
+         */
+        static std::shared_ptr<Tftp_sink> create(const Tftp_parameters &params);
+
+        /**
+         * @brief Static method. Derives name of local file from name of remote
+         * file - suffix of compression is removed.
+         * @param params Parameters of transfer.
+         */
+        static std::string local_name(const Tftp_parameters &params);
+};
+
+#endif
@@ -0,0 +1,335 @@
+/*
+ * @author Jakub Šuráň (xsuran07)
+ * @file tftp_watch.cpp
+ * @brief Implementation of watch mode uploading changed files.
+ */
+
+#include <iostream>
+#include <algorithm>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <signal.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/epoll.h>
+#include <sys/inotify.h>
+#include <sys/signalfd.h>
+
+#include "tftp_watch.h"
+
+#define MAX_EVENTS 16
+#define EVENT_BUFFER (64 * 1024)
+#define WATCH_MASK (IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_DELETE_SELF | IN_MOVE_SELF)
+
+#define ID_INOTIFY 0 // epoll identifier of inotify descriptor
+#define ID_SIGNAL 1 // epoll identifier of signal descriptor
+#define ID_ENGINE 2 // epoll identifier of engine
+
+// HELPERS
+
+// PUBLIC INSTANCE METHODS
+
+// constructor
+Tftp_watch::Tftp_watch(const std::vector<std::string> &roots, const Tftp_parameters &tmpl, size_t concurrency,
+    int64_t debounce)
+{
+    this->roots = roots;
+    this->tmpl = tmpl;
+    this->concurrency = (concurrency > 0)? concurrency : WATCH_CONCURRENCY;
+    this->debounce = debounce;
+    this->ifd = -1;
+    this->sfd = -1;
+    this->epfd = -1;
+    this->running = false;
+    this->jobs = 0;
+    this->failed = 0;
+}
+
+// destructor
+Tftp_watch::~Tftp_watch()
+{
+    if(this->ifd != -1) {
+        close(this->ifd);
+    }
+
+    if(this->sfd != -1) {
+        close(this->sfd);
+    }
+
+    if(this->epfd != -1) {
+        close(this->epfd);
+    }
+}
+
+bool Tftp_watch::run()
+{
+    struct epoll_event events[MAX_EVENTS];
+    struct signalfd_siginfo info;
+    int n;
+
+    if(!init()) {
+        return false;
+    }
+
+    while(this->running || this->engine.get_active() > 0) {
+        // drive uploads - it also arms timers of newly started ones
+        this->engine.step(0);
+
+        if(this->running) {
+            start_uploads();
+        }
+
+        if((n = epoll_wait(this->epfd, events, MAX_EVENTS, (this->running)? next_wait() : -1)) == -1) {
+            if(errno != EINTR) {
+                std::cerr << "epoll_wait() failed!" << std::endl;
+                return false;
+            }
+
+            n = 0;
+        }
+
+        for(int i = 0; i < n; i++) {
+            if(events[i].data.u64 == ID_INOTIFY) {
+                handle_events();
+            } else if(events[i].data.u64 == ID_SIGNAL && read(this->sfd, &info, sizeof(info)) == sizeof(info)) {
+                // waiting files aren't uploaded, running uploads are finished
+                this->running = false;
+            }
+        }
+    }
+
+    return true;
+}
+
+// PRIVATE INSTANCE METHODS
+
+bool Tftp_watch::init()
+{
+    struct epoll_event ev;
+    sigset_t mask;
+
+    if(this->engine.get_fd() == -1) {
+        return false;
+    }
+
+    if((this->ifd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC)) == -1) {
+        std::cerr << "inotify_init1() failed - " << strerror(errno) << "!" << std::endl;
+        return false;
+    }
+
+    // signals end watching in order (they are delivered only through descriptor)
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGINT);
+    sigaddset(&mask, SIGTERM);
+
+    if(sigprocmask(SIG_BLOCK, &mask, nullptr) == -1 || (this->sfd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC)) == -1) {
+        std::cerr << "signalfd() failed!" << std::endl;
+        return false;
+    }
+
+    if((this->epfd = epoll_create1(EPOLL_CLOEXEC)) == -1) {
+        std::cerr << "epoll_create1() failed!" << std::endl;
+        return false;
+    }
+
+    ev.events = EPOLLIN;
+    ev.data.u64 = ID_INOTIFY;
+    if(epoll_ctl(this->epfd, EPOLL_CTL_ADD, this->ifd, &ev) == -1) {
+        std::cerr << "epoll_ctl() failed!" << std::endl;
+        return false;
+    }
+
+    ev.data.u64 = ID_SIGNAL;
+    if(epoll_ctl(this->epfd, EPOLL_CTL_ADD, this->sfd, &ev) == -1) {
+        std::cerr << "epoll_ctl() failed!" << std::endl;
+        return false;
+    }
+
+    // engine is nested - its epoll descriptor is readable when transfers need attention
+    ev.data.u64 = ID_ENGINE;
+    if(epoll_ctl(this->epfd, EPOLL_CTL_ADD, this->engine.get_fd(), &ev) == -1) {
+        std::cerr << "epoll_ctl() failed!" << std::endl;
+        return false;
+    }
+
+    for(auto &root : this->roots) {
+        if(!add_watch(root, root, false)) {
+            return false;
+        }
+    }
+
+    this->running = true;
+    return true;
+}
+
+bool Tftp_watch::add_watch(const std::string &root, const std::string &path, bool enqueue)
+{
+    struct dirent *entry;
+    DIR *dir;
+    int wd;
+
+    if((wd = inotify_add_watch(this->ifd, path.c_str(), WATCH_MASK | IN_ONLYDIR)) == -1) {
+        std::cerr << "Cannot watch directory " << path << " - " << strerror(errno) << "!" << std::endl;
+        return false;
+    }
+
+    this->watches[wd] = {root, path};
+
+    // subdirectories are watched too, directory is read only once
+    if((dir = opendir(path.c_str())) == nullptr) {
+        return true;
+    }
+
+    while((entry = readdir(dir)) != nullptr) {
+        std::string name(entry->d_name);
+        std::string child = Tftp_parameters::join_path(path, name);
+        struct stat st;
+
+        if(name == "." || name == ".." || lstat(child.c_str(), &st) == -1) {
+            continue;
+        }
+
+        if(S_ISDIR(st.st_mode)) {
+            add_watch(root, child, enqueue);
+        } else if(enqueue && S_ISREG(st.st_mode)) {
+            this->enqueue(root, child);
+        }
+    }
+
+    closedir(dir);
+    return true;
+}
+
+void Tftp_watch::handle_events()
+{
+    alignas(struct inotify_event) char buf[EVENT_BUFFER];
+    ssize_t n;
+
+    while((n = read(this->ifd, buf, sizeof(buf))) > 0) {
+        for(char *ptr = buf; ptr < buf + n; ptr += sizeof(struct inotify_event) + ((struct inotify_event *) ptr)->len) {
+            struct inotify_event *event = (struct inotify_event *) ptr;
+
+            // events have been lost => all files are uploaded again (sync mode skips unchanged ones)
+            if(event->mask & IN_Q_OVERFLOW) {
+                std::cerr << "Events of watched directories have been lost - uploading all files!" << std::endl;
+
+                for(auto &root : this->roots) {
+                    add_watch(root, root, true);
+                }
+
+                continue;
+            }
+
+            auto it = this->watches.find(event->wd);
+
+            if(it == this->watches.end()) {
+                continue;
+            }
+
+            // directory has gone, its watch is removed by kernel
+            if(event->mask & (IN_IGNORED | IN_DELETE_SELF | IN_MOVE_SELF)) {
+                if(event->mask & IN_IGNORED) {
+                    this->watches.erase(it);
+                }
+
+                continue;
+            }
+
+            if(event->len == 0) {
+                continue;
+            }
+
+            watch_t watch = it->second;
+            std::string path = Tftp_parameters::join_path(watch.path, event->name);
+
+            // new directory may already contain files
+            if(event->mask & IN_ISDIR) {
+                if(event->mask & (IN_CREATE | IN_MOVED_TO)) {
+                    add_watch(watch.root, path, true);
+                }
+            } else if(event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) {
+                enqueue(watch.root, path);
+            }
+        }
+    }
+}
+
+void Tftp_watch::enqueue(const std::string &root, const std::string &path)
+{
+    std::string relative = path.substr(root.size());
+
+    if(!relative.empty() && relative.front() == '/') {
+        relative.erase(0, 1);
+    }
+
+    // rewrite of file postpones its upload
+    this->pending[path] = {Tftp_parameters::join_path(this->tmpl.get_filename(), relative),
+        Tftp_client::now_ms() + this->debounce};
+}
+
+void Tftp_watch::start_uploads()
+{
+    int64_t now = Tftp_client::now_ms();
+
+    for(auto it = this->pending.begin(); it != this->pending.end() && this->uploading.size() < this->concurrency;) {
+        Tftp_parameters::params_t values = this->tmpl.get_values();
+        Tftp_parameters params;
+        struct stat st;
+
+        // file is still changing or its previous version is being uploaded
+        if(it->second.due > now || this->uploading.count(it->first) > 0) {
+            it++;
+            continue;
+        }
+
+        std::string path = it->first;
+
+        values.filename = it->second.remote;
+        values.local = path;
+        it = this->pending.erase(it);
+
+        // temporary files are usually renamed or removed before upload
+        if(stat(path.c_str(), &st) == -1 || !S_ISREG(st.st_mode) || !params.set_values(values)) {
+            continue;
+        }
+
+        size_t id = this->jobs++;
+        int64_t started = Tftp_client::now_ms();
+
+        this->uploading.insert(path);
+
+        // callback is called during stepping of engine, never from inside of add
+        this->engine.add(params, [this, id, path, started](Tftp_client &client) {
+            Tftp_executor::result_t result = Tftp_executor::make_result(id, client, started);
+
+            this->uploading.erase(path);
+            this->failed += !result.ok;
+
+            if(this->on_result) {
+                this->on_result(result);
+            }
+        });
+    }
+}
+
+int64_t Tftp_watch::next_wait()
+{
+    int64_t now = Tftp_client::now_ms();
+    int64_t wait = -1;
+
+    // files waiting for free slot are started when some upload ends (engine wakes loop)
+    if(this->uploading.size() >= this->concurrency) {
+        return -1;
+    }
+
+    for(auto &file : this->pending) {
+        if(this->uploading.count(file.first) == 0) {
+            int64_t left = std::max<int64_t>(file.second.due - now, 0);
+
+            wait = (wait < 0)? left : std::min(wait, left);
+        }
+    }
+
+    return wait;
+}
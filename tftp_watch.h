@@ -0,0 +1,152 @@
+/*
+ * @author Jakub Šuráň (xsuran07)
+ * @file tftp_watch.h
+ * @brief Interface of watch mode uploading changed files.
+ */
+
+#ifndef __TFTP_WATCH_H_
+#define __TFTP_WATCH_H_
+
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <unordered_map>
+#include <functional>
+#include <stdint.h>
+
+#include "tftp_engine.h"
+#include "tftp_executor.h"
+
+#define WATCH_DEBOUNCE 500 // ms without change after which file is uploaded
+#define WATCH_CONCURRENCY 4 // default maximum of concurrent uploads
+
+/**
+ * @brief Watch mode - local directories are watched by inotify (recursively)
+ * and every file which has been written or moved into them is uploaded to
+ * server. Upload starts once file hasn't changed for debounce interval, so
+ * burst of rewrites of the same file results in one transfer. File changed
+ * again while it is being uploaded is uploaded once more after that. Uploads
+ * are run by one engine with bounded number of concurrent transfers. Remote
+ * path is given by path of file relative to watched directory appended to
+ * remote path of template request. Mode ends on SIGINT or SIGTERM once running
+ * uploads end.
+ */
+class Tftp_watch
+{
+    public:
+        /**
+         * @brief Callback called for result of every upload.
+         */
+        typedef std::function<void(const Tftp_executor::result_t &result)> report_cb_t;
+
+    private:
+        /**
+         * @brief Watched directory.
+         */
+        typedef struct {
+            std::string root; // watched directory given by user
+            std::string path; // this directory (root or its subdirectory)
+        } watch_t;
+
+        /**
+         * @brief File waiting for upload.
+         */
+        typedef struct {
+            std::string remote; // remote path of file
+            int64_t due; // time when file may be uploaded (ms)
+        } pending_t;
+
+        std::vector<std::string> roots;
+        Tftp_parameters tmpl; // template request, remote path of files is prefixed by its path
+        size_t concurrency;
+        int64_t debounce;
+        int ifd; // inotify descriptor
+        int sfd; // signal descriptor
+        int epfd;
+        bool running;
+        Tftp_engine engine;
+        std::unordered_map<int, watch_t> watches; // watch descriptor => directory
+        std::map<std::string, pending_t> pending; // local path => file waiting for upload
+        std::set<std::string> uploading; // local paths of running uploads
+        report_cb_t on_result;
+        size_t jobs; // number of started uploads
+        size_t failed;
+
+    public:
+        /**
+         * @brief Constructor.
+         * @param roots Directories to watch.
+         * @param tmpl Template request (upload) - its path is prefix of remote paths.
+         * @param concurrency Maximum of concurrent uploads (0 means default).
+         * @param debounce Time in ms without change after which file is uploaded.
+         */
+        Tftp_watch(const std::vector<std::string> &roots, const Tftp_parameters &tmpl, size_t concurrency = 0,
+            int64_t debounce = WATCH_DEBOUNCE);
+
+        /**
+         * @brief Destructor.
+         */
+        ~Tftp_watch();
+
+        Tftp_watch(const Tftp_watch &) = delete;
+        Tftp_watch &operator=(const Tftp_watch &) = delete;
+
+        /**
+         * @brief Setter for callback called for result of every upload.
+         */
+        void set_report(report_cb_t on_result) { this->on_result = on_result; };
+
+        /**
+         * @brief Watches directories and uploads changed files till SIGINT or SIGTERM.
+         * @returns true if watch mode ended properly, false if it couldn't be started.
+         */
+        bool run();
+
+        /**
+         * @brief Getter for number of uploads which haven't been successful.
+         */
+        size_t get_failed() { return this->failed; };
+
+    private:
+        /**
+         * @brief Creates inotify, signal and epoll descriptors and watches all directories.
+         * @returns true in case of success, false otherwise.
+         */
+        bool init();
+
+        /**
+         * @brief Watches directory and all its subdirectories.
+         * @param root Watched directory given by user.
+         * @param path Directory to watch.
+         * @param enqueue Determines if files already present in directories are uploaded
+         * (directory has been created or moved into watched tree).
+         * @returns true in case of success, false otherwise.
+         */
+        bool add_watch(const std::string &root, const std::string &path, bool enqueue);
+
+        /**
+         * @brief Reads and handles all pending inotify events.
+         */
+        void handle_events();
+
+        /**
+         * @brief Schedules upload of file (or postpones it if it is already scheduled).
+         * @param root Watched directory containing file.
+         * @param path Local path of file.
+         */
+        void enqueue(const std::string &root, const std::string &path);
+
+        /**
+         * @brief Starts uploads of files which haven't changed for debounce interval
+         * (as long as concurrency allows).
+         */
+        void start_uploads();
+
+        /**
+         * @brief Returns time to wait for the nearest upload in ms (-1 if there is none).
+         */
+        int64_t next_wait();
+};
+
+#endif
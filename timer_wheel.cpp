@@ -0,0 +1,202 @@
+/*
+ * @author Jakub Šuráň (xsuran07)
+ * @file timer_wheel.cpp
+ * @brief Implementation of hierarchical timing wheel.
+ */
+
+#include <algorithm>
+
+#include "timer_wheel.h"
+
+#define WHEEL_MASK (WHEEL_SLOTS - 1)
+#define WHEEL_SPAN(level) (1LL << (WHEEL_BITS * (level))) // number of ticks covered by one slot of level
+
+// HELPERS
+
+static inline uint64_t rotate_right(uint64_t x, int n)
+{
+    return (n == 0)? x : (x >> n) | (x << (64 - n));
+}
+
+// STATIC METHODS
+
+void Timer_wheel::init_timer(wheel_timer_t *timer, void *data)
+{
+    timer->prev = timer->next = nullptr;
+    timer->expires = 0;
+    timer->slot = -1;
+    timer->data = data;
+}
+
+// PUBLIC INSTANCE METHODS
+
+// constructor
+Timer_wheel::Timer_wheel(int64_t now)
+{
+    this->curr = now;
+    this->count = 0;
+
+    for(int i = 0; i < WHEEL_LEVELS; i++) {
+        this->occupied[i] = 0;
+    }
+
+    for(int i = 0; i < WHEEL_LEVELS * WHEEL_SLOTS; i++) {
+        this->slots[i].prev = this->slots[i].next = &this->slots[i];
+        this->slots[i].slot = i;
+    }
+}
+
+void Timer_wheel::schedule(wheel_timer_t *timer, int64_t expires)
+{
+    if(timer->slot >= 0) {
+        unlink(timer);
+    }
+
+    timer->expires = expires;
+    link(timer);
+}
+
+void Timer_wheel::cancel(wheel_timer_t *timer)
+{
+    if(timer->slot >= 0) {
+        unlink(timer);
+    }
+}
+
+void Timer_wheel::advance(int64_t now, std::vector<wheel_timer_t *> &expired)
+{
+    while(this->curr <= now) {
+        int64_t next = next_expiry();
+
+        // nothing happens till now => skip all ticks at once
+        if(next < 0 || next > now) {
+            this->curr = now + 1;
+            break;
+        }
+
+        this->curr = next;
+        int index = this->curr & WHEEL_MASK;
+
+        // beginning of new round => bring timers from higher levels down
+        if(index == 0) {
+            for(int level = 1; level < WHEEL_LEVELS; level++) {
+                int higher = (this->curr >> (WHEEL_BITS * level)) & WHEEL_MASK;
+
+                cascade(level, higher);
+                if(higher != 0) {
+                    break;
+                }
+            }
+        }
+
+        wheel_timer_t *head = &this->slots[index];
+
+        while(head->next != head) {
+            wheel_timer_t *timer = head->next;
+
+            unlink(timer);
+            expired.push_back(timer);
+        }
+
+        this->curr++;
+    }
+}
+
+int64_t Timer_wheel::next_expiry()
+{
+    int64_t next = -1;
+
+    if(this->count == 0) {
+        return -1;
+    }
+
+    for(int level = 0; level < WHEEL_LEVELS; level++) {
+        if(this->occupied[level] == 0) {
+            continue;
+        }
+
+        // the first slot of level which is reached from now on
+        int64_t unit = (this->curr + WHEEL_SPAN(level) - 1) >> (WHEEL_BITS * level);
+        uint64_t rotated = rotate_right(this->occupied[level], unit & WHEEL_MASK);
+        int64_t tick = (unit + __builtin_ctzll(rotated)) << (WHEEL_BITS * level);
+
+        if(next < 0 || tick < next) {
+            next = tick;
+        }
+    }
+
+    return next;
+}
+
+// PRIVATE INSTANCE METHODS
+
+void Timer_wheel::link(wheel_timer_t *timer)
+{
+    int64_t expires = std::max(timer->expires, this->curr);
+    int64_t delta = expires - this->curr;
+    int level = 0;
+
+    while(level < WHEEL_LEVELS - 1 && delta >= WHEEL_SPAN(level + 1)) {
+        level++;
+    }
+
+    // too distant deadline waits in the last slot and is placed again after cascading
+    if(delta >= WHEEL_SPAN(WHEEL_LEVELS)) {
+        expires = this->curr + WHEEL_SPAN(WHEEL_LEVELS) - 1;
+    }
+
+    int index = (expires >> (WHEEL_BITS * level)) & WHEEL_MASK;
+    wheel_timer_t *head = &this->slots[level * WHEEL_SLOTS + index];
+
+    timer->prev = head->prev;
+    timer->next = head;
+    head->prev->next = timer;
+    head->prev = timer;
+    timer->slot = head->slot;
+
+    this->occupied[level] |= 1ULL << index;
+    this->count++;
+}
+
+void Timer_wheel::unlink(wheel_timer_t *timer)
+{
+    wheel_timer_t *head = &this->slots[timer->slot];
+
+    timer->prev->next = timer->next;
+    timer->next->prev = timer->prev;
+
+    if(head->next == head) {
+        this->occupied[timer->slot / WHEEL_SLOTS] &= ~(1ULL << (timer->slot % WHEEL_SLOTS));
+    }
+
+    timer->prev = timer->next = nullptr;
+    timer->slot = -1;
+    this->count--;
+}
+
+void Timer_wheel::cascade(int level, int index)
+{
+    wheel_timer_t *head = &this->slots[level * WHEEL_SLOTS + index];
+    wheel_timer_t pending;
+
+    if(head->next == head) {
+        return;
+    }
+
+    // detach whole list first, so no timer can be linked back into it
+    pending.next = head->next;
+    pending.prev = head->prev;
+    pending.next->prev = &pending;
+    pending.prev->next = &pending;
+    head->next = head->prev = head;
+    this->occupied[level] &= ~(1ULL << index);
+
+    while(pending.next != &pending) {
+        wheel_timer_t *timer = pending.next;
+
+        pending.next = timer->next;
+        timer->next->prev = &pending;
+        this->count--;
+        link(timer);
+    }
+}
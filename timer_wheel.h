@@ -0,0 +1,109 @@
+/*
+ * @author Jakub Šuráň (xsuran07)
+ * @file timer_wheel.h
+ * @brief Interface of hierarchical timing wheel.
+ */
+
+#ifndef __TIMER_WHEEL_H_
+#define __TIMER_WHEEL_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+#define WHEEL_BITS 6
+#define WHEEL_SLOTS (1 << WHEEL_BITS) // slots on one level
+#define WHEEL_LEVELS 4 // 64 ms, ~4 s, ~4.5 min, ~4.7 h
+
+/**
+ * @brief Timer which can be scheduled in timing wheel. Timer is embedded
+ * into its owner, so scheduling doesn't allocate anything.
+ */
+typedef struct wheel_timer_s {
+    struct wheel_timer_s *prev;
+    struct wheel_timer_s *next;
+    int64_t expires; // deadline in ms
+    int slot; // index of slot timer is linked into, -1 if it isn't scheduled
+    void *data; // owner of timer
+} wheel_timer_t;
+
+/**
+ * @brief Hierarchical timing wheel with millisecond resolution. Scheduling,
+ * rescheduling and canceling of timer is O(1). Timers from higher levels are
+ * cascaded into lower ones when time reaches their slots.
+ */
+class Timer_wheel
+{
+    private:
+        wheel_timer_t slots[WHEEL_LEVELS * WHEEL_SLOTS]; // heads of circular lists
+        uint64_t occupied[WHEEL_LEVELS]; // bitmaps of non-empty slots
+        int64_t curr; // last processed tick
+        size_t count;
+
+    public:
+        /**
+         * @brief Constructor.
+         * @param now Current time in ms.
+         */
+        Timer_wheel(int64_t now);
+
+        Timer_wheel(const Timer_wheel &) = delete;
+        Timer_wheel &operator=(const Timer_wheel &) = delete;
+
+        /**
+         * @brief Static method. Prepares timer to be used with wheel.
+         * @param timer Timer to prepare.
+         * @param data Owner of timer.
+         */
+        static void init_timer(wheel_timer_t *timer, void *data);
+
+        /**
+         * @brief Schedules timer to given deadline (already scheduled timer is moved).
+         * @param timer Timer to schedule.
+         * @param expires Deadline in ms.
+         */
+        void schedule(wheel_timer_t *timer, int64_t expires);
+
+        /**
+         * @brief Removes timer from wheel (nothing happens if timer isn't scheduled).
+         */
+        void cancel(wheel_timer_t *timer);
+
+        /**
+         * @brief Moves time of wheel forward and collects expired timers
+         * (they are removed from wheel).
+         * @param now Current time in ms.
+         * @param expired Vector to append expired timers to.
+         */
+        void advance(int64_t now, std::vector<wheel_timer_t *> &expired);
+
+        /**
+         * @brief Computes time when wheel has to be advanced next time. Result may
+         * be earlier than the nearest deadline (when timers are cascaded), never later.
+         * @returns time in ms or -1 if there are no scheduled timers.
+         */
+        int64_t next_expiry();
+
+        /**
+         * @brief Getter for number of scheduled timers.
+         */
+        size_t size() { return this->count; };
+
+    private:
+        /**
+         * @brief Links timer into slot corresponding to its deadline.
+         */
+        void link(wheel_timer_t *timer);
+
+        /**
+         * @brief Unlinks timer from its slot.
+         */
+        void unlink(wheel_timer_t *timer);
+
+        /**
+         * @brief Moves all timers from given slot of higher level into lower levels.
+         */
+        void cascade(int level, int index);
+};
+
+#endif